@@ -0,0 +1,146 @@
+#include "arena.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "job_system.h"
+
+
+bool init_arena(ARENA *arena, size_t size) {
+	arena->base = (unsigned char *)aligned_alloc(ARENA_ALIGN, (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1));
+	arena->size = arena->base ? size : 0;
+	arena->used = 0;
+	arena->stats = {};
+	if (!arena->base) {
+		fprintf(stderr, "ERROR:ARENA:ALLOCATION:FAILED\n");
+		return false;
+	}
+	return true;
+}
+
+
+void destroy_arena(ARENA *arena) {
+	free(arena->base);
+	arena->base = NULL;
+	arena->size = 0;
+	arena->used = 0;
+}
+
+
+void *arena_alloc(ARENA *arena, size_t size, size_t align) {
+	uintptr_t start = ((uintptr_t)arena->base + arena->used + align - 1) & ~(uintptr_t)(align - 1);
+	size_t end = start - (uintptr_t)arena->base + size;
+	if (end > arena->size) {
+		arena->stats.failures++;
+		return NULL;
+	}
+	arena->used = end;
+	arena->stats.allocations++;
+	if (end > arena->stats.high_water) {
+		arena->stats.high_water = end;
+	}
+	return (void *)start;
+}
+
+
+void reset_arena(ARENA *arena) {
+	arena->used = 0;
+	arena->stats.allocations = 0;
+	arena->stats.failures = 0;
+}
+
+
+size_t arena_mark(const ARENA *arena) {
+	return arena->used;
+}
+
+
+void arena_rewind(ARENA *arena, size_t mark) {
+	if (mark < arena->used) {
+		arena->used = mark;
+	}
+}
+
+
+// a frame's worker arenas share one block, each starting on its own cache line
+bool init_frame_arenas(FRAME_ARENAS *frames, int frames_in_flight, int worker_count, size_t worker_size) {
+	if (worker_count <= 0) {
+		worker_count = get_worker_count() > 0 ? get_worker_count() : 1;
+	}
+	if (frames_in_flight < 1) frames_in_flight = 1;
+	if (frames_in_flight > MAX_FRAMES_IN_FLIGHT) frames_in_flight = MAX_FRAMES_IN_FLIGHT;
+	worker_size = (worker_size + 63) & ~(size_t)63;
+
+	frames->frames_in_flight = frames_in_flight;
+	frames->worker_count = worker_count;
+	frames->current = 0;
+	for (int f = 0; f < MAX_FRAMES_IN_FLIGHT; f++) {
+		frames->arenas[f] = NULL;
+		frames->blocks[f] = NULL;
+	}
+	for (int f = 0; f < frames_in_flight; f++) {
+		frames->blocks[f] = (unsigned char *)aligned_alloc(64, worker_size * worker_count);
+		if (!frames->blocks[f]) {
+			fprintf(stderr, "ERROR:ARENA:FRAME:ALLOCATION:FAILED\n");
+			destroy_frame_arenas(frames);
+			return false;
+		}
+		frames->arenas[f] = new ARENA[worker_count];
+		for (int w = 0; w < worker_count; w++) {
+			frames->arenas[f][w].base = frames->blocks[f] + w * worker_size;
+			frames->arenas[f][w].size = worker_size;
+			frames->arenas[f][w].used = 0;
+			frames->arenas[f][w].stats = {};
+		}
+	}
+	return true;
+}
+
+
+void destroy_frame_arenas(FRAME_ARENAS *frames) {
+	for (int f = 0; f < MAX_FRAMES_IN_FLIGHT; f++) {
+		delete[] frames->arenas[f];
+		free(frames->blocks[f]);
+		frames->arenas[f] = NULL;
+		frames->blocks[f] = NULL;
+	}
+	frames->frames_in_flight = 0;
+	frames->worker_count = 0;
+}
+
+
+void begin_frame_arenas(FRAME_ARENAS *frames) {
+	frames->current = (frames->current + 1) % frames->frames_in_flight;
+	for (int w = 0; w < frames->worker_count; w++) {
+		reset_arena(&frames->arenas[frames->current][w]);
+	}
+}
+
+
+void *frame_alloc(FRAME_ARENAS *frames, size_t size, size_t align) {
+	int worker = get_worker_index();
+	if (worker < 0 || worker >= frames->worker_count) {
+		fprintf(stderr, "ERROR:ARENA:FRAME:NOT_A_WORKER\n");
+		return NULL;
+	}
+	void *memory = arena_alloc(&frames->arenas[frames->current][worker], size, align);
+	if (!memory) {
+		fprintf(stderr, "ERROR:ARENA:FRAME:FULL\n");
+	}
+	return memory;
+}
+
+
+ARENA_STATS get_frame_arena_stats(const FRAME_ARENAS *frames) {
+	ARENA_STATS stats = {};
+	for (int w = 0; w < frames->worker_count; w++) {
+		const ARENA_STATS *current = &frames->arenas[frames->current][w].stats;
+		stats.allocations += current->allocations;
+		stats.failures += current->failures;
+		for (int f = 0; f < frames->frames_in_flight; f++) {
+			size_t high_water = frames->arenas[f][w].stats.high_water;
+			stats.high_water = high_water > stats.high_water ? high_water : stats.high_water;
+		}
+	}
+	return stats;
+}
@@ -0,0 +1,60 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// default arena values
+const size_t ARENA_ALIGN			= 16;
+const int MAX_FRAMES_IN_FLIGHT		= 3;
+const size_t FRAME_ARENA_SIZE		= 1 << 20;	// per worker per frame
+
+typedef struct {
+	int allocations;		// since the last reset
+	int failures;			// allocations that did not fit, since the last reset
+	size_t high_water;		// most bytes ever in use at once
+} ARENA_STATS;
+
+// Linear allocator over one block: allocating bumps an offset, nothing is
+// freed on its own, and a reset or a rewind to a mark drops everything after it
+typedef struct {
+	unsigned char *base;
+	size_t size;
+	size_t used;
+	ARENA_STATS stats;
+} ARENA;
+
+// One arena per worker for each frame in flight. A frame's data is allocated
+// while it is built and stays valid until the same slot comes round again,
+// frames_in_flight frames later, by which time the render thread is done with it.
+// Each worker allocates from its own arena, so jobs need no locking
+typedef struct {
+	int frames_in_flight;
+	int worker_count;
+	int current;
+	ARENA *arenas[MAX_FRAMES_IN_FLIGHT];	// worker_count each
+	unsigned char *blocks[MAX_FRAMES_IN_FLIGHT];
+} FRAME_ARENAS;
+
+
+bool init_arena(ARENA *arena, size_t size);
+void destroy_arena(ARENA *arena);
+// NULL when it does not fit; align is a power of two
+void *arena_alloc(ARENA *arena, size_t size, size_t align = ARENA_ALIGN);
+void reset_arena(ARENA *arena);
+size_t arena_mark(const ARENA *arena);
+void arena_rewind(ARENA *arena, size_t mark);
+
+// worker_count as in init_job_system, 0 for get_worker_count()
+bool init_frame_arenas(FRAME_ARENAS *frames, int frames_in_flight, int worker_count = 0,
+		size_t worker_size = FRAME_ARENA_SIZE);
+void destroy_frame_arenas(FRAME_ARENAS *frames);
+// moves to the next slot and resets it; call once the frame that last used
+// that slot is no longer read by anyone
+void begin_frame_arenas(FRAME_ARENAS *frames);
+// from the calling worker's arena for the current frame; NULL on other threads
+// or when the arena is full
+void *frame_alloc(FRAME_ARENAS *frames, size_t size, size_t align = ARENA_ALIGN);
+// summed over the current frame's worker arenas, high water over every frame
+ARENA_STATS get_frame_arena_stats(const FRAME_ARENAS *frames);
+
+#endif
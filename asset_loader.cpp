@@ -0,0 +1,291 @@
+#include "asset_loader.h"
+#include <glad/glad.h>
+#include <stdio.h>
+
+#include "frame_pacer.h"
+#include "shader.h"
+#include "texture.h"
+
+
+// once queued an I/O thread may resume the coroutine and free the frame this
+// awaiter lives in, so only the local copy is touched after the push
+void IO_AWAITER::await_suspend(std::coroutine_handle<> handle) {
+	ASSET_LOADER *target = loader;
+	{
+		std::lock_guard<std::mutex> lock(target->io_mutex);
+		target->io_queue.push_back(handle);
+	}
+	target->io_ready.notify_one();
+}
+
+
+static void file_read_done(FILE_READ *read) {
+	FILE_AWAITER *awaiter = (FILE_AWAITER *)read->user;
+	IO_AWAITER { awaiter->loader }.await_suspend(awaiter->handle);
+}
+
+
+// the completion may resume us on another thread before this returns,
+// so nothing here touches the awaiter after submitting
+void FILE_AWAITER::await_suspend(std::coroutine_handle<> coroutine) {
+	handle = coroutine;
+	read.callback = file_read_done;
+	read.user = this;
+	submit_file_read(&loader->reader, &read);
+}
+
+
+static void run_awaited_job(void *data) {
+	WORKER_AWAITER *awaiter = (WORKER_AWAITER *)data;
+	awaiter->func(awaiter->data);
+	IO_AWAITER { awaiter->loader }.await_suspend(awaiter->handle);
+}
+
+
+// as with files, the job may resume us before run_jobs returns
+void WORKER_AWAITER::await_suspend(std::coroutine_handle<> coroutine) {
+	handle = coroutine;
+	JOB_DECL job = { run_awaited_job, this };
+	run_jobs(&job, 1, &loader->worker_jobs);
+}
+
+
+void GL_AWAITER::await_suspend(std::coroutine_handle<> handle) {
+	std::lock_guard<std::mutex> lock(loader->gl_mutex);
+	loader->gl_queue.push_back(handle);
+}
+
+
+static void io_thread_main(ASSET_LOADER *loader) {
+	while (true) {
+		std::coroutine_handle<> handle;
+		{
+			std::unique_lock<std::mutex> lock(loader->io_mutex);
+			loader->io_ready.wait(lock, [loader] { return loader->stopping || !loader->io_queue.empty(); });
+			if (loader->stopping) {
+				return;
+			}
+			handle = loader->io_queue.front();
+			loader->io_queue.pop_front();
+		}
+		handle.resume();
+	}
+}
+
+
+bool init_asset_loader(ASSET_LOADER *loader, double start_time, int io_threads) {
+	if (!init_file_reader(&loader->reader)) {
+		fprintf(stderr, "ERROR:ASSET_LOADER:FILE_READER:FAILED\n");
+		return false;
+	}
+	loader->stopping = false;
+	loader->pending.store(0);
+	loader->worker_jobs.value.store(0);
+	loader->start_time = start_time;
+	loader->all_resident_time = 0.0;
+
+	for (int i = 0; i < io_threads; i++) {
+		loader->io_threads.emplace_back(io_thread_main, loader);
+	}
+	return true;
+}
+
+
+// loads still in flight are dropped; destroying a suspended frame frees
+// whatever it had read or decoded
+void shutdown_asset_loader(ASSET_LOADER *loader) {
+	{
+		std::lock_guard<std::mutex> lock(loader->io_mutex);
+		loader->stopping = true;
+	}
+	loader->io_ready.notify_all();
+	for (std::thread &thread : loader->io_threads) {
+		thread.join();
+	}
+	loader->io_threads.clear();
+	// jobs and reads finishing now queue their coroutines, which nothing
+	// resumes; once both have drained every suspended frame is in a queue
+	wait_for_counter(&loader->worker_jobs);
+	shutdown_file_reader(&loader->reader);
+
+	for (std::coroutine_handle<> handle : loader->io_queue) handle.destroy();
+	for (std::coroutine_handle<> handle : loader->gl_queue) handle.destroy();
+	loader->io_queue.clear();
+	loader->gl_queue.clear();
+}
+
+
+// GL thread only: resume queued uploads until the queue drains or the budget runs out
+int pump_gl_queue(ASSET_LOADER *loader, double budget) {
+	double deadline = pacer_now() + budget;
+	int resumed = 0;
+
+	while (true) {
+		std::coroutine_handle<> handle;
+		{
+			std::lock_guard<std::mutex> lock(loader->gl_mutex);
+			if (loader->gl_queue.empty()) {
+				break;
+			}
+			handle = loader->gl_queue.front();
+			loader->gl_queue.pop_front();
+		}
+
+		handle.resume();
+		resumed++;
+		if (pacer_now() > deadline) {
+			break;
+		}
+	}
+
+	return resumed;
+}
+
+
+bool assets_resident(const ASSET_LOADER *loader) {
+	return loader->pending.load(std::memory_order_acquire) == 0;
+}
+
+
+void finish_asset(ASSET_LOADER *loader) {
+	if (loader->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		loader->all_resident_time = pacer_now() - loader->start_time;
+	}
+}
+
+
+ASSET_TASK load_texture_async(ASSET_LOADER *loader, unsigned int texture, int unit,
+		std::string path, bool srgb) {
+	loader->pending.fetch_add(1, std::memory_order_relaxed);
+
+	FILE_READ file = co_await read_file_async(loader, path.c_str());
+	if (file.error) {
+		fprintf(stderr, "Failed to load texture %s\n", path.c_str());
+		release_file_read(&loader->reader, &file);
+		co_await resume_on_gl_thread(loader);
+		finish_asset(loader);
+		co_return;
+	}
+
+	// decode straight out of the reader's buffer
+	int width, height, channels;
+	OWNED_PIXELS pixels(decode_texture(file.data, (int)file.size, &width, &height, &channels),
+			free_texture_pixels);
+	release_file_read(&loader->reader, &file);
+
+	co_await resume_on_gl_thread(loader);
+	if (pixels) {
+		glActiveTexture(GL_TEXTURE0 + unit);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		upload_texture(pixels.get(), width, height, channels, srgb);
+	} else {
+		fprintf(stderr, "Failed to decode texture %s\n", path.c_str());
+	}
+	finish_asset(loader);
+}
+
+
+ASSET_TASK load_texture_layer_async(ASSET_LOADER *loader, TEXTURE_ARRAY *array, int layer,
+		std::string path) {
+	loader->pending.fetch_add(1, std::memory_order_relaxed);
+
+	FILE_READ file = co_await read_file_async(loader, path.c_str());
+	MIP_CHAIN chain;
+	MIP_BUILD build = { &chain, NULL, 0, 0, 0, false };
+	OWNED_PIXELS pixels(NULL, free_texture_pixels);
+	if (file.error) {
+		fprintf(stderr, "Failed to load texture %s\n", path.c_str());
+	} else {
+		pixels.reset(decode_texture(file.data, (int)file.size, &build.width, &build.height, &build.channels));
+		if (!pixels) {
+			fprintf(stderr, "Failed to decode texture %s\n", path.c_str());
+		}
+	}
+	release_file_read(&loader->reader, &file);
+
+	// the mips are filtered on the workers too, so the GL thread only copies
+	if (pixels) {
+		build.pixels = pixels.get();
+		co_await run_on_workers(loader, build_mip_chain_job, &build);
+		pixels.reset();
+	}
+
+	co_await resume_on_gl_thread(loader);
+	if (build.built) {
+		upload_texture_layer(array, layer, &chain);
+	}
+	finish_asset(loader);
+}
+
+
+ASSET_TASK load_atlas_image_async(ASSET_LOADER *loader, TEXTURE_ATLAS *atlas, ATLAS_REGION *region,
+		std::string path) {
+	loader->pending.fetch_add(1, std::memory_order_relaxed);
+
+	FILE_READ file = co_await read_file_async(loader, path.c_str());
+	int width = 0, height = 0, channels = 0;
+	OWNED_PIXELS image(NULL, free_atlas_image);
+	if (file.error) {
+		fprintf(stderr, "Failed to load texture %s\n", path.c_str());
+	} else {
+		unsigned char *pixels = decode_texture(file.data, (int)file.size, &width, &height, &channels);
+		if (pixels) {
+			// the gutter is built here so the GL thread only uploads
+			image.reset(expand_atlas_image(pixels, width, height, channels, atlas->padding));
+			free_texture_pixels(pixels);
+		} else {
+			fprintf(stderr, "Failed to decode texture %s\n", path.c_str());
+		}
+	}
+	release_file_read(&loader->reader, &file);
+
+	co_await resume_on_gl_thread(loader);
+	if (image) {
+		add_atlas_image(atlas, image.get(), width, height, region);
+	}
+	finish_asset(loader);
+}
+
+
+static void apply_shader_header(std::string *source, const std::string &header) {
+	if (header.empty()) {
+		return;
+	}
+	size_t line_end = source->find('\n');
+	source->replace(0, line_end == std::string::npos ? source->size() : line_end + 1, header);
+}
+
+
+ASSET_TASK load_program_async(ASSET_LOADER *loader, unsigned int *program,
+		std::string vert_path, std::string frag_path, std::string header) {
+	loader->pending.fetch_add(1, std::memory_order_relaxed);
+
+	FILE_READ vert_file = co_await read_file_async(loader, vert_path.c_str());
+	FILE_READ frag_file = co_await read_file_async(loader, frag_path.c_str());
+
+	// GL wants null-terminated source
+	bool loaded = !vert_file.error && !frag_file.error;
+	std::string vert_source;
+	std::string frag_source;
+	if (loaded) {
+		vert_source.assign((const char *)vert_file.data, vert_file.size);
+		frag_source.assign((const char *)frag_file.data, frag_file.size);
+		apply_shader_header(&vert_source, header);
+		apply_shader_header(&frag_source, header);
+	} else {
+		fprintf(stderr, "ERROR:LOADING:SHADER:FAILED\n");
+	}
+	release_file_read(&loader->reader, &vert_file);
+	release_file_read(&loader->reader, &frag_file);
+
+	co_await resume_on_gl_thread(loader);
+	if (loaded) {
+		unsigned int vert_shader = compile_vertex_shader(vert_source.c_str());
+		unsigned int frag_shader = compile_fragment_shader(frag_source.c_str());
+		*program = create_shader_program(vert_shader, frag_shader);
+		glDeleteShader(vert_shader);
+		glDeleteShader(frag_shader);
+	}
+
+	finish_asset(loader);
+}
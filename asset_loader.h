@@ -0,0 +1,145 @@
+#ifndef ASSET_LOADER_H
+#define ASSET_LOADER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "file_reader.h"
+#include "job_system.h"
+#include "texture_array.h"
+#include "texture_atlas.h"
+
+// default loader values
+const int IO_THREADS			= 2;
+const double GL_UPLOAD_BUDGET	= 0.004;	// seconds of GL-thread work per frame
+
+// Asset loads are coroutines that hop between three places: the file reader,
+// which resumes them once their bytes are in memory, a CPU pool for decoding,
+// and the GL thread, which resumes queued continuations from pump_gl_queue
+typedef struct {
+	FILE_READER reader;
+
+	std::vector<std::thread> io_threads;
+	std::deque<std::coroutine_handle<>> io_queue;
+	std::mutex io_mutex;
+	std::condition_variable io_ready;
+	bool stopping;
+
+	std::deque<std::coroutine_handle<>> gl_queue;
+	std::mutex gl_mutex;
+
+	JOB_COUNTER worker_jobs;	// run_on_workers jobs not yet finished
+
+	// metrics, in seconds since start_time
+	std::atomic<int> pending;
+	double start_time;
+	double all_resident_time;
+} ASSET_LOADER;
+
+// decoded pixels held across a suspension, with the function that frees them;
+// a frame destroyed at shutdown frees them too
+typedef std::unique_ptr<unsigned char, void (*)(unsigned char *)> OWNED_PIXELS;
+
+// fire-and-forget coroutine, the frame frees itself when the load finishes
+struct ASSET_TASK {
+	struct promise_type {
+		ASSET_TASK get_return_object() { return {}; }
+		std::suspend_never initial_suspend() noexcept { return {}; }
+		std::suspend_never final_suspend() noexcept { return {}; }
+		void return_void() {}
+		void unhandled_exception() { std::terminate(); }
+	};
+};
+
+struct IO_AWAITER {
+	ASSET_LOADER *loader;
+	bool await_ready() { return false; }
+	void await_suspend(std::coroutine_handle<> handle);
+	void await_resume() {}
+};
+
+// suspends until the whole file is in memory, then resumes on an I/O thread;
+// the result must be handed back with release_file_read. A frame destroyed
+// before it resumes releases the data itself
+struct FILE_AWAITER {
+	ASSET_LOADER *loader;
+	FILE_READ read;
+	std::coroutine_handle<> handle;
+	bool await_ready() { return false; }
+	void await_suspend(std::coroutine_handle<> handle);
+	FILE_READ await_resume() {
+		FILE_READ done = read;
+		read.data = NULL;
+		return done;
+	}
+	~FILE_AWAITER() {
+		if (read.data) {
+			release_file_read(&loader->reader, &read);
+		}
+	}
+};
+
+// suspends while func(data) runs as a job on the workers, where parallel_for
+// below it spreads out, then resumes on an I/O thread
+struct WORKER_AWAITER {
+	ASSET_LOADER *loader;
+	JOB_FUNC func;
+	void *data;
+	std::coroutine_handle<> handle;
+	bool await_ready() { return false; }
+	void await_suspend(std::coroutine_handle<> handle);
+	void await_resume() {}
+};
+
+struct GL_AWAITER {
+	ASSET_LOADER *loader;
+	bool await_ready() { return false; }
+	void await_suspend(std::coroutine_handle<> handle);
+	void await_resume() {}
+};
+
+inline IO_AWAITER resume_on_io_thread(ASSET_LOADER *loader) { return { loader }; }
+inline GL_AWAITER resume_on_gl_thread(ASSET_LOADER *loader) { return { loader }; }
+inline WORKER_AWAITER run_on_workers(ASSET_LOADER *loader, JOB_FUNC func, void *data) {
+	return { loader, func, data, {} };
+}
+inline FILE_AWAITER read_file_async(ASSET_LOADER *loader, const char *path) {
+	FILE_AWAITER awaiter = {};
+	awaiter.loader = loader;
+	awaiter.read.path = path;
+	return awaiter;
+}
+
+
+// false if the file reader could not start; no threads are left running
+bool init_asset_loader(ASSET_LOADER *loader, double start_time, int io_threads = IO_THREADS);
+void shutdown_asset_loader(ASSET_LOADER *loader);
+int pump_gl_queue(ASSET_LOADER *loader, double budget = GL_UPLOAD_BUDGET);
+bool assets_resident(const ASSET_LOADER *loader);
+// loads built on the loader elsewhere add to pending when they start and
+// call this on the GL thread once they are done, failed or dropped
+void finish_asset(ASSET_LOADER *loader);
+
+// texture must already exist; it is uploaded through the given texture unit
+ASSET_TASK load_texture_async(ASSET_LOADER *loader, unsigned int texture, int unit,
+		std::string path, bool srgb = false);
+// layer must come from reserve_texture_layer
+ASSET_TASK load_texture_layer_async(ASSET_LOADER *loader, TEXTURE_ARRAY *array, int layer,
+		std::string path);
+// *region is filled in on the GL thread; the page mips update on the next flush_texture_atlas
+ASSET_TASK load_atlas_image_async(ASSET_LOADER *loader, TEXTURE_ATLAS *atlas, ATLAS_REGION *region,
+		std::string path);
+// *program stays 0 until the program is linked on the GL thread; a non-empty
+// header replaces the #version line of both stages
+ASSET_TASK load_program_async(ASSET_LOADER *loader, unsigned int *program,
+		std::string vert_path, std::string frag_path, std::string header = "");
+
+#endif
@@ -0,0 +1,117 @@
+#include "atlas_packer.h"
+#include <limits.h>
+#include <stddef.h>
+
+
+void init_skyline_packer(SKYLINE_PACKER *packer, int width, int height) {
+	packer->width = width;
+	packer->height = height;
+	reset_skyline_packer(packer);
+}
+
+
+void reset_skyline_packer(SKYLINE_PACKER *packer) {
+	packer->skyline.clear();
+	packer->skyline.push_back({ 0, 0, packer->width });
+	packer->used_area = 0;
+}
+
+
+// top of a width-wide rectangle resting on the skyline from node index on,
+// or -1 if it would stick out of the packer
+static int fit_at(const SKYLINE_PACKER *packer, size_t index, int width, int height, int *waste) {
+	const std::vector<SKYLINE_NODE> &skyline = packer->skyline;
+	int x = skyline[index].x;
+	if (x + width > packer->width) {
+		return -1;
+	}
+
+	int y = 0;
+	int remaining = width;
+	for (size_t i = index; remaining > 0; i++) {
+		if (skyline[i].y > y) y = skyline[i].y;
+		remaining -= skyline[i].width;
+	}
+	if (y + height > packer->height) {
+		return -1;
+	}
+
+	// area trapped between the rectangle and the segments below it
+	*waste = 0;
+	remaining = width;
+	for (size_t i = index; remaining > 0; i++) {
+		int span = skyline[i].width < remaining ? skyline[i].width : remaining;
+		*waste += (y - skyline[i].y) * span;
+		remaining -= span;
+	}
+	return y;
+}
+
+
+bool skyline_pack(SKYLINE_PACKER *packer, int width, int height, int *x, int *y) {
+	std::vector<SKYLINE_NODE> &skyline = packer->skyline;
+	if (width <= 0 || height <= 0) {
+		return false;
+	}
+
+	size_t best_index = 0;
+	int best_top = INT_MAX;
+	int best_waste = INT_MAX;
+	int best_y = 0;
+	bool found = false;
+	for (size_t i = 0; i < skyline.size(); i++) {
+		int waste;
+		int fit_y = fit_at(packer, i, width, height, &waste);
+		if (fit_y < 0) {
+			continue;
+		}
+		int top = fit_y + height;
+		if (top < best_top || (top == best_top && waste < best_waste)) {
+			best_index = i;
+			best_top = top;
+			best_waste = waste;
+			best_y = fit_y;
+			found = true;
+		}
+	}
+	if (!found) {
+		return false;
+	}
+
+	// the new segment covers [x, x + width); shrink or drop the ones it shadows
+	SKYLINE_NODE node = { skyline[best_index].x, best_y + height, width };
+	skyline.insert(skyline.begin() + best_index, node);
+	int right = node.x + node.width;
+	for (size_t i = best_index + 1; i < skyline.size();) {
+		if (skyline[i].x >= right) {
+			break;
+		}
+		int shadowed = right - skyline[i].x;
+		if (shadowed < skyline[i].width) {
+			skyline[i].x += shadowed;
+			skyline[i].width -= shadowed;
+			break;
+		}
+		skyline.erase(skyline.begin() + i);
+	}
+
+	// merge neighbours at the same height so the list stays short
+	for (size_t i = 0; i + 1 < skyline.size();) {
+		if (skyline[i].y == skyline[i + 1].y) {
+			skyline[i].width += skyline[i + 1].width;
+			skyline.erase(skyline.begin() + i + 1);
+		} else {
+			i++;
+		}
+	}
+
+	*x = node.x;
+	*y = best_y;
+	packer->used_area += (long long)width * height;
+	return true;
+}
+
+
+float get_packer_occupancy(const SKYLINE_PACKER *packer) {
+	return (float)((double)packer->used_area / ((double)packer->width * packer->height));
+}
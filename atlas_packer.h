@@ -0,0 +1,30 @@
+#ifndef ATLAS_PACKER_H
+#define ATLAS_PACKER_H
+
+#include <vector>
+
+// Skyline bottom-left bin packer. The packed area is described by its top edge,
+// a list of horizontal segments; each rectangle goes where it leaves the lowest
+// top, ties broken by the least wasted area under it. Pure CPU, no GL.
+typedef struct {
+	int x;
+	int y;
+	int width;
+} SKYLINE_NODE;
+
+typedef struct {
+	int width;
+	int height;
+	std::vector<SKYLINE_NODE> skyline;
+	long long used_area;
+} SKYLINE_PACKER;
+
+
+void init_skyline_packer(SKYLINE_PACKER *packer, int width, int height);
+void reset_skyline_packer(SKYLINE_PACKER *packer);
+// false when the rectangle does not fit anywhere
+bool skyline_pack(SKYLINE_PACKER *packer, int width, int height, int *x, int *y);
+// used area over total area, 0..1
+float get_packer_occupancy(const SKYLINE_PACKER *packer);
+
+#endif
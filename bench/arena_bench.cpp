@@ -0,0 +1,303 @@
+// frame allocation benchmark: heap calls per frame in a headless copy of the
+// main thread's frame (move 1% of the scene, update it, run the entity
+// systems, size the draw list to the frame, cull two views), first the way it
+// is done without arenas (draw lists in vectors, parallel_for batch lists from
+// new[]) and then with the frame arenas and the job system's worker scratch.
+// Then ECS chunk churn through the chunk pool against aligned_alloc/free.
+// Every malloc in the process is counted, libstdc++'s operator new included
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+#include "../arena.h"
+#include "../ecs.h"
+#include "../job_system.h"
+#include "../pool.h"
+#include "../render_view.h"
+#include "../scene_graph.h"
+
+const int PARENTS		= 200;
+const int CHILDREN		= 100;		// PARENTS * CHILDREN drawn entities
+const int WORKERS		= 4;
+const float MOVED_SHARE	= 0.01f;
+const int WARMUP		= 10;
+const int FRAMES		= 200;
+const int POOL_ROUNDS	= 2000;
+const int POOL_LIVE		= 64;		// chunks alive at once in the churn test
+
+static std::atomic<long> malloc_calls;
+static std::atomic<long> free_calls;
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *memory, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+void __libc_free(void *memory);
+
+void *malloc(size_t size) {
+	malloc_calls.fetch_add(1, std::memory_order_relaxed);
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+	malloc_calls.fetch_add(1, std::memory_order_relaxed);
+	return __libc_calloc(count, size);
+}
+
+void *realloc(void *memory, size_t size) {
+	malloc_calls.fetch_add(1, std::memory_order_relaxed);
+	return __libc_realloc(memory, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+	malloc_calls.fetch_add(1, std::memory_order_relaxed);
+	return __libc_memalign(alignment, size);
+}
+
+void *memalign(size_t alignment, size_t size) {
+	malloc_calls.fetch_add(1, std::memory_order_relaxed);
+	return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **memory, size_t alignment, size_t size) {
+	malloc_calls.fetch_add(1, std::memory_order_relaxed);
+	*memory = __libc_memalign(alignment, size);
+	return *memory ? 0 : 12;
+}
+
+void free(void *memory) {
+	if (memory) {
+		free_calls.fetch_add(1, std::memory_order_relaxed);
+	}
+	__libc_free(memory);
+}
+}
+
+// the frame's draw output, as the render system writes it
+typedef struct {
+	glm::mat4 model;
+	int texture_layers[2];
+	int mesh;
+} DRAW_OUT;
+
+typedef struct {
+	DRAW_OUT *draws;
+	glm::vec4 *bounds;
+} FRAME_OUTPUT;
+
+typedef struct {
+	SCENE_GRAPH graph;
+	ECS_WORLD world;
+	std::vector<int> nodes;
+	RENDER_VIEW views[2];
+} BENCH_SCENE;
+
+static BENCH_SCENE scene;
+static unsigned int seed = 12345;
+
+static unsigned int next_random() {
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+
+static double now_seconds() {
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+
+static void follow_nodes(void *data, const CHUNK_VIEW *chunk) {
+	TRANSFORM_COMPONENT *transforms = (TRANSFORM_COMPONENT *)chunk->components[COMPONENT_TRANSFORM];
+	BOUNDS_COMPONENT *bounds = (BOUNDS_COMPONENT *)chunk->components[COMPONENT_BOUNDS];
+	const SCENE_NODE_REF *nodes = (const SCENE_NODE_REF *)chunk->components[COMPONENT_SCENE_NODE];
+	for (int i = 0; i < chunk->count; i++) {
+		transforms[i].world = get_world_matrix(&scene.graph, nodes[i].node);
+		bounds[i].center = glm::vec3(transforms[i].world[3]);
+	}
+}
+
+
+static void fill_draws(void *data, const CHUNK_VIEW *chunk) {
+	FRAME_OUTPUT *out = (FRAME_OUTPUT *)data;
+	const TRANSFORM_COMPONENT *transforms = (const TRANSFORM_COMPONENT *)chunk->components[COMPONENT_TRANSFORM];
+	const MESH_REF *meshes = (const MESH_REF *)chunk->components[COMPONENT_MESH];
+	const MATERIAL_REF *materials = (const MATERIAL_REF *)chunk->components[COMPONENT_MATERIAL];
+	const BOUNDS_COMPONENT *bounds = (const BOUNDS_COMPONENT *)chunk->components[COMPONENT_BOUNDS];
+	for (int i = 0; i < chunk->count; i++) {
+		DRAW_OUT *draw = &out->draws[chunk->first + i];
+		draw->model = transforms[i].world;
+		draw->texture_layers[0] = materials[i].texture_layers[0];
+		draw->texture_layers[1] = materials[i].texture_layers[1];
+		draw->mesh = meshes[i].mesh;
+		out->bounds[chunk->first + i] = glm::vec4(bounds[i].center, bounds[i].radius);
+	}
+}
+
+
+static void build_scene() {
+	init_scene_graph(&scene.graph);
+	init_ecs_world(&scene.world);
+	const unsigned int mask = HAS_TRANSFORM | HAS_MESH | HAS_MATERIAL | HAS_BOUNDS | HAS_SCENE_NODE;
+	for (int p = 0; p < PARENTS; p++) {
+		NODE_TRANSFORM local = make_node_transform(glm::vec3((p % 20) * 10.0f, 0.0f, (p / 20) * -10.0f));
+		int parent = add_scene_node(&scene.graph, SCENE_NO_PARENT, &local);
+		for (int c = 0; c < CHILDREN; c++) {
+			local = make_node_transform(glm::vec3((c % 10) - 4.5f, (c / 10) - 4.5f, 0.0f));
+			int node = add_scene_node(&scene.graph, parent, &local);
+			scene.nodes.push_back(node);
+
+			ENTITY entity = create_entity(&scene.world, mask);
+			MESH_REF *mesh = (MESH_REF *)get_component(&scene.world, entity, COMPONENT_MESH);
+			mesh->mesh = c % 4;
+			BOUNDS_COMPONENT *bounds = (BOUNDS_COMPONENT *)get_component(&scene.world, entity, COMPONENT_BOUNDS);
+			bounds->radius = 0.8661f;
+			((SCENE_NODE_REF *)get_component(&scene.world, entity, COMPONENT_SCENE_NODE))->node = node;
+		}
+	}
+
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 500.0f);
+	glm::mat4 view = glm::lookAt(glm::vec3(100.0f, 40.0f, 60.0f), glm::vec3(100.0f, 0.0f, -50.0f),
+			glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 overview = glm::lookAt(glm::vec3(100.0f, 200.0f, -50.0f), glm::vec3(100.0f, 0.0f, -50.0f),
+			glm::vec3(0.0f, 0.0f, -1.0f));
+	scene.views[0] = make_render_view(view, projection, glm::vec4(0.0f, 0.0f, 0.5f, 1.0f));
+	scene.views[1] = make_render_view(overview, projection, glm::vec4(0.5f, 0.0f, 0.5f, 1.0f));
+}
+
+
+// one frame of the main thread's work; the draw list either comes from the
+// frame arenas or, as before, from vectors sized to the frame
+static int run_frame(FRAME_ARENAS *frames) {
+	int moved = (int)(scene.nodes.size() * MOVED_SHARE);
+	for (int m = 0; m < moved; m++) {
+		int node = scene.nodes[next_random() % scene.nodes.size()];
+		NODE_TRANSFORM local = *get_node_transform(&scene.graph, node);
+		local.rotation = glm::angleAxis((next_random() % 360) * 0.0174533f, glm::vec3(0.0f, 1.0f, 0.0f));
+		set_node_transform(&scene.graph, node, &local);
+	}
+	update_scene_graph(&scene.graph);
+	run_system(&scene.world, HAS_TRANSFORM | HAS_BOUNDS | HAS_SCENE_NODE, follow_nodes, NULL);
+
+	const unsigned int render_mask = HAS_TRANSFORM | HAS_MESH | HAS_MATERIAL | HAS_BOUNDS;
+	int count = count_entities(&scene.world, render_mask);
+	FRAME_OUTPUT out;
+	int visible = 0;
+	if (frames) {
+		begin_frame_arenas(frames);
+		out.draws = (DRAW_OUT *)frame_alloc(frames, count * sizeof(DRAW_OUT));
+		out.bounds = (glm::vec4 *)frame_alloc(frames, count * sizeof(glm::vec4));
+		unsigned char *masks = (unsigned char *)frame_alloc(frames, count);
+		run_system(&scene.world, render_mask, fill_draws, &out);
+		cull_views(scene.views, 2, out.bounds, count, masks);
+		visible = masks[count / 2];
+	} else {
+		std::vector<DRAW_OUT> draws(count);
+		std::vector<glm::vec4> bounds(count);
+		std::vector<unsigned char> masks(count);
+		out.draws = draws.data();
+		out.bounds = bounds.data();
+		run_system(&scene.world, render_mask, fill_draws, &out);
+		cull_views(scene.views, 2, out.bounds, count, masks.data());
+		visible = masks[count / 2];
+	}
+	return visible;
+}
+
+
+static void time_frames(const char *name, size_t scratch_size, bool arenas) {
+	init_job_system(WORKERS, scratch_size);
+	FRAME_ARENAS frames;
+	if (arenas) {
+		init_frame_arenas(&frames, 2, WORKERS, 2 << 20);
+	}
+	for (int f = 0; f < WARMUP; f++) {
+		run_frame(arenas ? &frames : NULL);
+	}
+
+	long mallocs = malloc_calls.load();
+	long frees = free_calls.load();
+	double start = now_seconds();
+	for (int f = 0; f < FRAMES; f++) {
+		run_frame(arenas ? &frames : NULL);
+	}
+	double elapsed = now_seconds() - start;
+	mallocs = malloc_calls.load() - mallocs;
+	frees = free_calls.load() - frees;
+
+	printf("%-24s %10.1f %10.1f %10.3f", name, (double)mallocs / FRAMES, (double)frees / FRAMES,
+			elapsed * 1000.0 / FRAMES);
+	if (arenas) {
+		ARENA_STATS stats = get_frame_arena_stats(&frames);
+		printf("   high water %.0f KB, %d allocations, %d failed", stats.high_water / 1024.0, stats.allocations,
+				stats.failures);
+		destroy_frame_arenas(&frames);
+	}
+	printf("\n");
+	shutdown_job_system();
+}
+
+
+// chunks come and go the way they do when entities are spawned and despawned
+static void time_chunk_churn(bool pooled) {
+	POOL pool;
+	init_pool(&pool, ECS_CHUNK_SIZE, ECS_CHUNK_ALIGN, ECS_POOL_PAGE);
+	void *live[POOL_LIVE];
+	for (int i = 0; i < POOL_LIVE; i++) {
+		live[i] = pooled ? pool_alloc(&pool) : aligned_alloc(ECS_CHUNK_ALIGN, ECS_CHUNK_SIZE);
+	}
+
+	long mallocs = malloc_calls.load();
+	double start = now_seconds();
+	for (int r = 0; r < POOL_ROUNDS; r++) {
+		int slot = next_random() % POOL_LIVE;
+		if (pooled) {
+			pool_free(&pool, live[slot]);
+			live[slot] = pool_alloc(&pool);
+		} else {
+			free(live[slot]);
+			live[slot] = aligned_alloc(ECS_CHUNK_ALIGN, ECS_CHUNK_SIZE);
+		}
+		*(volatile unsigned char *)live[slot] = (unsigned char)r;
+	}
+	double elapsed = now_seconds() - start;
+	mallocs = malloc_calls.load() - mallocs;
+
+	printf("%-24s %10.2f %10.1f", pooled ? "chunk pool" : "aligned_alloc/free", (double)mallocs / POOL_ROUNDS,
+			elapsed * 1e9 / POOL_ROUNDS);
+	if (pooled) {
+		printf("   %d pages, high water %d chunks", pool.stats.pages, pool.stats.high_water);
+	}
+	printf("\n");
+	for (int i = 0; i < POOL_LIVE; i++) {
+		if (!pooled) {
+			free(live[i]);
+		}
+	}
+	destroy_pool(&pool);
+}
+
+
+int main() {
+	build_scene();
+	printf("%d entities, %d workers, %d frames\n", (int)scene.nodes.size(), WORKERS, FRAMES);
+	printf("%-24s %10s %10s %10s\n", "per frame", "mallocs", "frees", "ms");
+	time_frames("heap", 0, false);
+	time_frames("arenas + worker scratch", JOB_SCRATCH_SIZE, true);
+
+	printf("\n%-24s %10s %10s\n", "per chunk replaced", "mallocs", "ns");
+	time_chunk_churn(false);
+	time_chunk_churn(true);
+	destroy_ecs_world(&scene.world);
+	return 0;
+}
@@ -0,0 +1,112 @@
+// atlas packing benchmark: thousands of sprite-sized rectangles packed into
+// atlas pages the way add_atlas_image does, gutter and grid included, both in
+// arrival order (runtime) and sorted by height (what an offline cook would do)
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "../atlas_packer.h"
+
+const int PAGE_SIZE		= 2048;
+const int PADDING		= 4;
+const int MIN_SPRITE	= 8;
+const int MAX_SPRITE	= 128;
+const int PASSES		= 10;
+
+typedef struct {
+	int width;
+	int height;
+} SPRITE;
+
+
+static double now_seconds() {
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+
+// mostly small icons with a tail of larger images
+static std::vector<SPRITE> make_sprites(int count, unsigned int seed) {
+	srand(seed);
+	std::vector<SPRITE> sprites(count);
+	for (SPRITE &sprite : sprites) {
+		float u = rand() / (float)RAND_MAX;
+		float v = rand() / (float)RAND_MAX;
+		sprite.width = MIN_SPRITE + (int)(u * u * (MAX_SPRITE - MIN_SPRITE));
+		sprite.height = MIN_SPRITE + (int)(v * v * (MAX_SPRITE - MIN_SPRITE));
+	}
+	return sprites;
+}
+
+
+static int slot_size(int size) {
+	return (size + 2 * PADDING + PADDING - 1) / PADDING * PADDING;
+}
+
+
+// returns page count; image_area is the unpadded pixel area that was placed,
+// slot_area the same with gutters and grid rounding
+static int pack_sprites(const std::vector<SPRITE> &sprites, long long *image_area, long long *slot_area) {
+	std::vector<SKYLINE_PACKER> pages;
+	*image_area = 0;
+	*slot_area = 0;
+	for (const SPRITE &sprite : sprites) {
+		int w = slot_size(sprite.width);
+		int h = slot_size(sprite.height);
+		int x, y;
+		bool placed = false;
+		for (SKYLINE_PACKER &page : pages) {
+			if (skyline_pack(&page, w, h, &x, &y)) {
+				placed = true;
+				break;
+			}
+		}
+		if (!placed) {
+			SKYLINE_PACKER page;
+			init_skyline_packer(&page, PAGE_SIZE, PAGE_SIZE);
+			skyline_pack(&page, w, h, &x, &y);
+			pages.push_back(page);
+		}
+		*image_area += (long long)sprite.width * sprite.height;
+		*slot_area += (long long)w * h;
+	}
+	return (int)pages.size();
+}
+
+
+static void bench(const char *label, const std::vector<SPRITE> &sprites) {
+	long long image_area = 0;
+	long long slot_area = 0;
+	int pages = 0;
+	double start = now_seconds();
+	for (int pass = 0; pass < PASSES; pass++) {
+		pages = pack_sprites(sprites, &image_area, &slot_area);
+	}
+	double elapsed = (now_seconds() - start) / PASSES;
+
+	double page_area = (double)pages * PAGE_SIZE * PAGE_SIZE;
+	// packed counts gutters as used, so it is the packer's own efficiency
+	printf("  %-8s %6zu sprites  %3d pages  %5.1f%% image  %5.1f%% packed  %8.2f ms  %6.2f us/sprite\n",
+			label, sprites.size(), pages, 100.0 * image_area / page_area, 100.0 * slot_area / page_area,
+			elapsed * 1000.0, elapsed * 1e6 / sprites.size());
+}
+
+
+int main() {
+	printf("%dx%d pages, %d texel gutter, sprites %d..%d texels\n",
+			PAGE_SIZE, PAGE_SIZE, PADDING, MIN_SPRITE, MAX_SPRITE);
+
+	const int counts[] = { 1000, 4000, 16000 };
+	for (int count : counts) {
+		std::vector<SPRITE> sprites = make_sprites(count, 1234u + count);
+		bench("arrival", sprites);
+
+		std::sort(sprites.begin(), sprites.end(), [](const SPRITE &a, const SPRITE &b) {
+			return a.height != b.height ? a.height > b.height : a.width > b.width;
+		});
+		bench("sorted", sprites);
+	}
+	return 0;
+}
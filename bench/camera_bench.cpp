@@ -0,0 +1,134 @@
+// camera update benchmark: a 1000Hz mouse feeding a 60Hz frame loop, through
+// the old path (euler vectors rebuilt on every event, lookAt and perspective
+// every frame) and the lazy quaternion camera, plus a frame loop where the
+// camera holds still. Also checks both paths end on the same view matrix
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <math.h>
+#include <stdio.h>
+#include <chrono>
+
+#include "../camera.h"
+
+const int FRAMES			= 200000;
+const int EVENTS_PER_FRAME	= 17;	// 1000Hz mouse over a 60Hz frame
+const int PASSES			= 5;
+
+static volatile float sink;
+
+
+static double now_seconds() {
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+
+// the camera as it was: trig and three normalizes per mouse event
+typedef struct {
+	glm::vec3 position;
+	glm::vec3 front;
+	glm::vec3 up;
+	glm::vec3 right;
+	glm::vec3 worldup;
+	float yaw;
+	float pitch;
+	float zoom;
+} EULER_CAMERA;
+
+
+static void euler_update(EULER_CAMERA *cam) {
+	glm::vec3 front;
+	front.x = cos(glm::radians(cam->yaw)) * cos(glm::radians(cam->pitch));
+	front.y = sin(glm::radians(cam->pitch));
+	front.z = sin(glm::radians(cam->yaw)) * cos(glm::radians(cam->pitch));
+	cam->front	= glm::normalize(front);
+	cam->right	= glm::normalize(glm::cross(cam->front, cam->worldup));
+	cam->up		= glm::normalize(glm::cross(cam->right, cam->front));
+}
+
+
+static void euler_mouse(EULER_CAMERA *cam, float xoffset, float yoffset) {
+	cam->yaw += xoffset * SENSITIVITY;
+	cam->pitch += yoffset * SENSITIVITY;
+	cam->pitch = cam->pitch > PITCH_CONSTRAIN ? PITCH_CONSTRAIN : (cam->pitch < -PITCH_CONSTRAIN ? -PITCH_CONSTRAIN : cam->pitch);
+	euler_update(cam);
+}
+
+
+static glm::mat4 euler_view_projection(const EULER_CAMERA *cam) {
+	glm::mat4 projection = glm::perspective(glm::radians(cam->zoom), ASPECT, NEAR_PLANE, FAR_PLANE);
+	return projection * glm::lookAt(cam->position, cam->position + cam->front, cam->up);
+}
+
+
+// small wobbling deltas, the same sequence for both cameras
+static void mouse_delta(int frame, int event, float *dx, float *dy) {
+	*dx = (float)((frame * 7 + event * 3) % 11) - 5.0f;
+	*dy = (float)((frame * 5 + event) % 7) - 3.0f;
+}
+
+
+static double run_euler(int events, EULER_CAMERA *cam) {
+	double start = now_seconds();
+	for (int frame = 0; frame < FRAMES; frame++) {
+		for (int e = 0; e < events; e++) {
+			float dx, dy;
+			mouse_delta(frame, e, &dx, &dy);
+			euler_mouse(cam, dx, dy);
+		}
+		sink = euler_view_projection(cam)[3][2];
+	}
+	return now_seconds() - start;
+}
+
+
+static double run_lazy(int events, CAMERA *cam) {
+	double start = now_seconds();
+	for (int frame = 0; frame < FRAMES; frame++) {
+		for (int e = 0; e < events; e++) {
+			float dx, dy;
+			mouse_delta(frame, e, &dx, &dy);
+			get_cam_mouse_input(cam, dx, dy);
+		}
+		sink = get_view_projection_matrix(cam)[3][2];
+	}
+	return now_seconds() - start;
+}
+
+
+int main() {
+	printf("%d frames, best of %d passes\n", FRAMES, PASSES);
+	printf("%-22s %14s %14s %9s\n", "", "euler ns/frame", "lazy ns/frame", "speedup");
+
+	const int event_counts[] = { EVENTS_PER_FRAME, 0 };
+	const char *names[] = { "1000Hz mouse, 60Hz", "still camera" };
+	float max_diff = 0.0f;
+	for (int run = 0; run < 2; run++) {
+		double euler_best = 1e30, lazy_best = 1e30;
+		for (int pass = 0; pass < PASSES; pass++) {
+			EULER_CAMERA euler = { glm::vec3(0.0f, 0.0f, 3.0f), glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(0.0f),
+					glm::vec3(0.0f, 1.0f, 0.0f), YAW, PITCH, ZOOM };
+			euler_update(&euler);
+			CAMERA lazy = create_camera();
+
+			double t = run_euler(event_counts[run], &euler);
+			euler_best = t < euler_best ? t : euler_best;
+			t = run_lazy(event_counts[run], &lazy);
+			lazy_best = t < lazy_best ? t : lazy_best;
+
+			glm::mat4 a = euler_view_projection(&euler);
+			const glm::mat4 &b = get_view_projection_matrix(&lazy);
+			for (int c = 0; c < 4; c++) {
+				for (int r = 0; r < 4; r++) {
+					float diff = fabsf(a[c][r] - b[c][r]);
+					max_diff = diff > max_diff ? diff : max_diff;
+				}
+			}
+		}
+		printf("%-22s %14.1f %14.1f %8.1fx\n", names[run], euler_best * 1e9 / FRAMES, lazy_best * 1e9 / FRAMES,
+				euler_best / lazy_best);
+	}
+	printf("max view-projection difference: %g\n", max_diff);
+	return 0;
+}
@@ -0,0 +1,213 @@
+// image decode benchmark: MB/s of decoded pixels for every backend, one thread
+// and restart-interval parallel, over textures/ and any paths given on the
+// command line. run from the repository root. Built with JPEG_TURBO=1 it also
+// encodes a large restart-marked JPEG to show the parallel path on a huge image
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../image_decoder.h"
+#include "../job_system.h"
+
+#ifdef HAVE_LIBJPEG_TURBO
+#include <jpeglib.h>
+#endif
+
+const int PASSES = 5;
+const int LARGE_SIZE = 8192;
+
+
+static double now_seconds() {
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+
+static std::vector<std::string> list_textures(const char *dir) {
+	std::vector<std::string> paths;
+	DIR *d = opendir(dir);
+	if (!d) {
+		return paths;
+	}
+
+	struct dirent *entry;
+	while ((entry = readdir(d)) != NULL) {
+		const char *ext = strrchr(entry->d_name, '.');
+		if (ext && (!strcmp(ext, ".jpg") || !strcmp(ext, ".jpeg") || !strcmp(ext, ".png"))) {
+			paths.push_back(std::string(dir) + "/" + entry->d_name);
+		}
+	}
+	closedir(d);
+	return paths;
+}
+
+
+static std::vector<unsigned char> read_whole_file(const char *path) {
+	std::vector<unsigned char> data;
+	FILE *file = fopen(path, "rb");
+	if (!file) {
+		return data;
+	}
+	fseek(file, 0, SEEK_END);
+	data.resize(ftell(file));
+	fseek(file, 0, SEEK_SET);
+	if (fread(data.data(), 1, data.size(), file) != data.size()) {
+		data.clear();
+	}
+	fclose(file);
+	return data;
+}
+
+
+#ifdef HAVE_LIBJPEG_TURBO
+// the source image tiled up to LARGE_SIZE square, restart marker every MCU row
+static std::vector<unsigned char> make_large_jpeg(const DECODED_IMAGE *source) {
+	std::vector<unsigned char> pixels((size_t)LARGE_SIZE * LARGE_SIZE * 3);
+	for (int y = 0; y < LARGE_SIZE; y++) {
+		const unsigned char *row = source->pixels + (size_t)(y % source->height) * source->width * source->channels;
+		for (int x = 0; x < LARGE_SIZE; x++) {
+			const unsigned char *texel = row + (size_t)(x % source->width) * source->channels;
+			for (int c = 0; c < 3; c++) {
+				pixels[((size_t)y * LARGE_SIZE + x) * 3 + c] = texel[source->channels < 3 ? 0 : c];
+			}
+		}
+	}
+
+	struct jpeg_compress_struct info;
+	struct jpeg_error_mgr error;
+	info.err = jpeg_std_error(&error);
+	jpeg_create_compress(&info);
+	unsigned char *out = NULL;
+	unsigned long out_size = 0;
+	jpeg_mem_dest(&info, &out, &out_size);
+	info.image_width = LARGE_SIZE;
+	info.image_height = LARGE_SIZE;
+	info.input_components = 3;
+	info.in_color_space = JCS_RGB;
+	jpeg_set_defaults(&info);
+	jpeg_set_quality(&info, 90, TRUE);
+	info.restart_in_rows = 1;
+	jpeg_start_compress(&info, TRUE);
+	while (info.next_scanline < info.image_height) {
+		JSAMPROW row = &pixels[(size_t)info.next_scanline * LARGE_SIZE * 3];
+		jpeg_write_scanlines(&info, &row, 1);
+	}
+	jpeg_finish_compress(&info);
+	jpeg_destroy_compress(&info);
+
+	std::vector<unsigned char> jpeg(out, out + out_size);
+	free(out);
+	return jpeg;
+}
+#endif
+
+
+// returns decoded MB/s, 0 when the backend cannot decode the image
+static double time_decode(const IMAGE_DECODER *decoder, const std::vector<unsigned char> &data, int threads,
+		int *chunks) {
+	DECODED_IMAGE image;
+	double start = now_seconds();
+	size_t bytes = 0;
+	for (int pass = 0; pass < PASSES; pass++) {
+		if (!decode_image_with(decoder, data.data(), data.size(), &image, threads)) {
+			return 0.0;
+		}
+		bytes += (size_t)image.width * image.height * image.channels;
+		*chunks = image.chunks;
+		free_decoded_image(&image);
+	}
+	return bytes / (now_seconds() - start) / (1024.0 * 1024.0);
+}
+
+
+// the parallel path has to reproduce the single-threaded decode bit for bit
+static bool same_pixels(const IMAGE_DECODER *decoder, const std::vector<unsigned char> &data, int threads) {
+	DECODED_IMAGE serial, parallel;
+	if (!decode_image_with(decoder, data.data(), data.size(), &serial, 1)) {
+		return false;
+	}
+	bool same = false;
+	if (decode_image_with(decoder, data.data(), data.size(), &parallel, threads)) {
+		same = parallel.width == serial.width && parallel.height == serial.height
+				&& parallel.channels == serial.channels
+				&& !memcmp(parallel.pixels, serial.pixels, (size_t)serial.width * serial.height * serial.channels);
+		free_decoded_image(&parallel);
+	}
+	free_decoded_image(&serial);
+	return same;
+}
+
+
+static void bench_image(const char *name, const std::vector<unsigned char> &data,
+		const std::vector<const IMAGE_DECODER *> &decoders, int threads) {
+	for (const IMAGE_DECODER *decoder : decoders) {
+		int serial_chunks = 1, parallel_chunks = 1;
+		double serial = time_decode(decoder, data, 1, &serial_chunks);
+		if (serial == 0.0) {
+			continue;
+		}
+		double parallel = time_decode(decoder, data, threads, &parallel_chunks);
+		const char *check = parallel_chunks > 1 ? (same_pixels(decoder, data, threads) ? "match" : "MISMATCH") : "-";
+		printf("%-24s %8.1fKB %-14s %10.1f %10.1f %7d %9s\n", name, data.size() / 1024.0, decoder->name, serial,
+				parallel, parallel_chunks, check);
+	}
+}
+
+
+int main(int argc, char **argv) {
+	std::vector<std::string> paths = list_textures("textures");
+	for (int i = 1; i < argc; i++) {
+		paths.push_back(argv[i]);
+	}
+	if (paths.empty()) {
+		printf("no textures found, run from the repository root\n");
+		return 1;
+	}
+
+	std::vector<const IMAGE_DECODER *> decoders;
+	decoders.push_back(get_stb_decoder());
+	if (get_jpeg_turbo_decoder()) {
+		decoders.push_back(get_jpeg_turbo_decoder());
+	} else {
+		printf("built without libjpeg-turbo (make bench JPEG_TURBO=1)\n");
+	}
+	// the split pieces run as jobs, so the workers are what xN measures
+	int threads = (int)std::thread::hardware_concurrency();
+	if (threads < 2) threads = 2;
+	init_job_system(threads);
+
+	printf("%-24s %10s %-14s %10s %10s %7s %9s\n", "image", "file", "decoder", "MB/s x1", "MB/s xN", "chunks",
+			"xN check");
+	std::vector<unsigned char> largest_source;
+	for (const std::string &path : paths) {
+		std::vector<unsigned char> data = read_whole_file(path.c_str());
+		if (data.empty()) {
+			printf("could not read %s\n", path.c_str());
+			continue;
+		}
+		const char *slash = strrchr(path.c_str(), '/');
+		bench_image(slash ? slash + 1 : path.c_str(), data, decoders, threads);
+		if (data.size() > largest_source.size()) {
+			largest_source = data;
+		}
+	}
+
+#ifdef HAVE_LIBJPEG_TURBO
+	DECODED_IMAGE source;
+	if (decode_image_with(get_stb_decoder(), largest_source.data(), largest_source.size(), &source)) {
+		std::vector<unsigned char> large = make_large_jpeg(&source);
+		free_decoded_image(&source);
+		char label[64];
+		snprintf(label, sizeof(label), "tiled %dx%d", LARGE_SIZE, LARGE_SIZE);
+		bench_image(label, large, decoders, threads);
+	}
+#endif
+	printf("xN = %d workers, %u cores\n", threads, std::thread::hardware_concurrency());
+	shutdown_job_system();
+	return 0;
+}
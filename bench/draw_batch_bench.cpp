@@ -0,0 +1,264 @@
+// draw batching benchmark: MESHES distinct small meshes in the mesh pool, a
+// quarter of them in the lit vertex format, each drawn once through the
+// renderer. The draw commands are built on the workers, then submitted one
+// instanced draw per command against one glMultiDrawElementsIndirect per
+// vertex format, checking both give the same picture. The CPU columns time
+// render_snapshot up to its return, before the driver has drawn anything;
+// the frame column waits for glFinish, so on llvmpipe it is mostly
+// rasterization. Then a field of RUN_LENGTH copies of each mesh in a row,
+// where the commands already merge draws into instanced runs.
+// run from the repository root
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "../arena.h"
+#include "../draw_batch.h"
+#include "../gl_ext.h"
+#include "../job_system.h"
+#include "../render_thread.h"
+#include "../render_view.h"
+#include "../shader.h"
+
+const int TARGET_SIZE	= 512;
+const int MESHES		= 10000;
+const int GRID			= 100;		// meshes per row on screen
+const int RUN_LENGTH	= 4;
+const int WARMUP		= 3;
+const int PASSES		= 20;
+
+typedef struct {
+	double build_us;		// build_draw_commands on the workers
+	double submit_us;		// render_snapshot until it returns
+	double frame_ms;		// render_snapshot and glFinish
+} BATCH_TIMES;
+
+static unsigned int random_state = 12345;
+static FRAME_SNAPSHOT snapshot;
+static FRAME_ARENAS arenas;
+
+
+static unsigned int next_random() {
+	random_state = random_state * 1664525u + 1013904223u;
+	return random_state >> 8;
+}
+
+
+static double now_seconds() {
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+
+// a bumpy (w + 1) x (h + 1) grid in the unit square, in either format
+static int add_grid_mesh(MESH_POOL *pool, VERTEX_FORMAT format, int w, int h) {
+	int floats = get_vertex_layout(format)->stride / sizeof(float);
+	std::vector<float> vertices;
+	std::vector<unsigned int> indices;
+	for (int y = 0; y <= h; y++) {
+		for (int x = 0; x <= w; x++) {
+			float vertex[12] = { (float)x / w - 0.5f, (next_random() % 100) * 0.003f, (float)y / h - 0.5f,
+					(float)x / w, (float)y / h, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f };
+			vertices.insert(vertices.end(), vertex, vertex + floats);
+		}
+	}
+	for (int y = 0; y < h; y++) {
+		for (int x = 0; x < w; x++) {
+			unsigned int i = y * (w + 1) + x;
+			unsigned int quad[6] = { i, i + 1, i + w + 2, i, i + w + 2, i + w + 1 };
+			indices.insert(indices.end(), quad, quad + 6);
+		}
+	}
+	return add_mesh(pool, format, vertices.data(), (w + 1) * (h + 1), indices.data(), (int)indices.size());
+}
+
+
+// draw i at grid cell i; run_length draws in a row share a mesh
+static void fill_draws(const std::vector<int> &meshes, int run_length) {
+	for (int i = 0; i < snapshot.draw_count; i++) {
+		glm::vec3 position((i % GRID - GRID / 2 + 0.5f), 0.0f, (i / GRID - GRID / 2 + 0.5f));
+		snapshot.draws[i].model = glm::translate(glm::mat4(1.0f), position);
+		snapshot.draws[i].texture_layers[0] = 0;
+		snapshot.draws[i].texture_layers[1] = 0;
+		snapshot.draws[i].mesh = meshes[(i / run_length) % meshes.size()];
+		snapshot.view_masks[i] = 1;
+	}
+}
+
+
+static BATCH_TIMES time_batching(RENDERER *renderer, bool indirect) {
+	renderer->indirect_draws = indirect && gl_ext.multi_draw_indirect;
+	BATCH_TIMES best = { 1e30, 1e30, 1e30 };
+	for (int pass = 0; pass < WARMUP + PASSES; pass++) {
+		double start = now_seconds();
+		begin_frame_arenas(&arenas);
+		build_draw_commands(&snapshot, &arenas);
+		double built = now_seconds();
+		render_snapshot(renderer, &snapshot);
+		double submitted = now_seconds();
+		glFinish();
+		double finished = now_seconds();
+		if (pass >= WARMUP) {
+			best.build_us = std::min(best.build_us, (built - start) * 1e6);
+			best.submit_us = std::min(best.submit_us, (submitted - built) * 1e6);
+			best.frame_ms = std::min(best.frame_ms, (finished - built) * 1e3);
+		}
+	}
+	return best;
+}
+
+
+static std::vector<unsigned char> read_target() {
+	std::vector<unsigned char> pixels(TARGET_SIZE * TARGET_SIZE * 4);
+	glReadPixels(0, 0, TARGET_SIZE, TARGET_SIZE, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+	return pixels;
+}
+
+
+// header replaces the #version line, as load_program_async does
+static std::string read_shader(const char *path, const std::string &header) {
+	FILE *file = fopen(path, "rb");
+	if (!file) {
+		return "";
+	}
+	std::string source;
+	char chunk[4096];
+	size_t read;
+	while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+		source.append(chunk, read);
+	}
+	fclose(file);
+	size_t line_end = source.find('\n');
+	return header + source.substr(line_end == std::string::npos ? source.size() : line_end + 1);
+}
+
+
+static bool make_renderer(RENDERER *renderer, TEXTURE_ARRAY *textures, MESH_POOL *meshes) {
+	std::string header = "#version 330 core\n";
+	std::string vert_source = read_shader("shaders/shader.vert", header);
+	std::string frag_source = read_shader("shaders/shader.frag", header);
+	if (vert_source.empty() || frag_source.empty()) {
+		return false;
+	}
+	unsigned int vert = compile_vertex_shader(vert_source.c_str());
+	unsigned int frag = compile_fragment_shader(frag_source.c_str());
+	unsigned int program = create_shader_program(vert, frag);
+	glDeleteShader(vert);
+	glDeleteShader(frag);
+	*renderer = {};
+	renderer->shader_program = program;
+	renderer->meshes = meshes;
+	renderer->mix_amount = 0.4f;
+	renderer->textures = textures;
+	renderer->stereo_mode = STEREO_PASSES;
+	init_instance_buffer(renderer);
+	return true;
+}
+
+
+// both submissions of the current draws: times, draw calls and whether the
+// pictures match
+static void compare(RENDERER *renderer, const char *label) {
+	BATCH_TIMES direct = time_batching(renderer, false);
+	int direct_calls = renderer->draw_calls;
+	std::vector<unsigned char> reference = read_target();
+	BATCH_TIMES indirect = time_batching(renderer, true);
+	int indirect_calls = renderer->draw_calls;
+	std::vector<unsigned char> pixels = read_target();
+	int differ = 0;
+	for (size_t i = 0; i < pixels.size(); i += 4) {
+		differ += pixels[i] != reference[i] || pixels[i + 1] != reference[i + 1] || pixels[i + 2] != reference[i + 2];
+	}
+
+	printf("%s: %d draws, %d commands, built in %.1fus on the workers\n", label, snapshot.draw_count,
+			snapshot.passes[0].count, indirect.build_us);
+	printf("  %-22s %8s %12s %10s\n", "", "calls", "CPU submit", "frame");
+	printf("  %-22s %8d %10.1fus %8.2fms\n", "a draw per command", direct_calls, direct.submit_us, direct.frame_ms);
+	printf("  %-22s %8d %10.1fus %8.2fms  %.2fx less CPU, %d pixels differ\n",
+			renderer->indirect_draws ? "multi-draw indirect" : "indirect (unsupported)", indirect_calls,
+			indirect.submit_us, indirect.frame_ms, direct.submit_us / indirect.submit_us, differ);
+}
+
+
+int main() {
+	GLFWwindow *window = NULL;
+	if (glfwInit()) {
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		window = glfwCreateWindow(TARGET_SIZE, TARGET_SIZE, "draw_batch_bench", NULL, NULL);
+	}
+	if (!window) {
+		printf("no GL context\n");
+		return 1;
+	}
+	glfwMakeContextCurrent(window);
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+		printf("could not load GL\n");
+		return 1;
+	}
+	load_gl_extensions();
+	init_job_system();
+	init_frame_arenas(&arenas, 1);
+	glEnable(GL_DEPTH_TEST);
+
+	MESH_POOL pool;
+	init_mesh_pool(&pool);
+	std::vector<int> meshes;
+	for (int i = 0; i < MESHES; i++) {
+		VERTEX_FORMAT format = i % 4 == 3 ? VERTEX_LIT : VERTEX_POS_UV;
+		int mesh = add_grid_mesh(&pool, format, 1 + next_random() % 3, 1 + next_random() % 3);
+		if (mesh < 0) {
+			printf("mesh pool full after %d meshes\n", i);
+			return 1;
+		}
+		meshes.push_back(mesh);
+	}
+
+	TEXTURE_ARRAY textures;
+	init_texture_array(&textures, 64, 64);
+	RENDERER renderer;
+	if (!make_renderer(&renderer, &textures, &pool)) {
+		printf("shaders/ not found, run from the repository root\n");
+		return 1;
+	}
+	if (!gl_ext.multi_draw_indirect) {
+		printf("no GL_ARB_multi_draw_indirect: the indirect column falls back to a draw per command\n");
+	}
+
+	std::vector<DRAW_ITEM> draws(GRID * GRID);
+	std::vector<unsigned char> view_masks(GRID * GRID);
+	snapshot.draws = draws.data();
+	snapshot.view_masks = view_masks.data();
+	snapshot.draw_count = GRID * GRID;
+	snapshot.view_count = 1;
+	snapshot.viewport_width = TARGET_SIZE;
+	snapshot.viewport_height = TARGET_SIZE;
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 90.0f, 40.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1.0f, 1.0f, 300.0f);
+	snapshot.views[0] = make_render_view(view, projection, glm::vec4(0.0f, 0.0f, 1.0f, 1.0f));
+
+	printf("GL renderer: %s, %d workers\n", (const char *)glGetString(GL_RENDERER), get_worker_count());
+	fill_draws(meshes, 1);
+	compare(&renderer, "every draw a distinct mesh");
+	fill_draws(meshes, RUN_LENGTH);
+	compare(&renderer, "runs of one mesh");
+
+	destroy_instance_buffer(&renderer);
+	glDeleteProgram(renderer.shader_program);
+	destroy_texture_array(&textures);
+	destroy_mesh_pool(&pool);
+	destroy_frame_arenas(&arenas);
+	shutdown_job_system();
+	glfwDestroyWindow(window);
+	glfwTerminate();
+	return 0;
+}
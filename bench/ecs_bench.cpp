@@ -0,0 +1,289 @@
+// entity iteration benchmark: 1M renderable entities, a quarter of them in a
+// second archetype, run through three passes both as ECS systems over the
+// chunks and as loops over an array of structs holding the same components.
+// "AoS" carries only the four components; "AoS + state" adds the per-object
+// fields a game object struct usually grows (name, velocity, flags, owner),
+// which every pass then drags through the cache. Times are ns per entity, for
+// one worker and for all of them; the passes' results are compared at the end
+#include <glm/glm.hpp>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "../ecs.h"
+#include "../job_system.h"
+
+const int ENTITIES		= 1000000;
+const int REPEATS		= 10;
+const int AOS_BATCH		= 2048;
+
+// what the render system writes per entity, as DRAW_ITEM does
+typedef struct {
+	glm::mat4 model;
+	int texture_layers[2];
+	int mesh;
+} DRAW_OUT;
+
+typedef struct {
+	TRANSFORM_COMPONENT transform;
+	MESH_REF mesh;
+	MATERIAL_REF material;
+	BOUNDS_COMPONENT bounds;
+} LEAN_OBJECT;
+
+typedef struct {
+	char name[32];
+	TRANSFORM_COMPONENT transform;
+	glm::vec3 velocity;
+	MESH_REF mesh;
+	MATERIAL_REF material;
+	unsigned int flags;
+	BOUNDS_COMPONENT bounds;
+	void *owner;
+} STATE_OBJECT;
+
+typedef struct {
+	DRAW_OUT *draws;
+	glm::vec4 *spheres;
+	glm::vec4 plane;
+	std::atomic<int> visible;
+} PASS_OUTPUT;
+
+static unsigned int seed = 12345;
+
+static unsigned int next_random() {
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+
+static double now_seconds() {
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+
+// bounds follow the transform
+static void ecs_bounds(void *data, const CHUNK_VIEW *chunk) {
+	const TRANSFORM_COMPONENT *transforms = (const TRANSFORM_COMPONENT *)chunk->components[COMPONENT_TRANSFORM];
+	BOUNDS_COMPONENT *bounds = (BOUNDS_COMPONENT *)chunk->components[COMPONENT_BOUNDS];
+	for (int i = 0; i < chunk->count; i++) {
+		bounds[i].center = glm::vec3(transforms[i].world[3]);
+	}
+}
+
+
+// counts spheres in front of one plane, as a frustum test does six times
+static void ecs_cull(void *data, const CHUNK_VIEW *chunk) {
+	PASS_OUTPUT *out = (PASS_OUTPUT *)data;
+	const BOUNDS_COMPONENT *bounds = (const BOUNDS_COMPONENT *)chunk->components[COMPONENT_BOUNDS];
+	int visible = 0;
+	for (int i = 0; i < chunk->count; i++) {
+		visible += glm::dot(glm::vec3(out->plane), bounds[i].center) + out->plane.w >= -bounds[i].radius;
+	}
+	out->visible += visible;
+}
+
+
+static void ecs_render(void *data, const CHUNK_VIEW *chunk) {
+	PASS_OUTPUT *out = (PASS_OUTPUT *)data;
+	const TRANSFORM_COMPONENT *transforms = (const TRANSFORM_COMPONENT *)chunk->components[COMPONENT_TRANSFORM];
+	const MESH_REF *meshes = (const MESH_REF *)chunk->components[COMPONENT_MESH];
+	const MATERIAL_REF *materials = (const MATERIAL_REF *)chunk->components[COMPONENT_MATERIAL];
+	const BOUNDS_COMPONENT *bounds = (const BOUNDS_COMPONENT *)chunk->components[COMPONENT_BOUNDS];
+	for (int i = 0; i < chunk->count; i++) {
+		DRAW_OUT *draw = &out->draws[chunk->first + i];
+		draw->model = transforms[i].world;
+		draw->texture_layers[0] = materials[i].texture_layers[0];
+		draw->texture_layers[1] = materials[i].texture_layers[1];
+		draw->mesh = meshes[i].mesh;
+		out->spheres[chunk->first + i] = glm::vec4(bounds[i].center, bounds[i].radius);
+	}
+}
+
+
+template <typename OBJECT>
+struct AOS_PASS {
+	OBJECT *objects;
+	PASS_OUTPUT *out;
+
+	static void bounds(void *data, int begin, int end) {
+		OBJECT *objects = ((AOS_PASS *)data)->objects;
+		for (int i = begin; i < end; i++) {
+			objects[i].bounds.center = glm::vec3(objects[i].transform.world[3]);
+		}
+	}
+
+	static void cull(void *data, int begin, int end) {
+		AOS_PASS *pass = (AOS_PASS *)data;
+		glm::vec4 plane = pass->out->plane;
+		int visible = 0;
+		for (int i = begin; i < end; i++) {
+			const BOUNDS_COMPONENT *bounds = &pass->objects[i].bounds;
+			visible += glm::dot(glm::vec3(plane), bounds->center) + plane.w >= -bounds->radius;
+		}
+		pass->out->visible += visible;
+	}
+
+	static void render(void *data, int begin, int end) {
+		AOS_PASS *pass = (AOS_PASS *)data;
+		for (int i = begin; i < end; i++) {
+			const OBJECT *object = &pass->objects[i];
+			DRAW_OUT *draw = &pass->out->draws[i];
+			draw->model = object->transform.world;
+			draw->texture_layers[0] = object->material.texture_layers[0];
+			draw->texture_layers[1] = object->material.texture_layers[1];
+			draw->mesh = object->mesh.mesh;
+			pass->out->spheres[i] = glm::vec4(object->bounds.center, object->bounds.radius);
+		}
+	}
+};
+
+
+typedef struct {
+	double bounds;
+	double cull;
+	double render;
+} PASS_TIMES;
+
+
+static PASS_TIMES time_ecs(ECS_WORLD *world, PASS_OUTPUT *out) {
+	const unsigned int render_mask = HAS_TRANSFORM | HAS_MESH | HAS_MATERIAL | HAS_BOUNDS;
+	PASS_TIMES times = { 0.0, 0.0, 0.0 };
+	for (int r = 0; r < REPEATS; r++) {
+		double start = now_seconds();
+		run_system(world, HAS_TRANSFORM | HAS_BOUNDS, ecs_bounds, out);
+		times.bounds += now_seconds() - start;
+
+		out->visible = 0;
+		start = now_seconds();
+		run_system(world, HAS_BOUNDS, ecs_cull, out);
+		times.cull += now_seconds() - start;
+
+		start = now_seconds();
+		run_system(world, render_mask, ecs_render, out);
+		times.render += now_seconds() - start;
+	}
+	return times;
+}
+
+
+template <typename OBJECT>
+static PASS_TIMES time_aos(OBJECT *objects, PASS_OUTPUT *out) {
+	AOS_PASS<OBJECT> pass = { objects, out };
+	PASS_TIMES times = { 0.0, 0.0, 0.0 };
+	for (int r = 0; r < REPEATS; r++) {
+		double start = now_seconds();
+		parallel_for(ENTITIES, AOS_BATCH, AOS_PASS<OBJECT>::bounds, &pass);
+		times.bounds += now_seconds() - start;
+
+		out->visible = 0;
+		start = now_seconds();
+		parallel_for(ENTITIES, AOS_BATCH, AOS_PASS<OBJECT>::cull, &pass);
+		times.cull += now_seconds() - start;
+
+		start = now_seconds();
+		parallel_for(ENTITIES, AOS_BATCH, AOS_PASS<OBJECT>::render, &pass);
+		times.render += now_seconds() - start;
+	}
+	return times;
+}
+
+
+static void print_times(const char *name, int workers, PASS_TIMES times) {
+	double scale = 1e9 / ((double)REPEATS * ENTITIES);
+	printf("%-12s %7d %10.2f %10.2f %10.2f\n", name, workers, times.bounds * scale, times.cull * scale,
+			times.render * scale);
+}
+
+
+// the same draws in any order: sum them up order-independently
+static double checksum(const PASS_OUTPUT *out) {
+	double sum = 0.0;
+	for (int i = 0; i < ENTITIES; i++) {
+		sum += out->draws[i].model[3].x + out->draws[i].model[3].y * 3.0 + out->draws[i].texture_layers[1]
+				+ out->draws[i].mesh + out->spheres[i].z;
+	}
+	return sum;
+}
+
+
+int main(int argc, char **argv) {
+	int max_workers = argc > 1 ? atoi(argv[1]) : static_cast<int>(std::thread::hardware_concurrency());
+	if (max_workers < 1) max_workers = 1;
+
+	ECS_WORLD world;
+	init_ecs_world(&world);
+	std::vector<LEAN_OBJECT> lean(ENTITIES);
+	std::vector<STATE_OBJECT> state(ENTITIES);
+	for (int i = 0; i < ENTITIES; i++) {
+		unsigned int mask = HAS_TRANSFORM | HAS_MESH | HAS_MATERIAL | HAS_BOUNDS;
+		if (i % 4 == 3) {
+			mask |= HAS_SCENE_NODE;
+		}
+		ENTITY entity = create_entity(&world, mask);
+
+		LEAN_OBJECT object;
+		object.transform.world = glm::mat4(1.0f);
+		object.transform.world[3] = glm::vec4((float)(next_random() % 2000) * 0.1f - 100.0f,
+				(float)(next_random() % 2000) * 0.1f - 100.0f, (float)(next_random() % 2000) * 0.1f - 100.0f, 1.0f);
+		object.mesh.mesh = i % 4;
+		object.material.texture_layers[0] = next_random() % 8;
+		object.material.texture_layers[1] = next_random() % 8;
+		object.bounds.center = glm::vec3(0.0f);
+		object.bounds.radius = 0.8661f;
+		lean[i] = object;
+		state[i].transform = object.transform;
+		state[i].mesh = object.mesh;
+		state[i].material = object.material;
+		state[i].bounds = object.bounds;
+
+		*(TRANSFORM_COMPONENT *)get_component(&world, entity, COMPONENT_TRANSFORM) = object.transform;
+		*(MESH_REF *)get_component(&world, entity, COMPONENT_MESH) = object.mesh;
+		*(MATERIAL_REF *)get_component(&world, entity, COMPONENT_MATERIAL) = object.material;
+		*(BOUNDS_COMPONENT *)get_component(&world, entity, COMPONENT_BOUNDS) = object.bounds;
+	}
+	printf("%d entities in %d archetypes, %d chunks of %d bytes; %d and %d bytes per AoS object\n", ENTITIES,
+			(int)world.archetypes.size(), (int)(world.archetypes[0].chunks.size() + world.archetypes[1].chunks.size()),
+			ECS_CHUNK_SIZE, (int)sizeof(LEAN_OBJECT), (int)sizeof(STATE_OBJECT));
+
+	std::vector<DRAW_OUT> draws(ENTITIES);
+	std::vector<glm::vec4> spheres(ENTITIES);
+	PASS_OUTPUT out;
+	out.draws = draws.data();
+	out.spheres = spheres.data();
+	out.plane = glm::vec4(glm::normalize(glm::vec3(1.0f, 0.5f, -0.25f)), 10.0f);
+
+	printf("ns per entity  workers     bounds       cull     render\n");
+	int visible[3] = { 0, 0, 0 };
+	double sums[3] = { 0.0, 0.0, 0.0 };
+	int worker_counts[2] = { 1, max_workers };
+	for (int run = 0; run < (max_workers > 1 ? 2 : 1); run++) {
+		int workers = worker_counts[run];
+		init_job_system(workers);
+		print_times("ECS", workers, time_ecs(&world, &out));
+		visible[0] = out.visible;
+		sums[0] = checksum(&out);
+		print_times("AoS", workers, time_aos(lean.data(), &out));
+		visible[1] = out.visible;
+		sums[1] = checksum(&out);
+		print_times("AoS + state", workers, time_aos(state.data(), &out));
+		visible[2] = out.visible;
+		sums[2] = checksum(&out);
+		shutdown_job_system();
+	}
+
+	printf("visible: ECS %d, AoS %d, AoS + state %d; draw checksums %s\n", visible[0], visible[1], visible[2],
+			fabs(sums[0] - sums[1]) < 1e-3 * fabs(sums[1]) && fabs(sums[0] - sums[2]) < 1e-3 * fabs(sums[2])
+					? "match" : "DIFFER");
+	destroy_ecs_world(&world);
+	return 0;
+}
@@ -0,0 +1,246 @@
+// file loading benchmark: the blocking stdio/stbi_load path against the batched
+// file reader, on textures/ and on a synthetic set of small files.
+// run from the repository root; page cache is warm after the first pass
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "../file_reader.h"
+#include "../shader.h"
+#include "../texture.h"
+#include "../stb_image.h"
+
+const int TEXTURE_PASSES		= 10;
+const int SYNTHETIC_FILES		= 10000;
+const int SYNTHETIC_FILE_SIZE	= 4096;
+const int READ_WINDOW			= 256;	// reads in flight at once, well under the open file limit
+
+typedef struct {
+	std::mutex mutex;
+	std::condition_variable done;
+	std::vector<FILE_READ *> completed;
+} COMPLETIONS;
+
+
+static double now_seconds() {
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+
+static void on_read(FILE_READ *read) {
+	COMPLETIONS *completions = (COMPLETIONS *)read->user;
+	std::lock_guard<std::mutex> lock(completions->mutex);
+	completions->completed.push_back(read);
+	completions->done.notify_one();
+}
+
+
+// keeps READ_WINDOW reads in flight, each open file counts against the
+// process limit, and hands each successful result to consume as it lands;
+// returns how many reads failed
+template <typename CONSUME>
+static int read_batch(FILE_READER *reader, const std::vector<std::string> &paths, CONSUME consume) {
+	COMPLETIONS completions;
+	std::vector<FILE_READ> reads(paths.size());
+	std::vector<FILE_READ *> pointers(paths.size());
+	for (size_t i = 0; i < paths.size(); i++) {
+		reads[i] = {};
+		reads[i].path		= paths[i].c_str();
+		reads[i].callback	= on_read;
+		reads[i].user		= &completions;
+		pointers[i] = &reads[i];
+	}
+
+	// a low descriptor limit shrinks the window rather than failing opens
+	size_t window = READ_WINDOW;
+	struct rlimit limit;
+	if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur / 4 < window) {
+		window = limit.rlim_cur / 4 > 0 ? limit.rlim_cur / 4 : 1;
+	}
+	size_t submitted = paths.size() < window ? paths.size() : window;
+	submit_file_reads(reader, pointers.data(), (int)submitted);
+
+	size_t handled = 0;
+	int failed = 0;
+	while (handled < paths.size()) {
+		std::vector<FILE_READ *> batch;
+		{
+			std::unique_lock<std::mutex> lock(completions.mutex);
+			completions.done.wait(lock, [&] { return !completions.completed.empty(); });
+			batch.swap(completions.completed);
+		}
+		for (FILE_READ *read : batch) {
+			if (read->error) {
+				failed++;
+			} else {
+				consume(read);
+			}
+			release_file_read(reader, read);
+		}
+		handled += batch.size();
+
+		// refill the window with as many reads as just finished
+		size_t more = paths.size() - submitted < batch.size() ? paths.size() - submitted : batch.size();
+		if (more > 0) {
+			submit_file_reads(reader, pointers.data() + submitted, (int)more);
+			submitted += more;
+		}
+	}
+	return failed;
+}
+
+
+static void print_failures(int failed) {
+	if (failed) {
+		printf("  %-32s %8d reads FAILED\n", "", failed);
+	}
+}
+
+
+static std::vector<std::string> list_textures(const char *dir) {
+	std::vector<std::string> paths;
+	DIR *d = opendir(dir);
+	if (!d) {
+		return paths;
+	}
+
+	struct dirent *entry;
+	while ((entry = readdir(d)) != NULL) {
+		const char *ext = strrchr(entry->d_name, '.');
+		if (ext && (!strcmp(ext, ".jpg") || !strcmp(ext, ".jpeg") || !strcmp(ext, ".png"))) {
+			paths.push_back(std::string(dir) + "/" + entry->d_name);
+		}
+	}
+	closedir(d);
+	return paths;
+}
+
+
+static std::vector<std::string> make_synthetic_files(const char *dir) {
+	std::vector<std::string> paths;
+	std::vector<char> contents(SYNTHETIC_FILE_SIZE, '#');
+	for (int i = 0; i < SYNTHETIC_FILES; i++) {
+		char path[512];
+		snprintf(path, sizeof(path), "%s/asset_%05d.glsl", dir, i);
+		FILE *file = fopen(path, "wb");
+		if (!file) {
+			break;
+		}
+		fwrite(contents.data(), 1, contents.size(), file);
+		fclose(file);
+		paths.push_back(path);
+	}
+	return paths;
+}
+
+
+// both return how many reads failed
+static int bench_textures(FILE_READER *readers, int reader_count) {
+	std::vector<std::string> paths = list_textures("textures");
+	if (paths.empty()) {
+		printf("no textures found, run from the repository root\n");
+		return 1;
+	}
+
+	size_t decoded_bytes = 0;
+	double start = now_seconds();
+	for (int pass = 0; pass < TEXTURE_PASSES; pass++) {
+		for (const std::string &path : paths) {
+			int w, h, c;
+			unsigned char *pixels = stbi_load(path.c_str(), &w, &h, &c, 0);
+			if (pixels) decoded_bytes += (size_t)w * h * c;
+			stbi_image_free(pixels);
+		}
+	}
+	double baseline = (now_seconds() - start) / TEXTURE_PASSES;
+	printf("textures/ (%zu files, %.1f MB decoded per pass)\n", paths.size(),
+			decoded_bytes / (double)TEXTURE_PASSES / (1 << 20));
+	printf("  %-32s %8.2f ms\n", "stbi_load", baseline * 1000.0);
+
+	int total_failed = 0;
+	for (int r = 0; r < reader_count; r++) {
+		int failed = 0;
+		start = now_seconds();
+		for (int pass = 0; pass < TEXTURE_PASSES; pass++) {
+			failed += read_batch(&readers[r], paths, [](FILE_READ *read) {
+				int w, h, c;
+				unsigned char *pixels = decode_texture(read->data, (int)read->size, &w, &h, &c);
+				free_texture_pixels(pixels);
+			});
+		}
+		double elapsed = (now_seconds() - start) / TEXTURE_PASSES;
+		printf("  %-32s %8.2f ms  (%.2fx)\n", get_reader_backend_name(&readers[r]),
+				elapsed * 1000.0, baseline / elapsed);
+		print_failures(failed);
+		total_failed += failed;
+	}
+	return total_failed;
+}
+
+
+static int bench_synthetic(FILE_READER *readers, int reader_count) {
+	char dir[] = "/tmp/file_read_bench_XXXXXX";
+	if (!mkdtemp(dir)) {
+		perror("mkdtemp");
+		return 1;
+	}
+
+	std::vector<std::string> paths = make_synthetic_files(dir);
+	printf("synthetic (%zu files of %d bytes)\n", paths.size(), SYNTHETIC_FILE_SIZE);
+
+	double start = now_seconds();
+	for (const std::string &path : paths) {
+		free(load_shader(path.c_str()));
+	}
+	double baseline = now_seconds() - start;
+	printf("  %-32s %8.2f ms  %9.0f files/s\n", "load_shader (stdio)",
+			baseline * 1000.0, paths.size() / baseline);
+
+	int total_failed = 0;
+	for (int r = 0; r < reader_count; r++) {
+		start = now_seconds();
+		int failed = read_batch(&readers[r], paths, [](FILE_READ *) {});
+		double elapsed = now_seconds() - start;
+		printf("  %-32s %8.2f ms  %9.0f files/s  (%.2fx)\n", get_reader_backend_name(&readers[r]),
+				elapsed * 1000.0, paths.size() / elapsed, baseline / elapsed);
+		print_failures(failed);
+		total_failed += failed;
+	}
+
+	for (const std::string &path : paths) {
+		unlink(path.c_str());
+	}
+	rmdir(dir);
+	return total_failed;
+}
+
+
+int main() {
+	static FILE_READER readers[2];
+	int reader_count = 0;
+	if (init_file_reader(&readers[reader_count], READER_IO_URING)) reader_count++;
+	if (init_file_reader(&readers[reader_count], READER_THREAD_POOL)) reader_count++;
+
+	int failed = bench_textures(readers, reader_count);
+	failed += bench_synthetic(readers, reader_count);
+
+	for (int r = 0; r < reader_count; r++) {
+		shutdown_file_reader(&readers[r]);
+	}
+	// a failed read costs nothing, so the timings above only hold without any
+	if (failed) {
+		fprintf(stderr, "ERROR:FILE_READ_BENCH:READS_FAILED %d\n", failed);
+		return 1;
+	}
+	return 0;
+}
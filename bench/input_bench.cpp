@@ -0,0 +1,195 @@
+// input path benchmark: a synthetic 1000Hz mouse and WASD stream at 60Hz,
+// applied per event (a camera update for every cursor event and held key)
+// against queued and coalesced (one drain and one camera update per frame).
+// The coalesced frames are then recorded and replayed through the sim twice to
+// check replays are deterministic; pass a file from main --record-input to
+// replay that instead
+#include <glm/glm.hpp>
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+#include "../camera.h"
+#include "../input.h"
+#include "../simulation.h"
+
+const int FRAMES			= 20000;
+const int EVENTS_PER_FRAME	= 17;	// 1000Hz mouse over a 60Hz frame
+const int PASSES			= 5;
+const char *RECORDING_PATH	= "/tmp/input_bench.rec";
+
+// what the window callbacks would have seen
+typedef struct {
+	double cursor[EVENTS_PER_FRAME][2];
+	unsigned int keys;
+	double frame_time;
+} RAW_FRAME;
+
+
+static double now_seconds() {
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+
+static std::vector<RAW_FRAME> make_stream() {
+	std::vector<RAW_FRAME> stream(FRAMES);
+	unsigned int seed = 1;
+	double x = 400.0, y = 300.0;
+	for (int f = 0; f < FRAMES; f++) {
+		RAW_FRAME *frame = &stream[f];
+		for (int e = 0; e < EVENTS_PER_FRAME; e++) {
+			seed = seed * 1664525u + 1013904223u;
+			x += (double)((seed >> 8) % 9) - 4.0;
+			y += (double)((seed >> 16) % 7) - 3.0;
+			frame->cursor[e][0] = x;
+			frame->cursor[e][1] = y;
+		}
+		// a different key chord every half second, sometimes two keys at once
+		frame->keys = (unsigned int)((f / 30) * 7 % 16);
+		frame->frame_time = 1.0 / 60.0 + ((seed >> 4) % 100) * 1e-5;
+	}
+	return stream;
+}
+
+
+// the old shape: every event turns the camera and rebuilds its vectors,
+// every held key moves it on its own
+static double run_per_event(const std::vector<RAW_FRAME> &stream, CAMERA *cam) {
+	const CAMERA_MOVEMENTS directions[4] = { FORWARD, BACKWARD, LEFT, RIGHT };
+	double last_x = stream[0].cursor[0][0], last_y = stream[0].cursor[0][1];
+	double start = now_seconds();
+	for (const RAW_FRAME &frame : stream) {
+		for (int e = 0; e < EVENTS_PER_FRAME; e++) {
+			get_cam_mouse_input(cam, (float)(frame.cursor[e][0] - last_x), (float)(last_y - frame.cursor[e][1]));
+			update_cam_vecs(cam);
+			last_x = frame.cursor[e][0];
+			last_y = frame.cursor[e][1];
+		}
+		for (int k = 0; k < 4; k++) {
+			if (frame.keys & (1u << k)) {
+				get_cam_keyboard_input(cam, directions[k], (float)frame.frame_time);
+			}
+		}
+		update_cam_vecs(cam);
+	}
+	return now_seconds() - start;
+}
+
+
+static const int KEY_CODES[4] = { 'W', 'S', 'A', 'D' };
+
+static double run_coalesced(const std::vector<RAW_FRAME> &stream, CAMERA *cam, std::vector<INPUT_FRAME> *frames) {
+	static INPUT_QUEUE queue;
+	INPUT_STATE state;
+	init_input_queue(&queue);
+	init_input_state(&state);
+	unsigned int held = 0;
+	if (frames) {
+		frames->clear();
+	}
+
+	double start = now_seconds();
+	for (const RAW_FRAME &frame : stream) {
+		for (int k = 0; k < 4; k++) {
+			if ((frame.keys ^ held) & (1u << k)) {
+				push_key_event(&queue, KEY_CODES[k], frame.keys & (1u << k));
+			}
+		}
+		held = frame.keys;
+		for (int e = 0; e < EVENTS_PER_FRAME; e++) {
+			push_cursor_event(&queue, frame.cursor[e][0], frame.cursor[e][1]);
+		}
+
+		INPUT_FRAME input = drain_input_queue(&queue, &state);
+		input.frame_time = frame.frame_time;
+		get_cam_mouse_input(cam, input.mouse_dx, input.mouse_dy);
+		float forward	= (input.keys & INPUT_FORWARD ? 1.0f : 0.0f) - (input.keys & INPUT_BACKWARD ? 1.0f : 0.0f);
+		float strafe	= (input.keys & INPUT_RIGHT ? 1.0f : 0.0f) - (input.keys & INPUT_LEFT ? 1.0f : 0.0f);
+		get_cam_movement_input(cam, forward, strafe, (float)input.frame_time);
+		update_cam_vecs(cam);
+		if (frames) {
+			frames->push_back(input);
+		}
+	}
+	return now_seconds() - start;
+}
+
+
+// the frame loop from main.cpp minus the window
+static SIM_STATE replay_sim(INPUT_RECORDING *recording) {
+	CAMERA cam = create_camera();
+	SIM_STATE state = create_sim_state(&cam, MAX_CUBES);
+	SIM_CLOCK clock = create_sim_clock();
+	SIM_INPUT input = {};
+	recording->next = 0;
+
+	INPUT_FRAME frame;
+	while (next_replay_frame(recording, &frame)) {
+		input.keys		= frame.keys;
+		input.mouse_dx	+= frame.mouse_dx;
+		input.mouse_dy	+= frame.mouse_dy;
+		input.scroll	+= frame.scroll;
+		int ticks = advance_sim_clock(&clock, frame.frame_time);
+		for (int t = 0; t < ticks; t++) {
+			simulate_tick(&state, &input, (float)clock.tick_time);
+		}
+	}
+	return state;
+}
+
+
+int main(int argc, char **argv) {
+	// keys come in as GLFW codes; the letters match GLFW_KEY_W and friends
+	if (get_input_key_bit('W') != INPUT_FORWARD) {
+		printf("key table does not match\n");
+		return 1;
+	}
+
+	std::vector<RAW_FRAME> stream = make_stream();
+	printf("%d frames, %d cursor events per frame, best of %d passes\n", FRAMES, EVENTS_PER_FRAME, PASSES);
+
+	double per_event = 1e30, coalesced = 1e30;
+	CAMERA a, b;
+	std::vector<INPUT_FRAME> frames;
+	for (int pass = 0; pass < PASSES; pass++) {
+		a = create_camera();
+		b = create_camera();
+		double t = run_per_event(stream, &a);
+		per_event = t < per_event ? t : per_event;
+		t = run_coalesced(stream, &b, &frames);
+		coalesced = t < coalesced ? t : coalesced;
+	}
+	printf("per event:  %8.1f ns/frame\n", per_event * 1e9 / FRAMES);
+	printf("coalesced:  %8.1f ns/frame  (%.1fx)\n", coalesced * 1e9 / FRAMES, per_event / coalesced);
+	printf("final camera difference: position %g, yaw %g, pitch %g\n", glm::length(a.position - b.position),
+			a.yaw - b.yaw, a.pitch - b.pitch);
+
+	const char *path = argc > 1 ? argv[1] : RECORDING_PATH;
+	if (argc <= 1) {
+		INPUT_RECORDING recording;
+		if (!start_input_recording(&recording, path)) {
+			return 1;
+		}
+		for (const INPUT_FRAME &frame : frames) {
+			record_input_frame(&recording, &frame);
+		}
+		stop_input_recording(&recording);
+	}
+
+	INPUT_RECORDING replay;
+	if (!load_input_replay(&replay, path)) {
+		return 1;
+	}
+	double start = now_seconds();
+	SIM_STATE first = replay_sim(&replay);
+	double elapsed = now_seconds() - start;
+	SIM_STATE second = replay_sim(&replay);
+	bool same = !memcmp(&first.cam.position, &second.cam.position, sizeof(glm::vec3))
+			&& first.cam.yaw == second.cam.yaw && first.cam.pitch == second.cam.pitch && first.tick == second.tick;
+	printf("replayed %zu frames (%llu ticks) in %.2f ms, second replay %s\n", replay.frames.size(), first.tick,
+			elapsed * 1000.0, same ? "identical" : "DIFFERS");
+	return same ? 0 : 1;
+}
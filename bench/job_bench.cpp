@@ -0,0 +1,92 @@
+// transform-update scaling benchmark for the job system: the cube field from
+// main.cpp tiled out to a few hundred thousand instances, rebuilt every pass
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <thread>
+
+#include "../job_system.h"
+
+const int TRANSFORM_COUNT	= 1 << 18;
+const int BATCH_SIZE		= 256;
+const int PASSES			= 20;
+
+static const glm::vec3 cubePositions[] = {
+	glm::vec3( 0.0f,  0.0f,   0.0f),
+	glm::vec3( 2.0f,  5.0f, -15.0f),
+	glm::vec3(-1.5f, -2.2f,  -2.5f),
+	glm::vec3(-3.8f, -2.0f, -12.3f),
+	glm::vec3( 2.4f, -0.4f,  -3.5f),
+	glm::vec3(-1.7f,  3.0f,  -7.5f),
+	glm::vec3( 1.3f, -2.0f,  -2.5f),
+	glm::vec3( 1.5f,  2.0f,  -2.5f),
+	glm::vec3( 1.5f,  0.2f,  -1.5f),
+	glm::vec3(-1.3f,  1.0f,  -1.5f)
+};
+
+typedef struct {
+	glm::vec3 *positions;
+	float *angles;
+	glm::mat4 *models;
+} TRANSFORM_DATA;
+
+
+static double now_seconds() {
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+
+static void update_transforms(void *data, int begin, int end) {
+	TRANSFORM_DATA *t = (TRANSFORM_DATA *)data;
+	for (int i = begin; i < end; i++) {
+		glm::mat4 model = glm::mat4(1.0f);
+		model = glm::translate(model, t->positions[i]);
+		model = glm::rotate(model, glm::radians(t->angles[i]), glm::vec3(1.0f, 0.3f, 0.5f));
+		t->models[i] = model;
+	}
+}
+
+
+int main(int argc, char **argv) {
+	int max_workers = argc > 1 ? atoi(argv[1]) : static_cast<int>(std::thread::hardware_concurrency());
+	if (max_workers < 1) max_workers = 1;
+
+	TRANSFORM_DATA data;
+	data.positions	= new glm::vec3[TRANSFORM_COUNT];
+	data.angles		= new float[TRANSFORM_COUNT];
+	data.models		= new glm::mat4[TRANSFORM_COUNT];
+	for (int i = 0; i < TRANSFORM_COUNT; i++) {
+		glm::vec3 tile = glm::vec3((i / 10) % 64, (i / 640) % 64, i / 40960) * 20.0f;
+		data.positions[i]	= cubePositions[i % 10] + tile;
+		data.angles[i]		= 20.0f * (i % 10);
+	}
+
+	printf("%d transforms, batch %d, %d passes\n", TRANSFORM_COUNT, BATCH_SIZE, PASSES);
+	printf("workers   Mtransforms/s   speedup\n");
+
+	double base_rate = 0.0;
+	for (int workers = 1; workers <= max_workers; workers++) {
+		init_job_system(workers);
+		parallel_for(TRANSFORM_COUNT, BATCH_SIZE, update_transforms, &data);	// warm up
+
+		double start = now_seconds();
+		for (int pass = 0; pass < PASSES; pass++) {
+			parallel_for(TRANSFORM_COUNT, BATCH_SIZE, update_transforms, &data);
+		}
+		double elapsed = now_seconds() - start;
+		shutdown_job_system();
+
+		double rate = (double)TRANSFORM_COUNT * PASSES / elapsed / 1e6;
+		if (workers == 1) base_rate = rate;
+		printf("%7d   %13.2f   %6.2fx\n", workers, rate, rate / base_rate);
+	}
+
+	delete[] data.positions;
+	delete[] data.angles;
+	delete[] data.models;
+	return 0;
+}
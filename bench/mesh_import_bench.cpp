@@ -0,0 +1,317 @@
+// mesh import benchmark: a GRID x GRID heightfield of about a million
+// triangles written as OBJ text and as glTF (JSON and a .bin), then parse
+// throughput of each importer at 1, 2, 4... workers up to the machine's
+// thread count (or argv[1]), the whole text import (parse, weld, tangents)
+// into the mesh pool against mapping the cooked file into it, and a check
+// that every path gives the same mesh. Files go to a temporary directory.
+// run from the repository root; the page cache is warm after the first pass
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../job_system.h"
+#include "../mesh_import.h"
+#include "../mesh_pool.h"
+
+const int GRID		= 708;		// quads per side, 2 * GRID^2 triangles
+const int PASSES	= 3;
+
+typedef struct {
+	std::vector<LIT_VERTEX> vertices;
+	std::vector<uint32_t> indices;
+} SOURCE_MESH;
+
+
+static double now_ms() {
+	using namespace std::chrono;
+	return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+
+static size_t file_size(const std::string &path) {
+	struct stat info;
+	return stat(path.c_str(), &info) == 0 ? info.st_size : 0;
+}
+
+
+static std::vector<char> read_text(const std::string &path) {
+	std::vector<char> text(file_size(path));
+	FILE *file = fopen(path.c_str(), "rb");
+	if (file) {
+		text.resize(fread(text.data(), 1, text.size(), file));
+		fclose(file);
+	}
+	return text;
+}
+
+
+// rolling hills with exact normals, so the files carry everything but tangents
+static SOURCE_MESH make_heightfield() {
+	SOURCE_MESH mesh;
+	for (int y = 0; y <= GRID; y++) {
+		for (int x = 0; x <= GRID; x++) {
+			float u = (float)x / GRID, v = (float)y / GRID;
+			float a = u * 12.0f, b = v * 9.0f;
+			LIT_VERTEX vertex = {};
+			vertex.position = glm::vec3(u * 10.0f - 5.0f, 0.3f * sinf(a) * cosf(b), v * 10.0f - 5.0f);
+			glm::vec3 dx(1.0f, 0.3f * cosf(a) * cosf(b) * 12.0f / 10.0f, 0.0f);
+			glm::vec3 dz(0.0f, -0.3f * sinf(a) * sinf(b) * 9.0f / 10.0f, 1.0f);
+			vertex.normal = glm::normalize(glm::cross(dz, dx));
+			vertex.uv = glm::vec2(u, v);
+			mesh.vertices.push_back(vertex);
+		}
+	}
+	for (int y = 0; y < GRID; y++) {
+		for (int x = 0; x < GRID; x++) {
+			uint32_t i = y * (GRID + 1) + x;
+			uint32_t quad[6] = { i, i + GRID + 1, i + 1, i + 1, i + GRID + 1, i + GRID + 2 };
+			mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+		}
+	}
+	return mesh;
+}
+
+
+static bool write_obj(const SOURCE_MESH *mesh, const std::string &path) {
+	FILE *file = fopen(path.c_str(), "wb");
+	if (!file) {
+		return false;
+	}
+	fprintf(file, "# mesh_import_bench heightfield\no hills\n");
+	for (const LIT_VERTEX &v : mesh->vertices) {
+		fprintf(file, "v %.6f %.6f %.6f\n", v.position.x, v.position.y, v.position.z);
+	}
+	for (const LIT_VERTEX &v : mesh->vertices) {
+		fprintf(file, "vt %.6f %.6f\n", v.uv.x, v.uv.y);
+	}
+	for (const LIT_VERTEX &v : mesh->vertices) {
+		fprintf(file, "vn %.6f %.6f %.6f\n", v.normal.x, v.normal.y, v.normal.z);
+	}
+	for (size_t t = 0; t < mesh->indices.size(); t += 3) {
+		uint32_t a = mesh->indices[t] + 1, b = mesh->indices[t + 1] + 1, c = mesh->indices[t + 2] + 1;
+		fprintf(file, "f %u/%u/%u %u/%u/%u %u/%u/%u\n", a, a, a, b, b, b, c, c, c);
+	}
+	return fclose(file) == 0;
+}
+
+
+// positions, normals and uvs interleaved in one view, indices in another;
+// uvs flipped to glTF's top-left origin
+static bool write_gltf(const SOURCE_MESH *mesh, const std::string &dir) {
+	std::vector<float> interleaved;
+	for (const LIT_VERTEX &v : mesh->vertices) {
+		float vertex[8] = { v.position.x, v.position.y, v.position.z, v.normal.x, v.normal.y, v.normal.z,
+				v.uv.x, 1.0f - v.uv.y };
+		interleaved.insert(interleaved.end(), vertex, vertex + 8);
+	}
+	size_t vertex_bytes = interleaved.size() * sizeof(float);
+	size_t index_bytes = mesh->indices.size() * sizeof(uint32_t);
+	FILE *bin = fopen((dir + "/hills.bin").c_str(), "wb");
+	if (!bin) {
+		return false;
+	}
+	bool written = fwrite(interleaved.data(), 1, vertex_bytes, bin) == vertex_bytes
+			&& fwrite(mesh->indices.data(), 1, index_bytes, bin) == index_bytes;
+	written = fclose(bin) == 0 && written;
+
+	FILE *file = fopen((dir + "/hills.gltf").c_str(), "wb");
+	if (!file) {
+		return false;
+	}
+	size_t count = mesh->vertices.size();
+	fprintf(file,
+		"{\n"
+		"  \"asset\": { \"version\": \"2.0\" },\n"
+		"  \"scene\": 0,\n"
+		"  \"scenes\": [ { \"nodes\": [ 0 ] } ],\n"
+		"  \"nodes\": [ { \"name\": \"hills\", \"mesh\": 0 } ],\n"
+		"  \"meshes\": [ { \"primitives\": [ { \"attributes\": { \"POSITION\": 0, \"NORMAL\": 1, \"TEXCOORD_0\": 2 },"
+		" \"indices\": 3 } ] } ],\n"
+		"  \"buffers\": [ { \"uri\": \"hills.bin\", \"byteLength\": %zu } ],\n"
+		"  \"bufferViews\": [\n"
+		"    { \"buffer\": 0, \"byteOffset\": 0, \"byteLength\": %zu, \"byteStride\": 32 },\n"
+		"    { \"buffer\": 0, \"byteOffset\": %zu, \"byteLength\": %zu }\n"
+		"  ],\n"
+		"  \"accessors\": [\n"
+		"    { \"bufferView\": 0, \"byteOffset\": 0, \"componentType\": 5126, \"count\": %zu, \"type\": \"VEC3\" },\n"
+		"    { \"bufferView\": 0, \"byteOffset\": 12, \"componentType\": 5126, \"count\": %zu, \"type\": \"VEC3\" },\n"
+		"    { \"bufferView\": 0, \"byteOffset\": 24, \"componentType\": 5126, \"count\": %zu, \"type\": \"VEC2\" },\n"
+		"    { \"bufferView\": 1, \"componentType\": 5125, \"count\": %zu, \"type\": \"SCALAR\" }\n"
+		"  ]\n"
+		"}\n",
+		vertex_bytes + index_bytes, vertex_bytes, vertex_bytes, index_bytes, count, count, count,
+		mesh->indices.size());
+	return fclose(file) == 0 && written;
+}
+
+
+// largest position difference, or -1 when the triangles do not line up
+static float compare_meshes(const SOURCE_MESH *source, const IMPORTED_MESH *mesh) {
+	if (mesh->indices.size() != source->indices.size()) {
+		return -1.0f;
+	}
+	float worst = 0.0f;
+	for (size_t i = 0; i < source->indices.size(); i++) {
+		glm::vec3 a = source->vertices[source->indices[i]].position;
+		glm::vec3 b = mesh->vertices[mesh->indices[i]].position;
+		glm::vec3 d = glm::abs(a - b);
+		worst = fmaxf(worst, fmaxf(d.x, fmaxf(d.y, d.z)));
+	}
+	return worst;
+}
+
+
+// best of PASSES, in milliseconds
+template <typename FUNC>
+static double best_time(FUNC func) {
+	double best = 1e30;
+	for (int pass = 0; pass < PASSES; pass++) {
+		double start = now_ms();
+		func();
+		double elapsed = now_ms() - start;
+		best = elapsed < best ? elapsed : best;
+	}
+	return best;
+}
+
+
+int main(int argc, char **argv) {
+	int max_workers = argc > 1 ? atoi(argv[1]) : static_cast<int>(std::thread::hardware_concurrency());
+	if (max_workers < 1) max_workers = 1;
+
+	GLFWwindow *window = NULL;
+	if (glfwInit()) {
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		window = glfwCreateWindow(64, 64, "mesh_import_bench", NULL, NULL);
+	}
+	if (!window) {
+		printf("no GL context\n");
+		return 1;
+	}
+	glfwMakeContextCurrent(window);
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+		printf("could not load GL\n");
+		return 1;
+	}
+	init_job_system(max_workers);
+
+	char dir[] = "/tmp/mesh_import_bench_XXXXXX";
+	if (!mkdtemp(dir)) {
+		printf("could not create a temporary directory\n");
+		return 1;
+	}
+	std::string obj_path = std::string(dir) + "/hills.obj";
+	std::string gltf_path = std::string(dir) + "/hills.gltf";
+	std::string cooked_path = std::string(dir) + "/hills.mesh";
+	SOURCE_MESH source = make_heightfield();
+	if (!write_obj(&source, obj_path) || !write_gltf(&source, dir)) {
+		printf("could not write the model files\n");
+		return 1;
+	}
+	printf("%zu vertices, %zu triangles, %d hardware threads\n", source.vertices.size(), source.indices.size() / 3,
+			(int)std::thread::hardware_concurrency());
+
+	// parsing alone, from memory, on a growing job system; the glTF is one
+	// primitive, so this is the batching inside it
+	std::vector<char> obj_text = read_text(obj_path);
+	std::vector<char> gltf_json = read_text(gltf_path);
+	size_t gltf_bytes = gltf_json.size() + file_size(std::string(dir) + "/hills.bin");
+	IMPORTED_MESH obj_mesh, gltf_mesh;
+	double obj_single = 0.0, gltf_single = 0.0;
+	printf("%-8s %12s %9s %14s %9s\n", "workers", "OBJ MB/s", "speedup", "glTF MB/s", "speedup");
+	for (int workers = 1; ; workers = workers * 2 < max_workers ? workers * 2 : max_workers) {
+		shutdown_job_system();
+		init_job_system(workers);
+		double obj_ms = best_time([&] { obj_mesh = {}; import_obj(obj_text.data(), obj_text.size(), &obj_mesh); });
+		double gltf_ms = best_time([&] {
+			gltf_mesh = {};
+			import_gltf((const unsigned char *)gltf_json.data(), gltf_json.size(), gltf_path.c_str(), &gltf_mesh);
+		});
+		obj_single = workers == 1 ? obj_ms : obj_single;
+		gltf_single = workers == 1 ? gltf_ms : gltf_single;
+		printf("%-8d %12.1f %8.2fx %14.1f %8.2fx\n", workers, obj_text.size() / 1e3 / obj_ms, obj_single / obj_ms,
+				gltf_bytes / 1e3 / gltf_ms, gltf_single / gltf_ms);
+		if (workers == max_workers) {
+			break;
+		}
+	}
+	printf("%-28s %8.1f MB, largest position error %g\n", "OBJ", obj_text.size() / 1e6,
+			compare_meshes(&source, &obj_mesh));
+	printf("%-28s %8.1f MB, largest position error %g\n", "glTF (JSON + .bin)", gltf_bytes / 1e6,
+			compare_meshes(&source, &gltf_mesh));
+
+	// what import_mesh adds on top of parsing
+	IMPORTED_MESH processed;
+	double weld_ms = best_time([&] { processed = obj_mesh; weld_vertices(&processed); });
+	double tangent_ms = best_time([&] { generate_tangents(&processed); });
+	double normal_ms = best_time([&] { IMPORTED_MESH copy = processed; generate_normals(&copy); });
+	printf("%-28s %9.1f ms, %zu -> %zu vertices\n", "weld", weld_ms, obj_mesh.vertices.size(),
+			processed.vertices.size());
+	printf("%-28s %9.1f ms\n", "tangents", tangent_ms);
+	printf("%-28s %9.1f ms (only when the file has none)\n", "normals", normal_ms);
+
+	// text against cooked, all the way into the mesh pool
+	IMPORTED_MESH imported;
+	if (!import_mesh(obj_path.c_str(), &imported) || !cook_mesh(&imported, cooked_path.c_str())) {
+		printf("could not cook %s\n", obj_path.c_str());
+		return 1;
+	}
+	double cook_ms = best_time([&] { cook_mesh(&imported, cooked_path.c_str()); });
+	MESH_POOL pool;
+	init_mesh_pool(&pool);
+	int mesh = -1;
+	double text_ms = best_time([&] {
+		remove_mesh(&pool, mesh);
+		mesh = load_mesh_file(&pool, obj_path.c_str());
+		glFinish();
+	});
+	double cooked_ms = best_time([&] {
+		remove_mesh(&pool, mesh);
+		mesh = load_mesh_file(&pool, cooked_path.c_str());
+		glFinish();
+	});
+	double map_ms = best_time([&] {
+		COOKED_MESH cooked;
+		map_cooked_mesh(cooked_path.c_str(), &cooked);
+		unmap_cooked_mesh(&cooked);
+	});
+	printf("%-28s %9.1f ms, %.1f MB\n", "cook", cook_ms, file_size(cooked_path) / 1e6);
+	printf("%-28s %9.1f ms\n", "load .obj into the pool", text_ms);
+	printf("%-28s %9.1f ms  %.1fx faster, mapping alone %.2f ms\n", "load cooked into the pool", cooked_ms,
+			text_ms / cooked_ms, map_ms);
+
+	// the cooked bytes are exactly what the import produced
+	COOKED_MESH cooked;
+	bool same = map_cooked_mesh(cooked_path.c_str(), &cooked)
+			&& cooked.header->vertex_count == (int)imported.vertices.size()
+			&& cooked.header->index_count == (int)imported.indices.size()
+			&& !memcmp(cooked.vertices, imported.vertices.data(), imported.vertices.size() * sizeof(LIT_VERTEX))
+			&& !memcmp(cooked.indices, imported.indices.data(), imported.indices.size() * sizeof(uint32_t));
+	unmap_cooked_mesh(&cooked);
+	printf("cooked file matches the import: %s, pool holds mesh %d (%d indices)\n", same ? "yes" : "NO", mesh,
+			mesh >= 0 ? get_mesh(&pool, mesh)->index_count : 0);
+
+	destroy_mesh_pool(&pool);
+	const char *names[] = { "hills.obj", "hills.gltf", "hills.bin", "hills.mesh" };
+	for (const char *name : names) {
+		unlink((std::string(dir) + "/" + name).c_str());
+	}
+	rmdir(dir);
+	shutdown_job_system();
+	glfwDestroyWindow(window);
+	glfwTerminate();
+	return 0;
+}
@@ -0,0 +1,352 @@
+// mesh pool benchmark: MESHES small indexed meshes of random sizes drawn one
+// draw call each, every mesh with its own VAO, vertex and index buffer (what
+// main.cpp's cube did) against all of them in the mesh pool behind one VAO
+// with base-vertex draws. Then churn: half the meshes removed and as many
+// added at other sizes, the occupancy and fragmentation that leaves, and
+// defragmentation run to completion a budget at a time, checking the picture
+// is the same before and after. Ends with the range allocator alone.
+// run from the repository root; without a GPU the numbers are llvmpipe's
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+
+#include "../gl_ext.h"
+#include "../mesh_pool.h"
+#include "../shader.h"
+
+const int MESHES		= 4096;
+const int TARGET_SIZE	= 256;
+const int GRID			= 64;		// meshes per row on screen
+const int WARMUP		= 3;
+const int PASSES		= 20;
+const int ALLOC_OPS		= 1000000;
+
+static const char *vertex_source =
+	"#version 330 core\n"
+	"layout (location = 0) in vec3 position;\n"
+	"uniform vec3 place;\n"
+	"out vec3 tint;\n"
+	"void main() {\n"
+	"	gl_Position = vec4(position.xy * place.z + place.xy, 0.0, 1.0);\n"
+	"	tint = fract(position * 3.7 + 0.5);\n"
+	"}\n";
+
+static const char *fragment_source =
+	"#version 330 core\n"
+	"in vec3 tint;\n"
+	"out vec4 color;\n"
+	"void main() {\n"
+	"	color = vec4(tint, 1.0);\n"
+	"}\n";
+
+typedef struct {
+	std::vector<float> vertices;	// VERTEX_POS_UV
+	std::vector<unsigned int> indices;
+} MESH_DATA;
+
+// one mesh drawn the old way
+typedef struct {
+	unsigned int VAO;
+	unsigned int VBO;
+	unsigned int EBO;
+	int index_count;
+} SEPARATE_MESH;
+
+static unsigned int random_state = 12345;
+static int place_uniform;
+
+
+static unsigned int next_random() {
+	random_state = random_state * 1664525u + 1013904223u;
+	return random_state >> 8;
+}
+
+
+static double now_ms() {
+	using namespace std::chrono;
+	return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+
+// a bumpy (w + 1) x (h + 1) grid in the unit square
+static MESH_DATA make_grid(int w, int h) {
+	MESH_DATA mesh;
+	for (int y = 0; y <= h; y++) {
+		for (int x = 0; x <= w; x++) {
+			float vertex[5] = { (float)x / w - 0.5f, (float)y / h - 0.5f, (next_random() % 100) * 0.01f, 0.0f, 0.0f };
+			mesh.vertices.insert(mesh.vertices.end(), vertex, vertex + 5);
+		}
+	}
+	for (int y = 0; y < h; y++) {
+		for (int x = 0; x < w; x++) {
+			unsigned int i = y * (w + 1) + x;
+			unsigned int quad[6] = { i, i + 1, i + w + 2, i, i + w + 2, i + w + 1 };
+			mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+		}
+	}
+	return mesh;
+}
+
+
+static MESH_DATA random_mesh() {
+	return make_grid(1 + next_random() % 8, 1 + next_random() % 8);
+}
+
+
+static SEPARATE_MESH upload_separate(const MESH_DATA *data) {
+	SEPARATE_MESH mesh;
+	glGenVertexArrays(1, &mesh.VAO);
+	glBindVertexArray(mesh.VAO);
+	glGenBuffers(1, &mesh.VBO);
+	glBindBuffer(GL_ARRAY_BUFFER, mesh.VBO);
+	glBufferData(GL_ARRAY_BUFFER, data->vertices.size() * sizeof(float), data->vertices.data(), GL_STATIC_DRAW);
+	glGenBuffers(1, &mesh.EBO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, data->indices.size() * sizeof(unsigned int), data->indices.data(),
+			GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), NULL);
+	glEnableVertexAttribArray(0);
+	glBindVertexArray(0);
+	mesh.index_count = (int)data->indices.size();
+	return mesh;
+}
+
+
+static int add_pool_mesh(MESH_POOL *pool, const MESH_DATA *data) {
+	return add_mesh(pool, VERTEX_POS_UV, data->vertices.data(), (int)data->vertices.size() / 5, data->indices.data(),
+			(int)data->indices.size());
+}
+
+
+static void set_place(int slot) {
+	float cell = 2.0f / GRID;
+	glUniform3f(place_uniform, -1.0f + (slot % GRID + 0.5f) * cell, -1.0f + (slot / GRID + 0.5f) * cell, cell);
+}
+
+
+static void draw_separate(const std::vector<SEPARATE_MESH> &meshes) {
+	for (size_t i = 0; i < meshes.size(); i++) {
+		set_place((int)i);
+		glBindVertexArray(meshes[i].VAO);
+		glDrawElements(GL_TRIANGLES, meshes[i].index_count, GL_UNSIGNED_INT, NULL);
+	}
+}
+
+
+// slots follow the mesh list, so the picture only depends on what is drawn
+static void draw_pooled(const MESH_POOL *pool, const std::vector<int> &meshes) {
+	unsigned int bound_vao = 0;
+	for (size_t i = 0; i < meshes.size(); i++) {
+		set_place((int)i);
+		unsigned int vao = get_mesh_vao(pool, meshes[i]);
+		if (vao != bound_vao) {
+			glBindVertexArray(vao);
+			bound_vao = vao;
+		}
+		draw_mesh_instanced(pool, meshes[i], 1);
+	}
+}
+
+
+typedef struct {
+	double cpu_ms;
+	double frame_ms;
+} FRAME_TIMES;
+
+
+template <typename DRAW>
+static FRAME_TIMES time_frames(DRAW draw) {
+	FRAME_TIMES times = {};
+	for (int pass = 0; pass < WARMUP + PASSES; pass++) {
+		glFinish();
+		double start = now_ms();
+		glClear(GL_COLOR_BUFFER_BIT);
+		draw();
+		double submitted = now_ms();
+		glFinish();
+		if (pass >= WARMUP) {
+			times.cpu_ms += (submitted - start) / PASSES;
+			times.frame_ms += (now_ms() - start) / PASSES;
+		}
+	}
+	return times;
+}
+
+
+static std::vector<unsigned char> read_target() {
+	std::vector<unsigned char> pixels(TARGET_SIZE * TARGET_SIZE * 4);
+	glFinish();
+	glReadPixels(0, 0, TARGET_SIZE, TARGET_SIZE, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+	return pixels;
+}
+
+
+static void print_occupancy(const char *label, const MESH_POOL *pool) {
+	MESH_POOL_STATS stats = get_mesh_pool_stats(pool);
+	const RANGE_STATS *vertices = &stats.vertices[VERTEX_POS_UV];
+	printf("%-22s %6d meshes, %7.1f of %7.1f KB used, vertices %5.1f%% (%d free runs, %.2f fragmented), "
+			"indices %5.1f%% (%d free runs, %.2f fragmented)\n",
+			label, stats.meshes, stats.used_bytes / 1024.0, stats.buffer_bytes / 1024.0,
+			100.0 * vertices->used / vertices->capacity, vertices->free_ranges, get_range_fragmentation(vertices),
+			100.0 * stats.indices.used / stats.indices.capacity, stats.indices.free_ranges,
+			get_range_fragmentation(&stats.indices));
+}
+
+
+static void bench_allocator() {
+	RANGE_ALLOCATOR allocator;
+	init_range_allocator(&allocator, 1 << 24);
+	std::vector<int> live;
+	double start = now_ms();
+	int failures = 0;
+	for (int op = 0; op < ALLOC_OPS; op++) {
+		if (live.size() < 4096 || (next_random() & 1)) {
+			int block = range_alloc(&allocator, 1 + next_random() % 4000);
+			if (block >= 0) {
+				live.push_back(block);
+			} else {
+				failures++;
+			}
+		} else {
+			size_t i = next_random() % live.size();
+			range_free(&allocator, live[i]);
+			live[i] = live.back();
+			live.pop_back();
+		}
+	}
+	double elapsed = now_ms() - start;
+	RANGE_STATS stats = get_range_stats(&allocator);
+	printf("range allocator: %.1f ns per alloc or free, %d live, %d free runs, %d failed\n",
+			elapsed * 1e6 / ALLOC_OPS, stats.live, stats.free_ranges, failures);
+}
+
+
+int main() {
+	GLFWwindow *window = NULL;
+	if (glfwInit()) {
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		window = glfwCreateWindow(TARGET_SIZE, TARGET_SIZE, "mesh_pool_bench", NULL, NULL);
+	}
+	if (!window) {
+		printf("no GL context, skipping\n");
+		bench_allocator();
+		return 0;
+	}
+	glfwMakeContextCurrent(window);
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+		printf("could not load GL\n");
+		return 1;
+	}
+	load_gl_extensions();
+
+	unsigned int vert = compile_vertex_shader(vertex_source);
+	unsigned int frag = compile_fragment_shader(fragment_source);
+	unsigned int program = create_shader_program(vert, frag);
+	glDeleteShader(vert);
+	glDeleteShader(frag);
+	glUseProgram(program);
+	place_uniform = glGetUniformLocation(program, "place");
+	glViewport(0, 0, TARGET_SIZE, TARGET_SIZE);
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+
+	std::vector<MESH_DATA> data(MESHES);
+	long long vertex_total = 0;
+	for (int i = 0; i < MESHES; i++) {
+		data[i] = random_mesh();
+		vertex_total += data[i].vertices.size() / 5;
+	}
+
+	std::vector<SEPARATE_MESH> separate(MESHES);
+	double start = now_ms();
+	for (int i = 0; i < MESHES; i++) {
+		separate[i] = upload_separate(&data[i]);
+	}
+	glFinish();
+	double separate_upload = now_ms() - start;
+
+	MESH_POOL pool;
+	std::vector<int> pooled(MESHES);
+	start = now_ms();
+	init_mesh_pool(&pool);
+	for (int i = 0; i < MESHES; i++) {
+		pooled[i] = add_pool_mesh(&pool, &data[i]);
+	}
+	glFinish();
+	double pool_upload = now_ms() - start;
+
+	printf("%d meshes, %lld vertices, %d draws per frame\n", MESHES, vertex_total, MESHES);
+	printf("%-22s %10s %10s %10s\n", "path", "upload ms", "cpu ms", "frame ms");
+	FRAME_TIMES separate_times = time_frames([&]() { draw_separate(separate); });
+	std::vector<unsigned char> separate_pixels = read_target();
+	printf("%-22s %10.2f %10.3f %10.3f\n", "VAO per mesh", separate_upload, separate_times.cpu_ms,
+			separate_times.frame_ms);
+	FRAME_TIMES pool_times = time_frames([&]() { draw_pooled(&pool, pooled); });
+	std::vector<unsigned char> pool_pixels = read_target();
+	printf("%-22s %10.2f %10.3f %10.3f  %.2fx cpu, picture %s\n", "mesh pool", pool_upload, pool_times.cpu_ms,
+			pool_times.frame_ms, separate_times.cpu_ms / pool_times.cpu_ms,
+			separate_pixels == pool_pixels ? "identical" : "DIFFERS");
+	for (SEPARATE_MESH &mesh : separate) {
+		glDeleteVertexArrays(1, &mesh.VAO);
+		glDeleteBuffers(1, &mesh.VBO);
+		glDeleteBuffers(1, &mesh.EBO);
+	}
+
+	// churn: every other mesh out, the same number in at new sizes
+	print_occupancy("loaded", &pool);
+	std::vector<int> kept;
+	for (int i = 0; i < MESHES; i++) {
+		if (next_random() & 1) {
+			remove_mesh(&pool, pooled[i]);
+		} else {
+			kept.push_back(pooled[i]);
+		}
+	}
+	print_occupancy("half removed", &pool);
+	int replaced = MESHES - (int)kept.size();
+	for (int i = 0; i < replaced; i++) {
+		MESH_DATA mesh = make_grid(1 + next_random() % 5, 1 + next_random() % 5);
+		kept.push_back(add_pool_mesh(&pool, &mesh));
+	}
+	print_occupancy("refilled smaller", &pool);
+
+	glClear(GL_COLOR_BUFFER_BIT);
+	draw_pooled(&pool, kept);
+	std::vector<unsigned char> before = read_target();
+	int calls = 0;
+	GLsizeiptr moved = 0;
+	double defrag_ms = 0.0;
+	double worst_ms = 0.0;
+	for (;;) {
+		start = now_ms();
+		GLsizeiptr step = defragment_mesh_pool(&pool);
+		glFinish();
+		double elapsed = now_ms() - start;
+		if (!step) {
+			break;
+		}
+		calls++;
+		moved += step;
+		defrag_ms += elapsed;
+		worst_ms = elapsed > worst_ms ? elapsed : worst_ms;
+	}
+	glClear(GL_COLOR_BUFFER_BIT);
+	draw_pooled(&pool, kept);
+	std::vector<unsigned char> after = read_target();
+	print_occupancy("defragmented", &pool);
+	printf("defragmentation: %d calls of %.0f KB budget, %.1f KB moved, %.2f ms total, %.2f ms worst call, "
+			"picture %s\n", calls, MESH_DEFRAG_BUDGET / 1024.0, moved / 1024.0, defrag_ms, worst_ms,
+			before == after ? "unchanged" : "CHANGED");
+
+	destroy_mesh_pool(&pool);
+	glDeleteProgram(program);
+	bench_allocator();
+	glfwDestroyWindow(window);
+	glfwTerminate();
+	return 0;
+}
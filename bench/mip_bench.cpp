@@ -0,0 +1,204 @@
+// mip generation benchmark: build_mip_chain (box and Kaiser, one worker and all
+// of them) against glGenerateMipmap on a hidden window, for every image in
+// textures/. The "box I/O" column calls it from a plain thread, as the asset
+// loader's I/O threads used to, with the rows handed to the workers. run from
+// the repository root; on a machine without a GPU the GL numbers are whatever
+// the software rasterizer (llvmpipe) manages
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../job_system.h"
+#include "../mipmap.h"
+#include "../stb_image.h"
+
+const int PASSES = 10;
+
+
+static double now_seconds() {
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+
+static std::vector<std::string> list_textures(const char *dir) {
+	std::vector<std::string> paths;
+	DIR *d = opendir(dir);
+	if (!d) {
+		return paths;
+	}
+
+	struct dirent *entry;
+	while ((entry = readdir(d)) != NULL) {
+		const char *ext = strrchr(entry->d_name, '.');
+		if (ext && (!strcmp(ext, ".jpg") || !strcmp(ext, ".jpeg") || !strcmp(ext, ".png"))) {
+			paths.push_back(std::string(dir) + "/" + entry->d_name);
+		}
+	}
+	closedir(d);
+	return paths;
+}
+
+
+typedef struct {
+	const unsigned char *pixels;
+	int width;
+	int height;
+	MIP_FILTER filter;
+	double elapsed;
+} CPU_RUN;
+
+
+// runs as a job so parallel_for below it has a worker to split rows from
+static void cpu_pass(void *data) {
+	CPU_RUN *run = (CPU_RUN *)data;
+	MIP_CHAIN chain;
+	double start = now_seconds();
+	for (int pass = 0; pass < PASSES; pass++) {
+		build_mip_chain(&chain, run->pixels, run->width, run->height, 4, run->filter);
+	}
+	run->elapsed = (now_seconds() - start) / PASSES;
+}
+
+
+static double time_cpu(const unsigned char *pixels, int width, int height, MIP_FILTER filter) {
+	CPU_RUN run = { pixels, width, height, filter, 0.0 };
+	JOB_DECL job = { cpu_pass, &run };
+	JOB_COUNTER counter;
+	counter.value.store(0);
+	run_jobs(&job, 1, &counter);
+	wait_for_counter(&counter);
+	return run.elapsed;
+}
+
+
+// off the workers, so each level's rows go through the shared job queue
+static double time_off_worker(const unsigned char *pixels, int width, int height) {
+	CPU_RUN run = { pixels, width, height, MIP_BOX, 0.0 };
+	std::thread thread(cpu_pass, &run);
+	thread.join();
+	return run.elapsed;
+}
+
+
+// level 0 upload is outside the timed region; glFinish makes the driver finish
+static double time_gl_generate(unsigned int texture, const unsigned char *pixels, int width, int height) {
+	double elapsed = 0.0;
+	for (int pass = 0; pass < PASSES; pass++) {
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8_ALPHA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+		glFinish();
+		double start = now_seconds();
+		glGenerateMipmap(GL_TEXTURE_2D);
+		glFinish();
+		elapsed += now_seconds() - start;
+	}
+	return elapsed / PASSES;
+}
+
+
+// uploading the finished chain is the GL-thread cost the CPU path pays instead
+static double time_gl_upload_chain(unsigned int texture, const MIP_CHAIN *chain) {
+	double elapsed = 0.0;
+	for (int pass = 0; pass < PASSES; pass++) {
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glFinish();
+		double start = now_seconds();
+		for (int level = 1; level < chain->levels; level++) {
+			glTexImage2D(GL_TEXTURE_2D, level, GL_SRGB8_ALPHA8, chain->width[level], chain->height[level], 0,
+					GL_RGBA, GL_UNSIGNED_BYTE, get_mip_level(chain, level));
+		}
+		glFinish();
+		elapsed += now_seconds() - start;
+	}
+	return elapsed / PASSES;
+}
+
+
+int main() {
+	std::vector<std::string> paths = list_textures("textures");
+	if (paths.empty()) {
+		printf("no textures found, run from the repository root\n");
+		return 1;
+	}
+
+	GLFWwindow *window = NULL;
+	if (glfwInit()) {
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		window = glfwCreateWindow(64, 64, "mip_bench", NULL, NULL);
+	}
+	if (window) {
+		glfwMakeContextCurrent(window);
+		if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+			glfwDestroyWindow(window);
+			window = NULL;
+		} else {
+			printf("GL renderer: %s\n", (const char *)glGetString(GL_RENDERER));
+		}
+	}
+	if (!window) {
+		printf("no GL context, CPU timings only\n");
+	}
+
+	init_job_system();
+	int workers = get_worker_count();
+	unsigned int texture = 0;
+	if (window) glGenTextures(1, &texture);
+
+	printf("%-26s %10s %10s %10s %10s %10s %12s %12s %9s\n", "image", "box x1", "box xN", "box I/O",
+			"kaiser x1", "kaiser xN", "glGenMipmap", "chain upload", "vs GL");
+	for (const std::string &path : paths) {
+		int width, height, channels;
+		stbi_set_flip_vertically_on_load(1);
+		unsigned char *pixels = stbi_load(path.c_str(), &width, &height, &channels, 4);
+		if (!pixels) {
+			continue;
+		}
+
+		// x1 runs with every other worker parked behind a shutdown and restart
+		shutdown_job_system();
+		init_job_system(1);
+		double box_single = time_cpu(pixels, width, height, MIP_BOX);
+		double kaiser_single = time_cpu(pixels, width, height, MIP_KAISER);
+		shutdown_job_system();
+		init_job_system(workers);
+		double box_all = time_cpu(pixels, width, height, MIP_BOX);
+		double box_io = time_off_worker(pixels, width, height);
+		double kaiser_all = time_cpu(pixels, width, height, MIP_KAISER);
+
+		char label[64];
+		snprintf(label, sizeof(label), "%s %dx%d", strrchr(path.c_str(), '/') + 1, width, height);
+		printf("%-26s %8.2fms %8.2fms %8.2fms %8.2fms %8.2fms", label, box_single * 1000.0, box_all * 1000.0,
+				box_io * 1000.0, kaiser_single * 1000.0, kaiser_all * 1000.0);
+
+		if (window) {
+			MIP_CHAIN chain;
+			build_mip_chain(&chain, pixels, width, height, 4, MIP_BOX);
+			double generate = time_gl_generate(texture, pixels, width, height);
+			double upload = time_gl_upload_chain(texture, &chain);
+			// GL-thread time: glGenerateMipmap against uploading the finished chain
+			printf(" %10.2fms %10.2fms %8.2fx", generate * 1000.0, upload * 1000.0, generate / upload);
+		}
+		printf("\n");
+		stbi_image_free(pixels);
+	}
+	printf("xN = %d workers; vs GL = GL-thread time of glGenerateMipmap over the chain upload\n", workers);
+
+	shutdown_job_system();
+	if (window) {
+		glDeleteTextures(1, &texture);
+		glfwDestroyWindow(window);
+		glfwTerminate();
+	}
+	return 0;
+}
@@ -0,0 +1,324 @@
+// multi-view benchmark: a field of GRID * GRID cubes seen by 1-4 cameras at once,
+// drawn as one frame with shared transforms, one culling pass and one
+// instance upload, against one full frame per camera. Then stereo: both eyes
+// in one pass (GL_OVR_multiview or layered instancing, whichever the driver
+// has) against a pass per eye, checking both give the same picture. Frame
+// times are wall time to glFinish, so on llvmpipe they are mostly
+// rasterization; the CPU columns time transforms, culling and building the
+// draw commands alone.
+// run from the repository root
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "../arena.h"
+#include "../camera.h"
+#include "../draw_batch.h"
+#include "../gl_ext.h"
+#include "../job_system.h"
+#include "../render_thread.h"
+#include "../render_view.h"
+#include "../shader.h"
+
+const int TARGET_WIDTH	= 1280;
+const int TARGET_HEIGHT	= 720;
+const int GRID			= 32;	// GRID * GRID cubes
+const float SPACING		= 3.0f;
+const int WARMUP		= 3;
+const int PASSES		= 20;
+
+static float cube_vertices[] = {
+	-0.5f, -0.5f, -0.5f,  0.0f, 0.0f,   0.5f, -0.5f, -0.5f,  1.0f, 0.0f,   0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
+	 0.5f,  0.5f, -0.5f,  1.0f, 1.0f,  -0.5f,  0.5f, -0.5f,  0.0f, 1.0f,  -0.5f, -0.5f, -0.5f,  0.0f, 0.0f,
+	-0.5f, -0.5f,  0.5f,  0.0f, 0.0f,   0.5f, -0.5f,  0.5f,  1.0f, 0.0f,   0.5f,  0.5f,  0.5f,  1.0f, 1.0f,
+	 0.5f,  0.5f,  0.5f,  1.0f, 1.0f,  -0.5f,  0.5f,  0.5f,  0.0f, 1.0f,  -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
+	-0.5f,  0.5f,  0.5f,  1.0f, 0.0f,  -0.5f,  0.5f, -0.5f,  1.0f, 1.0f,  -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+	-0.5f, -0.5f, -0.5f,  0.0f, 1.0f,  -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,  -0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+	 0.5f,  0.5f,  0.5f,  1.0f, 0.0f,   0.5f,  0.5f, -0.5f,  1.0f, 1.0f,   0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+	 0.5f, -0.5f, -0.5f,  0.0f, 1.0f,   0.5f, -0.5f,  0.5f,  0.0f, 0.0f,   0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+	-0.5f, -0.5f, -0.5f,  0.0f, 1.0f,   0.5f, -0.5f, -0.5f,  1.0f, 1.0f,   0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
+	 0.5f, -0.5f,  0.5f,  1.0f, 0.0f,  -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,  -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+	-0.5f,  0.5f, -0.5f,  0.0f, 1.0f,   0.5f,  0.5f, -0.5f,  1.0f, 1.0f,   0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+	 0.5f,  0.5f,  0.5f,  1.0f, 0.0f,  -0.5f,  0.5f,  0.5f,  0.0f, 0.0f,  -0.5f,  0.5f, -0.5f,  0.0f, 1.0f
+};
+
+static FRAME_SNAPSHOT snapshot;
+static DRAW_ITEM draws[GRID * GRID];
+static unsigned char view_masks[GRID * GRID];
+static glm::vec4 bounds[GRID * GRID];
+static float spin;
+static int cube_mesh;
+static FRAME_ARENAS arenas;
+
+
+static double now_seconds() {
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+
+static void build_transforms(void *data, int begin, int end) {
+	for (int i = begin; i < end; i++) {
+		glm::vec3 position((i % GRID - GRID / 2) * SPACING, 0.0f, (i / GRID - GRID / 2) * SPACING);
+		glm::mat4 model = glm::translate(glm::mat4(1.0f), position);
+		model = glm::rotate(model, glm::radians(spin + i * 7.0f), glm::vec3(1.0f, 0.3f, 0.5f));
+		snapshot.draws[i].model = model;
+		snapshot.draws[i].texture_layers[0] = 0;
+		snapshot.draws[i].texture_layers[1] = 0;
+		snapshot.draws[i].mesh = cube_mesh;
+		bounds[i] = glm::vec4(position, 0.8661f);
+	}
+}
+
+
+// cameras spread around the field, each looking a different way
+static void make_views(RENDER_VIEW *views, int view_count) {
+	for (int v = 0; v < view_count; v++) {
+		glm::vec4 rect(0.0f, 0.0f, 1.0f, 1.0f);
+		if (view_count > 1) {
+			rect = glm::vec4((v % 2) * 0.5f, (v / 2) * 0.5f, 0.5f, view_count > 2 ? 0.5f : 1.0f);
+		}
+		CAMERA cam = create_camera(glm::vec3(0.0f, 4.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f),
+				glm::vec3(0.0f, 0.0f, -1.0f), SPEED, SENSITIVITY, ZOOM, YAW + v * 90.0f, -15.0f);
+		set_cam_aspect(&cam, get_view_aspect(rect, TARGET_WIDTH, TARGET_HEIGHT));
+		views[v] = make_render_view(get_view_matrix(&cam), get_projection_matrix(&cam), rect);
+	}
+}
+
+
+static int count_visible(unsigned char mask) {
+	int visible = 0;
+	for (int i = 0; i < snapshot.draw_count; i++) {
+		visible += (snapshot.view_masks[i] & mask) != 0;
+	}
+	return visible;
+}
+
+
+// one frame drawing every view in views
+static void shared_frame(RENDERER *renderer, const RENDER_VIEW *views, int view_count, bool stereo) {
+	parallel_for(snapshot.draw_count, 64, build_transforms, NULL);
+	for (int v = 0; v < view_count; v++) {
+		snapshot.views[v] = views[v];
+	}
+	snapshot.view_count = view_count;
+	snapshot.stereo = stereo;
+	cull_views(snapshot.views, view_count, bounds, snapshot.draw_count, snapshot.view_masks);
+	begin_frame_arenas(&arenas);
+	build_draw_commands(&snapshot, &arenas);
+	render_snapshot(renderer, &snapshot);
+}
+
+
+// a whole frame per view: transforms, culling and upload repeated each time
+static void separate_frames(RENDERER *renderer, const RENDER_VIEW *views, int view_count) {
+	for (int v = 0; v < view_count; v++) {
+		shared_frame(renderer, &views[v], 1, false);
+	}
+}
+
+
+static double time_frames(RENDERER *renderer, const RENDER_VIEW *views, int view_count, bool shared, bool stereo) {
+	double best = 1e30;
+	for (int pass = 0; pass < WARMUP + PASSES; pass++) {
+		double start = now_seconds();
+		if (shared) {
+			shared_frame(renderer, views, view_count, stereo);
+		} else {
+			separate_frames(renderer, views, view_count);
+		}
+		glFinish();
+		double elapsed = now_seconds() - start;
+		if (pass >= WARMUP && elapsed < best) {
+			best = elapsed;
+		}
+		spin += 1.0f;
+	}
+	return best * 1000.0;
+}
+
+
+// header replaces the #version line, as load_program_async does
+static std::string read_shader(const char *path, const std::string &header) {
+	FILE *file = fopen(path, "rb");
+	if (!file) {
+		return "";
+	}
+	std::string source;
+	char chunk[4096];
+	size_t read;
+	while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+		source.append(chunk, read);
+	}
+	fclose(file);
+	size_t line_end = source.find('\n');
+	return header + source.substr(line_end == std::string::npos ? source.size() : line_end + 1);
+}
+
+
+// CPU side only: transforms, culling and draw commands, which is what sharing saves
+static double time_cpu(const RENDER_VIEW *views, int view_count, bool shared) {
+	double best = 1e30;
+	for (int pass = 0; pass < WARMUP + PASSES; pass++) {
+		double start = now_seconds();
+		int frames = shared ? 1 : view_count;
+		for (int f = 0; f < frames; f++) {
+			parallel_for(snapshot.draw_count, 64, build_transforms, NULL);
+			cull_views(shared ? views : &views[f], shared ? view_count : 1, bounds, snapshot.draw_count,
+					snapshot.view_masks);
+			snapshot.view_count = shared ? view_count : 1;
+			begin_frame_arenas(&arenas);
+			build_draw_commands(&snapshot, &arenas);
+		}
+		double elapsed = now_seconds() - start;
+		if (pass >= WARMUP && elapsed < best) {
+			best = elapsed;
+		}
+	}
+	return best * 1e6;
+}
+
+
+static std::vector<unsigned char> read_window() {
+	std::vector<unsigned char> pixels(TARGET_WIDTH * TARGET_HEIGHT * 4);
+	glReadPixels(0, 0, TARGET_WIDTH, TARGET_HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+	return pixels;
+}
+
+
+static bool make_renderer(RENDERER *renderer, TEXTURE_ARRAY *textures, MESH_POOL *meshes, STEREO_MODE mode) {
+	std::string header = std::string("#version 330 core\n") + get_stereo_shader_define(mode);
+	std::string vert_source = read_shader("shaders/shader.vert", header);
+	std::string frag_source = read_shader("shaders/shader.frag", header);
+	if (vert_source.empty() || frag_source.empty()) {
+		return false;
+	}
+	unsigned int vert = compile_vertex_shader(vert_source.c_str());
+	unsigned int frag = compile_fragment_shader(frag_source.c_str());
+	unsigned int program = create_shader_program(vert, frag);
+	glDeleteShader(vert);
+	glDeleteShader(frag);
+	*renderer = {};
+	renderer->shader_program = program;
+	renderer->meshes = meshes;
+	renderer->mix_amount = 0.4f;
+	renderer->textures = textures;
+	renderer->stereo_mode = mode;
+	init_instance_buffer(renderer);
+	return true;
+}
+
+
+static void free_renderer(RENDERER *renderer) {
+	destroy_instance_buffer(renderer);
+	glDeleteProgram(renderer->shader_program);
+	destroy_stereo_target(renderer);
+}
+
+
+int main() {
+	GLFWwindow *window = NULL;
+	if (glfwInit()) {
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		window = glfwCreateWindow(TARGET_WIDTH, TARGET_HEIGHT, "multiview_bench", NULL, NULL);
+	}
+	if (!window) {
+		printf("no GL context\n");
+		return 1;
+	}
+	glfwMakeContextCurrent(window);
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+		printf("could not load GL\n");
+		return 1;
+	}
+	load_gl_extensions();
+	init_job_system();
+	init_frame_arenas(&arenas, 1);
+	glEnable(GL_DEPTH_TEST);
+
+	MESH_POOL meshes;
+	init_mesh_pool(&meshes);
+	cube_mesh = add_mesh(&meshes, VERTEX_POS_UV, cube_vertices, 36, NULL, 0);
+
+	TEXTURE_ARRAY textures;
+	init_texture_array(&textures, 64, 64);
+	RENDERER renderer;
+	if (!make_renderer(&renderer, &textures, &meshes, STEREO_PASSES)) {
+		printf("shaders/ not found, run from the repository root\n");
+		return 1;
+	}
+	snapshot.draws = draws;
+	snapshot.view_masks = view_masks;
+	snapshot.draw_count = GRID * GRID;
+	snapshot.viewport_width = TARGET_WIDTH;
+	snapshot.viewport_height = TARGET_HEIGHT;
+
+	printf("GL renderer: %s, %d workers, %d cubes\n", (const char *)glGetString(GL_RENDERER), get_worker_count(),
+			snapshot.draw_count);
+	printf("%5s %9s %14s %14s %8s %13s %13s\n", "views", "visible", "separate", "shared", "speedup", "CPU separate",
+			"CPU shared");
+	for (int view_count = 1; view_count <= MAX_VIEWS; view_count++) {
+		RENDER_VIEW views[MAX_VIEWS];
+		make_views(views, view_count);
+		double separate = time_frames(&renderer, views, view_count, false, false);
+		double shared = time_frames(&renderer, views, view_count, true, false);
+		double cpu_separate = time_cpu(views, view_count, false);
+		double cpu_shared = time_cpu(views, view_count, true);
+		printf("%5d %9d %12.2fms %12.2fms %7.2fx %11.1fus %11.1fus\n", view_count, count_visible(0xff), separate,
+				shared, separate / shared, cpu_separate, cpu_shared);
+	}
+
+	// stereo: one camera, two eyes side by side
+	RENDER_VIEW eyes[2];
+	CAMERA cam = create_camera(glm::vec3(0.0f, 4.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+			SPEED, SENSITIVITY, ZOOM, YAW, -15.0f);
+	set_cam_aspect(&cam, get_view_aspect(glm::vec4(0.0f, 0.0f, 0.5f, 1.0f), TARGET_WIDTH, TARGET_HEIGHT));
+	make_stereo_views(get_view_matrix(&cam), get_projection_matrix(&cam), STEREO_EYE_SEPARATION,
+			glm::vec4(0.0f, 0.0f, 0.5f, 1.0f), glm::vec4(0.5f, 0.0f, 0.5f, 1.0f), &eyes[0], &eyes[1]);
+	double passes = time_frames(&renderer, eyes, 2, true, true);
+	printf("stereo, a pass per eye:      %8.2fms\n", passes);
+	spin = 0.0f;
+	shared_frame(&renderer, eyes, 2, true);
+	std::vector<unsigned char> reference = read_window();
+	free_renderer(&renderer);
+
+	STEREO_MODE mode = choose_stereo_mode();
+	if (mode == STEREO_PASSES) {
+		printf("stereo, single pass:         not supported (no GL_OVR_multiview2 or GL_ARB_shader_viewport_layer_array)\n");
+	} else if (make_renderer(&renderer, &textures, &meshes, mode)) {
+		double single = time_frames(&renderer, eyes, 2, true, true);
+		spin = 0.0f;
+		shared_frame(&renderer, eyes, 2, true);
+		std::vector<unsigned char> pixels = read_window();
+		// the eye target and the window may round the clear color differently
+		int differ = 0;
+		for (size_t i = 0; i < pixels.size(); i += 4) {
+			bool same = true;
+			for (int c = 0; c < 3; c++) {
+				same = same && abs(pixels[i + c] - reference[i + c]) <= 1;
+			}
+			differ += !same;
+		}
+		printf("stereo, single pass (%s): %8.2fms  %.2fx, %d pixels differ from the per-eye passes\n",
+				mode == STEREO_MULTIVIEW ? "multiview" : "layered", single, passes / single, differ);
+		free_renderer(&renderer);
+	}
+
+	destroy_texture_array(&textures);
+	destroy_mesh_pool(&meshes);
+	destroy_frame_arenas(&arenas);
+	shutdown_job_system();
+	glfwDestroyWindow(window);
+	glfwTerminate();
+	return 0;
+}
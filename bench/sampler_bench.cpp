@@ -0,0 +1,199 @@
+// sampler preset benchmark: GPU time of a fragment pass that covers a
+// 1920x1080 target with a textured ground plane running off to the horizon,
+// so most of it is minified and sampled at a slant. Each preset is timed with
+// GL_TIME_ELAPSED queries, alongside the unmipmapped GL_NEAREST the materials
+// used before. Wall time to glFinish is printed too: software rasterizers
+// (llvmpipe) do not report meaningful query times. run from the repository root
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+#include "../gl_ext.h"
+#include "../mipmap.h"
+#include "../sampler.h"
+#include "../shader.h"
+#include "../texture.h"
+
+const int TARGET_WIDTH	= 1920;
+const int TARGET_HEIGHT	= 1080;
+const int WARMUP		= 5;
+const int PASSES		= 30;
+
+// one triangle over the whole target
+static const char *vertex_source =
+	"#version 330 core\n"
+	"out vec2 ndc;\n"
+	"void main() {\n"
+	"    vec2 p = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2) * 2.0 - 1.0;\n"
+	"    ndc = p;\n"
+	"    gl_Position = vec4(p, 0.0, 1.0);\n"
+	"}\n";
+
+// a camera one unit above an endless plane, pitched down so the top edge still
+// meets the ground far away
+static const char *fragment_source =
+	"#version 330 core\n"
+	"in vec2 ndc;\n"
+	"out vec4 color;\n"
+	"uniform sampler2D ground;\n"
+	"uniform float aspect;\n"
+	"void main() {\n"
+	"    float pitch = radians(-33.0);\n"
+	"    vec3 ray = normalize(vec3(ndc.x * aspect * 0.577, ndc.y * 0.577, -1.0));\n"
+	"    ray = vec3(ray.x, ray.y * cos(pitch) - ray.z * sin(pitch), ray.y * sin(pitch) + ray.z * cos(pitch));\n"
+	"    vec3 hit = ray * (1.0 / -ray.y);\n"
+	"    color = texture(ground, hit.xz * 0.5);\n"
+	"}\n";
+
+
+static unsigned int load_ground_texture(const char *path) {
+	FILE *file = fopen(path, "rb");
+	if (!file) {
+		return 0;
+	}
+	std::vector<unsigned char> data;
+	fseek(file, 0, SEEK_END);
+	data.resize(ftell(file));
+	fseek(file, 0, SEEK_SET);
+	size_t read = fread(data.data(), 1, data.size(), file);
+	fclose(file);
+
+	int width, height, channels;
+	unsigned char *pixels = read == data.size() ? decode_texture(data.data(), (int)data.size(), &width, &height, &channels)
+			: NULL;
+	if (!pixels) {
+		return 0;
+	}
+	MIP_CHAIN chain;
+	build_mip_chain(&chain, pixels, width, height, channels);
+	free_texture_pixels(pixels);
+
+	unsigned int texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	upload_mip_chain(&chain);
+	return texture;
+}
+
+
+static double now_seconds() {
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+
+typedef struct {
+	double gpu;		// milliseconds per pass, from the query
+	double wall;	// milliseconds per pass, draw to glFinish
+} PASS_TIME;
+
+
+static PASS_TIME time_pass(unsigned int sampler, unsigned int query) {
+	glBindSampler(0, sampler);
+	for (int pass = 0; pass < WARMUP; pass++) {
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+	}
+	glFinish();
+
+	PASS_TIME time = { 0.0, 0.0 };
+	for (int pass = 0; pass < PASSES; pass++) {
+		double start = now_seconds();
+		glBeginQuery(GL_TIME_ELAPSED, query);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+		glEndQuery(GL_TIME_ELAPSED);
+		glFinish();
+		time.wall += (now_seconds() - start) * 1000.0;
+		GLuint64 elapsed = 0;
+		glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+		time.gpu += elapsed / 1e6;
+	}
+	time.gpu /= PASSES;
+	time.wall /= PASSES;
+	return time;
+}
+
+
+int main() {
+	GLFWwindow *window = NULL;
+	if (glfwInit()) {
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		window = glfwCreateWindow(64, 64, "sampler_bench", NULL, NULL);
+	}
+	if (!window) {
+		printf("no GL context\n");
+		return 1;
+	}
+	glfwMakeContextCurrent(window);
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+		printf("could not load GL\n");
+		return 1;
+	}
+	load_gl_extensions();
+	printf("GL renderer: %s, max anisotropy %.0f\n", (const char *)glGetString(GL_RENDERER), gl_ext.max_anisotropy);
+
+	unsigned int texture = load_ground_texture("textures/wall.jpg");
+	if (!texture) {
+		printf("textures/wall.jpg not found, run from the repository root\n");
+		return 1;
+	}
+
+	unsigned int framebuffer, color;
+	glGenFramebuffers(1, &framebuffer);
+	glGenRenderbuffers(1, &color);
+	glBindRenderbuffer(GL_RENDERBUFFER, color);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, TARGET_WIDTH, TARGET_HEIGHT);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+	glViewport(0, 0, TARGET_WIDTH, TARGET_HEIGHT);
+
+	unsigned int vert = compile_vertex_shader(vertex_source);
+	unsigned int frag = compile_fragment_shader(fragment_source);
+	unsigned int program = create_shader_program(vert, frag);
+	glDeleteShader(vert);
+	glDeleteShader(frag);
+	glUseProgram(program);
+	glUniform1i(glGetUniformLocation(program, "ground"), 0);
+	glUniform1f(glGetUniformLocation(program, "aspect"), (float)TARGET_WIDTH / TARGET_HEIGHT);
+
+	unsigned int vao, query;
+	glGenVertexArrays(1, &vao);
+	glBindVertexArray(vao);
+	glGenQueries(1, &query);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, texture);
+
+	SAMPLER_CACHE samplers;
+	init_sampler_cache(&samplers);
+	SAMPLER_DESC unmipmapped = { GL_NEAREST, GL_NEAREST, GL_REPEAT, GL_REPEAT, 1.0f };
+	unsigned int sampler = acquire_sampler(&samplers, &unmipmapped);
+	printf("%-18s %12s %12s\n", "sampler", "GPU query", "wall");
+	PASS_TIME baseline = time_pass(sampler, query);
+	printf("%-18s %10.3fms %10.3fms\n", "nearest, no mips", baseline.gpu, baseline.wall);
+	release_sampler(&samplers, sampler);
+
+	for (int preset = 0; preset < SAMPLER_PRESET_COUNT; preset++) {
+		SAMPLER_DESC desc = get_sampler_preset((SAMPLER_PRESET)preset);
+		sampler = acquire_sampler(&samplers, &desc);
+		PASS_TIME time = time_pass(sampler, query);
+		printf("%-18s %10.3fms %10.3fms\n", get_sampler_preset_name((SAMPLER_PRESET)preset), time.gpu, time.wall);
+		release_sampler(&samplers, sampler);
+	}
+
+	destroy_sampler_cache(&samplers);
+	glDeleteQueries(1, &query);
+	glDeleteVertexArrays(1, &vao);
+	glDeleteProgram(program);
+	glDeleteFramebuffers(1, &framebuffer);
+	glDeleteRenderbuffers(1, &color);
+	glDeleteTextures(1, &texture);
+	glfwDestroyWindow(window);
+	glfwTerminate();
+	return 0;
+}
@@ -0,0 +1,139 @@
+// scene graph update benchmark: ~1M nodes in a forest four levels deep, added
+// depth first so the first update has to sort them. Each frame moves 1% of
+// the nodes at random and updates, against rebuilding every world matrix,
+// for one worker up to all of them; then checks a sample of world matrices
+// against walking the parent chain by hand
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "../job_system.h"
+#include "../scene_graph.h"
+
+const int ROOTS			= 900;
+const int BRANCHING		= 10;
+const int DEPTH			= 4;	// ROOTS * (1 + 10 + 100 + 1000) nodes
+const float DIRTY_SHARE	= 0.01f;
+const int FRAMES		= 20;
+const int CHECKS		= 1000;
+
+static unsigned int seed = 12345;
+
+static unsigned int next_random() {
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+
+static double now_seconds() {
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+
+static NODE_TRANSFORM random_transform() {
+	float angle = (next_random() % 360) * 0.0174533f;
+	glm::vec3 position((float)(next_random() % 100) * 0.1f, (float)(next_random() % 100) * 0.1f, 1.0f);
+	glm::quat rotation(cosf(angle * 0.5f), 0.0f, sinf(angle * 0.5f), 0.0f);
+	return make_node_transform(position, rotation, glm::vec3(1.0f));
+}
+
+
+static void add_subtree(SCENE_GRAPH *graph, std::vector<int> *parents, int parent, int depth) {
+	NODE_TRANSFORM local = random_transform();
+	int node = add_scene_node(graph, parent, &local);
+	parents->push_back(parent);
+	if (depth + 1 < DEPTH) {
+		for (int i = 0; i < BRANCHING; i++) {
+			add_subtree(graph, parents, node, depth + 1);
+		}
+	}
+}
+
+
+// the slow, obvious way: compose up the parent chain
+static glm::mat4 reference_world(const SCENE_GRAPH *graph, const std::vector<int> &parents, int node) {
+	glm::mat4 world(1.0f);
+	for (int n = node; n != SCENE_NO_PARENT; n = parents[n]) {
+		const NODE_TRANSFORM *local = get_node_transform(graph, n);
+		glm::mat4 m = glm::mat4_cast(local->rotation);
+		m[3] = glm::vec4(local->position, 1.0f);
+		world = m * world;
+	}
+	return world;
+}
+
+
+int main(int argc, char **argv) {
+	int max_workers = argc > 1 ? atoi(argv[1]) : static_cast<int>(std::thread::hardware_concurrency());
+	if (max_workers < 1) max_workers = 1;
+
+	SCENE_GRAPH graph;
+	init_scene_graph(&graph);
+	std::vector<int> parents;
+	for (int r = 0; r < ROOTS; r++) {
+		add_subtree(&graph, &parents, SCENE_NO_PARENT, 0);
+	}
+	int count = (int)parents.size();
+	int dirty_per_frame = (int)(count * DIRTY_SHARE);
+
+	init_job_system(1);
+	double start = now_seconds();
+	update_scene_graph(&graph);
+	printf("%d nodes, %d levels; first update (sort and build everything) %.1f ms\n", count,
+			(int)graph.level_starts.size() - 1, (now_seconds() - start) * 1000.0);
+	shutdown_job_system();
+
+	printf("%d of them moved per frame, %d frames\n", dirty_per_frame, FRAMES);
+	printf("workers   all nodes ms/frame   1%% dirty ms/frame   speedup\n");
+	for (int workers = 1; workers <= max_workers; workers++) {
+		init_job_system(workers);
+
+		double full = 0.0;
+		for (int frame = 0; frame < FRAMES; frame++) {
+			for (int n = 0; n < count; n++) {
+				set_node_transform(&graph, n, get_node_transform(&graph, n));
+			}
+			start = now_seconds();
+			update_scene_graph(&graph);
+			full += now_seconds() - start;
+		}
+
+		double partial = 0.0;
+		for (int frame = 0; frame < FRAMES; frame++) {
+			for (int d = 0; d < dirty_per_frame; d++) {
+				NODE_TRANSFORM local = random_transform();
+				set_node_transform(&graph, next_random() % count, &local);
+			}
+			start = now_seconds();
+			update_scene_graph(&graph);
+			partial += now_seconds() - start;
+		}
+		shutdown_job_system();
+
+		printf("%7d   %18.2f   %17.2f   %6.1fx\n", workers, full * 1000.0 / FRAMES, partial * 1000.0 / FRAMES,
+				full / partial);
+	}
+
+	float max_diff = 0.0f;
+	for (int c = 0; c < CHECKS; c++) {
+		int node = next_random() % count;
+		glm::mat4 expected = reference_world(&graph, parents, node);
+		const glm::mat4 &actual = get_world_matrix(&graph, node);
+		for (int col = 0; col < 4; col++) {
+			for (int row = 0; row < 4; row++) {
+				max_diff = fmaxf(max_diff, fabsf(expected[col][row] - actual[col][row]));
+			}
+		}
+	}
+	printf("max difference from walking the parents, %d nodes: %g\n", CHECKS, max_diff);
+	return 0;
+}
@@ -0,0 +1,231 @@
+// stream buffer benchmark: a frame's worth of instance data (COUNT mat4 + layer
+// pairs) rewritten every frame and drawn as instanced points, four ways:
+// glBufferData orphaning (the old render thread path), glBufferSubData into one
+// buffer, the stream buffer's unsynchronized map range ring and its persistent
+// mapped ring. Frames are not waited on, only fenced FRAMES_AHEAD back the way
+// a swap chain would, so a path that makes the driver sync or copy shows up in
+// the CPU time. run from the repository root; without a GPU the numbers are llvmpipe's
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+#include <stdio.h>
+#include <stddef.h>
+#include <chrono>
+
+#include "../gl_ext.h"
+#include "../render_thread.h"
+#include "../shader.h"
+#include "../stream_buffer.h"
+
+const int COUNT			= 10000;
+const int FRAMES		= 300;
+const int WARMUP		= 10;
+const int FRAMES_AHEAD	= 2;
+
+enum UPLOAD_PATH {
+	PATH_ORPHAN,
+	PATH_SUB_DATA,
+	PATH_MAP_RANGE,
+	PATH_PERSISTENT,
+	PATH_COUNT
+};
+
+static const char *path_names[PATH_COUNT] = { "glBufferData orphan", "glBufferSubData", "map range ring",
+		"persistent ring" };
+
+static const char *vertex_source =
+	"#version 330 core\n"
+	"layout (location = 2) in mat4 model;\n"
+	"layout (location = 6) in ivec2 layers;\n"
+	"flat out int layer;\n"
+	"void main() {\n"
+	"	gl_Position = model * vec4(0.0, 0.0, 0.0, 1.0);\n"
+	"	gl_PointSize = 1.0;\n"
+	"	layer = layers.x;\n"
+	"}\n";
+
+static const char *fragment_source =
+	"#version 330 core\n"
+	"flat in int layer;\n"
+	"out vec4 color;\n"
+	"void main() {\n"
+	"	color = vec4(float(layer & 255) / 255.0, 0.5, 0.5, 1.0);\n"
+	"}\n";
+
+
+static double now_ms() {
+	using namespace std::chrono;
+	return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+
+static void fill_instances(INSTANCE_DATA *instances, int frame) {
+	for (int i = 0; i < COUNT; i++) {
+		glm::mat4 model(1.0f);
+		model[3] = glm::vec4((i % 100) * 0.02f - 1.0f, (i / 100) * 0.02f - 1.0f, 0.0f, 1.0f);
+		instances[i].model = model;
+		instances[i].texture_layers[0] = frame + i;
+		instances[i].texture_layers[1] = 0;
+	}
+}
+
+
+static void point_attributes(GLintptr offset) {
+	const GLsizei stride = sizeof(INSTANCE_DATA);
+	for (int column = 0; column < 4; column++) {
+		glVertexAttribPointer(2 + column, 4, GL_FLOAT, GL_FALSE, stride,
+				(void *)(offset + column * sizeof(glm::vec4)));
+	}
+	glVertexAttribIPointer(6, 2, GL_INT, stride, (void *)(offset + offsetof(INSTANCE_DATA, texture_layers)));
+}
+
+
+typedef struct {
+	double cpu_ms;		// upload and draw calls, per frame
+	double frame_ms;	// wall time per frame, waits on old frames included
+	STREAM_STATS stats;
+} PATH_RESULT;
+
+
+static bool run_path(UPLOAD_PATH path, PATH_RESULT *result) {
+	const GLsizeiptr frame_bytes = COUNT * sizeof(INSTANCE_DATA);
+	static INSTANCE_DATA staging[COUNT];
+	unsigned int buffer = 0;
+	STREAM_BUFFER stream = {};
+	if (path == PATH_MAP_RANGE || path == PATH_PERSISTENT) {
+		if (!init_stream_buffer(&stream, STREAM_FRAMES * (frame_bytes + 256), path == PATH_PERSISTENT)) {
+			return false;
+		}
+		if (path == PATH_PERSISTENT && stream.mode != STREAM_PERSISTENT) {
+			destroy_stream_buffer(&stream);
+			return false;
+		}
+		buffer = stream.buffer;
+	} else {
+		glGenBuffers(1, &buffer);
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		glBufferData(GL_ARRAY_BUFFER, frame_bytes, NULL, GL_STREAM_DRAW);
+	}
+
+	GLsync frame_fences[FRAMES_AHEAD] = {};
+	double cpu = 0.0;
+	double start = 0.0;
+	for (int frame = 0; frame < WARMUP + FRAMES; frame++) {
+		if (frame == WARMUP) {
+			cpu = 0.0;
+			stream.stats = {};
+			start = now_ms();
+		}
+		// the swap chain: at most FRAMES_AHEAD frames queued
+		GLsync *oldest = &frame_fences[frame % FRAMES_AHEAD];
+		if (*oldest) {
+			glClientWaitSync(*oldest, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+			glDeleteSync(*oldest);
+		}
+
+		double t = now_ms();
+		GLintptr offset = 0;
+		if (path == PATH_ORPHAN || path == PATH_SUB_DATA) {
+			fill_instances(staging, frame);
+			glBindBuffer(GL_ARRAY_BUFFER, buffer);
+			if (path == PATH_ORPHAN) {
+				glBufferData(GL_ARRAY_BUFFER, frame_bytes, staging, GL_STREAM_DRAW);
+			} else {
+				glBufferSubData(GL_ARRAY_BUFFER, 0, frame_bytes, staging);
+			}
+		} else {
+			begin_stream_frame(&stream);
+			STREAM_ALLOCATION allocation = stream_alloc(&stream, frame_bytes);
+			if (allocation.data) {
+				fill_instances((INSTANCE_DATA *)allocation.data, frame);
+			}
+			stream_commit(&stream);
+			offset = allocation.offset;
+			glBindBuffer(GL_ARRAY_BUFFER, stream.buffer);
+		}
+		point_attributes(offset);
+		glClear(GL_COLOR_BUFFER_BIT);
+		glDrawArraysInstanced(GL_POINTS, 0, 1, COUNT);
+		cpu += now_ms() - t;
+
+		*oldest = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		glFlush();
+	}
+	glFinish();
+	result->frame_ms = (now_ms() - start) / FRAMES;
+	result->cpu_ms = cpu / FRAMES;
+	result->stats = stream.stats;
+
+	for (int i = 0; i < FRAMES_AHEAD; i++) {
+		if (frame_fences[i]) {
+			glDeleteSync(frame_fences[i]);
+		}
+	}
+	if (path == PATH_MAP_RANGE || path == PATH_PERSISTENT) {
+		destroy_stream_buffer(&stream);
+	} else {
+		glDeleteBuffers(1, &buffer);
+	}
+	return true;
+}
+
+
+int main() {
+	GLFWwindow *window = NULL;
+	if (glfwInit()) {
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		window = glfwCreateWindow(256, 256, "stream_buffer_bench", NULL, NULL);
+	}
+	if (!window) {
+		printf("no GL context, skipping\n");
+		return 0;
+	}
+	glfwMakeContextCurrent(window);
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+		printf("could not load GL\n");
+		return 1;
+	}
+	load_gl_extensions();
+
+	unsigned int vert = compile_vertex_shader(vertex_source);
+	unsigned int frag = compile_fragment_shader(fragment_source);
+	unsigned int program = create_shader_program(vert, frag);
+	glDeleteShader(vert);
+	glDeleteShader(frag);
+	unsigned int vao;
+	glGenVertexArrays(1, &vao);
+	glBindVertexArray(vao);
+	for (int location = 2; location <= 6; location++) {
+		glEnableVertexAttribArray(location);
+		glVertexAttribDivisor(location, 1);
+	}
+	glUseProgram(program);
+	glViewport(0, 0, 256, 256);
+
+	printf("%d instances, %.1f KB per frame, %d frames, at most %d queued\n", COUNT,
+			COUNT * sizeof(INSTANCE_DATA) / 1024.0, FRAMES, FRAMES_AHEAD);
+	printf("%-22s %10s %10s %8s %10s\n", "path", "cpu ms", "frame ms", "stalls", "stall ms");
+	for (int path = 0; path < PATH_COUNT; path++) {
+		PATH_RESULT result;
+		if (!run_path((UPLOAD_PATH)path, &result)) {
+			printf("%-22s not supported (no GL_ARB_buffer_storage)\n", path_names[path]);
+			continue;
+		}
+		if (path == PATH_MAP_RANGE || path == PATH_PERSISTENT) {
+			printf("%-22s %10.3f %10.3f %8ld %10.2f\n", path_names[path], result.cpu_ms, result.frame_ms,
+					result.stats.stalls, result.stats.stall_ms);
+		} else {
+			printf("%-22s %10.3f %10.3f %8s %10s\n", path_names[path], result.cpu_ms, result.frame_ms, "-", "-");
+		}
+	}
+
+	glDeleteVertexArrays(1, &vao);
+	glDeleteProgram(program);
+	glfwDestroyWindow(window);
+	glfwTerminate();
+	return 0;
+}
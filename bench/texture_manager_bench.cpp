@@ -0,0 +1,149 @@
+// texture manager benchmark: every image in textures/ loaded several times
+// over through the manager, then a working set that slides across them frame
+// by frame under a budget of half what they take fully resident. Cold
+// textures lose mip levels, the ones coming back into use are streamed in
+// again; prints resident, evicted and streamed bytes and the time
+// update_texture_residency takes. run from the repository root
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../asset_loader.h"
+#include "../frame_pacer.h"
+#include "../texture_manager.h"
+
+const int COPIES			= 4;	// managed textures per file, none shared
+const int FRAMES			= 240;
+const int WORKING_SET		= 8;	// textures used each frame
+const int SLIDE_FRAMES		= 30;	// frames before the working set moves on
+const double FRAME_SECONDS	= 1.0 / 60.0;
+
+
+static std::vector<std::string> list_textures(const char *dir) {
+	std::vector<std::string> paths;
+	DIR *d = opendir(dir);
+	if (!d) {
+		return paths;
+	}
+
+	struct dirent *entry;
+	while ((entry = readdir(d)) != NULL) {
+		const char *ext = strrchr(entry->d_name, '.');
+		if (ext && (!strcmp(ext, ".jpg") || !strcmp(ext, ".jpeg") || !strcmp(ext, ".png"))) {
+			paths.push_back(std::string(dir) + "/" + entry->d_name);
+		}
+	}
+	closedir(d);
+	return paths;
+}
+
+
+int main() {
+	GLFWwindow *window = NULL;
+	if (glfwInit()) {
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		window = glfwCreateWindow(64, 64, "texture_manager_bench", NULL, NULL);
+	}
+	if (!window) {
+		printf("no GL context\n");
+		return 1;
+	}
+	glfwMakeContextCurrent(window);
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+		printf("could not load GL\n");
+		return 1;
+	}
+
+	std::vector<std::string> paths = list_textures("textures");
+	if (paths.empty()) {
+		printf("no textures found, run from the repository root\n");
+		return 1;
+	}
+
+	init_job_system();
+	static ASSET_LOADER loader;
+	if (!init_asset_loader(&loader, pacer_now())) {
+		return 1;
+	}
+	static TEXTURE_MANAGER manager;
+	init_texture_manager(&manager, &loader);
+
+	// first loads count as pending, so the loader says when they have all landed
+	std::vector<int> ids;
+	for (int copy = 0; copy < COPIES; copy++) {
+		for (const std::string &path : paths) {
+			ids.push_back(load_managed_texture(&manager, path.c_str()));
+		}
+	}
+	while (!assets_resident(&loader)) {
+		pump_gl_queue(&loader, 1.0);
+		std::this_thread::yield();
+	}
+	TEXTURE_RESIDENCY_STATS stats = get_texture_residency_stats(&manager);
+	size_t full_bytes = stats.resident_bytes;
+	printf("%d textures (%zu files x %d) resident after %.1f ms: %.1f MB with mips\n", stats.textures,
+			paths.size(), COPIES, loader.all_resident_time * 1000.0, full_bytes / (double)(1 << 20));
+
+	size_t budget = full_bytes / 2;
+	set_texture_budget(&manager, budget);
+	printf("budget %.1f MB, working set %d textures sliding every %d frames, %d frames\n",
+			budget / (double)(1 << 20), WORKING_SET, SLIDE_FRAMES, FRAMES);
+
+	size_t evicted_bytes = 0, streamed_bytes = 0, peak_bytes = 0;
+	int evictions = 0, over_budget_frames = 0;
+	double update_seconds = 0.0, worst_update = 0.0;
+	int count = (int)ids.size();
+	for (int frame = 0; frame < FRAMES; frame++) {
+		double frame_start = pacer_now();
+		int first = (frame / SLIDE_FRAMES) * (WORKING_SET / 2);
+		for (int i = 0; i < WORKING_SET; i++) {
+			use_managed_texture(&manager, ids[(first + i) % count]);
+		}
+		pump_gl_queue(&loader);
+
+		double start = pacer_now();
+		update_texture_residency(&manager);
+		double elapsed = pacer_now() - start;
+		update_seconds += elapsed;
+		worst_update = elapsed > worst_update ? elapsed : worst_update;
+
+		stats = get_texture_residency_stats(&manager);
+		evictions += stats.evictions;
+		evicted_bytes += stats.evicted_bytes;
+		streamed_bytes += stats.streamed_bytes;
+		peak_bytes = stats.resident_bytes > peak_bytes ? stats.resident_bytes : peak_bytes;
+		over_budget_frames += stats.resident_bytes > budget;
+		if (frame % SLIDE_FRAMES == SLIDE_FRAMES - 1) {
+			printf("  frame %3d: resident %6.1f MB\n", frame, stats.resident_bytes / (double)(1 << 20));
+		}
+
+		double left = FRAME_SECONDS - (pacer_now() - frame_start);
+		if (left > 0.0) {
+			std::this_thread::sleep_for(std::chrono::duration<double>(left));
+		}
+	}
+
+	printf("resident  %8.1f MB now, %.1f MB peak, over budget after %d of %d frames\n",
+			stats.resident_bytes / (double)(1 << 20), peak_bytes / (double)(1 << 20), over_budget_frames, FRAMES);
+	printf("evicted   %8.1f MB in %d levels\n", evicted_bytes / (double)(1 << 20), evictions);
+	printf("streamed  %8.1f MB back in\n", streamed_bytes / (double)(1 << 20));
+	printf("update_texture_residency %.3f ms average, %.3f ms worst\n", update_seconds / FRAMES * 1000.0,
+			worst_update * 1000.0);
+
+	shutdown_asset_loader(&loader);
+	destroy_texture_manager(&manager);
+	shutdown_job_system();
+	glfwDestroyWindow(window);
+	glfwTerminate();
+	return 0;
+}
@@ -0,0 +1,173 @@
+// texture upload benchmark: the old path (decode as stored, JPEGs uploaded as
+// GL_RGB) against decode_texture's RGBA layout uploaded with the matching
+// unpack alignment, for every image in textures/. Decode and glTexImage2D are
+// timed apart. run from the repository root; without a GPU the numbers are llvmpipe's
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "../image_decoder.h"
+#include "../texture.h"
+
+const int PASSES = 20;
+
+
+static double now_seconds() {
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+
+static std::vector<std::string> list_textures(const char *dir) {
+	std::vector<std::string> paths;
+	DIR *d = opendir(dir);
+	if (!d) {
+		return paths;
+	}
+
+	struct dirent *entry;
+	while ((entry = readdir(d)) != NULL) {
+		const char *ext = strrchr(entry->d_name, '.');
+		if (ext && (!strcmp(ext, ".jpg") || !strcmp(ext, ".jpeg") || !strcmp(ext, ".png"))) {
+			paths.push_back(std::string(dir) + "/" + entry->d_name);
+		}
+	}
+	closedir(d);
+	return paths;
+}
+
+
+static std::vector<unsigned char> read_whole_file(const char *path) {
+	std::vector<unsigned char> data;
+	FILE *file = fopen(path, "rb");
+	if (!file) {
+		return data;
+	}
+	fseek(file, 0, SEEK_END);
+	data.resize(ftell(file));
+	fseek(file, 0, SEEK_SET);
+	if (fread(data.data(), 1, data.size(), file) != data.size()) {
+		data.clear();
+	}
+	fclose(file);
+	return data;
+}
+
+
+static double time_upload(unsigned int texture, const unsigned char *pixels, int width, int height, int channels,
+		int alignment) {
+	TEXTURE_FORMAT format = get_texture_format(channels);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+	glFinish();
+	double start = now_seconds();
+	for (int pass = 0; pass < PASSES; pass++) {
+		glTexImage2D(GL_TEXTURE_2D, 0, format.internal_format, width, height, 0, format.format, GL_UNSIGNED_BYTE, pixels);
+	}
+	glFinish();
+	double elapsed = (now_seconds() - start) / PASSES;
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	return elapsed;
+}
+
+
+// the old decode: channels as stored in the file
+static double time_stored_decode(const std::vector<unsigned char> &data, DECODED_IMAGE *image) {
+	double start = now_seconds();
+	for (int pass = 0; pass < PASSES; pass++) {
+		if (pass) free_decoded_image(image);
+		if (!decode_image(data.data(), data.size(), image)) {
+			return 0.0;
+		}
+	}
+	return (now_seconds() - start) / PASSES;
+}
+
+
+// the new one: decode_texture's GL-ready layout
+static double time_direct_decode(const std::vector<unsigned char> &data, DECODED_IMAGE *image) {
+	double start = now_seconds();
+	image->pixels = NULL;
+	for (int pass = 0; pass < PASSES; pass++) {
+		free_texture_pixels(image->pixels);
+		image->pixels = decode_texture(data.data(), (int)data.size(), &image->width, &image->height, &image->channels);
+		if (!image->pixels) {
+			return 0.0;
+		}
+	}
+	return (now_seconds() - start) / PASSES;
+}
+
+
+int main() {
+	std::vector<std::string> paths = list_textures("textures");
+	if (paths.empty()) {
+		printf("no textures found, run from the repository root\n");
+		return 1;
+	}
+
+	GLFWwindow *window = NULL;
+	if (glfwInit()) {
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		window = glfwCreateWindow(64, 64, "upload_bench", NULL, NULL);
+	}
+	if (!window) {
+		printf("no GL context\n");
+		return 1;
+	}
+	glfwMakeContextCurrent(window);
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+		printf("could not load GL\n");
+		return 1;
+	}
+	printf("GL renderer: %s\n", (const char *)glGetString(GL_RENDERER));
+
+	unsigned int texture;
+	glGenTextures(1, &texture);
+
+	printf("%-28s %12s %12s %12s %12s\n", "image", "decode old", "upload old", "decode new", "upload new");
+	for (const std::string &path : paths) {
+		std::vector<unsigned char> data = read_whole_file(path.c_str());
+		DECODED_IMAGE stored, direct;
+		double stored_decode = time_stored_decode(data, &stored);
+		if (stored_decode == 0.0) {
+			continue;
+		}
+		double direct_decode = time_direct_decode(data, &direct);
+		if (direct_decode == 0.0) {
+			free_decoded_image(&stored);
+			continue;
+		}
+
+		// the old upload left the default alignment of 4, which is only right for
+		// RGB rows that happen to be 4-byte multiples; 1 keeps odd widths correct
+		int old_alignment = (stored.width * stored.channels) % 4 ? 1 : 4;
+		double stored_upload = time_upload(texture, stored.pixels, stored.width, stored.height, stored.channels,
+				old_alignment);
+		double direct_upload = time_upload(texture, direct.pixels, direct.width, direct.height, direct.channels,
+				get_unpack_alignment(direct.width * direct.channels));
+
+		char label[64];
+		snprintf(label, sizeof(label), "%s %dx%d %dch", strrchr(path.c_str(), '/') + 1, stored.width, stored.height,
+				stored.channels);
+		printf("%-28s %10.2fms %10.2fms %10.2fms %10.2fms\n", label, stored_decode * 1000.0, stored_upload * 1000.0,
+				direct_decode * 1000.0, direct_upload * 1000.0);
+		free_decoded_image(&stored);
+		free_decoded_image(&direct);
+	}
+
+	glDeleteTextures(1, &texture);
+	glfwDestroyWindow(window);
+	glfwTerminate();
+	return 0;
+}
@@ -0,0 +1,245 @@
+// virtual texture benchmark: cooks an image (textures/img3.jpeg unless one is
+// given) into small tiles, then flies a camera low over a ground plane carrying
+// it. Near tiles want level 0 and the horizon wants the coarse ones, so the
+// feedback pass asks for a mix of levels that keeps changing as the camera
+// moves. The physical cache is held to a fixed number of page slots, well
+// under the cooked size; prints resident pages and bytes as it streams, tiles
+// uploaded and evicted, and the time update_virtual_texture takes.
+// usage: bench/vt_bench [image] [tile_size], run from the repository root
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <chrono>
+#include <thread>
+
+#include "../asset_loader.h"
+#include "../frame_pacer.h"
+#include "../shader.h"
+#include "../virtual_texture.h"
+
+const int TARGET_WIDTH		= 1280;
+const int TARGET_HEIGHT		= 720;
+const int TILE_SIZE			= 32;	// small, so an image from textures/ still makes many pages
+const int PAGE_SLOTS		= 12;	// per side of the physical cache
+const int FRAMES			= 300;
+const int REPORT_FRAMES		= 50;
+const double FRAME_SECONDS	= 1.0 / 60.0;
+
+// ground plane GROUND units square with the virtual texture stretched over it;
+// the camera looks along +z, pitched down towards it
+static const char *vertex_source =
+	"#version 330 core\n"
+	"out vec2 TexCoord;\n"
+	"uniform vec3 camera;\n"
+	"uniform float aspect;\n"
+	"const float GROUND = 8.0;\n"
+	"const float PITCH = radians(20.0);\n"
+	"const float FOCAL = 1.0 / tan(radians(30.0));\n"
+	"const float NEAR = 0.05;\n"
+	"const float FAR = 100.0;\n"
+	"void main() {\n"
+	"    vec2 corner = vec2((0x16 >> gl_VertexID) & 1, (0x34 >> gl_VertexID) & 1);\n"
+	"    TexCoord = corner;\n"
+	"    vec3 p = vec3(corner.x, 0.0, corner.y) * GROUND - camera;\n"
+	"    float x = p.x;\n"
+	"    float y = p.y * cos(PITCH) + p.z * sin(PITCH);\n"
+	"    float depth = p.z * cos(PITCH) - p.y * sin(PITCH);\n"
+	"    float z = depth * (FAR + NEAR) / (FAR - NEAR) - 2.0 * FAR * NEAR / (FAR - NEAR);\n"
+	"    gl_Position = vec4(x * FOCAL / aspect, y * FOCAL, z, depth);\n"
+	"}\n";
+
+
+static unsigned int load_program(const char *fragment_path) {
+	char *fragment_source = load_shader(fragment_path);
+	if (!fragment_source) {
+		return 0;
+	}
+	unsigned int vert = compile_vertex_shader(vertex_source);
+	unsigned int frag = compile_fragment_shader(fragment_source);
+	free(fragment_source);
+	unsigned int program = create_shader_program(vert, frag);
+	glDeleteShader(vert);
+	glDeleteShader(frag);
+	glUseProgram(program);
+	glUniform1f(glGetUniformLocation(program, "aspect"), (float)TARGET_WIDTH / TARGET_HEIGHT);
+	return program;
+}
+
+
+// a sweep up the plane and back down a neighbouring lane, half a unit above it
+static void camera_at(int frame, float camera[3]) {
+	float t = (float)frame / FRAMES;
+	float along = t < 0.5f ? t * 2.0f : 2.0f - t * 2.0f;
+	camera[0] = t < 0.5f ? 2.5f : 5.5f;
+	camera[1] = 0.5f;
+	camera[2] = -1.0f + along * 7.0f;
+}
+
+
+static void draw_ground(unsigned int program, const float camera[3]) {
+	glUseProgram(program);
+	glUniform3fv(glGetUniformLocation(program, "camera"), 1, camera);
+	glDrawArrays(GL_TRIANGLES, 0, 6);
+}
+
+
+int main(int argc, char **argv) {
+	const char *image_path = argc > 1 ? argv[1] : "textures/img3.jpeg";
+	int tile_size = argc > 2 ? atoi(argv[2]) : TILE_SIZE;
+	if (tile_size <= 0) {
+		printf("usage: %s [image] [tile_size]\n", argv[0]);
+		return 1;
+	}
+
+	GLFWwindow *window = NULL;
+	if (glfwInit()) {
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		window = glfwCreateWindow(64, 64, "vt_bench", NULL, NULL);
+	}
+	if (!window) {
+		printf("no GL context\n");
+		return 1;
+	}
+	glfwMakeContextCurrent(window);
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+		printf("could not load GL\n");
+		return 1;
+	}
+
+	char cooked_path[64];
+	snprintf(cooked_path, sizeof(cooked_path), "/tmp/vt_bench_%d.vtex", (int)getpid());
+	double start = pacer_now();
+	if (!cook_virtual_texture(image_path, cooked_path, tile_size)) {
+		printf("could not cook %s, run from the repository root\n", image_path);
+		return 1;
+	}
+	printf("cooked %s in %.1f ms\n", image_path, (pacer_now() - start) * 1000.0);
+
+	unsigned int feedback_program = load_program("shaders/vt_feedback.frag");
+	unsigned int color_program = load_program("shaders/virtual_texture.frag");
+	if (!feedback_program || !color_program) {
+		printf("shaders not found, run from the repository root\n");
+		unlink(cooked_path);
+		return 1;
+	}
+
+	init_job_system();
+	static ASSET_LOADER loader;
+	if (!init_asset_loader(&loader, pacer_now())) {
+		unlink(cooked_path);
+		return 1;
+	}
+
+	// the budget is a whole number of slots, so the cache comes out exactly PAGE_SLOTS square
+	int slot = tile_size + 2 * VT_TILE_BORDER;
+	size_t page_bytes = (size_t)slot * slot * 4;
+	size_t budget = page_bytes * PAGE_SLOTS * PAGE_SLOTS;
+	static VIRTUAL_TEXTURE vt;
+	if (!init_virtual_texture(&vt, &loader, cooked_path, budget)) {
+		shutdown_asset_loader(&loader);
+		unlink(cooked_path);
+		return 1;
+	}
+	int pages = vt.level_first_tile[vt.header.levels - 1] + 1;
+	int slots = vt.cache_slots_x * vt.cache_slots_y;
+	printf("%dx%d image, %d levels, %d pages of %zu bytes: %.1f MB cooked\n", vt.header.image_width,
+			vt.header.image_height, vt.header.levels, pages, page_bytes, pages * page_bytes / (double)(1 << 20));
+	printf("page budget %d slots, %.1f MB of cache texture, %d frames at %dx%d\n", slots,
+			slots * page_bytes / (double)(1 << 20), FRAMES, TARGET_WIDTH, TARGET_HEIGHT);
+
+	unsigned int framebuffer, color, depth;
+	glGenFramebuffers(1, &framebuffer);
+	glGenRenderbuffers(1, &color);
+	glGenRenderbuffers(1, &depth);
+	glBindRenderbuffer(GL_RENDERBUFFER, color);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, TARGET_WIDTH, TARGET_HEIGHT);
+	glBindRenderbuffer(GL_RENDERBUFFER, depth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, TARGET_WIDTH, TARGET_HEIGHT);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+	glViewport(0, 0, TARGET_WIDTH, TARGET_HEIGHT);
+	glEnable(GL_DEPTH_TEST);
+
+	unsigned int vao;
+	glGenVertexArrays(1, &vao);
+	glBindVertexArray(vao);
+	bind_virtual_texture(&vt, feedback_program, 0, 1);
+	bind_virtual_texture(&vt, color_program, 0, 1);
+
+	int uploaded = 0, evicted = 0, peak_resident = 0, over_budget_frames = 0, streaming_frames = 0;
+	double update_seconds = 0.0, worst_update = 0.0;
+	VT_STATS stats = get_vt_stats(&vt);
+	for (int frame = 0; frame < FRAMES; frame++) {
+		double frame_start = pacer_now();
+		// tiles that landed since last frame are uploaded, evicting cold ones, before
+		// the page table is rebuilt; update_virtual_texture zeroes those counts
+		pump_gl_queue(&loader);
+		stats = get_vt_stats(&vt);
+		uploaded += stats.uploaded_tiles;
+		evicted += stats.evicted_tiles;
+
+		start = pacer_now();
+		update_virtual_texture(&vt);
+		double elapsed = pacer_now() - start;
+		update_seconds += elapsed;
+		worst_update = elapsed > worst_update ? elapsed : worst_update;
+
+		stats = get_vt_stats(&vt);
+		peak_resident = stats.resident_tiles > peak_resident ? stats.resident_tiles : peak_resident;
+		over_budget_frames += stats.resident_tiles > slots;
+		streaming_frames += vt.in_flight > 0;
+
+		float camera[3];
+		camera_at(frame, camera);
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		begin_vt_feedback(&vt, TARGET_WIDTH, TARGET_HEIGHT);
+		draw_ground(feedback_program, camera);
+		end_vt_feedback(&vt);
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		draw_ground(color_program, camera);
+		glFinish();
+
+		if (frame % REPORT_FRAMES == REPORT_FRAMES - 1) {
+			printf("  frame %3d: %3d of %d slots resident, %5.2f MB, %3d pages requested, %2d in flight\n", frame,
+					stats.resident_tiles, slots, stats.resident_tiles * page_bytes / (double)(1 << 20),
+					stats.requested_tiles, vt.in_flight);
+		}
+
+		double left = FRAME_SECONDS - (pacer_now() - frame_start);
+		if (left > 0.0) {
+			std::this_thread::sleep_for(std::chrono::duration<double>(left));
+		}
+	}
+
+	printf("resident  %5d pages now, %d peak of %d slots, over budget after %d of %d frames\n", stats.resident_tiles,
+			peak_resident, slots, over_budget_frames, FRAMES);
+	printf("          %5.2f MB now, %.2f MB peak, %.1f MB if every page were resident\n",
+			stats.resident_tiles * page_bytes / (double)(1 << 20), peak_resident * page_bytes / (double)(1 << 20),
+			pages * page_bytes / (double)(1 << 20));
+	printf("uploaded  %5d pages, %d evicted, %.1f MB streamed, tiles in flight during %d frames\n", uploaded, evicted,
+			stats.streamed_bytes / (double)(1 << 20), streaming_frames);
+	printf("update_virtual_texture %.3f ms average, %.3f ms worst\n", update_seconds / FRAMES * 1000.0,
+			worst_update * 1000.0);
+
+	shutdown_asset_loader(&loader);
+	destroy_virtual_texture(&vt);
+	shutdown_job_system();
+	unlink(cooked_path);
+	glDeleteVertexArrays(1, &vao);
+	glDeleteProgram(feedback_program);
+	glDeleteProgram(color_program);
+	glDeleteFramebuffers(1, &framebuffer);
+	glDeleteRenderbuffers(1, &color);
+	glDeleteRenderbuffers(1, &depth);
+	glfwDestroyWindow(window);
+	glfwTerminate();
+	return 0;
+}
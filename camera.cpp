@@ -10,16 +10,26 @@ static float clamp(float value, float min_val, float max_val) {
 }
 
 
+// yaw turns about worldup from -Z, pitch about the turned X axis; for the
+// usual +Y up this is the old cos/sin front vector. One sin/cos pair per
+// angle, and the basis comes out of the unit quaternion already orthonormal
 void update_cam_vecs(CAMERA *cam) {
-	glm::vec3 front;
-
-	front.x	= cos(glm::radians(cam->yaw)) * cos(glm::radians(cam->pitch));
-	front.y = sin(glm::radians(cam->pitch));
-	front.z = sin(glm::radians(cam->yaw)) * cos(glm::radians(cam->pitch));
-
-	cam->front	= glm::normalize(front);
-	cam->right 	= glm::normalize(glm::cross(cam->front, cam->worldup));
-	cam->up		= glm::normalize(glm::cross(cam->right, cam->front));
+	if (!(cam->dirty & CAM_DIRTY_ORIENTATION)) {
+		return;
+	}
+
+	float half_yaw		= glm::radians(-(cam->yaw + 90.0f)) * 0.5f;
+	float half_pitch	= glm::radians(cam->pitch) * 0.5f;
+	float sy = sinf(half_yaw);
+	float sp = sinf(half_pitch);
+	glm::quat turn(cosf(half_yaw), cam->worldup.x * sy, cam->worldup.y * sy, cam->worldup.z * sy);
+	glm::quat tilt(cosf(half_pitch), sp, 0.0f, 0.0f);
+	cam->orientation = turn * tilt;
+
+	cam->front	= cam->orientation * glm::vec3(0.0f, 0.0f, -1.0f);
+	cam->right	= cam->orientation * glm::vec3(1.0f, 0.0f,  0.0f);
+	cam->up		= cam->orientation * glm::vec3(0.0f, 1.0f,  0.0f);
+	cam->dirty &= ~CAM_DIRTY_ORIENTATION;
 }
 
 
@@ -42,49 +52,137 @@ CAMERA create_camera(
 	cam.move_speed	= move_speed;
 	cam.mouse_sensitivity	= mouse_sensitivity;
 	cam.zoom		= zoom;
+	cam.aspect		= ASPECT;
+	cam.near_plane	= NEAR_PLANE;
+	cam.far_plane	= FAR_PLANE;
+	cam.dirty		= CAM_DIRTY_ALL;
 	update_cam_vecs(&cam);
 	return cam;
 }
 
 
-glm::mat4 get_view_matrix(CAMERA *cam) {
-	return glm::lookAt(cam->position, cam->position + cam->front, cam->up);
+void set_cam_aspect(CAMERA *cam, float aspect) {
+	if (aspect != cam->aspect) {
+		cam->aspect = aspect;
+		cam->dirty |= CAM_DIRTY_PROJECTION | CAM_DIRTY_VIEW_PROJECTION;
+	}
+}
+
+
+// lookAt without its normalizes and crosses: the basis rows and the position
+// projected onto them
+const glm::mat4 &get_view_matrix(CAMERA *cam) {
+	if (cam->dirty & CAM_DIRTY_VIEW) {
+		update_cam_vecs(cam);
+		glm::mat4 &view = cam->view;
+		view = glm::mat4(1.0f);
+		view[0][0] =  cam->right.x;	view[1][0] =  cam->right.y;	view[2][0] =  cam->right.z;
+		view[0][1] =  cam->up.x;	view[1][1] =  cam->up.y;	view[2][1] =  cam->up.z;
+		view[0][2] = -cam->front.x;	view[1][2] = -cam->front.y;	view[2][2] = -cam->front.z;
+		view[3][0] = -glm::dot(cam->right, cam->position);
+		view[3][1] = -glm::dot(cam->up, cam->position);
+		view[3][2] =  glm::dot(cam->front, cam->position);
+		cam->dirty &= ~CAM_DIRTY_VIEW;
+	}
+	return cam->view;
+}
+
+
+const glm::mat4 &get_projection_matrix(CAMERA *cam) {
+	if (cam->dirty & CAM_DIRTY_PROJECTION) {
+		cam->projection = glm::perspective(glm::radians(cam->zoom), cam->aspect, cam->near_plane, cam->far_plane);
+		cam->dirty &= ~CAM_DIRTY_PROJECTION;
+	}
+	return cam->projection;
+}
+
+
+const glm::mat4 &get_view_projection_matrix(CAMERA *cam) {
+	if (cam->dirty & CAM_DIRTY_VIEW_PROJECTION) {
+		cam->view_projection = get_projection_matrix(cam) * get_view_matrix(cam);
+		cam->dirty &= ~CAM_DIRTY_VIEW_PROJECTION;
+	}
+	return cam->view_projection;
 }
 
 
 void get_cam_keyboard_input(CAMERA *cam, CAMERA_MOVEMENTS direction, float delta_time) {
-    float velocity = cam->move_speed * delta_time;
-    if (direction == FORWARD) {
-        cam->position += cam->front * velocity;
-    }
-    if (direction == BACKWARD) {
-        cam->position -= cam->front * velocity;
-    }
-    if (direction == LEFT) {
-        cam->position -= cam->right * velocity;
-    }
-    if (direction == RIGHT) {
-        cam->position += cam->right * velocity;
+    float forward	= direction == FORWARD ? 1.0f : (direction == BACKWARD ? -1.0f : 0.0f);
+    float strafe	= direction == RIGHT ? 1.0f : (direction == LEFT ? -1.0f : 0.0f);
+    get_cam_movement_input(cam, forward, strafe, delta_time);
+}
+
+
+void get_cam_movement_input(CAMERA *cam, float forward, float strafe, float delta_time) {
+    if (forward == 0.0f && strafe == 0.0f) {
+        return;
     }
+    update_cam_vecs(cam);
+    float velocity = cam->move_speed * delta_time;
+    cam->position += (cam->front * forward + cam->right * strafe) * velocity;
+    cam->dirty |= CAM_DIRTY_VIEW | CAM_DIRTY_VIEW_PROJECTION;
 }
 
 
+// no trig here: the orientation is rebuilt by whoever reads it next
 void get_cam_mouse_input(CAMERA *cam, float xoffset, float yoffset, bool constrain_pitch) {
-    xoffset *= cam->mouse_sensitivity;
-    yoffset *= cam->mouse_sensitivity;
-
-    cam->yaw	+= xoffset;
-    cam->pitch	+= yoffset;
+    float yaw	= cam->yaw + xoffset * cam->mouse_sensitivity;
+    float pitch	= cam->pitch + yoffset * cam->mouse_sensitivity;
 
     if (constrain_pitch) {
-		cam->pitch = clamp(cam->pitch, -PITCH_CONSTRAIN, PITCH_CONSTRAIN);
+		pitch = clamp(pitch, -PITCH_CONSTRAIN, PITCH_CONSTRAIN);
     }
 
-    update_cam_vecs(cam);
+    if (yaw != cam->yaw || pitch != cam->pitch) {
+        cam->yaw	= yaw;
+        cam->pitch	= pitch;
+        cam->dirty |= CAM_DIRTY_ORIENTATION | CAM_DIRTY_VIEW | CAM_DIRTY_VIEW_PROJECTION;
+    }
 }
 
 
 void get_cam_mouse_scroll(CAMERA *cam, float yoffset) {
-    cam->zoom -= yoffset;
-    cam->zoom = clamp(cam->zoom, ZOOM_MIN, ZOOM_MAX);
+    float zoom = clamp(cam->zoom - yoffset, ZOOM_MIN, ZOOM_MAX);
+    if (zoom != cam->zoom) {
+        cam->zoom = zoom;
+        cam->dirty |= CAM_DIRTY_PROJECTION | CAM_DIRTY_VIEW_PROJECTION;
+    }
+}
+
+
+// blend two sim ticks for rendering; yaw is unwrapped so a plain lerp is fine.
+// Ticks that match blend to exactly curr, so a still camera never goes dirty
+void interpolate_camera(CAMERA *cam, const CAMERA *prev, const CAMERA *curr, float alpha) {
+	if (prev->position == curr->position && prev->yaw == curr->yaw && prev->pitch == curr->pitch
+			&& prev->zoom == curr->zoom) {
+		alpha = 1.0f;
+	}
+	glm::vec3 position	= glm::mix(prev->position, curr->position, alpha);
+	float yaw			= glm::mix(prev->yaw, curr->yaw, alpha);
+	float pitch			= glm::mix(prev->pitch, curr->pitch, alpha);
+	float zoom			= glm::mix(prev->zoom, curr->zoom, alpha);
+
+	unsigned int dirty = cam->dirty;
+	if (yaw != cam->yaw || pitch != cam->pitch || curr->worldup != cam->worldup) {
+		dirty |= CAM_DIRTY_ORIENTATION | CAM_DIRTY_VIEW | CAM_DIRTY_VIEW_PROJECTION;
+	}
+	if (position != cam->position) {
+		dirty |= CAM_DIRTY_VIEW | CAM_DIRTY_VIEW_PROJECTION;
+	}
+	if (zoom != cam->zoom || curr->aspect != cam->aspect || curr->near_plane != cam->near_plane
+			|| curr->far_plane != cam->far_plane) {
+		dirty |= CAM_DIRTY_PROJECTION | CAM_DIRTY_VIEW_PROJECTION;
+	}
+
+	cam->position		= position;
+	cam->yaw			= yaw;
+	cam->pitch			= pitch;
+	cam->zoom			= zoom;
+	cam->worldup		= curr->worldup;
+	cam->move_speed		= curr->move_speed;
+	cam->mouse_sensitivity	= curr->mouse_sensitivity;
+	cam->aspect			= curr->aspect;
+	cam->near_plane		= curr->near_plane;
+	cam->far_plane		= curr->far_plane;
+	cam->dirty			= dirty;
 }
@@ -3,6 +3,7 @@
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
 
 enum CAMERA_MOVEMENTS {
     FORWARD,
@@ -11,6 +12,15 @@ enum CAMERA_MOVEMENTS {
     RIGHT
 };
 
+// what has to be rebuilt before the cached state can be read again
+enum CAMERA_DIRTY {
+	CAM_DIRTY_ORIENTATION		= 1 << 0,	// orientation and basis vectors, from yaw and pitch
+	CAM_DIRTY_VIEW				= 1 << 1,
+	CAM_DIRTY_PROJECTION		= 1 << 2,
+	CAM_DIRTY_VIEW_PROJECTION	= 1 << 3,
+	CAM_DIRTY_ALL				= 0xf
+};
+
 // default camera values
 const float YAW				= -90.0f;
 const float PITCH			=   0.0f;
@@ -20,7 +30,15 @@ const float ZOOM			=  45.0f;
 const float PITCH_CONSTRAIN	=  89.0f;
 const float ZOOM_MIN		=	1.0f;
 const float ZOOM_MAX		=  45.0f;
+const float ASPECT			= 4.0f / 3.0f;
+const float NEAR_PLANE		=	0.1f;
+const float FAR_PLANE		= 100.0f;
 
+// Yaw, pitch, position and zoom are the camera's state; everything below
+// them is derived and rebuilt lazily, once, by the first reader after a
+// change. Change them through the functions below (or set dirty), so a
+// 1000Hz mouse costs two adds per event and a camera that holds still costs
+// nothing per frame.
 typedef struct {
 	// camera attributes
 	glm::vec3 position;
@@ -37,9 +55,20 @@ typedef struct {
 	float move_speed;
 	float mouse_sensitivity;
 	float zoom;
+	float aspect;
+	float near_plane;
+	float far_plane;
+
+	// derived
+	glm::quat orientation;	// rotation from looking down -Z with +Y up
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::mat4 view_projection;
+	unsigned int dirty;		// CAMERA_DIRTY bits
 } CAMERA;
 
 
+// rebuilds orientation and the basis vectors if yaw or pitch changed
 void update_cam_vecs(CAMERA *cam);
 CAMERA create_camera(
 		glm::vec3 position	= glm::vec3(0.0f, 0.0f,  3.0f),
@@ -52,8 +81,13 @@ CAMERA create_camera(
 		float pitch			= PITCH
 		);	
 
-glm::mat4 get_view_matrix(CAMERA *cam);
+void set_cam_aspect(CAMERA *cam, float aspect);
+const glm::mat4 &get_view_matrix(CAMERA *cam);
+const glm::mat4 &get_projection_matrix(CAMERA *cam);
+const glm::mat4 &get_view_projection_matrix(CAMERA *cam);
 void get_cam_keyboard_input(CAMERA *cam, CAMERA_MOVEMENTS direction, float delta_time);
+// forward and strafe are -1..1 axes, so held keys combine into one move
+void get_cam_movement_input(CAMERA *cam, float forward, float strafe, float delta_time);
 void get_cam_mouse_input(CAMERA *cam, 
 		float xoffset, 
 		float yoffset, 
@@ -61,5 +95,7 @@ void get_cam_mouse_input(CAMERA *cam,
 		); 
 
 void get_cam_mouse_scroll(CAMERA *cam, float yoffset);
+// blends into cam, which keeps its cached matrices when the result matches it
+void interpolate_camera(CAMERA *cam, const CAMERA *prev, const CAMERA *curr, float alpha);
 
 #endif
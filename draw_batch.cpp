@@ -0,0 +1,103 @@
+#include "draw_batch.h"
+
+#include "job_system.h"
+
+typedef struct {
+	const FRAME_SNAPSHOT *snapshot;
+	int pass_count;
+	int passes[MAX_PASSES];
+	unsigned char pass_masks[MAX_PASSES];
+	int *offsets;						// per block and pass: a count, then where the block writes
+	DRAW_COMMAND *lists[MAX_PASSES];	// NULL while counting
+} BATCH_BUILD;
+
+
+// the runs in draws [begin, end) visible under view_mask; writes them to out
+// unless it is NULL
+static int scan_runs(const FRAME_SNAPSHOT *snapshot, int begin, int end, unsigned char view_mask,
+		DRAW_COMMAND *out) {
+	int runs = 0;
+	int run_start = -1;
+	for (int i = begin; i <= end; i++) {
+		bool visible = i < end && (snapshot->view_masks[i] & view_mask);
+		if (run_start >= 0 && visible && snapshot->draws[i].mesh == snapshot->draws[run_start].mesh) {
+			continue;
+		}
+		if (run_start >= 0) {
+			if (out) {
+				out[runs] = { snapshot->draws[run_start].mesh, run_start, i - run_start };
+			}
+			runs++;
+		}
+		run_start = visible ? i : -1;
+	}
+	return runs;
+}
+
+
+static void batch_blocks(void *data, int begin, int end) {
+	BATCH_BUILD *build = (BATCH_BUILD *)data;
+	for (int block = begin; block < end; block++) {
+		int first = block * BATCH_BLOCK_DRAWS;
+		int last = first + BATCH_BLOCK_DRAWS < build->snapshot->draw_count ? first + BATCH_BLOCK_DRAWS
+				: build->snapshot->draw_count;
+		for (int p = 0; p < build->pass_count; p++) {
+			int *offset = &build->offsets[block * build->pass_count + p];
+			if (build->lists[p]) {
+				scan_runs(build->snapshot, first, last, build->pass_masks[p], build->lists[p] + *offset);
+			} else {
+				*offset = scan_runs(build->snapshot, first, last, build->pass_masks[p], NULL);
+			}
+		}
+	}
+}
+
+
+void clear_draw_commands(FRAME_SNAPSHOT *snapshot) {
+	for (int pass = 0; pass < MAX_PASSES; pass++) {
+		snapshot->passes[pass] = { NULL, 0 };
+	}
+}
+
+
+bool build_draw_commands(FRAME_SNAPSHOT *snapshot, FRAME_ARENAS *arenas) {
+	clear_draw_commands(snapshot);
+	BATCH_BUILD build = {};
+	build.snapshot = snapshot;
+	for (int v = 0; v < snapshot->view_count; v++) {
+		build.passes[build.pass_count] = v;
+		build.pass_masks[build.pass_count++] = (unsigned char)(1 << v);
+	}
+	if (snapshot->stereo) {
+		build.passes[build.pass_count] = STEREO_PASS;
+		build.pass_masks[build.pass_count++] = 0x3;
+	}
+	int blocks = (snapshot->draw_count + BATCH_BLOCK_DRAWS - 1) / BATCH_BLOCK_DRAWS;
+	if (!blocks) {
+		return true;
+	}
+	build.offsets = (int *)frame_alloc(arenas, blocks * build.pass_count * sizeof(int));
+	if (!build.offsets) {
+		return false;
+	}
+	parallel_for(blocks, 1, batch_blocks, &build);
+
+	// counts become offsets, each pass's list sized to its total
+	for (int p = 0; p < build.pass_count; p++) {
+		int total = 0;
+		for (int block = 0; block < blocks; block++) {
+			int *offset = &build.offsets[block * build.pass_count + p];
+			int count = *offset;
+			*offset = total;
+			total += count;
+		}
+		build.lists[p] = (DRAW_COMMAND *)frame_alloc(arenas, (total ? total : 1) * sizeof(DRAW_COMMAND));
+		if (!build.lists[p]) {
+			clear_draw_commands(snapshot);
+			return false;
+		}
+		snapshot->passes[build.passes[p]] = { build.lists[p], total };
+	}
+	parallel_for(blocks, 1, batch_blocks, &build);
+	return true;
+}
@@ -0,0 +1,20 @@
+#ifndef DRAW_BATCH_H
+#define DRAW_BATCH_H
+
+#include "arena.h"
+#include "render_thread.h"
+
+// default draw batching values
+const int BATCH_BLOCK_DRAWS = 1024;	// draws each job scans; runs break at block edges
+
+// Turns the culled draws into each pass's command list: a command per run of
+// consecutive draws visible in the pass that share a mesh. Blocks of draws
+// are counted on the workers, then written on the workers at offsets from
+// the counts, so the lists come out in draw order. The lists are taken from
+// the frame arenas; false, with every list empty, when they do not fit. Call
+// from a worker thread after cull_views
+bool build_draw_commands(FRAME_SNAPSHOT *snapshot, FRAME_ARENAS *arenas);
+// every pass empty, for a snapshot that skips build_draw_commands
+void clear_draw_commands(FRAME_SNAPSHOT *snapshot);
+
+#endif
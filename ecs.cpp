@@ -0,0 +1,273 @@
+#include "ecs.h"
+#include <string.h>
+
+#include "job_system.h"
+
+static const int component_sizes[COMPONENT_TYPE_COUNT] = {
+	sizeof(TRANSFORM_COMPONENT),
+	sizeof(MESH_REF),
+	sizeof(MATERIAL_REF),
+	sizeof(BOUNDS_COMPONENT),
+	sizeof(SCENE_NODE_REF)
+};
+
+
+static int align_up(int value, int alignment) {
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+
+// places the arrays for capacity entities; returns the bytes they take
+static int place_arrays(ARCHETYPE *arch, int capacity) {
+	int size = capacity * (int)sizeof(int);
+	for (int type = 0; type < COMPONENT_TYPE_COUNT; type++) {
+		if (!(arch->mask & (1u << type))) {
+			arch->offsets[type] = -1;
+			continue;
+		}
+		size = align_up(size, ECS_ARRAY_ALIGN);
+		arch->offsets[type] = size;
+		size += capacity * component_sizes[type];
+	}
+	return size;
+}
+
+
+// as many rows as fit in a chunk once the arrays are aligned
+static void layout_archetype(ARCHETYPE *arch) {
+	int row_size = sizeof(int);
+	for (int type = 0; type < COMPONENT_TYPE_COUNT; type++) {
+		if (arch->mask & (1u << type)) {
+			row_size += component_sizes[type];
+		}
+	}
+	int capacity = ECS_CHUNK_SIZE / row_size;
+	while (place_arrays(arch, capacity) > ECS_CHUNK_SIZE) {
+		capacity--;
+	}
+	arch->capacity = capacity;
+}
+
+
+static int find_archetype(ECS_WORLD *world, unsigned int mask) {
+	for (size_t i = 0; i < world->archetypes.size(); i++) {
+		if (world->archetypes[i].mask == mask) {
+			return (int)i;
+		}
+	}
+	ARCHETYPE arch;
+	arch.mask = mask;
+	layout_archetype(&arch);
+	world->archetypes.push_back(arch);
+	return (int)world->archetypes.size() - 1;
+}
+
+
+static inline int *chunk_entities(ECS_CHUNK *chunk) {
+	return (int *)chunk->data;
+}
+
+
+static inline unsigned char *chunk_component(const ARCHETYPE *arch, ECS_CHUNK *chunk, int type, int row) {
+	return chunk->data + arch->offsets[type] + row * component_sizes[type];
+}
+
+
+// appends a zeroed row for index, starting a chunk when the last is full
+static void append_row(ECS_WORLD *world, ARCHETYPE *arch, int index, int *chunk_index, int *row) {
+	if (arch->chunks.empty() || arch->chunks.back().count == arch->capacity) {
+		ECS_CHUNK chunk;
+		chunk.data = (unsigned char *)pool_alloc(&world->chunk_pool);
+		chunk.count = 0;
+		arch->chunks.push_back(chunk);
+	}
+	ECS_CHUNK *chunk = &arch->chunks.back();
+	*chunk_index = (int)arch->chunks.size() - 1;
+	*row = chunk->count++;
+	chunk_entities(chunk)[*row] = index;
+	for (int type = 0; type < COMPONENT_TYPE_COUNT; type++) {
+		if (arch->offsets[type] >= 0) {
+			memset(chunk_component(arch, chunk, type, *row), 0, component_sizes[type]);
+		}
+	}
+}
+
+
+// fills the hole with the archetype's last entity and frees an emptied chunk
+static void remove_row(ECS_WORLD *world, int archetype, int chunk_index, int row) {
+	ARCHETYPE *arch = &world->archetypes[archetype];
+	ECS_CHUNK *hole = &arch->chunks[chunk_index];
+	ECS_CHUNK *last = &arch->chunks.back();
+	int last_row = last->count - 1;
+	if (hole != last || row != last_row) {
+		int moved = chunk_entities(last)[last_row];
+		chunk_entities(hole)[row] = moved;
+		for (int type = 0; type < COMPONENT_TYPE_COUNT; type++) {
+			if (arch->offsets[type] >= 0) {
+				memcpy(chunk_component(arch, hole, type, row), chunk_component(arch, last, type, last_row),
+						component_sizes[type]);
+			}
+		}
+		world->entities[moved].chunk = chunk_index;
+		world->entities[moved].row = row;
+	}
+	if (--last->count == 0) {
+		pool_free(&world->chunk_pool, last->data);
+		arch->chunks.pop_back();
+	}
+}
+
+
+void init_ecs_world(ECS_WORLD *world) {
+	world->archetypes.clear();
+	world->entities.clear();
+	world->free_entities.clear();
+	world->matched.clear();
+	world->entity_count = 0;
+	init_pool(&world->chunk_pool, ECS_CHUNK_SIZE, ECS_CHUNK_ALIGN, ECS_POOL_PAGE);
+}
+
+
+void destroy_ecs_world(ECS_WORLD *world) {
+	destroy_pool(&world->chunk_pool);
+	init_ecs_world(world);
+}
+
+
+ENTITY create_entity(ECS_WORLD *world, unsigned int mask) {
+	ENTITY entity;
+	if (!world->free_entities.empty()) {
+		entity.index = world->free_entities.back();
+		world->free_entities.pop_back();
+	} else {
+		entity.index = (int)world->entities.size();
+		world->entities.push_back({ -1, 0, 0, 0 });
+	}
+	ENTITY_RECORD *record = &world->entities[entity.index];
+	entity.generation = record->generation;
+	record->archetype = find_archetype(world, mask);
+	append_row(world, &world->archetypes[record->archetype], entity.index, &record->chunk, &record->row);
+	world->entity_count++;
+	return entity;
+}
+
+
+bool entity_alive(const ECS_WORLD *world, ENTITY entity) {
+	if (entity.index < 0 || entity.index >= (int)world->entities.size()) {
+		return false;
+	}
+	const ENTITY_RECORD *record = &world->entities[entity.index];
+	return record->archetype >= 0 && record->generation == entity.generation;
+}
+
+
+void destroy_entity(ECS_WORLD *world, ENTITY entity) {
+	if (!entity_alive(world, entity)) {
+		return;
+	}
+	ENTITY_RECORD *record = &world->entities[entity.index];
+	remove_row(world, record->archetype, record->chunk, record->row);
+	record->archetype = -1;
+	record->generation++;
+	world->free_entities.push_back(entity.index);
+	world->entity_count--;
+}
+
+
+void set_entity_components(ECS_WORLD *world, ENTITY entity, unsigned int mask) {
+	if (!entity_alive(world, entity)) {
+		return;
+	}
+	ENTITY_RECORD *record = &world->entities[entity.index];
+	if (world->archetypes[record->archetype].mask == mask) {
+		return;
+	}
+	int from_archetype = record->archetype;
+	int from_chunk = record->chunk;
+	int from_row = record->row;
+	int to_archetype = find_archetype(world, mask);
+
+	// find_archetype may have grown the list, so look both up afterwards
+	ARCHETYPE *from = &world->archetypes[from_archetype];
+	ARCHETYPE *to = &world->archetypes[to_archetype];
+	int to_chunk, to_row;
+	append_row(world, to, entity.index, &to_chunk, &to_row);
+	for (int type = 0; type < COMPONENT_TYPE_COUNT; type++) {
+		if (from->offsets[type] >= 0 && to->offsets[type] >= 0) {
+			memcpy(chunk_component(to, &to->chunks[to_chunk], type, to_row),
+					chunk_component(from, &from->chunks[from_chunk], type, from_row), component_sizes[type]);
+		}
+	}
+	remove_row(world, from_archetype, from_chunk, from_row);
+	record->archetype = to_archetype;
+	record->chunk = to_chunk;
+	record->row = to_row;
+}
+
+
+void *get_component(ECS_WORLD *world, ENTITY entity, COMPONENT_TYPE type) {
+	if (!entity_alive(world, entity)) {
+		return NULL;
+	}
+	const ENTITY_RECORD *record = &world->entities[entity.index];
+	ARCHETYPE *arch = &world->archetypes[record->archetype];
+	if (arch->offsets[type] < 0) {
+		return NULL;
+	}
+	return chunk_component(arch, &arch->chunks[record->chunk], type, record->row);
+}
+
+
+int count_entities(const ECS_WORLD *world, unsigned int mask) {
+	int count = 0;
+	for (const ARCHETYPE &arch : world->archetypes) {
+		if ((arch.mask & mask) != mask) {
+			continue;
+		}
+		for (const ECS_CHUNK &chunk : arch.chunks) {
+			count += chunk.count;
+		}
+	}
+	return count;
+}
+
+
+typedef struct {
+	const CHUNK_VIEW *chunks;
+	SYSTEM_FUNC func;
+	void *data;
+} SYSTEM_RUN;
+
+
+static void run_chunks(void *data, int begin, int end) {
+	SYSTEM_RUN *run = (SYSTEM_RUN *)data;
+	for (int i = begin; i < end; i++) {
+		run->func(run->data, &run->chunks[i]);
+	}
+}
+
+
+int run_system(ECS_WORLD *world, unsigned int mask, SYSTEM_FUNC func, void *data) {
+	world->matched.clear();
+	int total = 0;
+	for (ARCHETYPE &arch : world->archetypes) {
+		if ((arch.mask & mask) != mask) {
+			continue;
+		}
+		for (ECS_CHUNK &chunk : arch.chunks) {
+			CHUNK_VIEW view;
+			view.count = chunk.count;
+			view.first = total;
+			view.entities = chunk_entities(&chunk);
+			for (int type = 0; type < COMPONENT_TYPE_COUNT; type++) {
+				view.components[type] = arch.offsets[type] >= 0 ? chunk.data + arch.offsets[type] : NULL;
+			}
+			world->matched.push_back(view);
+			total += chunk.count;
+		}
+	}
+
+	SYSTEM_RUN run = { world->matched.data(), func, data };
+	parallel_for((int)world->matched.size(), ECS_CHUNK_BATCH, run_chunks, &run);
+	return total;
+}
@@ -0,0 +1,128 @@
+#ifndef ECS_H
+#define ECS_H
+
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "pool.h"
+
+// default entity system values
+const int ECS_CHUNK_SIZE	= 16 * 1024;	// bytes per chunk, entity ids included
+const int ECS_CHUNK_ALIGN	= 64;			// chunk start, one cache line
+const int ECS_ARRAY_ALIGN	= 16;			// each component array within a chunk
+const int ECS_CHUNK_BATCH	= 1;			// chunks per job in run_system
+const int ECS_POOL_PAGE		= 16;			// chunks per page of the chunk pool
+
+enum COMPONENT_TYPE {
+	COMPONENT_TRANSFORM,
+	COMPONENT_MESH,
+	COMPONENT_MATERIAL,
+	COMPONENT_BOUNDS,
+	COMPONENT_SCENE_NODE,
+	COMPONENT_TYPE_COUNT
+};
+
+// an archetype is the set of component types its entities have
+enum COMPONENT_MASK {
+	HAS_TRANSFORM	= 1 << COMPONENT_TRANSFORM,
+	HAS_MESH		= 1 << COMPONENT_MESH,
+	HAS_MATERIAL	= 1 << COMPONENT_MATERIAL,
+	HAS_BOUNDS		= 1 << COMPONENT_BOUNDS,
+	HAS_SCENE_NODE	= 1 << COMPONENT_SCENE_NODE
+};
+
+typedef struct {
+	glm::mat4 world;
+} TRANSFORM_COMPONENT;
+
+// a mesh in the renderer's mesh pool
+typedef struct {
+	int mesh;
+} MESH_REF;
+
+typedef struct {
+	int texture_layers[2];
+} MATERIAL_REF;
+
+// world-space sphere the views cull against
+typedef struct {
+	glm::vec3 center;
+	float radius;
+} BOUNDS_COMPONENT;
+
+// the scene graph node the transform follows
+typedef struct {
+	int node;
+} SCENE_NODE_REF;
+
+typedef struct {
+	int index;
+	unsigned int generation;	// tells a reused index from the entity that held it before
+} ENTITY;
+
+// ECS_CHUNK_SIZE bytes: the entity indices, then one array per component type
+// of the archetype, each entity at the same row in every array
+typedef struct {
+	unsigned char *data;
+	int count;
+} ECS_CHUNK;
+
+// every chunk is full except the last; removing an entity moves the
+// archetype's last one into the hole, so the arrays never have gaps
+typedef struct {
+	unsigned int mask;						// COMPONENT_MASK
+	int capacity;							// entities per chunk
+	int offsets[COMPONENT_TYPE_COUNT];		// array start within a chunk, -1 when absent
+	std::vector<ECS_CHUNK> chunks;
+} ARCHETYPE;
+
+typedef struct {
+	int archetype;			// -1 while the index is free
+	int chunk;
+	int row;
+	unsigned int generation;
+} ENTITY_RECORD;
+
+// what a system sees of one chunk
+typedef struct {
+	int count;
+	int first;				// rows of the matched chunks before this one
+	const int *entities;	// entity indices by row
+	void *components[COMPONENT_TYPE_COUNT];	// arrays by type, NULL when the archetype lacks it
+} CHUNK_VIEW;
+
+typedef void (*SYSTEM_FUNC)(void *data, const CHUNK_VIEW *chunk);
+
+// Entities grouped by archetype, each archetype's components stored as
+// separate arrays in fixed-size chunks, so a system walking one component
+// streams through memory holding nothing else
+typedef struct {
+	std::vector<ARCHETYPE> archetypes;
+	std::vector<ENTITY_RECORD> entities;	// by entity index
+	std::vector<int> free_entities;
+	std::vector<CHUNK_VIEW> matched;		// run_system's chunk list, kept between runs
+	POOL chunk_pool;						// emptied chunks wait here for the next archetype to fill
+	int entity_count;
+} ECS_WORLD;
+
+
+void init_ecs_world(ECS_WORLD *world);
+void destroy_ecs_world(ECS_WORLD *world);
+
+// the new entity's components are zeroed
+ENTITY create_entity(ECS_WORLD *world, unsigned int mask);
+void destroy_entity(ECS_WORLD *world, ENTITY entity);
+bool entity_alive(const ECS_WORLD *world, ENTITY entity);
+// moves the entity to the archetype for mask, keeping the components both share
+void set_entity_components(ECS_WORLD *world, ENTITY entity, unsigned int mask);
+// NULL when the entity lacks the component; valid until entities are added,
+// removed or change archetype
+void *get_component(ECS_WORLD *world, ENTITY entity, COMPONENT_TYPE type);
+
+int count_entities(const ECS_WORLD *world, unsigned int mask);
+// calls func for every chunk whose archetype has all of mask, the chunks spread
+// over the job system; returns the entities matched. Call from a worker thread,
+// and create or destroy no entities until it returns
+int run_system(ECS_WORLD *world, unsigned int mask, SYSTEM_FUNC func, void *data);
+
+#endif
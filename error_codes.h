@@ -6,5 +6,7 @@
 #define GLFW_INIT_FAILED 8734
 #define GLFW_WINDOW_CREATE_FAILED 5404
 #define GLAD_INIT_FAILED 1872
+#define ASSET_LOADER_INIT_FAILED 2716
+#define FRAME_ARENA_INIT_FAILED 3158
 
 #endif
\ No newline at end of file
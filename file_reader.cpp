@@ -0,0 +1,558 @@
+#include "file_reader.h"
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <chrono>
+
+// user_data of the no-op that wakes the reaper for shutdown
+const unsigned long long WAKE_USER_DATA = 0;
+
+
+static int ring_setup(unsigned int entries, struct io_uring_params *params) {
+	return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+
+static int ring_enter(int fd, unsigned int to_submit, unsigned int min_complete, unsigned int flags) {
+	return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+
+static int ring_register(int fd, unsigned int opcode, const void *arg, unsigned int nr_args) {
+	return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+
+// small files land in a preallocated buffer, everything else gets its own
+static void allocate_read_buffer(FILE_READER *reader, FILE_READ *read) {
+	read->buffer_index = -1;
+	if (read->size <= READER_BUFFER_SIZE) {
+		std::lock_guard<std::mutex> lock(reader->buffer_mutex);
+		if (!reader->free_buffers.empty()) {
+			read->buffer_index = reader->free_buffers.back();
+			reader->free_buffers.pop_back();
+		}
+	}
+
+	if (read->buffer_index >= 0) {
+		read->data = reader->buffers + (size_t)read->buffer_index * READER_BUFFER_SIZE;
+	} else {
+		read->data = (unsigned char *)malloc(read->size ? read->size : 1);
+	}
+}
+
+
+static bool open_for_read(FILE_READER *reader, FILE_READ *read) {
+	read->data = NULL;
+	read->size = 0;
+	read->offset = 0;
+	read->error = 0;
+	read->buffer_index = -1;
+
+	read->fd = open(read->path, O_RDONLY | O_CLOEXEC);
+	if (read->fd < 0) {
+		read->error = errno;
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(read->fd, &st) != 0) {
+		read->error = errno;
+		close(read->fd);
+		read->fd = -1;
+		return false;
+	}
+
+	read->size = (size_t)st.st_size;
+	allocate_read_buffer(reader, read);
+	if (!read->data) {
+		read->error = ENOMEM;
+		close(read->fd);
+		read->fd = -1;
+		return false;
+	}
+	return true;
+}
+
+
+static void complete_read(FILE_READ *read) {
+	if (read->fd >= 0) {
+		close(read->fd);
+		read->fd = -1;
+	}
+	read->callback(read);
+}
+
+
+// io_uring backend ---------------------------------------------------------
+
+// the callback runs before the count drops, so a drained reader has no
+// callbacks left running either
+static void finish_read(FILE_READER *reader, FILE_READ *read) {
+	complete_read(read);
+	std::lock_guard<std::mutex> lock(reader->flight_mutex);
+	if (--reader->in_flight == 0) {
+		reader->drained.notify_all();
+	}
+}
+
+
+// needs submit_mutex; the kernel may take fewer than were queued, the rest
+// stay pending for the next call
+static bool submit_pending(FILE_READER *reader) {
+	int submitted = ring_enter(reader->ring_fd, reader->sq.pending, 0, 0);
+	if (submitted < 0) {
+		return false;
+	}
+	reader->sq.pending -= (unsigned int)submitted;
+	return true;
+}
+
+
+// needs submit_mutex; false only if the ring is full and could not be flushed
+static bool queue_sqe(FILE_READER *reader, unsigned char opcode, int fd, void *addr,
+		unsigned int len, unsigned long long offset, int buf_index, unsigned long long user_data) {
+	READER_SQ *sq = &reader->sq;
+	unsigned int tail = *sq->tail;
+	unsigned int head = __atomic_load_n(sq->head, __ATOMIC_ACQUIRE);
+
+	if (tail - head > *sq->ring_mask) {
+		if (!submit_pending(reader)) {
+			return false;
+		}
+		head = __atomic_load_n(sq->head, __ATOMIC_ACQUIRE);
+		if (tail - head > *sq->ring_mask) {
+			return false;
+		}
+	}
+
+	unsigned int index = tail & *sq->ring_mask;
+	struct io_uring_sqe *sqe = &sq->sqes[index];
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode		= opcode;
+	sqe->fd			= fd;
+	sqe->addr		= (unsigned long long)(uintptr_t)addr;
+	sqe->len		= len;
+	sqe->off		= offset;
+	sqe->buf_index	= buf_index >= 0 ? (unsigned short)buf_index : 0;
+	sqe->user_data	= user_data;
+
+	sq->array[index] = index;
+	__atomic_store_n(sq->tail, tail + 1, __ATOMIC_RELEASE);
+	sq->pending++;
+	return true;
+}
+
+
+static bool queue_read(FILE_READER *reader, FILE_READ *read) {
+	bool fixed = read->buffer_index >= 0 && reader->buffers_registered;
+	return queue_sqe(reader, fixed ? IORING_OP_READ_FIXED : IORING_OP_READ, read->fd,
+			read->data + read->offset, (unsigned int)(read->size - read->offset),
+			read->offset, fixed ? read->buffer_index : -1, (unsigned long long)(uintptr_t)read);
+}
+
+
+static void flush_submissions(FILE_READER *reader) {
+	if (reader->sq.pending > 0) {
+		submit_pending(reader);
+	}
+}
+
+
+static void handle_completion(FILE_READER *reader, FILE_READ *read, int result) {
+	if (result == -EINTR || result == -EAGAIN) {
+		result = 0;	// resubmit below
+	} else if (result < 0) {
+		read->error = -result;
+		finish_read(reader, read);
+		return;
+	} else if (result == 0) {
+		// file shrank under us, hand back what we have
+		read->size = read->offset;
+		finish_read(reader, read);
+		return;
+	}
+
+	read->offset += (size_t)result;
+	if (read->offset >= read->size) {
+		finish_read(reader, read);
+		return;
+	}
+
+	// short read: queue the rest
+	bool queued;
+	{
+		std::lock_guard<std::mutex> lock(reader->submit_mutex);
+		queued = queue_read(reader, read);
+		flush_submissions(reader);
+	}
+
+	if (!queued) {
+		read->error = EBUSY;
+		finish_read(reader, read);
+	}
+}
+
+
+static void reaper_main(FILE_READER *reader) {
+	READER_CQ *cq = &reader->cq;
+	bool stopping = false;
+
+	while (!stopping) {
+		int ret = ring_enter(reader->ring_fd, 0, 1, IORING_ENTER_GETEVENTS);
+		if (ret < 0 && errno != EINTR) {
+			fprintf(stderr, "ERROR:FILE_READER:RING_ENTER:FAILED %s\n", strerror(errno));
+			// nothing reaps the reads left in flight, so shutdown must not wait on them
+			std::lock_guard<std::mutex> lock(reader->flight_mutex);
+			reader->reaper_failed = true;
+			reader->drained.notify_all();
+			return;
+		}
+
+		unsigned int head = *cq->head;
+		unsigned int tail = __atomic_load_n(cq->tail, __ATOMIC_ACQUIRE);
+		while (head != tail) {
+			struct io_uring_cqe *cqe = &cq->cqes[head & *cq->ring_mask];
+			unsigned long long user_data = cqe->user_data;
+			int result = cqe->res;
+			head++;
+			__atomic_store_n(cq->head, head, __ATOMIC_RELEASE);
+
+			if (user_data == WAKE_USER_DATA) {
+				stopping = true;
+			} else {
+				handle_completion(reader, (FILE_READ *)(uintptr_t)user_data, result);
+			}
+			tail = __atomic_load_n(cq->tail, __ATOMIC_ACQUIRE);
+		}
+	}
+}
+
+
+static bool init_io_uring(FILE_READER *reader) {
+	struct io_uring_params params;
+	memset(&params, 0, sizeof(params));
+
+	reader->ring_fd = ring_setup(READER_QUEUE_DEPTH, &params);
+	if (reader->ring_fd < 0) {
+		return false;
+	}
+
+	reader->sq_map_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+	reader->cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+	if (single_mmap && reader->cq_map_size > reader->sq_map_size) {
+		reader->sq_map_size = reader->cq_map_size;
+	}
+
+	reader->sq_map = mmap(NULL, reader->sq_map_size, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, reader->ring_fd, IORING_OFF_SQ_RING);
+	if (reader->sq_map == MAP_FAILED) {
+		close(reader->ring_fd);
+		return false;
+	}
+
+	reader->cq_map = reader->sq_map;
+	if (!single_mmap) {
+		reader->cq_map = mmap(NULL, reader->cq_map_size, PROT_READ | PROT_WRITE,
+				MAP_SHARED | MAP_POPULATE, reader->ring_fd, IORING_OFF_CQ_RING);
+		if (reader->cq_map == MAP_FAILED) {
+			munmap(reader->sq_map, reader->sq_map_size);
+			close(reader->ring_fd);
+			return false;
+		}
+	}
+
+	reader->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+	void *sqes = mmap(NULL, reader->sqes_size, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, reader->ring_fd, IORING_OFF_SQES);
+	if (sqes == MAP_FAILED) {
+		if (!single_mmap) munmap(reader->cq_map, reader->cq_map_size);
+		munmap(reader->sq_map, reader->sq_map_size);
+		close(reader->ring_fd);
+		return false;
+	}
+
+	unsigned char *sq_base = (unsigned char *)reader->sq_map;
+	reader->sq.head			= (unsigned int *)(sq_base + params.sq_off.head);
+	reader->sq.tail			= (unsigned int *)(sq_base + params.sq_off.tail);
+	reader->sq.ring_mask	= (unsigned int *)(sq_base + params.sq_off.ring_mask);
+	reader->sq.array		= (unsigned int *)(sq_base + params.sq_off.array);
+	reader->sq.sqes			= (struct io_uring_sqe *)sqes;
+	reader->sq.pending		= 0;
+
+	unsigned char *cq_base = (unsigned char *)reader->cq_map;
+	reader->cq.head			= (unsigned int *)(cq_base + params.cq_off.head);
+	reader->cq.tail			= (unsigned int *)(cq_base + params.cq_off.tail);
+	reader->cq.ring_mask	= (unsigned int *)(cq_base + params.cq_off.ring_mask);
+	reader->cq.cqes			= (struct io_uring_cqe *)(cq_base + params.cq_off.cqes);
+
+	// pinning can fail under a low RLIMIT_MEMLOCK; plain reads into the same buffers still work
+	struct iovec iovecs[READER_BUFFER_COUNT];
+	for (int i = 0; i < READER_BUFFER_COUNT; i++) {
+		iovecs[i].iov_base	= reader->buffers + (size_t)i * READER_BUFFER_SIZE;
+		iovecs[i].iov_len	= READER_BUFFER_SIZE;
+	}
+	reader->buffers_registered =
+		ring_register(reader->ring_fd, IORING_REGISTER_BUFFERS, iovecs, READER_BUFFER_COUNT) == 0;
+
+	reader->reaper_failed = false;
+	reader->reaper = std::thread(reaper_main, reader);
+	return true;
+}
+
+
+// false if reads may still be landing in the buffers; the caller must then
+// leave them, and the ring, allocated
+static bool shutdown_io_uring(FILE_READER *reader) {
+	{
+		std::lock_guard<std::mutex> lock(reader->submit_mutex);
+		reader->stopping = true;
+	}
+
+	// reads left pending by a short submit are flushed again until the kernel
+	// has taken and finished all of them
+	bool drained = false;
+	while (!drained) {
+		{
+			std::lock_guard<std::mutex> lock(reader->submit_mutex);
+			flush_submissions(reader);
+		}
+		std::unique_lock<std::mutex> lock(reader->flight_mutex);
+		reader->drained.wait_for(lock, std::chrono::milliseconds(1),
+				[reader] { return reader->in_flight == 0 || reader->reaper_failed; });
+		drained = reader->in_flight == 0;
+		if (!drained && reader->reaper_failed) {
+			fprintf(stderr, "ERROR:FILE_READER:SHUTDOWN:READS_IN_FLIGHT %d\n", reader->in_flight);
+			reader->reaper.join();
+			return false;
+		}
+	}
+
+	// with nothing in flight the ring is empty, so only a failed syscall keeps
+	// the no-op from going in
+	bool woken = reader->reaper_failed;
+	for (int attempt = 0; attempt < 100 && !woken; attempt++) {
+		std::lock_guard<std::mutex> lock(reader->submit_mutex);
+		if (reader->sq.pending == 0) {
+			queue_sqe(reader, IORING_OP_NOP, -1, NULL, 0, 0, -1, WAKE_USER_DATA);
+		}
+		flush_submissions(reader);
+		woken = reader->sq.pending == 0;
+		if (!woken) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+	if (!woken) {
+		// the reaper still reads the ring and the reader, so neither can go
+		fprintf(stderr, "ERROR:FILE_READER:SHUTDOWN:WAKE_FAILED\n");
+		reader->reaper.detach();
+		return false;
+	}
+	reader->reaper.join();
+
+	munmap(reader->sq.sqes, reader->sqes_size);
+	if (reader->cq_map != reader->sq_map) {
+		munmap(reader->cq_map, reader->cq_map_size);
+	}
+	munmap(reader->sq_map, reader->sq_map_size);
+	close(reader->ring_fd);
+	return true;
+}
+
+
+// thread pool backend ------------------------------------------------------
+
+static void pool_read(FILE_READER *reader, FILE_READ *read) {
+	if (!open_for_read(reader, read)) {
+		read->callback(read);
+		return;
+	}
+
+	while (read->offset < read->size) {
+		ssize_t n = pread(read->fd, read->data + read->offset, read->size - read->offset, read->offset);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n < 0) {
+			read->error = errno;
+			break;
+		}
+		if (n == 0) {
+			read->size = read->offset;
+			break;
+		}
+		read->offset += (size_t)n;
+	}
+
+	complete_read(read);
+}
+
+
+static void pool_thread_main(FILE_READER *reader) {
+	while (true) {
+		FILE_READ *read;
+		{
+			std::unique_lock<std::mutex> lock(reader->pool_mutex);
+			reader->pool_ready.wait(lock, [reader] { return reader->stopping || !reader->pool_queue.empty(); });
+			if (reader->pool_queue.empty()) {
+				return;
+			}
+			read = reader->pool_queue.front();
+			reader->pool_queue.pop_front();
+		}
+		pool_read(reader, read);
+	}
+}
+
+
+// public -------------------------------------------------------------------
+
+bool init_file_reader(FILE_READER *reader, FILE_READER_BACKEND backend) {
+	reader->stopping = false;
+	reader->in_flight = 0;
+	reader->buffers = (unsigned char *)aligned_alloc(4096, READER_BUFFER_COUNT * READER_BUFFER_SIZE);
+	if (!reader->buffers) {
+		fprintf(stderr, "ERROR:FILE_READER:BUFFER:ALLOCATION:FAILED\n");
+		return false;
+	}
+
+	reader->buffers_registered = false;
+	reader->free_buffers.clear();
+	for (int i = READER_BUFFER_COUNT - 1; i >= 0; i--) {
+		reader->free_buffers.push_back(i);
+	}
+
+	if (backend != READER_THREAD_POOL && init_io_uring(reader)) {
+		reader->backend = READER_IO_URING;
+		return true;
+	}
+	if (backend == READER_IO_URING) {
+		fprintf(stderr, "ERROR:FILE_READER:IO_URING:UNAVAILABLE\n");
+		free(reader->buffers);
+		reader->buffers = NULL;
+		return false;
+	}
+
+	reader->backend = READER_THREAD_POOL;
+	for (int i = 0; i < READER_POOL_THREADS; i++) {
+		reader->pool.emplace_back(pool_thread_main, reader);
+	}
+	return true;
+}
+
+
+void shutdown_file_reader(FILE_READER *reader) {
+	if (reader->backend == READER_IO_URING) {
+		if (!shutdown_io_uring(reader)) {
+			return;
+		}
+	} else {
+		// the pool threads empty the queue before they exit
+		{
+			std::lock_guard<std::mutex> lock(reader->pool_mutex);
+			reader->stopping = true;
+		}
+		reader->pool_ready.notify_all();
+		for (std::thread &thread : reader->pool) {
+			thread.join();
+		}
+		reader->pool.clear();
+	}
+
+	free(reader->buffers);
+	reader->buffers = NULL;
+}
+
+
+const char *get_reader_backend_name(const FILE_READER *reader) {
+	if (reader->backend == READER_IO_URING) {
+		return reader->buffers_registered ? "io_uring (registered buffers)" : "io_uring";
+	}
+	return "thread pool";
+}
+
+
+static void cancel_reads(FILE_READ **reads, int count) {
+	for (int i = 0; i < count; i++) {
+		reads[i]->data = NULL;
+		reads[i]->size = 0;
+		reads[i]->buffer_index = -1;
+		reads[i]->fd = -1;
+		reads[i]->error = ECANCELED;
+		reads[i]->callback(reads[i]);
+	}
+}
+
+
+// with io_uring the files are opened here, on the calling thread; a failed open
+// runs the callback before this returns
+void submit_file_reads(FILE_READER *reader, FILE_READ **reads, int count) {
+	if (reader->backend == READER_THREAD_POOL) {
+		std::unique_lock<std::mutex> lock(reader->pool_mutex);
+		if (reader->stopping) {
+			lock.unlock();
+			cancel_reads(reads, count);
+			return;
+		}
+		for (int i = 0; i < count; i++) {
+			reader->pool_queue.push_back(reads[i]);
+		}
+		lock.unlock();
+		reader->pool_ready.notify_all();
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(reader->submit_mutex);
+	if (reader->stopping) {
+		lock.unlock();
+		cancel_reads(reads, count);
+		return;
+	}
+	for (int i = 0; i < count; i++) {
+		FILE_READ *read = reads[i];
+		if (!open_for_read(reader, read) || read->size == 0) {
+			lock.unlock();
+			complete_read(read);
+			lock.lock();
+			continue;
+		}
+
+		if (!queue_read(reader, read)) {
+			read->error = EBUSY;
+			lock.unlock();
+			complete_read(read);
+			lock.lock();
+			continue;
+		}
+		std::lock_guard<std::mutex> flight_lock(reader->flight_mutex);
+		reader->in_flight++;
+	}
+	flush_submissions(reader);
+}
+
+
+void submit_file_read(FILE_READER *reader, FILE_READ *read) {
+	submit_file_reads(reader, &read, 1);
+}
+
+
+void release_file_read(FILE_READER *reader, FILE_READ *read) {
+	if (read->buffer_index >= 0) {
+		std::lock_guard<std::mutex> lock(reader->buffer_mutex);
+		reader->free_buffers.push_back(read->buffer_index);
+	} else {
+		free(read->data);
+	}
+
+	read->data = NULL;
+	read->buffer_index = -1;
+}
@@ -0,0 +1,105 @@
+#ifndef FILE_READER_H
+#define FILE_READER_H
+
+#include <stddef.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+enum FILE_READER_BACKEND {
+	READER_AUTO,		// io_uring if the kernel allows it, else the thread pool
+	READER_IO_URING,
+	READER_THREAD_POOL
+};
+
+// default reader values
+const unsigned int READER_QUEUE_DEPTH	= 256;
+const int READER_BUFFER_COUNT			= 64;			// registered with the ring
+const size_t READER_BUFFER_SIZE			= 256 * 1024;	// larger files get their own allocation
+const int READER_POOL_THREADS			= 4;
+
+typedef struct FILE_READ FILE_READ;
+typedef void (*FILE_READ_CALLBACK)(FILE_READ *read);
+
+// one whole-file read; data stays valid until release_file_read
+struct FILE_READ {
+	const char *path;
+	FILE_READ_CALLBACK callback;	// runs on a reader thread
+	void *user;
+
+	unsigned char *data;
+	size_t size;
+	int error;			// 0 or an errno value
+
+	// internal
+	int fd;
+	int buffer_index;	// registered buffer, or -1 for a heap buffer
+	size_t offset;
+};
+
+typedef struct {
+	unsigned int *head;
+	unsigned int *tail;
+	unsigned int *ring_mask;
+	unsigned int *array;
+	struct io_uring_sqe *sqes;
+	unsigned int pending;	// queued but not yet submitted
+} READER_SQ;
+
+typedef struct {
+	unsigned int *head;
+	unsigned int *tail;
+	unsigned int *ring_mask;
+	struct io_uring_cqe *cqes;
+} READER_CQ;
+
+typedef struct {
+	FILE_READER_BACKEND backend;
+	bool stopping;
+
+	// io_uring backend
+	int ring_fd;
+	void *sq_map;
+	size_t sq_map_size;
+	void *cq_map;
+	size_t cq_map_size;
+	size_t sqes_size;
+	READER_SQ sq;
+	READER_CQ cq;
+	std::mutex submit_mutex;
+	std::thread reaper;
+	bool reaper_failed;
+
+	// reads the kernel may still write into; shutdown drains them to 0
+	int in_flight;
+	std::mutex flight_mutex;
+	std::condition_variable drained;
+
+	// registered buffers, also used by the pool so both backends behave alike
+	unsigned char *buffers;
+	bool buffers_registered;
+	std::vector<int> free_buffers;
+	std::mutex buffer_mutex;
+
+	// thread pool backend
+	std::vector<std::thread> pool;
+	std::deque<FILE_READ *> pool_queue;
+	std::mutex pool_mutex;
+	std::condition_variable pool_ready;
+} FILE_READER;
+
+
+bool init_file_reader(FILE_READER *reader, FILE_READER_BACKEND backend = READER_AUTO);
+// finishes every read already submitted, callbacks included, before freeing
+// anything; reads submitted after this starts fail with ECANCELED
+void shutdown_file_reader(FILE_READER *reader);
+const char *get_reader_backend_name(const FILE_READER *reader);
+
+// queues every read and submits them with a single syscall
+void submit_file_reads(FILE_READER *reader, FILE_READ **reads, int count);
+void submit_file_read(FILE_READER *reader, FILE_READ *read);
+void release_file_read(FILE_READER *reader, FILE_READ *read);
+
+#endif
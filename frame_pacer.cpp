@@ -0,0 +1,152 @@
+#include "frame_pacer.h"
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+
+double pacer_now() {
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+
+FRAME_PACER create_frame_pacer(PRESENT_MODE mode, float target_fps, bool finish_after_swap) {
+	FRAME_PACER pacer = {};
+	pacer.mode				= mode;
+	pacer.target_frame_time	= target_fps > 0.0f ? 1.0 / target_fps : 0.0;
+	pacer.spin_margin		= SPIN_MARGIN;
+	pacer.finish_after_swap	= finish_after_swap;
+
+	double now = pacer_now();
+	pacer.next_deadline		= now;
+	pacer.frame_start		= now;
+	pacer.last_frame_start	= now;
+	pacer.input_sampled		= now;
+	pacer.last_report		= now;
+	return pacer;
+}
+
+
+// needs a current context
+void apply_present_mode(FRAME_PACER *pacer) {
+	glfwSwapInterval(pacer->mode == PRESENT_VSYNC ? 1 : 0);
+}
+
+
+// sleep most of the way to the deadline, then spin off the remainder,
+// since sleep_for routinely oversleeps by a scheduler tick
+void pacer_wait(FRAME_PACER *pacer) {
+	if (pacer->mode != PRESENT_FIXED_RATE || pacer->target_frame_time <= 0.0) {
+		return;
+	}
+
+	double now = pacer_now();
+	pacer->next_deadline += pacer->target_frame_time;
+
+	// fell behind by more than a frame: resync instead of bursting to catch up
+	if (pacer->next_deadline < now - pacer->target_frame_time) {
+		pacer->next_deadline = now;
+		return;
+	}
+
+	double sleep_time = pacer->next_deadline - now - pacer->spin_margin;
+	if (sleep_time > 0.0) {
+		std::this_thread::sleep_for(std::chrono::duration<double>(sleep_time));
+	}
+
+	while (pacer_now() < pacer->next_deadline) {
+		std::this_thread::yield();
+	}
+}
+
+
+// call right before input is applied, returns the timestep for this frame
+float pacer_begin_frame(FRAME_PACER *pacer) {
+	pacer->last_frame_start = pacer->frame_start;
+	pacer->frame_start = pacer_now();
+	return static_cast<float>(pacer->frame_start - pacer->last_frame_start);
+}
+
+
+void pacer_mark_input(FRAME_PACER *pacer) {
+	pacer->input_sampled = pacer_now();
+}
+
+
+// call right after glfwSwapBuffers
+void pacer_mark_present(FRAME_PACER *pacer) {
+	pacer_record_present(pacer,
+			static_cast<float>(pacer->frame_start - pacer->last_frame_start),
+			pacer->input_sampled);
+}
+
+
+// same as pacer_mark_present, for a thread that presents frames timed elsewhere
+void pacer_record_present(FRAME_PACER *pacer, float frame_time, double input_sampled) {
+	if (pacer->finish_after_swap) {
+		glFinish();
+	}
+
+	double presented = pacer_now();
+	int i = pacer->sample_head;
+	pacer->frame_times[i]	= frame_time;
+	pacer->latencies[i]		= static_cast<float>(presented - input_sampled);
+
+	pacer->sample_head = (i + 1) % FRAME_STATS_SAMPLES;
+	if (pacer->sample_count < FRAME_STATS_SAMPLES) {
+		pacer->sample_count++;
+	}
+}
+
+
+FRAME_STATS get_frame_stats(const FRAME_PACER *pacer) {
+	FRAME_STATS stats = {};
+	int n = pacer->sample_count;
+	if (n == 0) {
+		return stats;
+	}
+
+	float sorted[FRAME_STATS_SAMPLES];
+	double frame_sum = 0.0;
+	double latency_sum = 0.0;
+	for (int i = 0; i < n; i++) {
+		sorted[i] = pacer->frame_times[i];
+		frame_sum += pacer->frame_times[i];
+		latency_sum += pacer->latencies[i];
+		stats.max_latency_ms = std::max(stats.max_latency_ms, pacer->latencies[i] * 1000.0f);
+	}
+
+	double mean = frame_sum / n;
+	double variance = 0.0;
+	for (int i = 0; i < n; i++) {
+		double d = pacer->frame_times[i] - mean;
+		variance += d * d;
+	}
+
+	std::sort(sorted, sorted + n);
+	stats.avg_frame_ms		= static_cast<float>(mean * 1000.0);
+	stats.jitter_ms			= static_cast<float>(sqrt(variance / n) * 1000.0);
+	stats.p99_frame_ms		= sorted[(n * 99) / 100] * 1000.0f;
+	stats.max_frame_ms		= sorted[n - 1] * 1000.0f;
+	stats.avg_latency_ms	= static_cast<float>(latency_sum / n * 1000.0);
+	return stats;
+}
+
+
+void report_frame_stats(FRAME_PACER *pacer) {
+	double now = pacer_now();
+	if (now - pacer->last_report < STATS_REPORT_PERIOD) {
+		return;
+	}
+	pacer->last_report = now;
+
+	FRAME_STATS stats = get_frame_stats(pacer);
+	printf("frame %.2f ms (jitter %.3f, p99 %.2f, max %.2f) | input->present %.2f ms (max %.2f)\n",
+			stats.avg_frame_ms, stats.jitter_ms, stats.p99_frame_ms, stats.max_frame_ms,
+			stats.avg_latency_ms, stats.max_latency_ms);
+}
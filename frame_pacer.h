@@ -0,0 +1,63 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+enum PRESENT_MODE {
+	PRESENT_VSYNC,		// swap interval 1, the driver paces us
+	PRESENT_UNCAPPED,	// swap interval 0, run as fast as possible
+	PRESENT_FIXED_RATE	// swap interval 0, sleep-plus-spin to target_fps
+};
+
+// default pacing values
+const float TARGET_FPS			= 60.0f;
+const double SPIN_MARGIN		= 0.002;	// seconds left to busy-wait after sleeping
+const int FRAME_STATS_SAMPLES	= 240;
+const double STATS_REPORT_PERIOD = 1.0;		// seconds between reports
+
+typedef struct {
+	PRESENT_MODE mode;
+	double target_frame_time;
+	double spin_margin;
+	bool finish_after_swap;	// glFinish after swap so latency includes the GPU
+
+	// timestamps in seconds
+	double next_deadline;
+	double frame_start;
+	double last_frame_start;
+	double input_sampled;
+
+	// ring of the last FRAME_STATS_SAMPLES frames
+	float frame_times[FRAME_STATS_SAMPLES];
+	float latencies[FRAME_STATS_SAMPLES];
+	int sample_head;
+	int sample_count;
+	double last_report;
+} FRAME_PACER;
+
+typedef struct {
+	float avg_frame_ms;
+	float jitter_ms;	// standard deviation of the frame time
+	float p99_frame_ms;
+	float max_frame_ms;
+	float avg_latency_ms;
+	float max_latency_ms;
+} FRAME_STATS;
+
+
+double pacer_now();
+FRAME_PACER create_frame_pacer(
+		PRESENT_MODE mode		= PRESENT_VSYNC,
+		float target_fps		= TARGET_FPS,
+		bool finish_after_swap	= false
+		);
+
+void apply_present_mode(FRAME_PACER *pacer);
+void pacer_wait(FRAME_PACER *pacer);
+float pacer_begin_frame(FRAME_PACER *pacer);
+void pacer_mark_input(FRAME_PACER *pacer);
+void pacer_mark_present(FRAME_PACER *pacer);
+void pacer_record_present(FRAME_PACER *pacer, float frame_time, double input_sampled);
+
+FRAME_STATS get_frame_stats(const FRAME_PACER *pacer);
+void report_frame_stats(FRAME_PACER *pacer);
+
+#endif
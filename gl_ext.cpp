@@ -0,0 +1,58 @@
+#include "gl_ext.h"
+#include <GLFW/glfw3.h>
+#include <string.h>
+
+GL_EXT_SUPPORT gl_ext;
+
+
+bool has_gl_extension(const char *name) {
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for (GLint i = 0; i < count; i++) {
+		const char *extension = (const char *)glGetStringi(GL_EXTENSIONS, i);
+		if (extension && strcmp(extension, name) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+
+void load_gl_extensions() {
+	gl_ext = {};
+
+	gl_ext.max_anisotropy = 1.0f;
+	if (has_gl_extension("GL_EXT_texture_filter_anisotropic") || has_gl_extension("GL_ARB_texture_filter_anisotropic")) {
+		glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY, &gl_ext.max_anisotropy);
+	}
+
+	gl_ext.shader_layer = has_gl_extension("GL_ARB_shader_viewport_layer_array");
+	if (has_gl_extension("GL_OVR_multiview") && has_gl_extension("GL_OVR_multiview2")) {
+		gl_ext.FramebufferTextureMultiviewOVR = (PFN_FRAMEBUFFER_TEXTURE_MULTIVIEW)glfwGetProcAddress("glFramebufferTextureMultiviewOVR");
+		gl_ext.multiview = gl_ext.FramebufferTextureMultiviewOVR != NULL;
+	}
+
+	if (has_gl_extension("GL_ARB_buffer_storage")) {
+		gl_ext.BufferStorage = (PFN_BUFFER_STORAGE)glfwGetProcAddress("glBufferStorage");
+		gl_ext.buffer_storage = gl_ext.BufferStorage != NULL;
+	}
+	if (has_gl_extension("GL_ARB_multi_draw_indirect") && has_gl_extension("GL_ARB_draw_indirect")
+			&& has_gl_extension("GL_ARB_base_instance")) {
+		gl_ext.MultiDrawElementsIndirect = (PFN_MULTI_DRAW_ELEMENTS_INDIRECT)glfwGetProcAddress("glMultiDrawElementsIndirect");
+		gl_ext.multi_draw_indirect = gl_ext.MultiDrawElementsIndirect != NULL;
+	}
+	if (has_gl_extension("GL_ARB_shader_storage_buffer_object")) {
+		glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &gl_ext.storage_buffer_alignment);
+	}
+
+	if (has_gl_extension("GL_ARB_bindless_texture")) {
+		gl_ext.GetTextureHandleARB = (PFN_GET_TEXTURE_HANDLE)glfwGetProcAddress("glGetTextureHandleARB");
+		gl_ext.GetTextureSamplerHandleARB = (PFN_GET_TEXTURE_SAMPLER_HANDLE)glfwGetProcAddress("glGetTextureSamplerHandleARB");
+		gl_ext.MakeTextureHandleResidentARB = (PFN_MAKE_TEXTURE_HANDLE_RESIDENT)glfwGetProcAddress("glMakeTextureHandleResidentARB");
+		gl_ext.MakeTextureHandleNonResidentARB = (PFN_MAKE_TEXTURE_HANDLE_NON_RESIDENT)glfwGetProcAddress("glMakeTextureHandleNonResidentARB");
+		gl_ext.UniformHandleui64ARB = (PFN_UNIFORM_HANDLE)glfwGetProcAddress("glUniformHandleui64ARB");
+		gl_ext.bindless_texture = gl_ext.GetTextureHandleARB && gl_ext.GetTextureSamplerHandleARB
+			&& gl_ext.MakeTextureHandleResidentARB
+			&& gl_ext.MakeTextureHandleNonResidentARB && gl_ext.UniformHandleui64ARB;
+	}
+}
@@ -0,0 +1,80 @@
+#ifndef GL_EXT_H
+#define GL_EXT_H
+
+#include <glad/glad.h>
+
+// glad is generated for plain 3.3 core, so anything newer is looked up here at
+// runtime and only used when the driver advertises it
+
+// GL_ARB_bindless_texture
+typedef GLuint64 (APIENTRYP PFN_GET_TEXTURE_HANDLE)(GLuint texture);
+typedef GLuint64 (APIENTRYP PFN_GET_TEXTURE_SAMPLER_HANDLE)(GLuint texture, GLuint sampler);
+typedef void (APIENTRYP PFN_MAKE_TEXTURE_HANDLE_RESIDENT)(GLuint64 handle);
+typedef void (APIENTRYP PFN_MAKE_TEXTURE_HANDLE_NON_RESIDENT)(GLuint64 handle);
+typedef void (APIENTRYP PFN_UNIFORM_HANDLE)(GLint location, GLuint64 value);
+
+// GL_OVR_multiview
+typedef void (APIENTRYP PFN_FRAMEBUFFER_TEXTURE_MULTIVIEW)(GLenum target, GLenum attachment, GLuint texture,
+		GLint level, GLint base_view_index, GLsizei num_views);
+
+// GL_ARB_buffer_storage, core in 4.4
+typedef void (APIENTRYP PFN_BUFFER_STORAGE)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT			0x0040
+#define GL_MAP_COHERENT_BIT				0x0080
+#endif
+
+// GL_ARB_multi_draw_indirect, core in 4.3; needs GL_ARB_draw_indirect for the
+// buffer target and GL_ARB_base_instance for base_instance to be honoured
+typedef void (APIENTRYP PFN_MULTI_DRAW_ELEMENTS_INDIRECT)(GLenum mode, GLenum type, const void *indirect,
+		GLsizei draw_count, GLsizei stride);
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER			0x8F3F
+#endif
+
+// what the driver reads from the indirect buffer for each draw
+typedef struct {
+	GLuint count;
+	GLuint instance_count;
+	GLuint first_index;
+	GLint base_vertex;
+	GLuint base_instance;
+} DRAW_ELEMENTS_INDIRECT_COMMAND;
+
+// GL_ARB_shader_storage_buffer_object, core in 4.3
+#ifndef GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT
+#define GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT	0x90DF
+#endif
+
+// GL_EXT_texture_filter_anisotropic, core in 4.6 under the same values
+#ifndef GL_TEXTURE_MAX_ANISOTROPY
+#define GL_TEXTURE_MAX_ANISOTROPY		0x84FE
+#define GL_MAX_TEXTURE_MAX_ANISOTROPY	0x84FF
+#endif
+
+typedef struct {
+	bool bindless_texture;
+	float max_anisotropy;	// 1 when anisotropic filtering is unavailable
+	bool multiview;			// GL_OVR_multiview2: one draw renders to several array layers
+	bool shader_layer;		// GL_ARB_shader_viewport_layer_array: gl_Layer from the vertex shader
+	bool buffer_storage;	// GL_ARB_buffer_storage: immutable buffers that stay mapped while drawn from
+	int storage_buffer_alignment;	// offset alignment for shader storage ranges, 0 without them
+	bool multi_draw_indirect;	// one call for many draws, each with its own base instance
+
+	PFN_GET_TEXTURE_HANDLE GetTextureHandleARB;
+	PFN_GET_TEXTURE_SAMPLER_HANDLE GetTextureSamplerHandleARB;
+	PFN_MAKE_TEXTURE_HANDLE_RESIDENT MakeTextureHandleResidentARB;
+	PFN_MAKE_TEXTURE_HANDLE_NON_RESIDENT MakeTextureHandleNonResidentARB;
+	PFN_UNIFORM_HANDLE UniformHandleui64ARB;
+	PFN_FRAMEBUFFER_TEXTURE_MULTIVIEW FramebufferTextureMultiviewOVR;
+	PFN_BUFFER_STORAGE BufferStorage;
+	PFN_MULTI_DRAW_ELEMENTS_INDIRECT MultiDrawElementsIndirect;
+} GL_EXT_SUPPORT;
+
+extern GL_EXT_SUPPORT gl_ext;
+
+// needs a current context; safe to call again after a context switch
+void load_gl_extensions();
+bool has_gl_extension(const char *name);
+
+#endif
@@ -0,0 +1,763 @@
+#include "mesh_import.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <string>
+
+#include "job_system.h"
+
+// glTF 2.0 import, a minimal JSON reader included; no GL calls, like mesh_import.cpp
+
+const int JSON_MAX_DEPTH		= 64;
+const int GLTF_MAX_NODE_DEPTH	= 64;
+const uint32_t GLB_MAGIC		= 0x46546C67;	// "glTF"
+const uint32_t GLB_CHUNK_JSON	= 0x4E4F534A;
+const uint32_t GLB_CHUNK_BIN	= 0x004E4942;
+const int GLTF_TRIANGLES		= 4;
+
+enum JSON_TYPE {
+	JSON_NULL,
+	JSON_BOOL,
+	JSON_NUMBER,
+	JSON_STRING,
+	JSON_ARRAY,
+	JSON_OBJECT
+};
+
+typedef struct JSON_VALUE JSON_VALUE;
+struct JSON_VALUE {
+	JSON_TYPE type;
+	double number;					// bools too
+	std::string string;
+	std::vector<JSON_VALUE> items;	// array items or object values
+	std::vector<std::string> keys;	// object keys, one per item
+};
+
+typedef struct {
+	const char *p;
+	const char *end;
+} JSON_READER;
+
+// an accessor resolved to memory; data NULL reads as zeros
+typedef struct {
+	const unsigned char *data;
+	int count;
+	int components;
+	int component_type;
+	bool normalized;
+	size_t stride;
+} GLTF_ACCESSOR;
+
+// one triangle primitive placed by one node, with where its output goes
+typedef struct {
+	GLTF_ACCESSOR positions;
+	GLTF_ACCESSOR normals;		// count 0 when absent, and below
+	GLTF_ACCESSOR uvs;
+	GLTF_ACCESSOR tangents;
+	GLTF_ACCESSOR indices;
+	glm::mat4 transform;
+	glm::mat3 linear;			// transform without the translation
+	glm::mat3 normal_matrix;
+	float mirror;				// -1 when transform mirrors
+	int first_vertex;
+	int first_index;
+	int index_count;
+} GLTF_PRIMITIVE;
+
+typedef struct {
+	JSON_VALUE json;
+	const unsigned char *bin;						// a .glb's binary chunk
+	size_t bin_size;
+	std::vector<std::vector<unsigned char>> buffers;
+	std::vector<GLTF_PRIMITIVE> primitives;
+	int skipped_primitives;
+} GLTF_FILE;
+
+typedef struct {
+	const GLTF_PRIMITIVE *primitives;
+	int primitive_count;
+	IMPORTED_MESH *mesh;
+	std::atomic<bool> bad_index;
+} GLTF_DECODE;
+
+
+static void skip_json_space(JSON_READER *reader) {
+	while (reader->p < reader->end && (*reader->p == ' ' || *reader->p == '\t' || *reader->p == '\n'
+			|| *reader->p == '\r')) {
+		reader->p++;
+	}
+}
+
+
+static void append_utf8(std::string *out, unsigned int code) {
+	if (code < 0x80) {
+		*out += (char)code;
+	} else if (code < 0x800) {
+		*out += (char)(0xC0 | code >> 6);
+		*out += (char)(0x80 | (code & 0x3F));
+	} else {
+		*out += (char)(0xE0 | code >> 12);
+		*out += (char)(0x80 | (code >> 6 & 0x3F));
+		*out += (char)(0x80 | (code & 0x3F));
+	}
+}
+
+
+static bool read_json_string(JSON_READER *reader, std::string *out) {
+	if (reader->p >= reader->end || *reader->p != '"') {
+		return false;
+	}
+	reader->p++;
+	while (reader->p < reader->end && *reader->p != '"') {
+		char c = *reader->p++;
+		if (c != '\\') {
+			*out += c;
+			continue;
+		}
+		if (reader->p >= reader->end) {
+			return false;
+		}
+		c = *reader->p++;
+		switch (c) {
+			case 'b': *out += '\b'; break;
+			case 'f': *out += '\f'; break;
+			case 'n': *out += '\n'; break;
+			case 'r': *out += '\r'; break;
+			case 't': *out += '\t'; break;
+			case 'u': {
+				// surrogate pairs are not joined; names and URIs seldom need them
+				if (reader->end - reader->p < 4) {
+					return false;
+				}
+				char hex[5] = { reader->p[0], reader->p[1], reader->p[2], reader->p[3], '\0' };
+				append_utf8(out, (unsigned int)strtoul(hex, NULL, 16));
+				reader->p += 4;
+				break;
+			}
+			default: *out += c; break;
+		}
+	}
+	if (reader->p >= reader->end) {
+		return false;
+	}
+	reader->p++;
+	return true;
+}
+
+
+static bool read_json_value(JSON_READER *reader, JSON_VALUE *value, int depth) {
+	skip_json_space(reader);
+	if (reader->p >= reader->end || depth > JSON_MAX_DEPTH) {
+		return false;
+	}
+	char c = *reader->p;
+	if (c == '{' || c == '[') {
+		bool object = c == '{';
+		value->type = object ? JSON_OBJECT : JSON_ARRAY;
+		reader->p++;
+		skip_json_space(reader);
+		if (reader->p < reader->end && *reader->p == (object ? '}' : ']')) {
+			reader->p++;
+			return true;
+		}
+		while (true) {
+			if (object) {
+				skip_json_space(reader);
+				value->keys.emplace_back();
+				if (!read_json_string(reader, &value->keys.back())) {
+					return false;
+				}
+				skip_json_space(reader);
+				if (reader->p >= reader->end || *reader->p != ':') {
+					return false;
+				}
+				reader->p++;
+			}
+			value->items.emplace_back();
+			if (!read_json_value(reader, &value->items.back(), depth + 1)) {
+				return false;
+			}
+			skip_json_space(reader);
+			if (reader->p >= reader->end) {
+				return false;
+			}
+			c = *reader->p++;
+			if (c == (object ? '}' : ']')) {
+				return true;
+			}
+			if (c != ',') {
+				return false;
+			}
+		}
+	}
+	if (c == '"') {
+		value->type = JSON_STRING;
+		return read_json_string(reader, &value->string);
+	}
+	static const struct { const char *word; JSON_TYPE type; double number; } words[] = {
+		{ "true", JSON_BOOL, 1.0 }, { "false", JSON_BOOL, 0.0 }, { "null", JSON_NULL, 0.0 }
+	};
+	for (const auto &word : words) {
+		size_t length = strlen(word.word);
+		if ((size_t)(reader->end - reader->p) >= length && !memcmp(reader->p, word.word, length)) {
+			value->type = word.type;
+			value->number = word.number;
+			reader->p += length;
+			return true;
+		}
+	}
+
+	// numbers are short; strtod needs them terminated
+	char number[64];
+	size_t length = 0;
+	while (reader->p + length < reader->end && length < sizeof(number) - 1
+			&& reader->p[length] && strchr("+-0123456789.eE", reader->p[length])) {
+		number[length] = reader->p[length];
+		length++;
+	}
+	number[length] = '\0';
+	char *parsed;
+	value->type = JSON_NUMBER;
+	value->number = strtod(number, &parsed);
+	if (parsed == number) {
+		return false;
+	}
+	reader->p += parsed - number;
+	return true;
+}
+
+
+static const JSON_VALUE *json_member(const JSON_VALUE *object, const char *key) {
+	if (!object || object->type != JSON_OBJECT) {
+		return NULL;
+	}
+	for (size_t i = 0; i < object->keys.size(); i++) {
+		if (object->keys[i] == key) {
+			return &object->items[i];
+		}
+	}
+	return NULL;
+}
+
+
+static const JSON_VALUE *json_item(const JSON_VALUE *array, int index) {
+	if (!array || array->type != JSON_ARRAY || index < 0 || index >= (int)array->items.size()) {
+		return NULL;
+	}
+	return &array->items[index];
+}
+
+
+static double json_number(const JSON_VALUE *object, const char *key, double fallback) {
+	const JSON_VALUE *member = json_member(object, key);
+	return member && (member->type == JSON_NUMBER || member->type == JSON_BOOL) ? member->number : fallback;
+}
+
+
+static int json_count(const JSON_VALUE *array) {
+	return array && array->type == JSON_ARRAY ? (int)array->items.size() : 0;
+}
+
+
+static bool decode_base64(const char *text, size_t length, std::vector<unsigned char> *out) {
+	unsigned int bits = 0;
+	int bit_count = 0;
+	out->reserve(length * 3 / 4);
+	for (size_t i = 0; i < length && text[i] != '='; i++) {
+		char c = text[i];
+		int value = c >= 'A' && c <= 'Z' ? c - 'A' : c >= 'a' && c <= 'z' ? c - 'a' + 26
+				: c >= '0' && c <= '9' ? c - '0' + 52 : c == '+' ? 62 : c == '/' ? 63 : -1;
+		if (value < 0) {
+			return false;
+		}
+		bits = bits << 6 | value;
+		bit_count += 6;
+		if (bit_count >= 8) {
+			bit_count -= 8;
+			out->push_back((unsigned char)(bits >> bit_count));
+		}
+	}
+	return true;
+}
+
+
+static bool read_whole_file(const std::string &path, std::vector<unsigned char> *data) {
+	FILE *file = fopen(path.c_str(), "rb");
+	if (!file) {
+		return false;
+	}
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	data->resize(size > 0 ? size : 0);
+	bool read = size > 0 && fread(data->data(), 1, data->size(), file) == data->size();
+	fclose(file);
+	return read;
+}
+
+
+// every buffer in memory: the .glb chunk, a data URI, or a file beside path
+static bool load_gltf_buffers(GLTF_FILE *file, const char *path) {
+	const JSON_VALUE *buffers = json_member(&file->json, "buffers");
+	std::string directory = path;
+	size_t slash = directory.find_last_of('/');
+	directory = slash == std::string::npos ? "" : directory.substr(0, slash + 1);
+
+	file->buffers.resize(json_count(buffers));
+	for (int i = 0; i < json_count(buffers); i++) {
+		const JSON_VALUE *buffer = json_item(buffers, i);
+		const JSON_VALUE *uri = json_member(buffer, "uri");
+		std::vector<unsigned char> *data = &file->buffers[i];
+		if (!uri || uri->type != JSON_STRING) {
+			if (i != 0 || !file->bin) {
+				fprintf(stderr, "ERROR:MESH_IMPORT:GLTF_BUFFER_MISSING %d\n", i);
+				return false;
+			}
+			data->assign(file->bin, file->bin + file->bin_size);
+		} else if (!uri->string.compare(0, 5, "data:")) {
+			size_t comma = uri->string.find(";base64,");
+			if (comma == std::string::npos || !decode_base64(uri->string.c_str() + comma + 8,
+					uri->string.size() - comma - 8, data)) {
+				fprintf(stderr, "ERROR:MESH_IMPORT:GLTF_BAD_DATA_URI %d\n", i);
+				return false;
+			}
+		} else if (!read_whole_file(directory + uri->string, data)) {
+			fprintf(stderr, "ERROR:MESH_IMPORT:GLTF_BUFFER_READ_FAILED %s%s\n", directory.c_str(),
+					uri->string.c_str());
+			return false;
+		}
+		if (data->size() < (size_t)json_number(buffer, "byteLength", 0.0)) {
+			fprintf(stderr, "ERROR:MESH_IMPORT:GLTF_BUFFER_TOO_SHORT %d\n", i);
+			return false;
+		}
+	}
+	return true;
+}
+
+
+static int get_component_size(int component_type) {
+	switch (component_type) {
+		case 5120: case 5121: return 1;		// byte, unsigned byte
+		case 5122: case 5123: return 2;		// short, unsigned short
+		case 5125: case 5126: return 4;		// unsigned int, float
+		default: return 0;
+	}
+}
+
+
+static int get_type_components(const std::string &type) {
+	if (type == "SCALAR") return 1;
+	if (type == "VEC2") return 2;
+	if (type == "VEC3") return 3;
+	if (type == "VEC4") return 4;
+	return 0;
+}
+
+
+// checked against its buffer view; sparse accessors are not supported
+static bool resolve_accessor(const GLTF_FILE *file, int index, GLTF_ACCESSOR *accessor) {
+	const JSON_VALUE *json = json_item(json_member(&file->json, "accessors"), index);
+	const JSON_VALUE *type = json_member(json, "type");
+	if (!json || !type || type->type != JSON_STRING || json_member(json, "sparse")) {
+		return false;
+	}
+	accessor->count = (int)json_number(json, "count", 0.0);
+	accessor->components = get_type_components(type->string);
+	accessor->component_type = (int)json_number(json, "componentType", 0.0);
+	accessor->normalized = json_number(json, "normalized", 0.0) != 0.0;
+	int element_size = accessor->components * get_component_size(accessor->component_type);
+	if (accessor->count <= 0 || !element_size) {
+		return false;
+	}
+	accessor->stride = element_size;
+	accessor->data = NULL;
+	const JSON_VALUE *view_index = json_member(json, "bufferView");
+	if (!view_index) {
+		return true;
+	}
+
+	const JSON_VALUE *view = json_item(json_member(&file->json, "bufferViews"), (int)view_index->number);
+	int buffer = (int)json_number(view, "buffer", -1.0);
+	if (!view || buffer < 0 || buffer >= (int)file->buffers.size()) {
+		return false;
+	}
+	size_t view_offset = (size_t)json_number(view, "byteOffset", 0.0);
+	size_t view_length = (size_t)json_number(view, "byteLength", 0.0);
+	size_t offset = (size_t)json_number(json, "byteOffset", 0.0);
+	accessor->stride = (size_t)json_number(view, "byteStride", (double)element_size);
+	size_t last_byte = offset + accessor->stride * (accessor->count - 1) + element_size;
+	if (accessor->stride < (size_t)element_size || view_offset + view_length > file->buffers[buffer].size()
+			|| last_byte > view_length) {
+		return false;
+	}
+	accessor->data = file->buffers[buffer].data() + view_offset + offset;
+	return true;
+}
+
+
+// element i as floats, normalized integers mapped to 0..1 or -1..1
+static void read_accessor(const GLTF_ACCESSOR *accessor, int i, float *out) {
+	if (!accessor->data) {
+		for (int c = 0; c < accessor->components; c++) {
+			out[c] = 0.0f;
+		}
+		return;
+	}
+	const unsigned char *element = accessor->data + i * accessor->stride;
+	for (int c = 0; c < accessor->components; c++) {
+		float value = 0.0f;
+		switch (accessor->component_type) {
+			case 5126: memcpy(&value, element + c * 4, 4); break;
+			case 5121: value = element[c] / (accessor->normalized ? 255.0f : 1.0f); break;
+			case 5120: value = (signed char)element[c] / (accessor->normalized ? 127.0f : 1.0f); break;
+			case 5123: case 5122: {
+				uint16_t bits;
+				memcpy(&bits, element + c * 2, 2);
+				value = accessor->component_type == 5123 ? bits / (accessor->normalized ? 65535.0f : 1.0f)
+						: (int16_t)bits / (accessor->normalized ? 32767.0f : 1.0f);
+				break;
+			}
+			case 5125: {
+				uint32_t bits;
+				memcpy(&bits, element + c * 4, 4);
+				value = (float)bits;
+				break;
+			}
+		}
+		out[c] = accessor->normalized ? fmaxf(value, -1.0f) : value;
+	}
+}
+
+
+// add_gltf_mesh only lets through unsigned byte, short and int indices
+static uint32_t read_index(const GLTF_ACCESSOR *accessor, int i) {
+	if (!accessor->count) {
+		return i;
+	}
+	const unsigned char *element = accessor->data + i * accessor->stride;
+	switch (accessor->component_type) {
+		case 5121: return element[0];
+		case 5123: { uint16_t value; memcpy(&value, element, 2); return value; }
+		default: { uint32_t value; memcpy(&value, element, 4); return value; }
+	}
+}
+
+
+static bool is_index_type(int component_type) {
+	return component_type == 5121 || component_type == 5123 || component_type == 5125;
+}
+
+
+static glm::mat4 get_node_matrix(const JSON_VALUE *node) {
+	const JSON_VALUE *matrix = json_member(node, "matrix");
+	if (json_count(matrix) == 16) {
+		glm::mat4 result;
+		for (int i = 0; i < 16; i++) {
+			result[i / 4][i % 4] = (float)matrix->items[i].number;
+		}
+		return result;
+	}
+	glm::vec3 translation(0.0f), scale(1.0f);
+	glm::quat rotation(1.0f, 0.0f, 0.0f, 0.0f);
+	const JSON_VALUE *t = json_member(node, "translation");
+	const JSON_VALUE *r = json_member(node, "rotation");
+	const JSON_VALUE *s = json_member(node, "scale");
+	if (json_count(t) == 3) {
+		translation = glm::vec3(t->items[0].number, t->items[1].number, t->items[2].number);
+	}
+	if (json_count(r) == 4) {
+		rotation = glm::quat((float)r->items[3].number, (float)r->items[0].number, (float)r->items[1].number,
+				(float)r->items[2].number);
+	}
+	if (json_count(s) == 3) {
+		scale = glm::vec3(s->items[0].number, s->items[1].number, s->items[2].number);
+	}
+	return glm::translate(glm::mat4(1.0f), translation) * glm::mat4_cast(rotation) * glm::scale(glm::mat4(1.0f), scale);
+}
+
+
+static bool add_gltf_mesh(GLTF_FILE *file, int mesh_index, const glm::mat4 &transform) {
+	const JSON_VALUE *primitives = json_member(json_item(json_member(&file->json, "meshes"), mesh_index), "primitives");
+	for (int p = 0; p < json_count(primitives); p++) {
+		const JSON_VALUE *json = &primitives->items[p];
+		const JSON_VALUE *attributes = json_member(json, "attributes");
+		const JSON_VALUE *position = json_member(attributes, "POSITION");
+		if (json_number(json, "mode", GLTF_TRIANGLES) != GLTF_TRIANGLES || !position) {
+			file->skipped_primitives++;
+			continue;
+		}
+		GLTF_PRIMITIVE primitive = {};
+		primitive.transform = transform;
+		primitive.linear = glm::mat3(transform);
+		primitive.normal_matrix = glm::transpose(glm::inverse(primitive.linear));
+		primitive.mirror = glm::determinant(primitive.linear) < 0.0f ? -1.0f : 1.0f;
+		const struct { const char *name; GLTF_ACCESSOR *accessor; int components; } wanted[] = {
+			{ "POSITION", &primitive.positions, 3 }, { "NORMAL", &primitive.normals, 3 },
+			{ "TEXCOORD_0", &primitive.uvs, 2 }, { "TANGENT", &primitive.tangents, 4 }
+		};
+		for (const auto &attribute : wanted) {
+			const JSON_VALUE *index = json_member(attributes, attribute.name);
+			if (index && (!resolve_accessor(file, (int)index->number, attribute.accessor)
+					|| attribute.accessor->components != attribute.components)) {
+				fprintf(stderr, "ERROR:MESH_IMPORT:GLTF_BAD_ACCESSOR %s\n", attribute.name);
+				return false;
+			}
+		}
+		const JSON_VALUE *indices = json_member(json, "indices");
+		if (indices) {
+			GLTF_ACCESSOR *accessor = &primitive.indices;
+			if (!resolve_accessor(file, (int)indices->number, accessor) || !accessor->data
+					|| accessor->components != 1 || !is_index_type(accessor->component_type)) {
+				fprintf(stderr, "ERROR:MESH_IMPORT:GLTF_BAD_ACCESSOR indices\n");
+				return false;
+			}
+		}
+		primitive.index_count = indices ? primitive.indices.count : primitive.positions.count;
+		primitive.index_count -= primitive.index_count % 3;
+		file->primitives.push_back(primitive);
+	}
+	return true;
+}
+
+
+static bool add_gltf_node(GLTF_FILE *file, int node_index, const glm::mat4 &parent, int depth) {
+	const JSON_VALUE *node = json_item(json_member(&file->json, "nodes"), node_index);
+	if (!node || depth > GLTF_MAX_NODE_DEPTH) {
+		fprintf(stderr, "ERROR:MESH_IMPORT:GLTF_BAD_NODE %d\n", node_index);
+		return false;
+	}
+	glm::mat4 transform = parent * get_node_matrix(node);
+	const JSON_VALUE *mesh = json_member(node, "mesh");
+	if (mesh && !add_gltf_mesh(file, (int)mesh->number, transform)) {
+		return false;
+	}
+	const JSON_VALUE *children = json_member(node, "children");
+	for (int i = 0; i < json_count(children); i++) {
+		if (!add_gltf_node(file, (int)children->items[i].number, transform, depth + 1)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+// the default scene's node trees, or every root node when there is no scene,
+// or every mesh as it is when there are no nodes
+static bool collect_gltf_primitives(GLTF_FILE *file) {
+	const JSON_VALUE *scenes = json_member(&file->json, "scenes");
+	const JSON_VALUE *nodes = json_member(&file->json, "nodes");
+	glm::mat4 identity(1.0f);
+	if (json_count(scenes)) {
+		const JSON_VALUE *scene = json_item(scenes, (int)json_number(&file->json, "scene", 0.0));
+		const JSON_VALUE *roots = json_member(scene, "nodes");
+		for (int i = 0; i < json_count(roots); i++) {
+			if (!add_gltf_node(file, (int)roots->items[i].number, identity, 0)) {
+				return false;
+			}
+		}
+	} else if (json_count(nodes)) {
+		std::vector<bool> child(json_count(nodes), false);
+		for (int n = 0; n < json_count(nodes); n++) {
+			const JSON_VALUE *children = json_member(&nodes->items[n], "children");
+			for (int i = 0; i < json_count(children); i++) {
+				int index = (int)children->items[i].number;
+				if (index >= 0 && index < (int)child.size()) {
+					child[index] = true;
+				}
+			}
+		}
+		for (int n = 0; n < json_count(nodes); n++) {
+			if (!child[n] && !add_gltf_node(file, n, identity, 0)) {
+				return false;
+			}
+		}
+	} else {
+		for (int m = 0; m < json_count(json_member(&file->json, "meshes")); m++) {
+			if (!add_gltf_mesh(file, m, identity)) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+
+// the primitive whose range of the merged mesh holds item, a vertex or an
+// index; empty ranges share their start with the next, which wins
+static int find_primitive(const GLTF_DECODE *job, int item, bool by_index) {
+	int low = 0, high = job->primitive_count - 1;
+	while (low < high) {
+		int middle = (low + high + 1) / 2;
+		const GLTF_PRIMITIVE *primitive = &job->primitives[middle];
+		if ((by_index ? primitive->first_index : primitive->first_vertex) <= item) {
+			low = middle;
+		} else {
+			high = middle - 1;
+		}
+	}
+	return low;
+}
+
+
+// batches run over the merged mesh, so one large primitive spreads over the
+// workers like many small ones
+static void decode_vertices(void *data, int begin, int end) {
+	GLTF_DECODE *job = (GLTF_DECODE *)data;
+	int p = find_primitive(job, begin, false);
+	for (int index = begin; index < end; index++) {
+		while (index >= job->primitives[p].first_vertex + job->primitives[p].positions.count) {
+			p++;
+		}
+		const GLTF_PRIMITIVE *primitive = &job->primitives[p];
+		int v = index - primitive->first_vertex;
+		LIT_VERTEX *vertex = &job->mesh->vertices[index];
+		float values[4];
+		read_accessor(&primitive->positions, v, values);
+		vertex->position = glm::vec3(primitive->transform * glm::vec4(values[0], values[1], values[2], 1.0f));
+		vertex->uv = glm::vec2(0.0f);
+		if (primitive->uvs.count > v) {
+			read_accessor(&primitive->uvs, v, values);
+			vertex->uv = glm::vec2(values[0], 1.0f - values[1]);	// glTF's first row is the top
+		}
+		vertex->normal = glm::vec3(0.0f);
+		if (primitive->normals.count > v) {
+			read_accessor(&primitive->normals, v, values);
+			glm::vec3 normal = primitive->normal_matrix * glm::vec3(values[0], values[1], values[2]);
+			float length = glm::length(normal);
+			vertex->normal = length > 0.0f ? normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+		}
+		vertex->tangent = glm::vec4(0.0f);
+		if (primitive->tangents.count > v) {
+			read_accessor(&primitive->tangents, v, values);
+			glm::vec3 tangent = glm::normalize(primitive->linear * glm::vec3(values[0], values[1], values[2]));
+			vertex->tangent = glm::vec4(tangent, values[3] < 0.0f ? -primitive->mirror : primitive->mirror);
+		}
+	}
+}
+
+
+// over triangles; a mirroring transform flips the winding back
+static void decode_triangles(void *data, int begin, int end) {
+	GLTF_DECODE *job = (GLTF_DECODE *)data;
+	int p = find_primitive(job, begin * 3, true);
+	bool bad_index = false;
+	for (int triangle = begin; triangle < end; triangle++) {
+		int first = triangle * 3;
+		while (first >= job->primitives[p].first_index + job->primitives[p].index_count) {
+			p++;
+		}
+		const GLTF_PRIMITIVE *primitive = &job->primitives[p];
+		int i = first - primitive->first_index;
+		uint32_t a = read_index(&primitive->indices, i);
+		uint32_t b = read_index(&primitive->indices, i + 1);
+		uint32_t c = read_index(&primitive->indices, i + 2);
+		uint32_t count = primitive->positions.count;
+		if (a >= count || b >= count || c >= count) {
+			bad_index = true;
+			a = b = c = 0;
+		}
+		uint32_t *indices = &job->mesh->indices[first];
+		indices[0] = primitive->first_vertex + a;
+		indices[1] = primitive->first_vertex + (primitive->mirror < 0.0f ? c : b);
+		indices[2] = primitive->first_vertex + (primitive->mirror < 0.0f ? b : c);
+	}
+	if (bad_index) {
+		job->bad_index.store(true, std::memory_order_relaxed);
+	}
+}
+
+
+static bool read_glb(const unsigned char *data, size_t size, const char **json, size_t *json_size, GLTF_FILE *file) {
+	uint32_t header[3];
+	if (size < sizeof(header)) {
+		return false;
+	}
+	memcpy(header, data, sizeof(header));
+	if (header[0] != GLB_MAGIC || header[1] != 2 || header[2] > size) {
+		return false;
+	}
+	*json = NULL;
+	for (size_t offset = sizeof(header); offset + 8 <= header[2];) {
+		uint32_t chunk[2];
+		memcpy(chunk, data + offset, sizeof(chunk));
+		offset += sizeof(chunk);
+		if (chunk[0] > header[2] - offset) {
+			return false;
+		}
+		if (chunk[1] == GLB_CHUNK_JSON && !*json) {
+			*json = (const char *)data + offset;
+			*json_size = chunk[0];
+		} else if (chunk[1] == GLB_CHUNK_BIN && !file->bin) {
+			file->bin = data + offset;
+			file->bin_size = chunk[0];
+		}
+		offset += (chunk[0] + 3) & ~3u;
+	}
+	return *json != NULL;
+}
+
+
+bool import_gltf(const unsigned char *data, size_t size, const char *path, IMPORTED_MESH *mesh) {
+	GLTF_FILE file = {};
+	const char *json = (const char *)data;
+	size_t json_size = size;
+	uint32_t magic = 0;
+	memcpy(&magic, data, size < 4 ? size : 4);
+	if (magic == GLB_MAGIC && !read_glb(data, size, &json, &json_size, &file)) {
+		fprintf(stderr, "ERROR:MESH_IMPORT:GLB_BAD_CONTAINER\n");
+		return false;
+	}
+	JSON_READER reader = { json, json + json_size };
+	if (!read_json_value(&reader, &file.json, 0) || file.json.type != JSON_OBJECT) {
+		fprintf(stderr, "ERROR:MESH_IMPORT:GLTF_BAD_JSON at byte %ld\n", (long)(reader.p - json));
+		return false;
+	}
+	if (!load_gltf_buffers(&file, path) || !collect_gltf_primitives(&file)) {
+		return false;
+	}
+	if (file.skipped_primitives) {
+		fprintf(stderr, "ERROR:MESH_IMPORT:GLTF_PRIMITIVES_SKIPPED %d not triangle lists\n",
+				file.skipped_primitives);
+	}
+
+	// every primitive's output range is known up front, so they decode in parallel
+	long long vertex_count = 0, index_count = 0;
+	mesh->has_uvs = mesh->has_normals = mesh->has_tangents = true;
+	for (GLTF_PRIMITIVE &primitive : file.primitives) {
+		primitive.first_vertex = (int)vertex_count;
+		primitive.first_index = (int)index_count;
+		vertex_count += primitive.positions.count;
+		index_count += primitive.index_count;
+		mesh->has_uvs = mesh->has_uvs && primitive.uvs.count >= primitive.positions.count;
+		mesh->has_normals = mesh->has_normals && primitive.normals.count >= primitive.positions.count;
+		mesh->has_tangents = mesh->has_tangents && primitive.tangents.count >= primitive.positions.count;
+		if (vertex_count > INT_MAX || index_count > INT_MAX) {
+			fprintf(stderr, "ERROR:MESH_IMPORT:TOO_LARGE\n");
+			return false;
+		}
+	}
+	mesh->has_tangents = mesh->has_tangents && mesh->has_normals;
+	if (!index_count) {
+		fprintf(stderr, "ERROR:MESH_IMPORT:NO_TRIANGLES\n");
+		return false;
+	}
+	mesh->vertices.resize(vertex_count);
+	mesh->indices.resize(index_count);
+	GLTF_DECODE job;
+	job.primitives = file.primitives.data();
+	job.primitive_count = (int)file.primitives.size();
+	job.mesh = mesh;
+	job.bad_index.store(false);
+	parallel_for((int)vertex_count, IMPORT_BATCH, decode_vertices, &job);
+	parallel_for((int)(index_count / 3), IMPORT_BATCH, decode_triangles, &job);
+	if (job.bad_index.load()) {
+		fprintf(stderr, "ERROR:MESH_IMPORT:GLTF_INDEX_OUT_OF_RANGE\n");
+		return false;
+	}
+	return true;
+}
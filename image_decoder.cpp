@@ -0,0 +1,536 @@
+#include "image_decoder.h"
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "job_system.h"
+#include "stb_image.h"
+
+#ifdef HAVE_LIBJPEG_TURBO
+#include <jpeglib.h>
+#endif
+
+static const IMAGE_DECODER *registered[MAX_IMAGE_DECODERS];
+static int registered_count = 0;
+
+
+static bool is_jpeg(const unsigned char *data, size_t size) {
+	return size >= 4 && data[0] == 0xFF && data[1] == 0xD8 && data[2] == 0xFF;
+}
+
+
+// stb_image allocates with plain malloc, so its output frees like the others
+static bool stb_can_decode(const unsigned char *data, size_t size) {
+	return size > 0;
+}
+
+
+static bool stb_info(const unsigned char *data, size_t size, int *width, int *height, int *channels) {
+	return stbi_info_from_memory(data, (int)size, width, height, channels) != 0;
+}
+
+
+// stb_image's JPEG colour conversion writes desired_channels directly; other
+// formats convert in one extra pass inside stb_image
+static unsigned char *stb_decode(const unsigned char *data, size_t size, int *width, int *height, int *channels,
+		int desired_channels) {
+	// the flip flag is thread local in stb_image, so set it on whichever thread decodes
+	stbi_set_flip_vertically_on_load_thread(1);
+	unsigned char *pixels = stbi_load_from_memory(data, (int)size, width, height, channels, desired_channels);
+	if (desired_channels) {
+		*channels = desired_channels;
+	}
+	return pixels;
+}
+
+
+static const IMAGE_DECODER stb_decoder = { "stb_image", stb_can_decode, stb_info, stb_decode };
+
+const IMAGE_DECODER *get_stb_decoder() {
+	return &stb_decoder;
+}
+
+
+#ifdef HAVE_LIBJPEG_TURBO
+typedef struct {
+	struct jpeg_error_mgr base;
+	jmp_buf jump;
+} JPEG_ERROR;
+
+
+static void jpeg_error_exit(j_common_ptr info) {
+	longjmp(((JPEG_ERROR *)info->err)->jump, 1);
+}
+
+
+// warnings about recoverable corruption would otherwise go to stderr per image
+static void jpeg_silence(j_common_ptr info) {
+}
+
+
+static bool turbo_info(const unsigned char *data, size_t size, int *width, int *height, int *channels) {
+	struct jpeg_decompress_struct info;
+	JPEG_ERROR error;
+	info.err = jpeg_std_error(&error.base);
+	error.base.error_exit = jpeg_error_exit;
+	error.base.output_message = jpeg_silence;
+	if (setjmp(error.jump)) {
+		jpeg_destroy_decompress(&info);
+		return false;
+	}
+
+	jpeg_create_decompress(&info);
+	jpeg_mem_src(&info, data, (unsigned long)size);
+	jpeg_read_header(&info, TRUE);
+	*width = (int)info.image_width;
+	*height = (int)info.image_height;
+	*channels = info.num_components == 1 ? 1 : 3;
+	jpeg_destroy_decompress(&info);
+	return true;
+}
+
+
+// the output colour space the decoder's own conversion writes, or JCS_UNKNOWN
+static J_COLOR_SPACE turbo_color_space(int components, int desired_channels) {
+	switch (desired_channels) {
+		case 0: return components == 1 ? JCS_GRAYSCALE : JCS_RGB;
+		case 1: return JCS_GRAYSCALE;
+		case 3: return JCS_RGB;
+#ifdef JCS_ALPHA_EXTENSIONS
+		case 4: return JCS_EXT_RGBA;
+#endif
+		default: return JCS_UNKNOWN;
+	}
+}
+
+
+// no C++ objects live across the setjmp, so the longjmp out of libjpeg is safe
+static unsigned char *turbo_decode(const unsigned char *data, size_t size, int *width, int *height, int *channels,
+		int desired_channels) {
+	struct jpeg_decompress_struct info;
+	JPEG_ERROR error;
+	unsigned char *volatile pixels = NULL;
+
+	info.err = jpeg_std_error(&error.base);
+	error.base.error_exit = jpeg_error_exit;
+	error.base.output_message = jpeg_silence;
+	if (setjmp(error.jump)) {
+		jpeg_destroy_decompress(&info);
+		free(pixels);
+		return NULL;
+	}
+
+	jpeg_create_decompress(&info);
+	jpeg_mem_src(&info, data, (unsigned long)size);
+	jpeg_read_header(&info, TRUE);
+	// CMYK is rare enough to leave to stb_image
+	J_COLOR_SPACE color_space = turbo_color_space(info.num_components, desired_channels);
+	if (info.jpeg_color_space == JCS_CMYK || info.jpeg_color_space == JCS_YCCK || color_space == JCS_UNKNOWN) {
+		jpeg_destroy_decompress(&info);
+		return NULL;
+	}
+	info.out_color_space = color_space;
+	jpeg_start_decompress(&info);
+
+	size_t stride = (size_t)info.output_width * info.output_components;
+	pixels = alloc_image_pixels(stride * info.output_height);
+	if (!pixels) {
+		jpeg_destroy_decompress(&info);
+		return NULL;
+	}
+	// scanlines arrive top first, GL wants the bottom row first
+	while (info.output_scanline < info.output_height) {
+		JSAMPROW row = pixels + (info.output_height - 1 - info.output_scanline) * stride;
+		jpeg_read_scanlines(&info, &row, 1);
+	}
+
+	*width = (int)info.output_width;
+	*height = (int)info.output_height;
+	*channels = info.output_components;
+	jpeg_finish_decompress(&info);
+	jpeg_destroy_decompress(&info);
+	return pixels;
+}
+
+
+static const IMAGE_DECODER turbo_decoder = { "libjpeg-turbo", is_jpeg, turbo_info, turbo_decode };
+#endif
+
+const IMAGE_DECODER *get_jpeg_turbo_decoder() {
+#ifdef HAVE_LIBJPEG_TURBO
+	return &turbo_decoder;
+#else
+	return NULL;
+#endif
+}
+
+
+bool register_image_decoder(const IMAGE_DECODER *decoder) {
+	if (registered_count == MAX_IMAGE_DECODERS) {
+		fprintf(stderr, "ERROR:IMAGE_DECODER:TOO_MANY_DECODERS\n");
+		return false;
+	}
+	registered[registered_count++] = decoder;
+	return true;
+}
+
+
+// where the pieces of a single-scan sequential JPEG sit; only those can be cut
+// at restart markers and handed to an ordinary decoder piece by piece
+typedef struct {
+	size_t height_field;	// SOF image height, patched per chunk
+	size_t scan;			// first entropy-coded byte
+	size_t end;				// the EOI marker
+	int width;
+	int height;
+	int mcu_width;
+	int mcu_height;
+	int restart_interval;
+	bool vertical_subsampling;
+	std::vector<size_t> restarts;	// offset of every RSTn marker in the scan
+} JPEG_LAYOUT;
+
+
+static int read_u16(const unsigned char *p) {
+	return (p[0] << 8) | p[1];
+}
+
+
+static bool find_jpeg_layout(const unsigned char *data, size_t size, JPEG_LAYOUT *layout) {
+	if (!is_jpeg(data, size)) {
+		return false;
+	}
+	layout->height_field = 0;
+	layout->restart_interval = 0;
+	int components = 0;
+
+	size_t pos = 2;
+	while (pos + 4 <= size) {
+		if (data[pos] != 0xFF) {
+			return false;
+		}
+		int marker = data[pos + 1];
+		if (marker == 0xFF) {
+			pos++;
+			continue;
+		}
+		size_t length = read_u16(data + pos + 2);
+		if (length < 2 || pos + 2 + length > size) {
+			return false;
+		}
+		const unsigned char *segment = data + pos + 4;
+
+		if (marker == 0xC0 || marker == 0xC1) {
+			if (length < 8) {
+				return false;
+			}
+			layout->height_field = pos + 5;
+			layout->height = read_u16(segment + 1);
+			layout->width = read_u16(segment + 3);
+			components = segment[5];
+			if (layout->height == 0 || components == 0 || length < 8 + 3 * (size_t)components) {
+				return false;
+			}
+			int h_max = 1, v_max = 1;
+			for (int c = 0; c < components; c++) {
+				int sampling = segment[6 + 3 * c + 1];
+				if ((sampling >> 4) > h_max) h_max = sampling >> 4;
+				if ((sampling & 15) > v_max) v_max = sampling & 15;
+			}
+			// a single-component scan is not interleaved: its MCU is one block
+			layout->mcu_width = components == 1 ? 8 : 8 * h_max;
+			layout->mcu_height = components == 1 ? 8 : 8 * v_max;
+			layout->vertical_subsampling = components > 1 && v_max > 1;
+		} else if (marker >= 0xC2 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+			// progressive, lossless or arithmetic coded
+			return false;
+		} else if (marker == 0xDD) {
+			layout->restart_interval = read_u16(segment);
+		} else if (marker == 0xDA) {
+			if (!layout->height_field || !layout->restart_interval || segment[0] != components) {
+				return false;
+			}
+			layout->scan = pos + 2 + length;
+			break;
+		}
+		pos += 2 + length;
+	}
+	if (!layout->height_field || !layout->restart_interval || pos + 4 > size) {
+		return false;
+	}
+
+	layout->restarts.clear();
+	size_t i = layout->scan;
+	while (i + 1 < size) {
+		if (data[i] != 0xFF) {
+			i++;
+			continue;
+		}
+		int next = data[i + 1];
+		if (next == 0x00) {
+			i += 2;
+		} else if (next == 0xFF) {
+			i++;
+		} else if (next >= 0xD0 && next <= 0xD7) {
+			layout->restarts.push_back(i);
+			i += 2;
+		} else {
+			// anything but EOI means a second scan
+			layout->end = i;
+			return next == 0xD9;
+		}
+	}
+	return false;
+}
+
+
+typedef struct {
+	int first_row;		// in MCU rows
+	int first_segment;	// restart interval the chunk starts with
+} JPEG_CUT;
+
+
+// every restart interval that begins on an MCU row, starting with the image's top
+static std::vector<JPEG_CUT> find_row_cuts(const JPEG_LAYOUT *layout) {
+	int mcus_per_row = (layout->width + layout->mcu_width - 1) / layout->mcu_width;
+	int mcu_rows = (layout->height + layout->mcu_height - 1) / layout->mcu_height;
+	long total = (long)mcus_per_row * mcu_rows;
+	long segments = (total + layout->restart_interval - 1) / layout->restart_interval;
+
+	std::vector<JPEG_CUT> cuts;
+	if (segments != (long)layout->restarts.size() + 1) {
+		return cuts;
+	}
+	cuts.push_back({ 0, 0 });
+	for (long segment = 1; segment < segments; segment++) {
+		long mcu = segment * layout->restart_interval;
+		if (mcu % mcus_per_row == 0) {
+			cuts.push_back({ (int)(mcu / mcus_per_row), (int)segment });
+		}
+	}
+	return cuts;
+}
+
+
+// a standalone JPEG holding the rows from cut up to next (NULL for the bottom
+// of the image): the original headers with the height patched, the scan with
+// its restart markers renumbered from RST0, then EOI
+static std::vector<unsigned char> build_chunk(const unsigned char *data, const JPEG_LAYOUT *layout,
+		const JPEG_CUT *cut, const JPEG_CUT *next) {
+	int segments = (int)layout->restarts.size() + 1;
+	int end_segment = next ? next->first_segment : segments;
+	size_t begin = cut->first_segment ? layout->restarts[cut->first_segment - 1] + 2 : layout->scan;
+	size_t end = end_segment < segments ? layout->restarts[end_segment - 1] : layout->end;
+
+	int first_pixel = cut->first_row * layout->mcu_height;
+	int end_pixel = next ? next->first_row * layout->mcu_height : layout->height;
+	int rows = end_pixel - first_pixel;
+
+	std::vector<unsigned char> chunk;
+	chunk.reserve(layout->scan + (end - begin) + 2);
+	chunk.insert(chunk.end(), data, data + layout->scan);
+	chunk[layout->height_field] = (unsigned char)(rows >> 8);
+	chunk[layout->height_field + 1] = (unsigned char)rows;
+	chunk.insert(chunk.end(), data + begin, data + end);
+	for (int segment = cut->first_segment; segment < end_segment - 1; segment++) {
+		size_t at = layout->scan + layout->restarts[segment] - begin;
+		chunk[at + 1] = (unsigned char)(0xD0 + ((segment - cut->first_segment) & 7));
+	}
+	chunk.push_back(0xFF);
+	chunk.push_back(0xD9);
+	return chunk;
+}
+
+
+typedef struct {
+	int cut;			// index into the row cuts of the first row kept
+	int next_cut;		// first row of the next chunk, or the cut count for the bottom
+	unsigned char *pixels;
+	int width;
+	int height;
+	int channels;
+} DECODED_CHUNK;
+
+typedef struct {
+	const IMAGE_DECODER *decoder;
+	const unsigned char *data;
+	const JPEG_LAYOUT *layout;
+	const JPEG_CUT *cuts;
+	int cut_count;
+	int context;		// extra row cuts decoded either side of a chunk
+	int desired_channels;
+	DECODED_CHUNK *chunks;
+} CHUNK_DECODE;
+
+
+// vertically subsampled chroma is upsampled from the neighbouring chroma
+// rows, so each chunk decodes one cut further either side and drops the
+// extra rows to match a whole-image decode exactly
+static void decode_chunks(void *data, int begin, int end) {
+	CHUNK_DECODE *job = (CHUNK_DECODE *)data;
+	const JPEG_CUT *cuts = job->cuts;
+	int mcu_height = job->layout->mcu_height;
+	for (int c = begin; c < end; c++) {
+		DECODED_CHUNK *out = &job->chunks[c];
+		int first = out->cut > job->context ? out->cut - job->context : 0;
+		int last = out->next_cut + job->context < job->cut_count ? out->next_cut + job->context : job->cut_count;
+		std::vector<unsigned char> chunk = build_chunk(job->data, job->layout, &cuts[first],
+				last < job->cut_count ? &cuts[last] : NULL);
+		out->pixels = job->decoder->decode(chunk.data(), chunk.size(), &out->width, &out->height, &out->channels,
+				job->desired_channels);
+		// rows above the kept ones count toward the top of the decoded chunk
+		int skip_top = (cuts[out->cut].first_row - cuts[first].first_row) * mcu_height;
+		out->height -= skip_top;
+		// a chunk that decoded short, say from a corrupt scan, fails the whole image
+		int bottom = out->next_cut < job->cut_count ? cuts[out->next_cut].first_row * mcu_height
+				: job->layout->height;
+		if (out->pixels && out->height < bottom - cuts[out->cut].first_row * mcu_height) {
+			free(out->pixels);
+			out->pixels = NULL;
+		}
+	}
+}
+
+
+// false when the image cannot be cut, so the caller falls back to one decode
+static bool decode_parallel(const IMAGE_DECODER *decoder, const unsigned char *data, const JPEG_LAYOUT &layout,
+		DECODED_IMAGE *image, int threads, int desired_channels) {
+	std::vector<JPEG_CUT> cuts = find_row_cuts(&layout);
+	int cut_count = (int)cuts.size();
+	int mcu_rows = (layout.height + layout.mcu_height - 1) / layout.mcu_height;
+	int wanted = threads * PARALLEL_DECODE_CHUNKS;
+
+	// about equal pieces, each starting on a row cut
+	std::vector<DECODED_CHUNK> chunks;
+	for (int c = 0; c < cut_count; c++) {
+		if ((long)cuts[c].first_row * wanted >= (long)mcu_rows * (long)chunks.size()) {
+			if (!chunks.empty()) {
+				chunks.back().next_cut = c;
+			}
+			chunks.push_back(DECODED_CHUNK{ c, cut_count, NULL, 0, 0, 0 });
+		}
+	}
+	int count = (int)chunks.size();
+	if (count < 2) {
+		return false;
+	}
+
+	// one chunk per job; a decode is long enough that finer batches gain nothing
+	CHUNK_DECODE job = { decoder, data, &layout, cuts.data(), cut_count, layout.vertical_subsampling ? 1 : 0,
+			desired_channels, chunks.data() };
+	parallel_for(count, 1, decode_chunks, &job);
+
+	bool complete = true;
+	for (const DECODED_CHUNK &chunk : chunks) {
+		complete = complete && chunk.pixels && chunk.width == layout.width && chunk.channels == chunks[0].channels;
+	}
+	unsigned char *pixels = NULL;
+	size_t stride = (size_t)layout.width * chunks[0].channels;
+	if (complete) {
+		pixels = alloc_image_pixels(stride * layout.height);
+	}
+	if (pixels) {
+		// chunks are bottom row first too: skip the extra rows below the kept
+		// ones, then the kept block lands counted up from the image's bottom
+		for (const DECODED_CHUNK &chunk : chunks) {
+			int top = cuts[chunk.cut].first_row * layout.mcu_height;
+			int bottom = chunk.next_cut < cut_count ? cuts[chunk.next_cut].first_row * layout.mcu_height
+					: layout.height;
+			int skip_bottom = chunk.height - (bottom - top);
+			memcpy(pixels + (size_t)(layout.height - bottom) * stride, chunk.pixels + (size_t)skip_bottom * stride,
+					stride * (bottom - top));
+		}
+		image->pixels = pixels;
+		image->width = layout.width;
+		image->height = layout.height;
+		image->channels = chunks[0].channels;
+		image->decoder = decoder;
+		image->chunks = count;
+	}
+	for (DECODED_CHUNK &chunk : chunks) {
+		free(chunk.pixels);
+	}
+	return pixels != NULL;
+}
+
+
+static bool decode_with(const IMAGE_DECODER *decoder, const unsigned char *data, size_t size, DECODED_IMAGE *image,
+		int threads, long min_pixels, int desired_channels) {
+	image->pixels = NULL;
+	if (!decoder->can_decode(data, size)) {
+		return false;
+	}
+
+	if (threads > 1) {
+		JPEG_LAYOUT layout;
+		if (find_jpeg_layout(data, size, &layout) && (long)layout.width * layout.height >= min_pixels
+				&& decode_parallel(decoder, data, layout, image, threads, desired_channels)) {
+			return true;
+		}
+	}
+
+	image->pixels = decoder->decode(data, size, &image->width, &image->height, &image->channels, desired_channels);
+	image->decoder = decoder;
+	image->chunks = 1;
+	return image->pixels != NULL;
+}
+
+
+bool decode_image_with(const IMAGE_DECODER *decoder, const unsigned char *data, size_t size, DECODED_IMAGE *image,
+		int threads, int desired_channels) {
+	return decode_with(decoder, data, size, image, threads, 0, desired_channels);
+}
+
+
+// registered decoders newest first, then the built-ins
+static int get_decoders(const IMAGE_DECODER **decoders) {
+	int count = 0;
+	for (int i = registered_count - 1; i >= 0; i--) {
+		decoders[count++] = registered[i];
+	}
+	if (get_jpeg_turbo_decoder()) {
+		decoders[count++] = get_jpeg_turbo_decoder();
+	}
+	decoders[count++] = &stb_decoder;
+	return count;
+}
+
+
+bool decode_image(const unsigned char *data, size_t size, DECODED_IMAGE *image, int desired_channels) {
+	const IMAGE_DECODER *decoders[MAX_IMAGE_DECODERS + 2];
+	int count = get_decoders(decoders);
+	// split only when there are workers to take the pieces
+	int threads = get_worker_count();
+	for (int i = 0; i < count; i++) {
+		if (decode_with(decoders[i], data, size, image, threads, PARALLEL_DECODE_PIXELS, desired_channels)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+
+bool get_image_info(const unsigned char *data, size_t size, int *width, int *height, int *channels) {
+	const IMAGE_DECODER *decoders[MAX_IMAGE_DECODERS + 2];
+	int count = get_decoders(decoders);
+	for (int i = 0; i < count; i++) {
+		if (decoders[i]->can_decode(data, size) && decoders[i]->info(data, size, width, height, channels)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+
+unsigned char *alloc_image_pixels(size_t size) {
+	// aligned_alloc wants a multiple of the alignment
+	return (unsigned char *)aligned_alloc(IMAGE_ALIGNMENT, (size + IMAGE_ALIGNMENT - 1) / IMAGE_ALIGNMENT * IMAGE_ALIGNMENT);
+}
+
+
+void free_decoded_image(DECODED_IMAGE *image) {
+	free(image->pixels);
+	image->pixels = NULL;
+}
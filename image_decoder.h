@@ -0,0 +1,62 @@
+#ifndef IMAGE_DECODER_H
+#define IMAGE_DECODER_H
+
+#include <stddef.h>
+
+// default image decoder values
+const int MAX_IMAGE_DECODERS		= 8;
+const long PARALLEL_DECODE_PIXELS	= 4 * 1024 * 1024;	// restart-parallel JPEG decode above this
+const int PARALLEL_DECODE_CHUNKS	= 4;				// chunks per worker, for balance
+const size_t IMAGE_ALIGNMENT		= 64;				// decoded buffers start on a cache line
+
+// a decode backend. Pixels come back tightly packed, bottom row first (the
+// order glTexImage2D wants), allocated with malloc or alloc_image_pixels so
+// any decoder's output is released with free. decode writes desired_channels
+// per texel straight from the decoder's colour conversion (0 keeps the file's
+// own count) and reports the channels actually in the buffer; a backend that
+// cannot produce the layout returns NULL and the next one is tried
+typedef struct {
+	const char *name;
+	bool (*can_decode)(const unsigned char *data, size_t size);
+	bool (*info)(const unsigned char *data, size_t size, int *width, int *height, int *channels);
+	unsigned char *(*decode)(const unsigned char *data, size_t size, int *width, int *height, int *channels,
+			int desired_channels);
+} IMAGE_DECODER;
+
+typedef struct {
+	unsigned char *pixels;
+	int width;
+	int height;
+	int channels;					// in the buffer, not necessarily in the file
+	const IMAGE_DECODER *decoder;	// the backend that produced the pixels
+	int chunks;						// restart-interval pieces decoded in parallel, 1 if not split
+} DECODED_IMAGE;
+
+
+// the built-in backends; get_jpeg_turbo_decoder is NULL unless built with JPEG_TURBO=1
+const IMAGE_DECODER *get_stb_decoder();
+const IMAGE_DECODER *get_jpeg_turbo_decoder();
+
+// call before any decode; registered decoders are tried ahead of the built-ins,
+// newest first
+bool register_image_decoder(const IMAGE_DECODER *decoder);
+
+// any thread: tries each backend that claims the data until one succeeds.
+// Large restart-marked JPEGs are split and the pieces decoded as jobs on the
+// job system's workers; without a job system they decode in one piece
+bool decode_image(const unsigned char *data, size_t size, DECODED_IMAGE *image, int desired_channels = 0);
+
+// one backend only; threads > 1 allows the restart-parallel path whatever the
+// size and sizes the split, the pieces still run on the job system
+bool decode_image_with(const IMAGE_DECODER *decoder, const unsigned char *data, size_t size, DECODED_IMAGE *image,
+		int threads = 1, int desired_channels = 0);
+
+// dimensions and channel count from the headers, without decoding
+bool get_image_info(const unsigned char *data, size_t size, int *width, int *height, int *channels);
+
+// IMAGE_ALIGNMENT-aligned, released with free like every decoder's output
+unsigned char *alloc_image_pixels(size_t size);
+
+void free_decoded_image(DECODED_IMAGE *image);
+
+#endif
@@ -0,0 +1,178 @@
+#include "input.h"
+#include <GLFW/glfw3.h>
+
+
+void init_input_queue(INPUT_QUEUE *queue) {
+	queue->head.store(0, std::memory_order_relaxed);
+	queue->tail.store(0, std::memory_order_relaxed);
+	queue->dropped.store(0, std::memory_order_relaxed);
+	queue->held_keys.store(0, std::memory_order_relaxed);
+	queue->pressed_keys.store(0, std::memory_order_relaxed);
+}
+
+
+void init_input_state(INPUT_STATE *state) {
+	state->keys			= 0;
+	state->have_cursor	= false;
+	state->cursor_x		= 0.0;
+	state->cursor_y		= 0.0;
+}
+
+
+unsigned int get_input_key_bit(int key) {
+	switch (key) {
+		case GLFW_KEY_W: return INPUT_FORWARD;
+		case GLFW_KEY_S: return INPUT_BACKWARD;
+		case GLFW_KEY_A: return INPUT_LEFT;
+		case GLFW_KEY_D: return INPUT_RIGHT;
+		case GLFW_KEY_ESCAPE: return INPUT_QUIT;
+		default: return 0;
+	}
+}
+
+
+static bool push_event(INPUT_QUEUE *queue, const INPUT_EVENT *event) {
+	unsigned int head = queue->head.load(std::memory_order_relaxed);
+	unsigned int tail = queue->tail.load(std::memory_order_acquire);
+	if (head - tail >= (unsigned int)INPUT_QUEUE_SIZE) {
+		queue->dropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+	queue->events[head & (INPUT_QUEUE_SIZE - 1)] = *event;
+	queue->head.store(head + 1, std::memory_order_release);
+	return true;
+}
+
+
+// never dropped, so always true
+bool push_key_event(INPUT_QUEUE *queue, int key, bool pressed) {
+	unsigned int bit = get_input_key_bit(key);
+	if (!bit) {
+		return true;
+	}
+	if (pressed) {
+		queue->held_keys.fetch_or(bit, std::memory_order_relaxed);
+		queue->pressed_keys.fetch_or(bit, std::memory_order_relaxed);
+	} else {
+		queue->held_keys.fetch_and(~bit, std::memory_order_relaxed);
+	}
+	return true;
+}
+
+
+bool push_cursor_event(INPUT_QUEUE *queue, double x, double y) {
+	INPUT_EVENT event = { INPUT_EVENT_CURSOR, x, y };
+	return push_event(queue, &event);
+}
+
+
+bool push_scroll_event(INPUT_QUEUE *queue, double yoffset) {
+	INPUT_EVENT event = { INPUT_EVENT_SCROLL, 0.0, yoffset };
+	return push_event(queue, &event);
+}
+
+
+// cursor deltas telescope, so only the last position of the frame matters
+INPUT_FRAME drain_input_queue(INPUT_QUEUE *queue, INPUT_STATE *state) {
+	INPUT_FRAME frame = {};
+	unsigned int tail = queue->tail.load(std::memory_order_relaxed);
+	unsigned int head = queue->head.load(std::memory_order_acquire);
+
+	bool moved = false;
+	double cursor_x = 0.0, cursor_y = 0.0;
+	for (; tail != head; tail++) {
+		const INPUT_EVENT *event = &queue->events[tail & (INPUT_QUEUE_SIZE - 1)];
+		switch (event->type) {
+			case INPUT_EVENT_CURSOR:
+				if (!state->have_cursor) {
+					// the first position only sets the origin
+					state->cursor_x = event->x;
+					state->cursor_y = event->y;
+					state->have_cursor = true;
+				}
+				cursor_x = event->x;
+				cursor_y = event->y;
+				moved = true;
+				break;
+			case INPUT_EVENT_SCROLL:
+				frame.scroll += static_cast<float>(event->y);
+				break;
+		}
+	}
+	queue->tail.store(tail, std::memory_order_release);
+
+	if (moved) {
+		frame.mouse_dx = static_cast<float>(cursor_x - state->cursor_x);
+		frame.mouse_dy = static_cast<float>(state->cursor_y - cursor_y);
+		state->cursor_x = cursor_x;
+		state->cursor_y = cursor_y;
+	}
+	// a press and release between two drains still moves the frame it lands in
+	state->keys = queue->held_keys.load(std::memory_order_relaxed);
+	frame.keys = state->keys | queue->pressed_keys.exchange(0, std::memory_order_relaxed);
+	return frame;
+}
+
+
+bool start_input_recording(INPUT_RECORDING *recording, const char *path) {
+	recording->frames.clear();
+	recording->next = 0;
+	recording->file = fopen(path, "wb");
+	if (!recording->file) {
+		fprintf(stderr, "ERROR:INPUT:RECORDING_OPEN_FAILED %s\n", path);
+		return false;
+	}
+	unsigned int header[3] = { INPUT_MAGIC, INPUT_VERSION, (unsigned int)sizeof(INPUT_FRAME) };
+	fwrite(header, sizeof(header), 1, recording->file);
+	return true;
+}
+
+
+void record_input_frame(INPUT_RECORDING *recording, const INPUT_FRAME *frame) {
+	if (recording->file) {
+		fwrite(frame, sizeof(INPUT_FRAME), 1, recording->file);
+	}
+}
+
+
+void stop_input_recording(INPUT_RECORDING *recording) {
+	if (recording->file) {
+		fclose(recording->file);
+		recording->file = NULL;
+	}
+}
+
+
+bool load_input_replay(INPUT_RECORDING *recording, const char *path) {
+	recording->file = NULL;
+	recording->frames.clear();
+	recording->next = 0;
+
+	FILE *file = fopen(path, "rb");
+	if (!file) {
+		fprintf(stderr, "ERROR:INPUT:REPLAY_OPEN_FAILED %s\n", path);
+		return false;
+	}
+	unsigned int header[3];
+	if (fread(header, sizeof(header), 1, file) != 1 || header[0] != INPUT_MAGIC || header[1] != INPUT_VERSION
+			|| header[2] != sizeof(INPUT_FRAME)) {
+		fprintf(stderr, "ERROR:INPUT:REPLAY_BAD_HEADER %s\n", path);
+		fclose(file);
+		return false;
+	}
+	INPUT_FRAME frame;
+	while (fread(&frame, sizeof(INPUT_FRAME), 1, file) == 1) {
+		recording->frames.push_back(frame);
+	}
+	fclose(file);
+	return true;
+}
+
+
+bool next_replay_frame(INPUT_RECORDING *recording, INPUT_FRAME *frame) {
+	if (recording->next >= recording->frames.size()) {
+		return false;
+	}
+	*frame = recording->frames[recording->next++];
+	return true;
+}
@@ -0,0 +1,97 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <stdio.h>
+#include <atomic>
+#include <vector>
+
+// default input values
+const int INPUT_QUEUE_SIZE		= 1024;	// events between drains, power of two
+const unsigned int INPUT_MAGIC	= 0x52504e49;	// "INPR"
+const unsigned int INPUT_VERSION	= 1;
+
+// held keys as one bitmask, so any combination applies at once
+enum INPUT_KEY_BITS {
+	INPUT_FORWARD	= 1 << 0,
+	INPUT_BACKWARD	= 1 << 1,
+	INPUT_LEFT		= 1 << 2,
+	INPUT_RIGHT		= 1 << 3,
+	INPUT_QUIT		= 1 << 4
+};
+
+enum INPUT_EVENT_TYPE {
+	INPUT_EVENT_CURSOR,
+	INPUT_EVENT_SCROLL
+};
+
+typedef struct {
+	INPUT_EVENT_TYPE type;
+	double x;				// cursor position or scroll offset
+	double y;
+} INPUT_EVENT;
+
+// Raw window events, single producer (the window callbacks) and single
+// consumer (the frame loop), lock-free. A full queue drops the event and
+// counts it; cursor events carry absolute positions, so a dropped one costs
+// nothing once a later one arrives. Keys never go through the queue: a
+// dropped release would leave the key held, so they are applied to bitmasks
+// straight away
+typedef struct {
+	INPUT_EVENT events[INPUT_QUEUE_SIZE];
+	std::atomic<unsigned int> head;		// next slot to write
+	std::atomic<unsigned int> tail;		// next slot to read
+	std::atomic<unsigned int> dropped;
+	std::atomic<unsigned int> held_keys;	// INPUT_KEY_BITS down right now
+	std::atomic<unsigned int> pressed_keys;	// pressed since the last drain
+} INPUT_QUEUE;
+
+// a frame's input after coalescing; also the unit of recording
+typedef struct {
+	double frame_time;	// seconds, what the frame advanced the sim clock by
+	unsigned int keys;	// INPUT_KEY_BITS held
+	float mouse_dx;
+	float mouse_dy;		// up is positive
+	float scroll;
+} INPUT_FRAME;
+
+// what persists between drains
+typedef struct {
+	unsigned int keys;
+	bool have_cursor;
+	double cursor_x;
+	double cursor_y;
+} INPUT_STATE;
+
+// recording appends frames to a file; replay serves them back in order
+typedef struct {
+	FILE *file;
+	std::vector<INPUT_FRAME> frames;
+	size_t next;
+} INPUT_RECORDING;
+
+
+void init_input_queue(INPUT_QUEUE *queue);
+void init_input_state(INPUT_STATE *state);
+
+// GLFW key to INPUT_KEY_BITS, 0 for keys nothing is bound to
+unsigned int get_input_key_bit(int key);
+
+// producer side, safe from the window callbacks
+bool push_key_event(INPUT_QUEUE *queue, int key, bool pressed);
+bool push_cursor_event(INPUT_QUEUE *queue, double x, double y);
+bool push_scroll_event(INPUT_QUEUE *queue, double yoffset);
+
+// consumer side, once per frame: every event since the last drain folded
+// into one frame, a key tapped in between counting as held for it;
+// frame_time is left at 0 for the caller
+INPUT_FRAME drain_input_queue(INPUT_QUEUE *queue, INPUT_STATE *state);
+
+bool start_input_recording(INPUT_RECORDING *recording, const char *path);
+void record_input_frame(INPUT_RECORDING *recording, const INPUT_FRAME *frame);
+void stop_input_recording(INPUT_RECORDING *recording);
+
+bool load_input_replay(INPUT_RECORDING *recording, const char *path);
+// false once the recording runs out
+bool next_replay_frame(INPUT_RECORDING *recording, INPUT_FRAME *frame);
+
+#endif
@@ -0,0 +1,365 @@
+#include "job_system.h"
+#include <deque>
+#include <mutex>
+#include <thread>
+
+typedef struct {
+	JOB_FUNC func;
+	void *data;
+	JOB_COUNTER *counter;
+} JOB;
+
+// a deque slot holds the job itself; thieves read it before their CAS, while
+// the owner may be refilling it, so every field is atomic
+typedef struct {
+	std::atomic<JOB_FUNC> func;
+	std::atomic<void *> data;
+	std::atomic<JOB_COUNTER *> counter;
+} JOB_SLOT;
+
+// Chase-Lev work-stealing deque: the owner pushes and takes at the bottom,
+// thieves steal from the top. Orderings follow Le et al., "Correct and
+// Efficient Work-Stealing for Weak Memory Models" (PPoPP 2013), with a
+// release store on bottom in place of the fence so the job body is published too
+typedef struct {
+	alignas(64) std::atomic<long> top;
+	alignas(64) std::atomic<long> bottom;
+	JOB_SLOT buffer[JOB_QUEUE_SIZE];
+} JOB_DEQUE;
+
+typedef struct {
+	JOB_DEQUE deque;
+	unsigned int rng;
+	ARENA scratch;				// only touched by the owner
+	std::thread thread;
+} WORKER;
+
+static WORKER *workers;
+static int worker_count;
+static std::atomic<bool> running;
+static std::atomic<unsigned int> wake_signal;
+static std::atomic<int> sleeping;
+static thread_local int worker_index = -1;
+
+// jobs from threads that are not workers, drained by the worker threads
+static std::deque<JOB> injected;
+static std::mutex injected_mutex;
+static std::atomic<int> injected_count;
+
+
+static void read_slot(JOB_SLOT *slot, JOB *job) {
+	job->func = slot->func.load(std::memory_order_relaxed);
+	job->data = slot->data.load(std::memory_order_relaxed);
+	job->counter = slot->counter.load(std::memory_order_relaxed);
+}
+
+
+// false when full, before anything is written
+static bool deque_push(JOB_DEQUE *deque, const JOB *job) {
+	long b = deque->bottom.load(std::memory_order_relaxed);
+	long t = deque->top.load(std::memory_order_acquire);
+	if (b - t >= JOB_QUEUE_SIZE) {
+		return false;
+	}
+
+	JOB_SLOT *slot = &deque->buffer[b & (JOB_QUEUE_SIZE - 1)];
+	slot->func.store(job->func, std::memory_order_relaxed);
+	slot->data.store(job->data, std::memory_order_relaxed);
+	slot->counter.store(job->counter, std::memory_order_relaxed);
+	deque->bottom.store(b + 1, std::memory_order_release);
+	return true;
+}
+
+
+static bool deque_take(JOB_DEQUE *deque, JOB *job) {
+	long b = deque->bottom.load(std::memory_order_relaxed) - 1;
+	deque->bottom.store(b, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	long t = deque->top.load(std::memory_order_relaxed);
+
+	if (t > b) {
+		deque->bottom.store(b + 1, std::memory_order_relaxed);
+		return false;
+	}
+
+	read_slot(&deque->buffer[b & (JOB_QUEUE_SIZE - 1)], job);
+	bool taken = true;
+	if (t == b) {
+		// last element: race the thieves for it
+		taken = deque->top.compare_exchange_strong(t, t + 1,
+				std::memory_order_seq_cst, std::memory_order_relaxed);
+		deque->bottom.store(b + 1, std::memory_order_relaxed);
+	}
+	return taken;
+}
+
+
+// the job is copied out before the CAS: once top moves past it the owner may
+// push over its slot
+static bool deque_steal(JOB_DEQUE *deque, JOB *job) {
+	long t = deque->top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	long b = deque->bottom.load(std::memory_order_acquire);
+	if (t >= b) {
+		return false;
+	}
+
+	read_slot(&deque->buffer[t & (JOB_QUEUE_SIZE - 1)], job);
+	return deque->top.compare_exchange_strong(t, t + 1,
+			std::memory_order_seq_cst, std::memory_order_relaxed);
+}
+
+
+// worker 0 is the main thread, which only helps while it waits on frame
+// work; a long job from another thread would stall the frame, so it leaves
+// them to the others
+static bool take_injected(JOB *job) {
+	if (worker_index == 0 || injected_count.load(std::memory_order_acquire) == 0) {
+		return false;
+	}
+	std::lock_guard<std::mutex> lock(injected_mutex);
+	if (injected.empty()) {
+		return false;
+	}
+	*job = injected.front();
+	injected.pop_front();
+	injected_count.fetch_sub(1, std::memory_order_relaxed);
+	return true;
+}
+
+
+static void execute_job(JOB *job) {
+	job->func(job->data);
+	if (job->counter) {
+		job->counter->value.fetch_sub(1, std::memory_order_release);
+	}
+}
+
+
+// one round of work: own queue first, then a steal from each other worker
+static bool run_one_job(WORKER *self) {
+	JOB job;
+	bool found = deque_take(&self->deque, &job) || take_injected(&job);
+	for (int i = 0; i < worker_count && !found; i++) {
+		self->rng = self->rng * 1664525u + 1013904223u;
+		WORKER *victim = &workers[(self->rng >> 16) % worker_count];
+		if (victim != self) {
+			found = deque_steal(&victim->deque, &job);
+		}
+	}
+
+	if (!found) {
+		return false;
+	}
+	execute_job(&job);
+	return true;
+}
+
+
+static void worker_main(int index) {
+	worker_index = index;
+	WORKER *self = &workers[index];
+	int idle = 0;
+
+	while (running.load(std::memory_order_acquire)) {
+		if (run_one_job(self)) {
+			idle = 0;
+			continue;
+		}
+
+		if (++idle < IDLE_SPINS) {
+			std::this_thread::yield();
+			continue;
+		}
+
+		// sleep until someone pushes; re-check after announcing to avoid a lost wakeup
+		unsigned int signal = wake_signal.load(std::memory_order_acquire);
+		sleeping.fetch_add(1, std::memory_order_seq_cst);
+		if (!run_one_job(self) && running.load(std::memory_order_acquire)) {
+			wake_signal.wait(signal, std::memory_order_acquire);
+		}
+		sleeping.fetch_sub(1, std::memory_order_relaxed);
+		idle = 0;
+	}
+}
+
+
+void init_job_system(int count, size_t scratch_size) {
+	if (count <= 0) {
+		count = static_cast<int>(std::thread::hardware_concurrency());
+	}
+	if (count <= 0) count = 1;
+	if (count > MAX_WORKERS) count = MAX_WORKERS;
+
+	worker_count = count;
+	workers = new WORKER[count];
+	for (int i = 0; i < count; i++) {
+		workers[i].deque.top.store(0);
+		workers[i].deque.bottom.store(0);
+		workers[i].rng = 0x9e3779b9u * (i + 1);
+		workers[i].scratch = {};
+		if (scratch_size > 0) {
+			init_arena(&workers[i].scratch, scratch_size);
+		}
+	}
+
+	running.store(true);
+	worker_index = 0;
+	for (int i = 1; i < count; i++) {
+		workers[i].thread = std::thread(worker_main, i);
+	}
+}
+
+
+void shutdown_job_system() {
+	if (!workers) {
+		return;
+	}
+
+	running.store(false, std::memory_order_release);
+	wake_signal.fetch_add(1, std::memory_order_release);
+	wake_signal.notify_all();
+	for (int i = 1; i < worker_count; i++) {
+		workers[i].thread.join();
+	}
+	for (int i = 0; i < worker_count; i++) {
+		destroy_arena(&workers[i].scratch);
+	}
+	injected.clear();
+	injected_count.store(0);
+
+	delete[] workers;
+	workers = NULL;
+	worker_count = 0;
+	worker_index = -1;
+}
+
+
+int get_worker_count() {
+	return worker_count;
+}
+
+
+int get_worker_index() {
+	return worker_index;
+}
+
+
+ARENA *get_worker_scratch() {
+	return worker_index >= 0 && workers[worker_index].scratch.base ? &workers[worker_index].scratch : NULL;
+}
+
+
+void run_jobs(const JOB_DECL *jobs, int count, JOB_COUNTER *counter) {
+	if (counter) {
+		counter->value.fetch_add(count, std::memory_order_relaxed);
+	}
+
+	if (worker_index < 0 && worker_count <= 1) {
+		// no worker thread to hand them to: run inline
+		for (int i = 0; i < count; i++) {
+			JOB job = { jobs[i].func, jobs[i].data, counter };
+			execute_job(&job);
+		}
+		return;
+	}
+
+	if (worker_index < 0) {
+		std::lock_guard<std::mutex> lock(injected_mutex);
+		for (int i = 0; i < count; i++) {
+			injected.push_back({ jobs[i].func, jobs[i].data, counter });
+		}
+		injected_count.fetch_add(count, std::memory_order_release);
+	} else {
+		WORKER *self = &workers[worker_index];
+		for (int i = 0; i < count; i++) {
+			JOB job = { jobs[i].func, jobs[i].data, counter };
+			if (!deque_push(&self->deque, &job)) {
+				// queue full: run it here rather than drop it
+				execute_job(&job);
+			}
+		}
+	}
+
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (sleeping.load(std::memory_order_relaxed) > 0) {
+		wake_signal.fetch_add(1, std::memory_order_release);
+		wake_signal.notify_all();
+	}
+}
+
+
+// helps run jobs until the counter drains, so it is safe to call from inside a
+// job; other threads only wait
+void wait_for_counter(JOB_COUNTER *counter) {
+	while (counter->value.load(std::memory_order_acquire) > 0) {
+		if (worker_index < 0 || !run_one_job(&workers[worker_index])) {
+			std::this_thread::yield();
+		}
+	}
+}
+
+
+typedef struct {
+	RANGE_FUNC func;
+	void *data;
+	int begin;
+	int end;
+} RANGE_JOB;
+
+static void range_job(void *data) {
+	RANGE_JOB *range = (RANGE_JOB *)data;
+	range->func(range->data, range->begin, range->end);
+}
+
+
+void parallel_for(int count, int batch_size, RANGE_FUNC func, void *data) {
+	if (batch_size < 1) batch_size = 1;
+	if (count <= batch_size || worker_count <= 1) {
+		func(data, 0, count);
+		return;
+	}
+
+	// never queue more batches than a deque holds
+	int batches = (count + batch_size - 1) / batch_size;
+	if (batches > JOB_QUEUE_SIZE / 2) {
+		batches = JOB_QUEUE_SIZE / 2;
+		batch_size = (count + batches - 1) / batches;
+		batches = (count + batch_size - 1) / batch_size;
+	}
+
+	// the batch lists live on this worker's scratch; nested calls made while
+	// waiting below finish before it is rewound, so it is used as a stack
+	ARENA *scratch = get_worker_scratch();
+	size_t mark = scratch ? arena_mark(scratch) : 0;
+	RANGE_JOB *ranges = scratch ? (RANGE_JOB *)arena_alloc(scratch, batches * sizeof(RANGE_JOB)) : NULL;
+	JOB_DECL *decls = ranges ? (JOB_DECL *)arena_alloc(scratch, batches * sizeof(JOB_DECL)) : NULL;
+	bool on_heap = !decls;
+	if (on_heap) {
+		if (scratch) {
+			arena_rewind(scratch, mark);
+		}
+		ranges = new RANGE_JOB[batches];
+		decls = new JOB_DECL[batches];
+	}
+	for (int i = 0; i < batches; i++) {
+		ranges[i].func	= func;
+		ranges[i].data	= data;
+		ranges[i].begin	= i * batch_size;
+		ranges[i].end	= (i + 1) * batch_size < count ? (i + 1) * batch_size : count;
+		decls[i].func	= range_job;
+		decls[i].data	= &ranges[i];
+	}
+
+	JOB_COUNTER counter;
+	counter.value.store(0);
+	run_jobs(decls, batches, &counter);
+	wait_for_counter(&counter);
+
+	if (on_heap) {
+		delete[] decls;
+		delete[] ranges;
+	} else {
+		arena_rewind(scratch, mark);
+	}
+}
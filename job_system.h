@@ -0,0 +1,45 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <stddef.h>
+#include <atomic>
+
+#include "arena.h"
+
+// default job system values
+const int MAX_WORKERS		= 64;
+const int JOB_QUEUE_SIZE	= 4096;	// per worker, power of two
+const int IDLE_SPINS		= 64;	// failed steal rounds before a worker sleeps
+const size_t JOB_SCRATCH_SIZE	= 128 * 1024;	// per worker, holds parallel_for's largest batch list
+
+typedef void (*JOB_FUNC)(void *data);
+typedef void (*RANGE_FUNC)(void *data, int begin, int end);
+
+// counts unfinished jobs; a job may wait on another job's counter to depend on it
+typedef struct {
+	std::atomic<int> value;
+} JOB_COUNTER;
+
+typedef struct {
+	JOB_FUNC func;
+	void *data;
+} JOB_DECL;
+
+
+// worker_count includes the calling thread, which becomes worker 0.
+// jobs submitted from other threads wait in a shared queue for the worker
+// threads, or run inline when there are none.
+// with a scratch_size of 0 parallel_for takes its batch lists from the heap
+void init_job_system(int worker_count = 0, size_t scratch_size = JOB_SCRATCH_SIZE);
+void shutdown_job_system();
+int get_worker_count();
+int get_worker_index();
+// the calling worker's own arena for temporaries that die within a job: take
+// an arena_mark and rewind to it before the job returns. NULL off the workers
+ARENA *get_worker_scratch();
+
+void run_jobs(const JOB_DECL *jobs, int count, JOB_COUNTER *counter);
+void wait_for_counter(JOB_COUNTER *counter);
+void parallel_for(int count, int batch_size, RANGE_FUNC func, void *data);
+
+#endif
@@ -5,44 +5,132 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <string.h>
 #include <iostream>
+#include <string>
+#include <thread>
 
 #include "camera.h"
+#include "input.h"
 #include "texture.h"
 #include "shader.h"
 #include "error_codes.h"
+#include "frame_pacer.h"
+#include "simulation.h"
+#include "render_thread.h"
+#include "scene_graph.h"
+#include "ecs.h"
+#include "job_system.h"
+#include "arena.h"
+#include "draw_batch.h"
+#include "mesh_import.h"
+#include "asset_loader.h"
+#include "texture_array.h"
+#include "sampler.h"
+#include "texture_cache.h"
+#include "gl_ext.h"
 
 // settings
 const unsigned int WINDOW_WIDTH		= 800;
 const unsigned int WINDOW_HEIGHT	= 600;
-
-// camera
-CAMERA cam;
-bool first_mouse	= true;
-float mouse_last_x	= WINDOW_WIDTH / 2.0f;
-float mouse_last_y	= WINDOW_HEIGHT / 2.0f;
+const PRESENT_MODE present_mode		= PRESENT_VSYNC;
+const float target_fps				= 60.0f;	// only used by PRESENT_FIXED_RATE
+const float tick_rate				= TICK_RATE;
+const VIEW_LAYOUT view_layout		= VIEW_SINGLE;
+
+// simulation
+SIM_INPUT sim_input;
+SIM_STATE sim_state;
+SIM_STATE prev_sim_state;
+SIM_STATE view_state;
+SIM_CLOCK sim_clock;
+
+// input, queued by the window callbacks and drained once per frame
+INPUT_QUEUE input_queue;
+INPUT_STATE input_state;
+INPUT_RECORDING input_recording;	// --record-input <file>
+INPUT_RECORDING input_replay;		// --replay-input <file>
+bool recording_input = false;
+bool replaying_input = false;
+
+// the second view in the split and picture-in-picture layouts
+CAMERA overview_cam;
+
+// every cube is a child of one root, so moving the root moves the field
+SCENE_GRAPH scene;
+int scene_root;
+int cube_nodes[MAX_CUBES];
+
+// what gets drawn: one entity per cube, its transform following its scene node
+ECS_WORLD ecs;
+ENTITY cube_entities[MAX_CUBES];
+const unsigned int CUBE_COMPONENTS = HAS_TRANSFORM | HAS_MESH | HAS_MATERIAL | HAS_BOUNDS | HAS_SCENE_NODE;
+const unsigned int FOLLOW_NODE_COMPONENTS = HAS_TRANSFORM | HAS_BOUNDS | HAS_SCENE_NODE;
+const unsigned int RENDER_COMPONENTS = HAS_TRANSFORM | HAS_MESH | HAS_MATERIAL | HAS_BOUNDS;
 
 // timing
-float delta_time = 0.0f;
-float last_frame = 0.0f;
+FRAME_PACER pacer;
+float frame_time = 0.0f;
+
+// per-frame data, one slot per snapshot the threads can hold between them
+FRAME_ARENAS frame_arenas;
+
+// rendering, owned by the render thread once it starts
+RENDERER renderer;
+SNAPSHOT_MAILBOX mailbox;
+ASSET_LOADER loader;
+TEXTURE_ARRAY texture_array;
+SAMPLER_CACHE samplers;
+TEXTURE_CACHE texture_cache;
+unsigned int material_sampler;
+MESH_POOL mesh_pool;
+int cube_mesh;
+const char *cube_mesh_path = NULL;	// --mesh <file>
+float cube_bound_radius;
+int framebuffer_width	= WINDOW_WIDTH;
+int framebuffer_height	= WINDOW_HEIGHT;
 
 // filepath constants
 const char *vertexShaderSource_path = "shaders/shader.vert";
 const char *fragmentShaderSource_path = "shaders/shader.frag";
-const char *texture1_path = "textures/img1.jpeg";
-const char *texture2_path = "textures/img3.jpeg";
+// each cube's material names its own files; the texture cache loads each once
+const char *cube_texture_paths[2] = { "textures/img1.jpeg", "textures/img3.jpeg" };
+
+// filtering shared by every material texture
+const SAMPLER_PRESET material_sampler_preset = SAMPLER_ANISOTROPIC;
+
+// per-frame draw building, run as systems over the entity chunks
+const float CUBE_BOUND_RADIUS = 0.8661f;	// half the diagonal of a unit cube
+const glm::vec3 CUBE_SPIN_AXIS = glm::normalize(glm::vec3(1.0f, 0.3f, 0.5f));
+typedef struct {
+	FRAME_SNAPSHOT *snapshot;
+	glm::vec4 *bounds;		// world-space spheres the views cull against
+} DRAW_BUILD;
 
 // prototypes
 void processInput(GLFWwindow *window);
 void mouse_callback(GLFWwindow *window, double xpos, double ypos);
 void mouse_scroll_callback(GLFWwindow *window, double xoffset, double yoffset);
+void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods);
+bool parse_input_args(int argc, char **argv);
 GLFWwindow *create_window(const unsigned int width, const unsigned int height, const char *title);
 void framebuffer_size_callback(GLFWwindow *window, int width, int height);
 void enable_glfw_params();
 bool init_opengl();
+void build_scene(const glm::vec3 *positions, int count);
+void build_snapshot(FRAME_SNAPSHOT *snapshot, SIM_STATE *state);
+void follow_scene_nodes(void *data, const CHUNK_VIEW *chunk);
+void render_system(void *data, const CHUNK_VIEW *chunk);
 
 
-int main() {
+int main(int argc, char **argv) {
+	double startup_time = pacer_now();
+
+	init_input_queue(&input_queue);
+	init_input_state(&input_state);
+	if (!parse_input_args(argc, argv)) {
+		return INIT_FAILED;
+	}
 
 	if (!init_opengl()) {
 		return GLFW_INIT_FAILED;
@@ -58,20 +146,31 @@ int main() {
 		return GLAD_INIT_FAILED;
 	}
 
-	cam = create_camera();
+	load_gl_extensions();
+	pacer = create_frame_pacer(present_mode, target_fps);
+	init_job_system();
+	if (!init_frame_arenas(&frame_arenas, SNAPSHOT_SLOTS)) {
+		shutdown_job_system();
+		glfwTerminate();
+		return FRAME_ARENA_INIT_FAILED;
+	}
 
 	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 	enable_glfw_params();
 
-	const char *vertexShaderSource = load_shader(vertexShaderSource_path);
-	const char *fragmentShaderSource = load_shader(fragmentShaderSource_path);
-
-	unsigned int vertexShader = compile_vertex_shader(vertexShaderSource);
-	unsigned int fragmentShader = compile_fragment_shader(fragmentShaderSource);
-	unsigned int shaderProgram = create_shader_program(vertexShader, fragmentShader);
-
-	glDeleteShader(vertexShader);
-	glDeleteShader(fragmentShader);
+	// shaders and textures stream in while the first frames render
+	if (!init_asset_loader(&loader, startup_time)) {
+		destroy_frame_arenas(&frame_arenas);
+		shutdown_job_system();
+		glfwTerminate();
+		return ASSET_LOADER_INIT_FAILED;
+	}
+	renderer.shader_program = 0;
+	renderer.stereo_mode = view_layout == VIEW_STEREO ? choose_stereo_mode() : STEREO_PASSES;
+	std::string shader_header = gl_ext.bindless_texture ? "#version 400 core\n#define BINDLESS\n" : "#version 330 core\n";
+	shader_header += get_stereo_shader_define(renderer.stereo_mode);
+	load_program_async(&loader, &renderer.shader_program,
+			vertexShaderSource_path, fragmentShaderSource_path, shader_header);
 
 	float vertices[] = {
 		-0.5f, -0.5f, -0.5f,  0.0f, 0.0f,
@@ -130,143 +229,181 @@ int main() {
 		glm::vec3(-1.3f,  1.0f,  -1.5f)
 	};
 
-	unsigned int VBO;
-	unsigned int VAO;
-
-	glGenBuffers(1, &VBO);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-	glGenVertexArrays(1, &VAO);
-	glBindVertexArray(VAO);
-
-	// position attribute
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), NULL);
-	glEnableVertexAttribArray(0);
-
-	// texture attribute
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-
-	// texture 1
-	unsigned int texture1;
-	glGenTextures(1, &texture1);
-
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, texture1);
-
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-	make_texture(texture1_path, JPG_TEX);
-
-	// texture 2
-	unsigned int texture2;
-	glGenTextures(1, &texture2);
-
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, texture2);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-	make_texture(texture2_path, JPG_TEX);
-
-	// tell OPENGL for each sample to which texutre unit it belongs to (only has to be done once)
-	glUseProgram(shaderProgram);
-	glUniform1i(glGetUniformLocation(shaderProgram, "texture1"), 0);
-	glUniform1i(glGetUniformLocation(shaderProgram, "texture2"), 1);
-
-	unsigned int mixAmount_uniform_location = glGetUniformLocation(shaderProgram, "mixAmount");
-	float mix_amount = 0.4;
-	glUniform1f(mixAmount_uniform_location, mix_amount);
+	glm::vec4 view_rects[MAX_VIEWS];
+	get_view_layout_rects(view_layout, view_rects);
+	CAMERA cam = create_camera();
+	set_cam_aspect(&cam, get_view_aspect(view_rects[0], WINDOW_WIDTH, WINDOW_HEIGHT));
+	overview_cam = create_camera(glm::vec3(0.0f, 12.0f, 8.0f), glm::vec3(0.0f, 1.0f, 0.0f),
+			glm::vec3(0.0f, 0.0f, -1.0f), SPEED, SENSITIVITY, ZOOM, YAW, -50.0f);
+	set_cam_aspect(&overview_cam, get_view_aspect(view_rects[1], WINDOW_WIDTH, WINDOW_HEIGHT));
+	sim_input = {};
+	sim_state = create_sim_state(&cam, sizeof(cubePositions) / sizeof(cubePositions[0]));
+	prev_sim_state = sim_state;
+	view_state = sim_state;
+	sim_clock = create_sim_clock(tick_rate);
+	const float tick_dt = static_cast<float>(sim_clock.tick_time);
+
+	// position and texture coordinate per vertex, drawn in order
+	init_mesh_pool(&mesh_pool);
+	cube_mesh = add_mesh(&mesh_pool, VERTEX_POS_UV, vertices, 36, NULL, 0);
+	cube_bound_radius = CUBE_BOUND_RADIUS;
+	if (cube_mesh_path) {
+		// a model that fails to load leaves the cubes as they are
+		int model = load_mesh_file(&mesh_pool, cube_mesh_path, &cube_bound_radius);
+		cube_mesh = model >= 0 ? model : cube_mesh;
+	}
 
-	unsigned int model_uniform_location = glGetUniformLocation(shaderProgram, "model");
-	unsigned int view_uniform_location = glGetUniformLocation(shaderProgram, "view");
-	unsigned int projection_uniform_location = glGetUniformLocation(shaderProgram, "projection");
+	// every texture goes into one array, grown to the largest image as they arrive
+	init_texture_array(&texture_array, 256, 256);
+	init_sampler_cache(&samplers);
+	SAMPLER_DESC material_sampler_desc = get_sampler_preset(material_sampler_preset, GL_CLAMP_TO_EDGE);
+	material_sampler = acquire_sampler(&samplers, &material_sampler_desc);
+	set_texture_array_sampler(&texture_array, material_sampler);
+	init_texture_cache(&texture_cache, &loader, &samplers);
+	build_scene(cubePositions, sim_state.cube_count);
+
+	renderer.window = window;
+	renderer.meshes = &mesh_pool;
+	renderer.mix_amount = 0.4f;
+	renderer.textures = &texture_array;
+	renderer.program_ready = false;
+	renderer.loader = &loader;
+	renderer.startup_time = startup_time;
+	renderer.present_stats = create_frame_pacer(present_mode, target_fps);
+
+	// hand the context over; from here on this thread only simulates
+	init_snapshot_mailbox(&mailbox);
+	glfwMakeContextCurrent(NULL);
+	std::thread render_thread(render_thread_main, &renderer, &mailbox);
 
 	while (!glfwWindowShouldClose(window)) {
-		glClearColor(0.1f, 0.7f, 0.9f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-		processInput(window);
-
-		float current_frame = static_cast<float>(glfwGetTime());
-		delta_time = current_frame - last_frame;
-		last_frame = current_frame;
+		// wait first so input is sampled as close to submission as possible
+		pacer_wait(&pacer);
+		glfwPollEvents();
 
-		glm::mat4 projection = glm::perspective(glm::radians(cam.zoom), 
-				(float) WINDOW_WIDTH / WINDOW_HEIGHT, 0.1f, 100.0f);
-		glUniformMatrix4fv(projection_uniform_location, 1, GL_FALSE, glm::value_ptr(projection));
+		frame_time = pacer_begin_frame(&pacer);
+		processInput(window);
+		pacer_mark_input(&pacer);
 
-		glm::mat4 view = get_view_matrix(&cam);
-		glUniformMatrix4fv(view_uniform_location, 1, GL_FALSE, glm::value_ptr(view));
+		int ticks = advance_sim_clock(&sim_clock, frame_time);
+		for (int t = 0; t < ticks; t++) {
+			prev_sim_state = sim_state;
+			simulate_tick(&sim_state, &sim_input, tick_dt);
+		}
 
-		for (int i = 0; i < 10; i++) {
-			glm::mat4 model = glm::mat4(1.0f);
-			model = glm::translate(model, cubePositions[i]);
-			float angle = 20.0f * i;
-			model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
-			glUniformMatrix4fv(model_uniform_location, 1, GL_FALSE, glm::value_ptr(model));
+		// render between the last two ticks so motion stays smooth at any frame rate
+		interpolate_sim_state(&view_state, &prev_sim_state, &sim_state, get_sim_alpha(&sim_clock));
 
-			glDrawArrays(GL_TRIANGLES, 0, 36);
+		// waits only if the render thread is still a full frame behind
+		FRAME_SNAPSHOT *snapshot = begin_snapshot(&mailbox);
+		if (!snapshot) {
+			break;
 		}
-
-		glfwSwapBuffers(window);
-		glfwPollEvents();
+		// the render thread is done with the frame that last used this slot
+		begin_frame_arenas(&frame_arenas);
+		build_snapshot(snapshot, &view_state);
+		publish_snapshot(&mailbox);
 	}
 
-	glDeleteVertexArrays(1, &VAO);
-	glDeleteBuffers(1, &VBO);
-	glDeleteProgram(shaderProgram);
+	close_snapshot_mailbox(&mailbox);
+	render_thread.join();
+	shutdown_asset_loader(&loader);
+	stop_input_recording(&input_recording);
+	ARENA_STATS arena_stats = get_frame_arena_stats(&frame_arenas);
+	printf("frame arena high water: %.1f of %.1f KB per worker\n", arena_stats.high_water / 1024.0,
+			FRAME_ARENA_SIZE / 1024.0);
+	destroy_frame_arenas(&frame_arenas);
+	shutdown_job_system();
+	destroy_ecs_world(&ecs);
+	glfwMakeContextCurrent(window);
+
+	MESH_POOL_STATS mesh_stats = get_mesh_pool_stats(&mesh_pool);
+	printf("mesh pool: %d meshes, %.1f of %.1f KB used, %d grows, %.1f KB moved by defragmentation\n",
+			mesh_stats.meshes, mesh_stats.used_bytes / 1024.0, mesh_stats.buffer_bytes / 1024.0, mesh_stats.grows,
+			mesh_stats.moved_bytes / 1024.0);
+	destroy_mesh_pool(&mesh_pool);
+	glDeleteProgram(renderer.shader_program);
+	destroy_texture_array(&texture_array);
+	TEXTURE_CACHE_STATS cache_stats = get_texture_cache_stats(&texture_cache);
+	printf("texture cache: %d layers loaded, %d material lookups shared a load\n", cache_stats.layers,
+			cache_stats.hits);
+	destroy_texture_cache(&texture_cache);
+	release_sampler(&samplers, material_sampler);
+	destroy_sampler_cache(&samplers);
 	glfwDestroyWindow(window);
 	glfwTerminate();
 	return 0;
 }
 
 
-void mouse_scroll_callback(GLFWwindow *window, double xoffset, double yoffset) {
-	get_cam_mouse_scroll(&cam, static_cast<float>(yoffset));
+// --record-input <file> saves every frame's input and frame time;
+// --replay-input <file> plays them back instead of the window's, so a run
+// can be repeated exactly. --mesh <file> draws an .obj, .gltf, .glb or
+// cooked .mesh model in place of every cube
+bool parse_input_args(int argc, char **argv) {
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--record-input") && i + 1 < argc) {
+			recording_input = start_input_recording(&input_recording, argv[++i]);
+			if (!recording_input) {
+				return false;
+			}
+		} else if (!strcmp(argv[i], "--replay-input") && i + 1 < argc) {
+			replaying_input = load_input_replay(&input_replay, argv[++i]);
+			if (!replaying_input) {
+				return false;
+			}
+		} else if (!strcmp(argv[i], "--mesh") && i + 1 < argc) {
+			cube_mesh_path = argv[++i];
+		} else {
+			std::cout << "usage: " << argv[0] << " [--record-input file] [--replay-input file] [--mesh file]\n";
+			return false;
+		}
+	}
+	return true;
 }
 
 
-void mouse_callback(GLFWwindow *window, double xpos_in, double ypos_in) {
-	float xpos = static_cast<float>(xpos_in);
-	float ypos = static_cast<float>(ypos_in);
-	
-	if (first_mouse) {
-		mouse_last_x = xpos;
-		mouse_last_y = ypos;
-		first_mouse = false;
-	}
+void mouse_scroll_callback(GLFWwindow *window, double xoffset, double yoffset) {
+	push_scroll_event(&input_queue, yoffset);
+}
+
 
-	float xoffset = xpos - mouse_last_x;
-	float yoffset = mouse_last_y - ypos;
+void mouse_callback(GLFWwindow *window, double xpos, double ypos) {
+	push_cursor_event(&input_queue, xpos, ypos);
+}
 
-	mouse_last_x = xpos;
-	mouse_last_y = ypos;
 
-	get_cam_mouse_input(&cam, xoffset, yoffset);
+// repeats change nothing, the key is already held
+void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods) {
+	if (action != GLFW_REPEAT) {
+		push_key_event(&input_queue, key, action == GLFW_PRESS);
+	}
 }
 
 
+// one drain per frame: mouse deltas summed, keys as a bitmask
 void processInput(GLFWwindow *window) {
-	if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
+	INPUT_FRAME input = drain_input_queue(&input_queue, &input_state);
+	bool quit = input.keys & INPUT_QUIT;
+	input.frame_time = frame_time;
+	if (replaying_input) {
+		if (!next_replay_frame(&input_replay, &input)) {
+			quit = true;
+		}
+		frame_time = static_cast<float>(input.frame_time);
+	}
+	if (recording_input) {
+		record_input_frame(&input_recording, &input);
+	}
+	if (quit) {
 		glfwSetWindowShouldClose(window, 1);
 	}
 
-	if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) {
-		get_cam_keyboard_input(&cam, FORWARD, delta_time);
-	} else if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) {
-		get_cam_keyboard_input(&cam, BACKWARD, delta_time);
-	} else if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) {
-		get_cam_keyboard_input(&cam, LEFT, delta_time);
-	} else if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) {
-		get_cam_keyboard_input(&cam, RIGHT, delta_time);
-	}
+	// mouse and scroll are consumed by the next sim tick
+	sim_input.keys		= input.keys;
+	sim_input.mouse_dx	+= input.mouse_dx;
+	sim_input.mouse_dy	+= input.mouse_dy;
+	sim_input.scroll	+= input.scroll;
 }
 
 
@@ -280,14 +417,135 @@ GLFWwindow *create_window(const unsigned int width, const unsigned int heigt, co
 		glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 		glfwSetCursorPosCallback(window, mouse_callback);
 		glfwSetScrollCallback(window, mouse_scroll_callback);
+		glfwSetKeyCallback(window, key_callback);
 	}
 
 	return window;
 }
 
 
+// no context on this thread, the render thread applies the viewport
 void framebuffer_size_callback(GLFWwindow *window, int width, int height) {
-	glViewport(0, 0, width, height);
+	framebuffer_width = width;
+	framebuffer_height = height;
+}
+
+
+void build_scene(const glm::vec3 *positions, int count) {
+	init_scene_graph(&scene);
+	NODE_TRANSFORM local = make_node_transform();
+	scene_root = add_scene_node(&scene, SCENE_NO_PARENT, &local);
+
+	init_ecs_world(&ecs);
+	for (int i = 0; i < count; i++) {
+		local = make_node_transform(positions[i]);
+		cube_nodes[i] = add_scene_node(&scene, scene_root, &local);
+
+		// a full array hands out -1; without a material the entity falls outside
+		// RENDER_COMPONENTS and is not drawn
+		int layers[2];
+		for (int t = 0; t < 2; t++) {
+			layers[t] = acquire_texture_layer(&texture_cache, &texture_array, cube_texture_paths[t]);
+		}
+		bool has_material = layers[0] >= 0 && layers[1] >= 0;
+		cube_entities[i] = create_entity(&ecs, has_material ? CUBE_COMPONENTS : CUBE_COMPONENTS & ~HAS_MATERIAL);
+		MESH_REF *mesh = (MESH_REF *)get_component(&ecs, cube_entities[i], COMPONENT_MESH);
+		mesh->mesh = cube_mesh;
+		if (has_material) {
+			MATERIAL_REF *material = (MATERIAL_REF *)get_component(&ecs, cube_entities[i], COMPONENT_MATERIAL);
+			material->texture_layers[0] = layers[0];
+			material->texture_layers[1] = layers[1];
+		}
+		BOUNDS_COMPONENT *bounds = (BOUNDS_COMPONENT *)get_component(&ecs, cube_entities[i], COMPONENT_BOUNDS);
+		bounds->radius = cube_bound_radius;
+		SCENE_NODE_REF *node = (SCENE_NODE_REF *)get_component(&ecs, cube_entities[i], COMPONENT_SCENE_NODE);
+		node->node = cube_nodes[i];
+	}
+}
+
+
+void build_snapshot(FRAME_SNAPSHOT *snapshot, SIM_STATE *state) {
+	glm::vec4 rects[MAX_VIEWS];
+	CAMERA *cam = &state->cam;
+	snapshot->view_count = get_view_layout_rects(view_layout, rects);
+	snapshot->stereo = view_layout == VIEW_STEREO;
+	if (snapshot->stereo) {
+		make_stereo_views(get_view_matrix(cam), get_projection_matrix(cam), STEREO_EYE_SEPARATION,
+				rects[0], rects[1], &snapshot->views[0], &snapshot->views[1]);
+	} else {
+		snapshot->views[0] = make_render_view(get_view_matrix(cam), get_projection_matrix(cam), rects[0]);
+		if (snapshot->view_count > 1) {
+			snapshot->views[1] = make_render_view(get_view_matrix(&overview_cam),
+					get_projection_matrix(&overview_cam), rects[1]);
+		}
+	}
+	snapshot->viewport_width = framebuffer_width;
+	snapshot->viewport_height = framebuffer_height;
+
+	snapshot->frame_time = frame_time;
+	snapshot->input_sampled = pacer.input_sampled;
+
+	// the sim owns the spin; the scene graph turns it into world matrices
+	for (int i = 0; i < state->cube_count; i++) {
+		NODE_TRANSFORM local = *get_node_transform(&scene, cube_nodes[i]);
+		local.rotation = glm::angleAxis(glm::radians(state->cube_angles[i]), CUBE_SPIN_AXIS);
+		set_node_transform(&scene, cube_nodes[i], &local);
+	}
+	update_scene_graph(&scene);
+
+	run_system(&ecs, FOLLOW_NODE_COMPONENTS, follow_scene_nodes, NULL);
+
+	// sized to this frame's entities; the arena slot outlives the snapshot
+	int draw_count = count_entities(&ecs, RENDER_COMPONENTS);
+	DRAW_BUILD build;
+	build.snapshot = snapshot;
+	build.bounds = (glm::vec4 *)frame_alloc(&frame_arenas, draw_count * sizeof(glm::vec4));
+	snapshot->draws = (DRAW_ITEM *)frame_alloc(&frame_arenas, draw_count * sizeof(DRAW_ITEM));
+	snapshot->view_masks = (unsigned char *)frame_alloc(&frame_arenas, draw_count);
+	if (!build.bounds || !snapshot->draws || !snapshot->view_masks) {
+		snapshot->draw_count = 0;
+		clear_draw_commands(snapshot);
+		return;
+	}
+	snapshot->draw_count = run_system(&ecs, RENDER_COMPONENTS, render_system, &build);
+
+	// transforms are built once above; only the culling is per view
+	cull_views(snapshot->views, snapshot->view_count, build.bounds, snapshot->draw_count, snapshot->view_masks);
+
+	// runs of a mesh become one command each, later one indirect draw per format
+	if (!build_draw_commands(snapshot, &frame_arenas)) {
+		snapshot->draw_count = 0;
+	}
+}
+
+
+void follow_scene_nodes(void *data, const CHUNK_VIEW *chunk) {
+	TRANSFORM_COMPONENT *transforms = (TRANSFORM_COMPONENT *)chunk->components[COMPONENT_TRANSFORM];
+	BOUNDS_COMPONENT *bounds = (BOUNDS_COMPONENT *)chunk->components[COMPONENT_BOUNDS];
+	const SCENE_NODE_REF *nodes = (const SCENE_NODE_REF *)chunk->components[COMPONENT_SCENE_NODE];
+	for (int i = 0; i < chunk->count; i++) {
+		transforms[i].world = get_world_matrix(&scene, nodes[i].node);
+		bounds[i].center = glm::vec3(transforms[i].world[3]);
+	}
+}
+
+
+// one draw per entity, in chunk order; the render thread turns the draws
+// into the instance buffer
+void render_system(void *data, const CHUNK_VIEW *chunk) {
+	DRAW_BUILD *build = (DRAW_BUILD *)data;
+	const TRANSFORM_COMPONENT *transforms = (const TRANSFORM_COMPONENT *)chunk->components[COMPONENT_TRANSFORM];
+	const MESH_REF *meshes = (const MESH_REF *)chunk->components[COMPONENT_MESH];
+	const MATERIAL_REF *materials = (const MATERIAL_REF *)chunk->components[COMPONENT_MATERIAL];
+	const BOUNDS_COMPONENT *bounds = (const BOUNDS_COMPONENT *)chunk->components[COMPONENT_BOUNDS];
+	for (int i = 0; i < chunk->count; i++) {
+		DRAW_ITEM *draw = &build->snapshot->draws[chunk->first + i];
+		draw->model = transforms[i].world;
+		draw->texture_layers[0] = materials[i].texture_layers[0];
+		draw->texture_layers[1] = materials[i].texture_layers[1];
+		draw->mesh = meshes[i].mesh;
+		build->bounds[chunk->first + i] = glm::vec4(bounds[i].center, bounds[i].radius);
+	}
 }
 
 
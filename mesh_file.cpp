@@ -0,0 +1,146 @@
+#include "mesh_import.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <atomic>
+
+#include "job_system.h"
+
+// cooked mesh files: mapped, checked and handed to the mesh pool
+
+typedef struct {
+	const uint32_t *indices;
+	uint32_t vertex_count;
+	std::atomic<bool> out_of_range;
+} INDEX_CHECK;
+
+
+static void check_indices(void *data, int begin, int end) {
+	INDEX_CHECK *check = (INDEX_CHECK *)data;
+	uint32_t largest = 0;
+	for (int i = begin; i < end; i++) {
+		largest = check->indices[i] > largest ? check->indices[i] : largest;
+	}
+	if (largest >= check->vertex_count) {
+		check->out_of_range.store(true, std::memory_order_relaxed);
+	}
+}
+
+
+bool map_cooked_mesh(const char *path, COOKED_MESH *cooked) {
+	*cooked = {};
+	int fd = open(path, O_RDONLY);
+	struct stat info;
+	if (fd < 0 || fstat(fd, &info) != 0) {
+		fprintf(stderr, "ERROR:MESH_FILE:OPEN_FAILED %s\n", path);
+		if (fd >= 0) {
+			close(fd);
+		}
+		return false;
+	}
+	size_t size = info.st_size;
+	void *map = size >= sizeof(MESH_FILE_HEADER) ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+	close(fd);
+	if (map == MAP_FAILED) {
+		fprintf(stderr, "ERROR:MESH_FILE:MAP_FAILED %s\n", path);
+		return false;
+	}
+	// the whole file is about to be copied out once, front to back; advice
+	// values are not flags, so one call each
+	madvise(map, size, MADV_SEQUENTIAL);
+	madvise(map, size, MADV_WILLNEED);
+
+	const MESH_FILE_HEADER *header = (const MESH_FILE_HEADER *)map;
+	const VERTEX_LAYOUT *layout = header->vertex_format >= 0 && header->vertex_format < VERTEX_FORMAT_COUNT
+			? get_vertex_layout((VERTEX_FORMAT)header->vertex_format) : NULL;
+	bool valid = !memcmp(header->magic, MESH_MAGIC, sizeof(MESH_MAGIC)) && header->version == MESH_FILE_VERSION
+			&& layout && header->vertex_stride == layout->stride && header->vertex_count > 0
+			&& header->index_count > 0 && header->vertex_offset >= (int64_t)sizeof(MESH_FILE_HEADER)
+			&& header->index_offset >= 0 && header->vertex_offset % 4 == 0 && header->index_offset % 4 == 0
+			&& (uint64_t)header->vertex_offset + (uint64_t)header->vertex_count * header->vertex_stride <= size
+			&& (uint64_t)header->index_offset + (uint64_t)header->index_count * sizeof(uint32_t) <= size;
+	if (!valid) {
+		fprintf(stderr, "ERROR:MESH_FILE:BAD_HEADER %s\n", path);
+		munmap(map, size);
+		return false;
+	}
+
+	// an index past the vertices would have the GPU read another mesh's
+	// vertices, or past the end of the pool's buffer
+	INDEX_CHECK check;
+	check.indices = (const uint32_t *)((const unsigned char *)map + header->index_offset);
+	check.vertex_count = (uint32_t)header->vertex_count;
+	check.out_of_range.store(false);
+	parallel_for(header->index_count, INDEX_CHECK_BATCH, check_indices, &check);
+	if (check.out_of_range.load()) {
+		fprintf(stderr, "ERROR:MESH_FILE:INDEX_OUT_OF_RANGE %s\n", path);
+		munmap(map, size);
+		return false;
+	}
+
+	cooked->map = map;
+	cooked->map_size = size;
+	cooked->header = header;
+	cooked->vertices = (const unsigned char *)map + header->vertex_offset;
+	cooked->indices = check.indices;
+	return true;
+}
+
+
+void unmap_cooked_mesh(COOKED_MESH *cooked) {
+	if (cooked->map) {
+		munmap(cooked->map, cooked->map_size);
+	}
+	*cooked = {};
+}
+
+
+static bool is_cooked_mesh(const char *path) {
+	char magic[sizeof(MESH_MAGIC)] = {};
+	FILE *file = fopen(path, "rb");
+	if (!file) {
+		return false;
+	}
+	bool read = fread(magic, 1, sizeof(magic), file) == sizeof(magic);
+	fclose(file);
+	return read && !memcmp(magic, MESH_MAGIC, sizeof(MESH_MAGIC));
+}
+
+
+int load_mesh_file(MESH_POOL *pool, const char *path, float *radius) {
+	int mesh = -1;
+	glm::vec3 center;
+	float bounds_radius;
+	if (is_cooked_mesh(path)) {
+		// the mapping is the upload's source; nothing is parsed or copied on the CPU
+		COOKED_MESH cooked;
+		if (!map_cooked_mesh(path, &cooked)) {
+			return -1;
+		}
+		const MESH_FILE_HEADER *header = cooked.header;
+		mesh = add_mesh(pool, (VERTEX_FORMAT)header->vertex_format, cooked.vertices, header->vertex_count,
+				cooked.indices, header->index_count);
+		center = glm::vec3(header->bounds_center[0], header->bounds_center[1], header->bounds_center[2]);
+		bounds_radius = header->bounds_radius;
+		unmap_cooked_mesh(&cooked);
+	} else {
+		IMPORTED_MESH imported;
+		if (!import_mesh(path, &imported)) {
+			return -1;
+		}
+		mesh = add_mesh(pool, VERTEX_LIT, imported.vertices.data(), (int)imported.vertices.size(),
+				imported.indices.data(), (int)imported.indices.size());
+		get_mesh_bounds(&imported, &center, &bounds_radius);
+	}
+	if (mesh < 0) {
+		fprintf(stderr, "ERROR:MESH_FILE:POOL_FULL %s\n", path);
+		return -1;
+	}
+	if (radius) {
+		*radius = glm::length(center) + bounds_radius;
+	}
+	return mesh;
+}
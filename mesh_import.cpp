@@ -0,0 +1,677 @@
+#include "mesh_import.h"
+#include <fcntl.h>
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "job_system.h"
+
+// kept free of GL calls so offline tools can import and cook
+
+static_assert(sizeof(LIT_VERTEX) == 12 * sizeof(float), "LIT_VERTEX must match the VERTEX_LIT layout");
+
+// an attribute a face corner leaves out
+const int OBJ_MISSING = INT_MIN;
+
+// a face corner's position, uv and normal. Negative OBJ indices count back
+// from the chunk's own attributes until the chunks' bases are known
+typedef struct {
+	int index[3];
+	int chunk_relative;		// bit per index
+} OBJ_CORNER;
+
+typedef struct {
+	const char *begin;
+	const char *end;
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec2> uvs;
+	std::vector<glm::vec3> normals;
+	std::vector<OBJ_CORNER> corners;	// three per triangle
+	const char *bad_line;				// first line that did not parse
+	bool bad_index;
+	int bases[3];						// attributes in earlier chunks
+	int first_corner;
+	bool all_uvs;
+	bool all_normals;
+} OBJ_CHUNK;
+
+typedef struct {
+	OBJ_CHUNK *chunks;
+	int totals[3];
+	std::vector<OBJ_CORNER> *corners;
+} OBJ_MERGE;
+
+typedef struct {
+	const unsigned char *keys;
+	size_t key_size;
+	size_t stride;
+	uint32_t *hashes;
+} KEY_HASHES;
+
+typedef struct {
+	IMPORTED_MESH *mesh;
+	const std::vector<glm::vec3> *accumulated;
+	const std::vector<glm::vec3> *bitangents;
+	const uint32_t *groups;
+} VERTEX_PASS;
+
+static const double powers_of_ten[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+
+static inline bool is_digit(char c) {
+	return (unsigned char)(c - '0') < 10;
+}
+
+
+static inline const char *skip_spaces(const char *p, const char *end) {
+	while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+		p++;
+	}
+	return p;
+}
+
+
+// the plain decimals OBJ files hold, without strtof's locale and rounding
+// machinery: up to 19 significant digits gathered into an integer and scaled
+// once by an exact power of ten. inf, nan and extreme exponents go through
+// strtof. NULL when there is no number
+static const char *parse_float(const char *p, const char *end, float *out) {
+	const char *start = p;
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+')) {
+		negative = *p == '-';
+		p++;
+	}
+	uint64_t mantissa = 0;
+	int digits = 0;
+	int exponent = 0;
+	bool any = false;
+	for (; p < end && is_digit(*p); p++) {
+		any = true;
+		if (digits < 19) {
+			mantissa = mantissa * 10 + (*p - '0');
+			digits += mantissa != 0;
+		} else {
+			exponent++;
+		}
+	}
+	if (p < end && *p == '.') {
+		for (p++; p < end && is_digit(*p); p++) {
+			any = true;
+			if (digits < 19) {
+				mantissa = mantissa * 10 + (*p - '0');
+				digits += mantissa != 0;
+				exponent--;
+			}
+		}
+	}
+	if (any && p < end && (*p == 'e' || *p == 'E')) {
+		const char *e = p + 1;
+		bool negative_exponent = false;
+		if (e < end && (*e == '-' || *e == '+')) {
+			negative_exponent = *e == '-';
+			e++;
+		}
+		if (e < end && is_digit(*e)) {
+			int value = 0;
+			for (; e < end && is_digit(*e); e++) {
+				value = value < 10000 ? value * 10 + (*e - '0') : value;
+			}
+			exponent += negative_exponent ? -value : value;
+			p = e;
+		}
+	}
+
+	if (any && exponent >= -22 && exponent <= 22) {
+		double value = (double)mantissa;
+		value = exponent < 0 ? value / powers_of_ten[-exponent] : value * powers_of_ten[exponent];
+		*out = (float)(negative ? -value : value);
+		return p;
+	}
+
+	// the slow path needs its token terminated
+	char token[64];
+	size_t length = 0;
+	for (p = start; p < end && length < sizeof(token) - 1 && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n'
+			&& *p != '/'; p++) {
+		token[length++] = *p;
+	}
+	token[length] = '\0';
+	char *parsed;
+	*out = strtof(token, &parsed);
+	return parsed == token ? NULL : start + (parsed - token);
+}
+
+
+static const char *parse_int(const char *p, const char *end, int *out) {
+	bool negative = p < end && *p == '-';
+	if (p < end && (*p == '-' || *p == '+')) {
+		p++;
+	}
+	if (p >= end || !is_digit(*p)) {
+		return NULL;
+	}
+	long long value = 0;
+	for (; p < end && is_digit(*p); p++) {
+		value = value < INT_MAX ? value * 10 + (*p - '0') : value;
+	}
+	if (value > INT_MAX) {
+		return NULL;
+	}
+	*out = (int)(negative ? -value : value);
+	return p;
+}
+
+
+static const char *parse_floats(const char *p, const char *end, float *out, int count) {
+	for (int i = 0; i < count && p; i++) {
+		p = parse_float(skip_spaces(p, end), end, &out[i]);
+	}
+	return p;
+}
+
+
+// v, v/vt, v//vn or v/vt/vn
+static const char *parse_corner(const char *p, const char *end, const OBJ_CHUNK *chunk, OBJ_CORNER *corner) {
+	int counts[3] = { (int)chunk->positions.size(), (int)chunk->uvs.size(), (int)chunk->normals.size() };
+	corner->chunk_relative = 0;
+	for (int k = 0; k < 3; k++) {
+		corner->index[k] = OBJ_MISSING;
+		if (k > 0) {
+			if (p >= end || *p != '/') {
+				continue;
+			}
+			p++;
+			if (p < end && (*p == '/' || *p == ' ' || *p == '\t' || *p == '\r')) {
+				continue;
+			}
+		}
+		int index;
+		p = parse_int(p, end, &index);
+		if (!p || index == 0) {
+			return NULL;
+		}
+		if (index > 0) {
+			corner->index[k] = index - 1;
+		} else {
+			corner->index[k] = counts[k] + index;
+			corner->chunk_relative |= 1 << k;
+		}
+	}
+	return p;
+}
+
+
+static void parse_obj_chunk(OBJ_CHUNK *chunk) {
+	const char *end = chunk->end;
+	for (const char *line = chunk->begin; line < end && !chunk->bad_line;) {
+		const char *line_end = (const char *)memchr(line, '\n', end - line);
+		line_end = line_end ? line_end : end;
+		const char *p = skip_spaces(line, line_end);
+
+		bool parsed = true;
+		if (line_end - p > 2 && p[0] == 'v' && (p[1] == ' ' || p[1] == '\t')) {
+			glm::vec3 position;
+			parsed = parse_floats(p + 2, line_end, &position.x, 3) != NULL;
+			chunk->positions.push_back(position);
+		} else if (line_end - p > 3 && p[0] == 'v' && p[1] == 't' && (p[2] == ' ' || p[2] == '\t')) {
+			glm::vec2 uv(0.0f);
+			const char *v = parse_floats(p + 3, line_end, &uv.x, 1);
+			parsed = v != NULL;
+			if (v && !parse_floats(v, line_end, &uv.y, 1)) {
+				uv.y = 0.0f;	// v is optional
+			}
+			chunk->uvs.push_back(uv);
+		} else if (line_end - p > 3 && p[0] == 'v' && p[1] == 'n' && (p[2] == ' ' || p[2] == '\t')) {
+			glm::vec3 normal;
+			parsed = parse_floats(p + 3, line_end, &normal.x, 3) != NULL;
+			chunk->normals.push_back(normal);
+		} else if (line_end - p > 2 && p[0] == 'f' && (p[1] == ' ' || p[1] == '\t')) {
+			// a polygon becomes a fan around its first corner
+			OBJ_CORNER first, previous, corner;
+			int corners = 0;
+			p = skip_spaces(p + 2, line_end);
+			while (parsed && p < line_end) {
+				p = parse_corner(p, line_end, chunk, &corner);
+				parsed = p != NULL;
+				if (!parsed) {
+					break;
+				}
+				if (corners >= 2) {
+					chunk->corners.push_back(first);
+					chunk->corners.push_back(previous);
+					chunk->corners.push_back(corner);
+				}
+				if (!corners) {
+					first = corner;
+				}
+				previous = corner;
+				corners++;
+				p = skip_spaces(p, line_end);
+			}
+			parsed = parsed && corners >= 3;
+		}
+		if (!parsed) {
+			chunk->bad_line = line;
+		}
+		line = line_end + 1;
+	}
+}
+
+
+static void parse_obj_chunks(void *data, int begin, int end) {
+	OBJ_CHUNK *chunks = (OBJ_CHUNK *)data;
+	for (int i = begin; i < end; i++) {
+		parse_obj_chunk(&chunks[i]);
+	}
+}
+
+
+// chunk-relative indices become absolute, every index is checked, and the
+// chunk's corners land at their place in the merged list
+static void resolve_obj_chunks(void *data, int begin, int end) {
+	OBJ_MERGE *merge = (OBJ_MERGE *)data;
+	for (int i = begin; i < end; i++) {
+		OBJ_CHUNK *chunk = &merge->chunks[i];
+		chunk->all_uvs = true;
+		chunk->all_normals = true;
+		OBJ_CORNER *out = merge->corners->data() + chunk->first_corner;
+		for (size_t c = 0; c < chunk->corners.size(); c++) {
+			OBJ_CORNER corner = chunk->corners[c];
+			for (int k = 0; k < 3; k++) {
+				if (corner.index[k] == OBJ_MISSING) {
+					continue;
+				}
+				if (corner.chunk_relative & (1 << k)) {
+					corner.index[k] += chunk->bases[k];
+				}
+				if (corner.index[k] < 0 || corner.index[k] >= merge->totals[k]) {
+					chunk->bad_index = true;
+				}
+			}
+			corner.chunk_relative = 0;
+			chunk->all_uvs = chunk->all_uvs && corner.index[1] != OBJ_MISSING;
+			chunk->all_normals = chunk->all_normals && corner.index[2] != OBJ_MISSING;
+			out[c] = corner;
+		}
+	}
+}
+
+
+static inline uint32_t hash_key(const unsigned char *key, size_t size) {
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < size; i += 4) {
+		uint32_t word;
+		memcpy(&word, key + i, 4);
+		hash = (hash ^ word) * 0x5bd1e995u;
+		hash ^= hash >> 15;
+	}
+	return hash;
+}
+
+
+static void hash_keys(void *data, int begin, int end) {
+	KEY_HASHES *job = (KEY_HASHES *)data;
+	for (int i = begin; i < end; i++) {
+		job->hashes[i] = hash_key(job->keys + i * job->stride, job->key_size);
+	}
+}
+
+
+// maps every key to the first one bitwise equal to it: remap[i] is key i's
+// new index, firsts[n] the old index of new key n, in order of first
+// appearance. Hashing runs on the job system, the table fill does not
+static void weld_keys(const void *keys, size_t key_size, size_t stride, int count, std::vector<uint32_t> *remap,
+		std::vector<uint32_t> *firsts) {
+	const unsigned char *base = (const unsigned char *)keys;
+	std::vector<uint32_t> hashes(count);
+	KEY_HASHES job = { base, key_size, stride, hashes.data() };
+	parallel_for(count, IMPORT_BATCH, hash_keys, &job);
+
+	size_t table_size = 16;
+	while (table_size < (size_t)count * 2) {
+		table_size *= 2;
+	}
+	std::vector<uint32_t> table(table_size, UINT32_MAX);
+	remap->resize(count);
+	firsts->clear();
+	for (int i = 0; i < count; i++) {
+		size_t slot = hashes[i] & (table_size - 1);
+		while (true) {
+			uint32_t entry = table[slot];
+			if (entry == UINT32_MAX) {
+				entry = (uint32_t)firsts->size();
+				table[slot] = entry;
+				firsts->push_back(i);
+				break;
+			}
+			uint32_t first = (*firsts)[entry];
+			if (hashes[first] == hashes[i] && !memcmp(base + first * stride, base + i * stride, key_size)) {
+				break;
+			}
+			slot = (slot + 1) & (table_size - 1);
+		}
+		(*remap)[i] = table[slot];
+	}
+}
+
+
+typedef struct {
+	const OBJ_CORNER *corners;
+	const uint32_t *firsts;
+	const glm::vec3 *positions;
+	const glm::vec2 *uvs;
+	const glm::vec3 *normals;
+	LIT_VERTEX *vertices;
+} OBJ_VERTICES;
+
+
+static void build_obj_vertices(void *data, int begin, int end) {
+	OBJ_VERTICES *job = (OBJ_VERTICES *)data;
+	for (int i = begin; i < end; i++) {
+		const OBJ_CORNER *corner = &job->corners[job->firsts[i]];
+		LIT_VERTEX *vertex = &job->vertices[i];
+		vertex->position = job->positions[corner->index[0]];
+		vertex->uv = corner->index[1] != OBJ_MISSING ? job->uvs[corner->index[1]] : glm::vec2(0.0f);
+		vertex->normal = corner->index[2] != OBJ_MISSING ? job->normals[corner->index[2]] : glm::vec3(0.0f);
+		vertex->tangent = glm::vec4(0.0f);
+	}
+}
+
+
+bool import_obj(const char *text, size_t size, IMPORTED_MESH *mesh) {
+	// chunks start just past a line end so no line is split between two jobs
+	std::vector<OBJ_CHUNK> chunks;
+	const char *end = text + size;
+	for (const char *begin = text; begin < end;) {
+		const char *chunk_end = size_t(end - begin) > OBJ_CHUNK_SIZE ? begin + OBJ_CHUNK_SIZE : end;
+		const char *line_end = (const char *)memchr(chunk_end, '\n', end - chunk_end);
+		chunk_end = line_end ? line_end + 1 : end;
+		chunks.push_back({});
+		chunks.back().begin = begin;
+		chunks.back().end = chunk_end;
+		begin = chunk_end;
+	}
+	parallel_for((int)chunks.size(), 1, parse_obj_chunks, chunks.data());
+
+	OBJ_MERGE merge = { chunks.data(), { 0, 0, 0 }, NULL };
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec2> uvs;
+	std::vector<glm::vec3> normals;
+	int corner_count = 0;
+	for (OBJ_CHUNK &chunk : chunks) {
+		chunk.bases[0] = (int)positions.size();
+		chunk.bases[1] = (int)uvs.size();
+		chunk.bases[2] = (int)normals.size();
+		chunk.first_corner = corner_count;
+		positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+		uvs.insert(uvs.end(), chunk.uvs.begin(), chunk.uvs.end());
+		normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+		corner_count += (int)chunk.corners.size();
+		chunk.positions = std::vector<glm::vec3>();
+		chunk.uvs = std::vector<glm::vec2>();
+		chunk.normals = std::vector<glm::vec3>();
+	}
+	merge.totals[0] = (int)positions.size();
+	merge.totals[1] = (int)uvs.size();
+	merge.totals[2] = (int)normals.size();
+	std::vector<OBJ_CORNER> corners(corner_count);
+	merge.corners = &corners;
+	parallel_for((int)chunks.size(), 1, resolve_obj_chunks, &merge);
+
+	mesh->has_uvs = true;
+	mesh->has_normals = true;
+	mesh->has_tangents = false;
+	for (const OBJ_CHUNK &chunk : chunks) {
+		if (chunk.bad_line) {
+			int line = 1;
+			for (const char *p = text; (p = (const char *)memchr(p, '\n', chunk.bad_line - p)); p++) {
+				line++;
+			}
+			fprintf(stderr, "ERROR:MESH_IMPORT:OBJ_PARSE_FAILED line %d\n", line);
+			return false;
+		}
+		if (chunk.bad_index) {
+			fprintf(stderr, "ERROR:MESH_IMPORT:OBJ_INDEX_OUT_OF_RANGE\n");
+			return false;
+		}
+		mesh->has_uvs = mesh->has_uvs && chunk.all_uvs;
+		mesh->has_normals = mesh->has_normals && chunk.all_normals;
+	}
+	chunks.clear();
+	if (!corner_count) {
+		fprintf(stderr, "ERROR:MESH_IMPORT:NO_TRIANGLES\n");
+		return false;
+	}
+
+	// each distinct corner becomes one vertex
+	std::vector<uint32_t> firsts;
+	weld_keys(corners.data(), sizeof(corners[0].index), sizeof(OBJ_CORNER), corner_count, &mesh->indices, &firsts);
+	mesh->vertices.resize(firsts.size());
+	OBJ_VERTICES job = { corners.data(), firsts.data(), positions.data(), uvs.data(), normals.data(),
+			mesh->vertices.data() };
+	parallel_for((int)firsts.size(), IMPORT_BATCH, build_obj_vertices, &job);
+	return true;
+}
+
+
+void weld_vertices(IMPORTED_MESH *mesh) {
+	std::vector<uint32_t> remap, firsts;
+	weld_keys(mesh->vertices.data(), sizeof(LIT_VERTEX), sizeof(LIT_VERTEX), (int)mesh->vertices.size(), &remap,
+			&firsts);
+	if (firsts.size() == mesh->vertices.size()) {
+		return;
+	}
+	std::vector<LIT_VERTEX> welded(firsts.size());
+	for (size_t i = 0; i < firsts.size(); i++) {
+		welded[i] = mesh->vertices[firsts[i]];
+	}
+	mesh->vertices.swap(welded);
+	for (uint32_t &index : mesh->indices) {
+		index = remap[index];
+	}
+}
+
+
+static glm::vec3 any_perpendicular(glm::vec3 n) {
+	glm::vec3 axis = fabsf(n.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+	return glm::normalize(glm::cross(n, axis));
+}
+
+
+static void finish_normals(void *data, int begin, int end) {
+	VERTEX_PASS *pass = (VERTEX_PASS *)data;
+	for (int i = begin; i < end; i++) {
+		glm::vec3 sum = (*pass->accumulated)[pass->groups[i]];
+		float length = glm::length(sum);
+		pass->mesh->vertices[i].normal = length > 0.0f ? sum / length : glm::vec3(0.0f, 1.0f, 0.0f);
+	}
+}
+
+
+void generate_normals(IMPORTED_MESH *mesh) {
+	// vertices split only by their UVs still share a normal
+	std::vector<uint32_t> groups, firsts;
+	weld_keys(mesh->vertices.data(), sizeof(glm::vec3), sizeof(LIT_VERTEX), (int)mesh->vertices.size(), &groups,
+			&firsts);
+	std::vector<glm::vec3> accumulated(firsts.size(), glm::vec3(0.0f));
+	for (size_t t = 0; t + 2 < mesh->indices.size(); t += 3) {
+		const uint32_t *triangle = &mesh->indices[t];
+		glm::vec3 p0 = mesh->vertices[triangle[0]].position;
+		glm::vec3 face = glm::cross(mesh->vertices[triangle[1]].position - p0, mesh->vertices[triangle[2]].position - p0);
+		for (int k = 0; k < 3; k++) {
+			accumulated[groups[triangle[k]]] += face;
+		}
+	}
+	VERTEX_PASS pass = { mesh, &accumulated, NULL, groups.data() };
+	parallel_for((int)mesh->vertices.size(), IMPORT_BATCH, finish_normals, &pass);
+	mesh->has_normals = true;
+}
+
+
+static void finish_tangents(void *data, int begin, int end) {
+	VERTEX_PASS *pass = (VERTEX_PASS *)data;
+	for (int i = begin; i < end; i++) {
+		LIT_VERTEX *vertex = &pass->mesh->vertices[i];
+		glm::vec3 n = vertex->normal;
+		glm::vec3 t = (*pass->accumulated)[i] - n * glm::dot(n, (*pass->accumulated)[i]);
+		float length = glm::length(t);
+		t = length > 1e-8f ? t / length : any_perpendicular(n);
+		float handedness = glm::dot(glm::cross(n, t), (*pass->bitangents)[i]) < 0.0f ? -1.0f : 1.0f;
+		vertex->tangent = glm::vec4(t, handedness);
+	}
+}
+
+
+void generate_tangents(IMPORTED_MESH *mesh) {
+	std::vector<glm::vec3> tangents(mesh->vertices.size(), glm::vec3(0.0f));
+	std::vector<glm::vec3> bitangents(mesh->vertices.size(), glm::vec3(0.0f));
+	for (size_t t = 0; t + 2 < mesh->indices.size(); t += 3) {
+		const uint32_t *triangle = &mesh->indices[t];
+		const LIT_VERTEX *v0 = &mesh->vertices[triangle[0]];
+		const LIT_VERTEX *v1 = &mesh->vertices[triangle[1]];
+		const LIT_VERTEX *v2 = &mesh->vertices[triangle[2]];
+		glm::vec3 e1 = v1->position - v0->position;
+		glm::vec3 e2 = v2->position - v0->position;
+		glm::vec2 d1 = v1->uv - v0->uv;
+		glm::vec2 d2 = v2->uv - v0->uv;
+		float det = d1.x * d2.y - d2.x * d1.y;
+		if (fabsf(det) < 1e-12f) {
+			continue;
+		}
+		// left unnormalized so larger triangles weigh more
+		glm::vec3 s = (e1 * d2.y - e2 * d1.y) / det;
+		glm::vec3 b = (e2 * d1.x - e1 * d2.x) / det;
+		for (int k = 0; k < 3; k++) {
+			tangents[triangle[k]] += s;
+			bitangents[triangle[k]] += b;
+		}
+	}
+	VERTEX_PASS pass = { mesh, &tangents, &bitangents, NULL };
+	parallel_for((int)mesh->vertices.size(), IMPORT_BATCH, finish_tangents, &pass);
+	mesh->has_tangents = true;
+}
+
+
+void get_mesh_bounds(const IMPORTED_MESH *mesh, glm::vec3 *center, float *radius) {
+	if (mesh->vertices.empty()) {
+		*center = glm::vec3(0.0f);
+		*radius = 0.0f;
+		return;
+	}
+	glm::vec3 low = mesh->vertices[0].position;
+	glm::vec3 high = low;
+	for (const LIT_VERTEX &vertex : mesh->vertices) {
+		low = glm::min(low, vertex.position);
+		high = glm::max(high, vertex.position);
+	}
+	*center = (low + high) * 0.5f;
+	float farthest = 0.0f;
+	for (const LIT_VERTEX &vertex : mesh->vertices) {
+		glm::vec3 offset = vertex.position - *center;
+		farthest = fmaxf(farthest, glm::dot(offset, offset));
+	}
+	*radius = sqrtf(farthest);
+}
+
+
+bool import_mesh(const char *path, IMPORTED_MESH *mesh) {
+	const char *extension = strrchr(path, '.');
+	bool obj = extension && !strcasecmp(extension, ".obj");
+	bool gltf = extension && (!strcasecmp(extension, ".gltf") || !strcasecmp(extension, ".glb"));
+	if (!obj && !gltf) {
+		fprintf(stderr, "ERROR:MESH_IMPORT:UNKNOWN_FORMAT %s\n", path);
+		return false;
+	}
+
+	// mapped rather than read, the parsers only ever look at it once
+	int fd = open(path, O_RDONLY);
+	struct stat info;
+	if (fd < 0 || fstat(fd, &info) != 0 || info.st_size <= 0) {
+		fprintf(stderr, "ERROR:MESH_IMPORT:OPEN_FAILED %s\n", path);
+		if (fd >= 0) {
+			close(fd);
+		}
+		return false;
+	}
+	void *data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		fprintf(stderr, "ERROR:MESH_IMPORT:MAP_FAILED %s\n", path);
+		return false;
+	}
+	madvise(data, info.st_size, MADV_SEQUENTIAL);
+	bool imported = obj ? import_obj((const char *)data, info.st_size, mesh)
+			: import_gltf((const unsigned char *)data, info.st_size, path, mesh);
+	munmap(data, info.st_size);
+	if (!imported) {
+		fprintf(stderr, "ERROR:MESH_IMPORT:IMPORT_FAILED %s\n", path);
+		return false;
+	}
+
+	weld_vertices(mesh);
+	if (!mesh->has_normals) {
+		generate_normals(mesh);
+	}
+	if (!mesh->has_tangents) {
+		generate_tangents(mesh);
+	}
+	return true;
+}
+
+
+static bool write_padded(FILE *file, const void *data, size_t size, int64_t *written) {
+	static const unsigned char zeros[16] = {};
+	size_t padding = (16 - *written % 16) % 16;
+	bool ok = fwrite(zeros, 1, padding, file) == padding && fwrite(data, 1, size, file) == size;
+	*written += padding + size;
+	return ok;
+}
+
+
+bool cook_mesh(const IMPORTED_MESH *mesh, const char *out_path) {
+	if (mesh->vertices.size() > INT_MAX || mesh->indices.size() > INT_MAX) {
+		fprintf(stderr, "ERROR:MESH_IMPORT:TOO_LARGE %s\n", out_path);
+		return false;
+	}
+	FILE *file = fopen(out_path, "wb");
+	if (!file) {
+		fprintf(stderr, "ERROR:MESH_IMPORT:OPEN_FAILED %s\n", out_path);
+		return false;
+	}
+
+	MESH_FILE_HEADER header = {};
+	memcpy(header.magic, MESH_MAGIC, sizeof(MESH_MAGIC));
+	header.version = MESH_FILE_VERSION;
+	header.vertex_format = VERTEX_LIT;
+	header.vertex_stride = sizeof(LIT_VERTEX);
+	header.vertex_count = (int32_t)mesh->vertices.size();
+	header.index_count = (int32_t)mesh->indices.size();
+	size_t vertex_bytes = mesh->vertices.size() * sizeof(LIT_VERTEX);
+	header.vertex_offset = (sizeof(header) + 15) & ~(int64_t)15;
+	header.index_offset = (header.vertex_offset + vertex_bytes + 15) & ~(int64_t)15;
+	glm::vec3 center;
+	get_mesh_bounds(mesh, &center, &header.bounds_radius);
+	header.bounds_center[0] = center.x;
+	header.bounds_center[1] = center.y;
+	header.bounds_center[2] = center.z;
+
+	int64_t written = 0;
+	bool ok = write_padded(file, &header, sizeof(header), &written)
+			&& write_padded(file, mesh->vertices.data(), vertex_bytes, &written)
+			&& write_padded(file, mesh->indices.data(), mesh->indices.size() * sizeof(uint32_t), &written);
+	if (fclose(file) != 0 || !ok) {
+		fprintf(stderr, "ERROR:MESH_IMPORT:WRITE_FAILED %s\n", out_path);
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,95 @@
+#ifndef MESH_IMPORT_H
+#define MESH_IMPORT_H
+
+#include <glm/glm.hpp>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "mesh_pool.h"
+
+// default mesh import values
+const size_t OBJ_CHUNK_SIZE		= 256 << 10;	// bytes of OBJ text a job parses, cut at line ends
+const int IMPORT_BATCH			= 4096;			// vertices or corners per job elsewhere
+const int INDEX_CHECK_BATCH		= 64 << 10;		// indices a job range-checks in a cooked file
+const char MESH_MAGIC[4]		= { 'M', 'E', 'S', 'H' };
+const int32_t MESH_FILE_VERSION	= 1;
+
+// the VERTEX_LIT layout the mesh pool draws
+typedef struct {
+	glm::vec3 position;
+	glm::vec2 uv;
+	glm::vec3 normal;
+	glm::vec4 tangent;		// w is the bitangent's handedness
+} LIT_VERTEX;
+
+// indexed triangles on the CPU, as the importers hand them over
+typedef struct {
+	std::vector<LIT_VERTEX> vertices;
+	std::vector<uint32_t> indices;
+	bool has_uvs;
+	bool has_normals;
+	bool has_tangents;
+} IMPORTED_MESH;
+
+// Cooked mesh file: this header, then the vertices in vertex_format's layout
+// and the 32-bit indices, each at a 16-byte aligned offset. A loader maps the
+// file and hands both ranges straight to the GPU, with nothing to parse
+typedef struct {
+	char magic[4];
+	int32_t version;
+	int32_t vertex_format;		// VERTEX_FORMAT
+	int32_t vertex_stride;
+	int32_t vertex_count;
+	int32_t index_count;
+	int64_t vertex_offset;		// bytes from the start of the file
+	int64_t index_offset;
+	float bounds_center[3];
+	float bounds_radius;
+} MESH_FILE_HEADER;
+
+// a cooked file mapped read-only; the pointers stay valid until unmapped
+typedef struct {
+	void *map;
+	size_t map_size;
+	const MESH_FILE_HEADER *header;
+	const void *vertices;
+	const uint32_t *indices;
+} COOKED_MESH;
+
+
+// Wavefront OBJ text: v, vt, vn and f (polygons fanned into triangles, negative
+// indices allowed); everything else is skipped. The text is cut into chunks at
+// line ends and parsed on the job system, then every face corner becomes a
+// vertex and identical corners are welded
+bool import_obj(const char *text, size_t size, IMPORTED_MESH *mesh);
+// glTF 2.0, JSON (.gltf, buffers as files beside it or data URIs) or binary
+// (.glb). Every triangle primitive of the default scene's nodes is merged into
+// one mesh in world space; vertices and triangles are decoded in batches
+// across all primitives on the job system. path locates external buffers
+bool import_gltf(const unsigned char *data, size_t size, const char *path, IMPORTED_MESH *mesh);
+
+// merges vertices whose every attribute is bitwise equal and rewrites the indices
+void weld_vertices(IMPORTED_MESH *mesh);
+// area-weighted smooth normals, shared across UV seams by position
+void generate_normals(IMPORTED_MESH *mesh);
+// per-vertex tangent frames from the UV directions of the triangles around
+// each vertex, orthogonalized against the normal; needs normals
+void generate_tangents(IMPORTED_MESH *mesh);
+// sphere around the vertices: the box center and the farthest vertex from it
+void get_mesh_bounds(const IMPORTED_MESH *mesh, glm::vec3 *center, float *radius);
+
+// reads an .obj, .gltf or .glb by extension, then fills in whatever the file
+// lacked: normals, welding, tangents
+bool import_mesh(const char *path, IMPORTED_MESH *mesh);
+bool cook_mesh(const IMPORTED_MESH *mesh, const char *out_path);
+
+// checks the header, and every index against the vertex count
+bool map_cooked_mesh(const char *path, COOKED_MESH *cooked);
+void unmap_cooked_mesh(COOKED_MESH *cooked);
+// a cooked file, mapped and uploaded from the mapping, or a source file
+// imported first; radius, if given, gets the bounding radius around the
+// model's origin. Returns the mesh, or -1. GL thread only
+int load_mesh_file(MESH_POOL *pool, const char *path, float *radius = NULL);
+
+#endif
@@ -0,0 +1,308 @@
+#include "mesh_pool.h"
+#include <stdio.h>
+
+static const VERTEX_LAYOUT vertex_layouts[VERTEX_FORMAT_COUNT] = {
+	{ "pos_uv", 5 * sizeof(float), 2, { { 0, 3, 0 }, { 1, 2, 3 * sizeof(float) } } },
+	{ "lit", 12 * sizeof(float), 4,
+			{ { 0, 3, 0 }, { 1, 2, 3 * sizeof(float) }, { 7, 3, 5 * sizeof(float) }, { 8, 4, 8 * sizeof(float) } } }
+};
+
+// beyond this a unit offset times the stride may not fit the allocator's ints
+const int MESH_POOL_MAX_UNITS = 1 << 28;
+
+
+const VERTEX_LAYOUT *get_vertex_layout(VERTEX_FORMAT format) {
+	return &vertex_layouts[format];
+}
+
+
+// doubles, at least to minimum, until needed more units fit past capacity
+static int grown_capacity(int capacity, int needed, int minimum) {
+	long long grown = capacity * 2ll > minimum ? capacity * 2ll : minimum;
+	while (grown < (long long)capacity + needed) {
+		grown *= 2;
+	}
+	return grown > MESH_POOL_MAX_UNITS ? -1 : (int)grown;
+}
+
+
+// a bigger buffer holding the old one's contents; the old one is deleted
+static unsigned int resize_buffer(unsigned int old_buffer, GLsizeiptr old_size, GLsizeiptr size) {
+	unsigned int buffer;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, size, NULL, GL_STATIC_DRAW);
+	if (old_buffer) {
+		glBindBuffer(GL_COPY_READ_BUFFER, old_buffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, old_size);
+		glDeleteBuffers(1, &old_buffer);
+	}
+	return buffer;
+}
+
+
+static void point_store(VERTEX_STORE *store, const VERTEX_LAYOUT *layout) {
+	glBindVertexArray(store->VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, store->buffer);
+	for (int i = 0; i < layout->attribute_count; i++) {
+		const VERTEX_ATTRIBUTE *attribute = &layout->attributes[i];
+		glVertexAttribPointer(attribute->location, attribute->components, GL_FLOAT, GL_FALSE, layout->stride,
+				(void *)(size_t)attribute->offset);
+		glEnableVertexAttribArray(attribute->location);
+	}
+	glBindVertexArray(0);
+}
+
+
+static bool grow_store(MESH_POOL *pool, VERTEX_FORMAT format, int needed) {
+	VERTEX_STORE *store = &pool->stores[format];
+	const VERTEX_LAYOUT *layout = &vertex_layouts[format];
+	int old_capacity = store->vertices.capacity;
+	int capacity = grown_capacity(old_capacity, needed, MESH_POOL_VERTICES);
+	if (capacity < 0) {
+		fprintf(stderr, "ERROR:MESH_POOL:VERTICES:TOO_MANY\n");
+		return false;
+	}
+	store->buffer = resize_buffer(store->buffer, (GLsizeiptr)old_capacity * layout->stride,
+			(GLsizeiptr)capacity * layout->stride);
+	grow_range_allocator(&store->vertices, capacity);
+	point_store(store, layout);
+	if (old_capacity > 0) {
+		pool->grows++;
+	}
+	return true;
+}
+
+
+// the element buffer binding is VAO state, so every format's VAO is repointed
+static bool grow_indices(MESH_POOL *pool, int needed) {
+	int old_capacity = pool->indices.capacity;
+	int capacity = grown_capacity(old_capacity, needed, MESH_POOL_INDICES);
+	if (capacity < 0) {
+		fprintf(stderr, "ERROR:MESH_POOL:INDICES:TOO_MANY\n");
+		return false;
+	}
+	pool->index_buffer = resize_buffer(pool->index_buffer, (GLsizeiptr)old_capacity * sizeof(unsigned int),
+			(GLsizeiptr)capacity * sizeof(unsigned int));
+	grow_range_allocator(&pool->indices, capacity);
+	for (int format = 0; format < VERTEX_FORMAT_COUNT; format++) {
+		glBindVertexArray(pool->stores[format].VAO);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool->index_buffer);
+	}
+	glBindVertexArray(0);
+	pool->grows++;
+	return true;
+}
+
+
+void init_mesh_pool(MESH_POOL *pool, int index_capacity) {
+	for (int format = 0; format < VERTEX_FORMAT_COUNT; format++) {
+		VERTEX_STORE *store = &pool->stores[format];
+		glGenVertexArrays(1, &store->VAO);
+		store->buffer = 0;
+		init_range_allocator(&store->vertices, 0);
+	}
+	pool->index_buffer = 0;
+	init_range_allocator(&pool->indices, 0);
+	pool->scratch_buffer = 0;
+	pool->scratch_size = 0;
+	pool->meshes.clear();
+	pool->free_meshes.clear();
+	pool->grows = 0;
+	pool->moved_bytes = 0;
+
+	// the first allocation is not a grow
+	grow_indices(pool, index_capacity);
+	pool->grows = 0;
+}
+
+
+void destroy_mesh_pool(MESH_POOL *pool) {
+	for (int format = 0; format < VERTEX_FORMAT_COUNT; format++) {
+		VERTEX_STORE *store = &pool->stores[format];
+		glDeleteVertexArrays(1, &store->VAO);
+		if (store->buffer) {
+			glDeleteBuffers(1, &store->buffer);
+		}
+		store->VAO = 0;
+		store->buffer = 0;
+		init_range_allocator(&store->vertices, 0);
+	}
+	glDeleteBuffers(1, &pool->index_buffer);
+	if (pool->scratch_buffer) {
+		glDeleteBuffers(1, &pool->scratch_buffer);
+	}
+	pool->index_buffer = 0;
+	pool->scratch_buffer = 0;
+	pool->scratch_size = 0;
+	init_range_allocator(&pool->indices, 0);
+	pool->meshes.clear();
+	pool->free_meshes.clear();
+}
+
+
+int add_mesh(MESH_POOL *pool, VERTEX_FORMAT format, const void *vertices, int vertex_count,
+		const unsigned int *indices, int index_count) {
+	if (vertex_count <= 0) {
+		return -1;
+	}
+	std::vector<unsigned int> in_order;
+	if (!indices) {
+		in_order.resize(vertex_count);
+		for (int i = 0; i < vertex_count; i++) {
+			in_order[i] = i;
+		}
+		indices = in_order.data();
+		index_count = vertex_count;
+	}
+
+	int mesh;
+	if (!pool->free_meshes.empty()) {
+		mesh = pool->free_meshes.back();
+		pool->free_meshes.pop_back();
+	} else {
+		mesh = (int)pool->meshes.size();
+		pool->meshes.push_back({});
+	}
+
+	VERTEX_STORE *store = &pool->stores[format];
+	int vertex_block = range_alloc(&store->vertices, vertex_count, mesh);
+	if (vertex_block < 0 && grow_store(pool, format, vertex_count)) {
+		vertex_block = range_alloc(&store->vertices, vertex_count, mesh);
+	}
+	int index_block = range_alloc(&pool->indices, index_count, mesh);
+	if (index_block < 0 && grow_indices(pool, index_count)) {
+		index_block = range_alloc(&pool->indices, index_count, mesh);
+	}
+	if (vertex_block < 0 || index_block < 0) {
+		range_free(&store->vertices, vertex_block);
+		range_free(&pool->indices, index_block);
+		pool->meshes[mesh].vertex_block = -1;
+		pool->free_meshes.push_back(mesh);
+		return -1;
+	}
+
+	MESH_RECORD *record = &pool->meshes[mesh];
+	record->format = format;
+	record->vertex_block = vertex_block;
+	record->index_block = index_block;
+	record->base_vertex = get_range_offset(&store->vertices, vertex_block);
+	record->vertex_count = vertex_count;
+	record->first_index = get_range_offset(&pool->indices, index_block);
+	record->index_count = index_count;
+
+	int stride = vertex_layouts[format].stride;
+	glBindBuffer(GL_COPY_WRITE_BUFFER, store->buffer);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)record->base_vertex * stride, (GLsizeiptr)vertex_count * stride,
+			vertices);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, pool->index_buffer);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)record->first_index * sizeof(unsigned int),
+			(GLsizeiptr)index_count * sizeof(unsigned int), indices);
+	return mesh;
+}
+
+
+void remove_mesh(MESH_POOL *pool, int mesh) {
+	if (mesh < 0 || mesh >= (int)pool->meshes.size() || pool->meshes[mesh].vertex_block < 0) {
+		return;
+	}
+	MESH_RECORD *record = &pool->meshes[mesh];
+	range_free(&pool->stores[record->format].vertices, record->vertex_block);
+	range_free(&pool->indices, record->index_block);
+	record->vertex_block = -1;
+	record->index_block = -1;
+	pool->free_meshes.push_back(mesh);
+}
+
+
+void draw_mesh_instanced(const MESH_POOL *pool, int mesh, int instances) {
+	const MESH_RECORD *record = &pool->meshes[mesh];
+	glDrawElementsInstancedBaseVertex(GL_TRIANGLES, record->index_count, GL_UNSIGNED_INT,
+			(void *)((size_t)record->first_index * sizeof(unsigned int)), instances, record->base_vertex);
+}
+
+
+typedef struct {
+	MESH_POOL *pool;
+	unsigned int buffer;
+	int unit_size;
+	bool indices;		// moving index ranges, not vertex ranges
+} DEFRAG_PASS;
+
+
+// glCopyBufferSubData refuses overlapping ranges of one buffer, so those go
+// out to the scratch buffer and back
+static void copy_within(MESH_POOL *pool, unsigned int buffer, GLintptr from, GLintptr to, GLsizeiptr size) {
+	glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	if (to + size <= from) {
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, from, to, size);
+		return;
+	}
+	if (pool->scratch_size < size) {
+		if (pool->scratch_buffer) {
+			glDeleteBuffers(1, &pool->scratch_buffer);
+		}
+		glGenBuffers(1, &pool->scratch_buffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, pool->scratch_buffer);
+		glBufferData(GL_COPY_WRITE_BUFFER, size, NULL, GL_STREAM_COPY);
+		pool->scratch_size = size;
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, pool->scratch_buffer);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, from, 0, size);
+	glBindBuffer(GL_COPY_READ_BUFFER, pool->scratch_buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, to, size);
+}
+
+
+static void move_mesh_range(void *data, int owner, int from_offset, int to_offset, int size) {
+	DEFRAG_PASS *pass = (DEFRAG_PASS *)data;
+	copy_within(pass->pool, pass->buffer, (GLintptr)from_offset * pass->unit_size, (GLintptr)to_offset * pass->unit_size,
+			(GLsizeiptr)size * pass->unit_size);
+	if (pass->indices) {
+		pass->pool->meshes[owner].first_index = to_offset;
+	} else {
+		pass->pool->meshes[owner].base_vertex = to_offset;
+	}
+}
+
+
+// already-submitted draws read the old ranges first: GL orders the copies
+// after them
+GLsizeiptr defragment_mesh_pool(MESH_POOL *pool, GLsizeiptr max_bytes) {
+	GLsizeiptr moved = 0;
+	if (pool->indices.free_ranges > 1) {
+		DEFRAG_PASS pass = { pool, pool->index_buffer, (int)sizeof(unsigned int), true };
+		moved += (GLsizeiptr)compact_ranges(&pool->indices, (int)(max_bytes / pass.unit_size), move_mesh_range, &pass)
+				* pass.unit_size;
+	}
+	for (int format = 0; format < VERTEX_FORMAT_COUNT && moved < max_bytes; format++) {
+		VERTEX_STORE *store = &pool->stores[format];
+		if (store->vertices.free_ranges <= 1) {
+			continue;
+		}
+		DEFRAG_PASS pass = { pool, store->buffer, vertex_layouts[format].stride, false };
+		int max_units = (int)((max_bytes - moved) / pass.unit_size);
+		moved += (GLsizeiptr)compact_ranges(&store->vertices, max_units, move_mesh_range, &pass) * pass.unit_size;
+	}
+	pool->moved_bytes += moved;
+	return moved;
+}
+
+
+MESH_POOL_STATS get_mesh_pool_stats(const MESH_POOL *pool) {
+	MESH_POOL_STATS stats = {};
+	stats.meshes = (int)(pool->meshes.size() - pool->free_meshes.size());
+	for (int format = 0; format < VERTEX_FORMAT_COUNT; format++) {
+		stats.vertices[format] = get_range_stats(&pool->stores[format].vertices);
+		stats.used_bytes += (GLsizeiptr)stats.vertices[format].used * vertex_layouts[format].stride;
+		stats.buffer_bytes += (GLsizeiptr)stats.vertices[format].capacity * vertex_layouts[format].stride;
+	}
+	stats.indices = get_range_stats(&pool->indices);
+	stats.used_bytes += (GLsizeiptr)stats.indices.used * sizeof(unsigned int);
+	stats.buffer_bytes += (GLsizeiptr)stats.indices.capacity * sizeof(unsigned int);
+	stats.grows = pool->grows;
+	stats.moved_bytes = pool->moved_bytes;
+	return stats;
+}
@@ -0,0 +1,107 @@
+#ifndef MESH_POOL_H
+#define MESH_POOL_H
+
+#include <glad/glad.h>
+#include <vector>
+
+#include "range_allocator.h"
+
+// default mesh pool values
+const int MESH_POOL_VERTICES			= 1 << 16;		// per vertex format, on its first mesh
+const int MESH_POOL_INDICES				= 1 << 18;
+const GLsizeiptr MESH_DEFRAG_BUDGET		= 256 << 10;	// bytes defragment_mesh_pool moves per call
+
+enum VERTEX_FORMAT {
+	VERTEX_POS_UV,		// the cube's: position, texture coordinate
+	VERTEX_LIT,			// position, texture coordinate, normal, tangent with handedness in w
+	VERTEX_FORMAT_COUNT
+};
+
+// float attributes only; locations 2-6 are the instance attributes
+typedef struct {
+	int location;
+	int components;
+	int offset;
+} VERTEX_ATTRIBUTE;
+
+typedef struct {
+	const char *name;
+	int stride;
+	int attribute_count;
+	VERTEX_ATTRIBUTE attributes[4];
+} VERTEX_LAYOUT;
+
+// every mesh of one format: one buffer, one VAO pointing at it and at the
+// shared index buffer
+typedef struct {
+	unsigned int VAO;
+	unsigned int buffer;			// 0 until the format's first mesh
+	RANGE_ALLOCATOR vertices;
+} VERTEX_STORE;
+
+// indices are the mesh's own, from 0; the draw adds base_vertex
+typedef struct {
+	VERTEX_FORMAT format;
+	int vertex_block;				// -1 while the slot is free
+	int index_block;
+	int base_vertex;
+	int vertex_count;
+	int first_index;
+	int index_count;
+} MESH_RECORD;
+
+typedef struct {
+	int meshes;
+	RANGE_STATS vertices[VERTEX_FORMAT_COUNT];	// in vertices
+	RANGE_STATS indices;
+	GLsizeiptr used_bytes;
+	GLsizeiptr buffer_bytes;
+	int grows;
+	GLsizeiptr moved_bytes;						// by defragmentation, all time
+} MESH_POOL_STATS;
+
+// Static meshes sub-allocated from a few large buffers: a vertex buffer per
+// format and one index buffer, each managed by a range allocator and doubled
+// by copy when full. Every mesh of a format draws from the same VAO with
+// glDrawElementsBaseVertex, so switching meshes binds nothing. Meshes are
+// known by index, which stays valid until removed; defragmentation slides
+// them down inside their buffers and only their offsets change. GL thread only
+typedef struct {
+	VERTEX_STORE stores[VERTEX_FORMAT_COUNT];
+	unsigned int index_buffer;
+	RANGE_ALLOCATOR indices;
+	unsigned int scratch_buffer;	// overlapping moves go through here
+	GLsizeiptr scratch_size;
+	std::vector<MESH_RECORD> meshes;
+	std::vector<int> free_meshes;
+	int grows;
+	GLsizeiptr moved_bytes;
+} MESH_POOL;
+
+
+const VERTEX_LAYOUT *get_vertex_layout(VERTEX_FORMAT format);
+
+void init_mesh_pool(MESH_POOL *pool, int index_capacity = MESH_POOL_INDICES);
+void destroy_mesh_pool(MESH_POOL *pool);
+
+// vertices in the format's layout; indices NULL draws the vertices in order.
+// Returns the mesh, or -1 when a buffer could not grow to fit it
+int add_mesh(MESH_POOL *pool, VERTEX_FORMAT format, const void *vertices, int vertex_count,
+		const unsigned int *indices, int index_count);
+void remove_mesh(MESH_POOL *pool, int mesh);
+inline const MESH_RECORD *get_mesh(const MESH_POOL *pool, int mesh) {
+	return &pool->meshes[mesh];
+}
+inline unsigned int get_mesh_vao(const MESH_POOL *pool, int mesh) {
+	return pool->stores[pool->meshes[mesh].format].VAO;
+}
+// with get_mesh_vao bound
+void draw_mesh_instanced(const MESH_POOL *pool, int mesh, int instances);
+
+// compacts buffers with more than one free run, at most max_bytes of copying
+// a call; returns the bytes moved. Leaves GL_COPY_READ_BUFFER and
+// GL_COPY_WRITE_BUFFER bound
+GLsizeiptr defragment_mesh_pool(MESH_POOL *pool, GLsizeiptr max_bytes = MESH_DEFRAG_BUDGET);
+MESH_POOL_STATS get_mesh_pool_stats(const MESH_POOL *pool);
+
+#endif
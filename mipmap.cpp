@@ -0,0 +1,280 @@
+#include "mipmap.h"
+#include <glad/glad.h>
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "job_system.h"
+
+// linear values are re-encoded through a table this fine; 8-bit sRGB steps near
+// black are about 1/3300 apart in linear
+const int ENCODE_STEPS	= 16383;
+const int KAISER_TAPS	= 8;
+const float KAISER_ALPHA	= 4.0f;
+
+typedef struct {
+	float srgb_to_linear[256];
+	float unorm_to_float[256];
+	unsigned char linear_to_srgb[ENCODE_STEPS + 1];
+	unsigned char float_to_unorm[ENCODE_STEPS + 1];
+	float kaiser[KAISER_TAPS];
+} MIP_TABLES;
+
+
+static float bessel_i0(float x) {
+	float sum = 1.0f, term = 1.0f;
+	for (int k = 1; k < 20; k++) {
+		term *= (x / (2.0f * k)) * (x / (2.0f * k));
+		sum += term;
+	}
+	return sum;
+}
+
+
+static MIP_TABLES make_tables() {
+	MIP_TABLES tables;
+	for (int i = 0; i < 256; i++) {
+		float c = i / 255.0f;
+		tables.srgb_to_linear[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+		tables.unorm_to_float[i] = c;
+	}
+	for (int i = 0; i <= ENCODE_STEPS; i++) {
+		float l = (float)i / ENCODE_STEPS;
+		float s = l <= 0.0031308f ? l * 12.92f : 1.055f * powf(l, 1.0f / 2.4f) - 0.055f;
+		tables.linear_to_srgb[i] = (unsigned char)(s * 255.0f + 0.5f);
+		tables.float_to_unorm[i] = (unsigned char)(l * 255.0f + 0.5f);
+	}
+
+	// taps sit 0.5, 1.5, 2.5 and 3.5 source texels either side of the output centre
+	float total = 0.0f;
+	for (int i = 0; i < KAISER_TAPS; i++) {
+		float d = i - (KAISER_TAPS - 1) * 0.5f;
+		float x = (float)M_PI * d * 0.5f;
+		float sinc = sinf(x) / x;
+		float t = d / (KAISER_TAPS * 0.5f);
+		tables.kaiser[i] = sinc * bessel_i0(KAISER_ALPHA * sqrtf(1.0f - t * t)) / bessel_i0(KAISER_ALPHA);
+		total += tables.kaiser[i];
+	}
+	for (int i = 0; i < KAISER_TAPS; i++) {
+		tables.kaiser[i] /= total;
+	}
+	return tables;
+}
+
+
+static const MIP_TABLES *get_tables() {
+	static const MIP_TABLES tables = make_tables();
+	return &tables;
+}
+
+
+// one RGBA texel as four floats; SSE2 when the target has it
+#ifdef __SSE2__
+typedef __m128 TEXEL;
+static inline TEXEL texel_zero() { return _mm_setzero_ps(); }
+static inline TEXEL texel_add(TEXEL a, TEXEL b) { return _mm_add_ps(a, b); }
+static inline TEXEL texel_scale(TEXEL a, float s) { return _mm_mul_ps(a, _mm_set1_ps(s)); }
+static inline TEXEL texel_load(const float *p) { return _mm_loadu_ps(p); }
+static inline void texel_store(float *p, TEXEL a) { _mm_storeu_ps(p, a); }
+static inline void texel_indices(TEXEL a, int *out) {
+	a = _mm_min_ps(_mm_max_ps(a, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+	_mm_storeu_si128((__m128i *)out, _mm_cvtps_epi32(_mm_mul_ps(a, _mm_set1_ps((float)ENCODE_STEPS))));
+}
+#else
+typedef struct { float v[4]; } TEXEL;
+static inline TEXEL texel_zero() { return { { 0.0f, 0.0f, 0.0f, 0.0f } }; }
+static inline TEXEL texel_add(TEXEL a, TEXEL b) {
+	return { { a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3] } };
+}
+static inline TEXEL texel_scale(TEXEL a, float s) { return { { a.v[0] * s, a.v[1] * s, a.v[2] * s, a.v[3] * s } }; }
+static inline TEXEL texel_load(const float *p) { return { { p[0], p[1], p[2], p[3] } }; }
+static inline void texel_store(float *p, TEXEL a) { memcpy(p, a.v, sizeof(a.v)); }
+static inline void texel_indices(TEXEL a, int *out) {
+	for (int c = 0; c < 4; c++) {
+		float v = a.v[c] < 0.0f ? 0.0f : (a.v[c] > 1.0f ? 1.0f : a.v[c]);
+		out[c] = (int)(v * ENCODE_STEPS + 0.5f);
+	}
+}
+#endif
+
+
+typedef struct {
+	const MIP_TABLES *tables;
+	const float *color_decode;
+	const unsigned char *color_encode;
+	const unsigned char *src;
+	int src_width;
+	int src_height;
+	unsigned char *dst;
+	int dst_width;
+} MIP_LEVEL_JOB;
+
+
+static inline TEXEL decode_texel(const MIP_LEVEL_JOB *job, const unsigned char *p) {
+	float texel[4] = {
+		job->color_decode[p[0]], job->color_decode[p[1]], job->color_decode[p[2]],
+		job->tables->unorm_to_float[p[3]]
+	};
+	return texel_load(texel);
+}
+
+
+static inline void encode_texel(const MIP_LEVEL_JOB *job, unsigned char *p, TEXEL texel) {
+	int index[4];
+	texel_indices(texel, index);
+	p[0] = job->color_encode[index[0]];
+	p[1] = job->color_encode[index[1]];
+	p[2] = job->color_encode[index[2]];
+	p[3] = job->tables->float_to_unorm[index[3]];
+}
+
+
+static inline int clamp_index(int i, int size) {
+	return i < 0 ? 0 : (i >= size ? size - 1 : i);
+}
+
+
+static void box_rows(void *data, int begin, int end) {
+	const MIP_LEVEL_JOB *job = (const MIP_LEVEL_JOB *)data;
+	for (int y = begin; y < end; y++) {
+		// odd sizes clamp, so the last row or column is counted twice
+		const unsigned char *row0 = job->src + (size_t)clamp_index(2 * y, job->src_height) * job->src_width * 4;
+		const unsigned char *row1 = job->src + (size_t)clamp_index(2 * y + 1, job->src_height) * job->src_width * 4;
+		unsigned char *out = job->dst + (size_t)y * job->dst_width * 4;
+
+		for (int x = 0; x < job->dst_width; x++) {
+			int x0 = clamp_index(2 * x, job->src_width) * 4;
+			int x1 = clamp_index(2 * x + 1, job->src_width) * 4;
+			TEXEL sum = texel_add(texel_add(decode_texel(job, row0 + x0), decode_texel(job, row0 + x1)),
+					texel_add(decode_texel(job, row1 + x0), decode_texel(job, row1 + x1)));
+			encode_texel(job, out + 4 * x, texel_scale(sum, 0.25f));
+		}
+	}
+}
+
+
+// separable: each source row is decoded and filtered horizontally once per
+// batch into a ring of KAISER_TAPS rows, then the ring is combined vertically
+static void kaiser_rows(void *data, int begin, int end) {
+	const MIP_LEVEL_JOB *job = (const MIP_LEVEL_JOB *)data;
+	const float *weights = job->tables->kaiser;
+	int half = KAISER_TAPS / 2;
+
+	std::vector<float> decoded((size_t)job->src_width * 4);
+	std::vector<float> ring((size_t)KAISER_TAPS * job->dst_width * 4);
+	int ring_row[KAISER_TAPS];
+	for (int i = 0; i < KAISER_TAPS; i++) ring_row[i] = INT_MIN;
+
+	for (int y = begin; y < end; y++) {
+		int first = 2 * y - half + 1;
+		for (int r = first; r < first + KAISER_TAPS; r++) {
+			int slot = r & (KAISER_TAPS - 1);
+			if (ring_row[slot] == r) {
+				continue;
+			}
+			ring_row[slot] = r;
+
+			const unsigned char *src = job->src + (size_t)clamp_index(r, job->src_height) * job->src_width * 4;
+			for (int x = 0; x < job->src_width; x++) {
+				texel_store(&decoded[(size_t)x * 4], decode_texel(job, src + 4 * x));
+			}
+			float *filtered = &ring[(size_t)slot * job->dst_width * 4];
+			for (int x = 0; x < job->dst_width; x++) {
+				TEXEL sum = texel_zero();
+				for (int i = 0; i < KAISER_TAPS; i++) {
+					int sx = clamp_index(2 * x - half + 1 + i, job->src_width);
+					sum = texel_add(sum, texel_scale(texel_load(&decoded[(size_t)sx * 4]), weights[i]));
+				}
+				texel_store(filtered + (size_t)x * 4, sum);
+			}
+		}
+
+		unsigned char *out = job->dst + (size_t)y * job->dst_width * 4;
+		for (int x = 0; x < job->dst_width; x++) {
+			TEXEL sum = texel_zero();
+			for (int i = 0; i < KAISER_TAPS; i++) {
+				int slot = (first + i) & (KAISER_TAPS - 1);
+				sum = texel_add(sum, texel_scale(texel_load(&ring[((size_t)slot * job->dst_width + x) * 4]), weights[i]));
+			}
+			encode_texel(job, out + 4 * x, sum);
+		}
+	}
+}
+
+
+bool build_mip_chain(MIP_CHAIN *chain, const unsigned char *pixels, int width, int height, int channels,
+		MIP_FILTER filter, bool srgb) {
+	if (channels < 1 || channels > 4 || width <= 0 || height <= 0) {
+		fprintf(stderr, "ERROR:MIPMAP:BAD_IMAGE\n");
+		return false;
+	}
+
+	// lay out every level first so the whole chain is one allocation
+	size_t total = 0;
+	int w = width, h = height;
+	chain->levels = 0;
+	while (chain->levels < MAX_MIP_LEVELS) {
+		chain->width[chain->levels] = w;
+		chain->height[chain->levels] = h;
+		chain->offset[chain->levels] = total;
+		chain->levels++;
+		total += (size_t)w * h * 4;
+		if (w == 1 && h == 1) {
+			break;
+		}
+		w = w > 1 ? w / 2 : 1;
+		h = h > 1 ? h / 2 : 1;
+	}
+	chain->pixels.resize(total);
+
+	unsigned char *base = chain->pixels.data();
+	size_t texels = (size_t)width * height;
+	for (size_t i = 0; i < texels; i++) {
+		const unsigned char *src = pixels + i * channels;
+		unsigned char *dst = base + i * 4;
+		switch (channels) {
+			case 1: dst[0] = dst[1] = dst[2] = src[0]; dst[3] = 255; break;
+			case 2: dst[0] = dst[1] = dst[2] = src[0]; dst[3] = src[1]; break;
+			case 3: dst[0] = src[0]; dst[1] = src[1]; dst[2] = src[2]; dst[3] = 255; break;
+			case 4: memcpy(dst, src, 4); break;
+		}
+	}
+
+	const MIP_TABLES *tables = get_tables();
+	for (int level = 1; level < chain->levels; level++) {
+		MIP_LEVEL_JOB job;
+		job.tables = tables;
+		job.color_decode = srgb ? tables->srgb_to_linear : tables->unorm_to_float;
+		job.color_encode = srgb ? tables->linear_to_srgb : tables->float_to_unorm;
+		job.src = base + chain->offset[level - 1];
+		job.src_width = chain->width[level - 1];
+		job.src_height = chain->height[level - 1];
+		job.dst = base + chain->offset[level];
+		job.dst_width = chain->width[level];
+
+		parallel_for(chain->height[level], MIP_ROW_BATCH, filter == MIP_KAISER ? kaiser_rows : box_rows, &job);
+	}
+	return true;
+}
+
+
+void build_mip_chain_job(void *data) {
+	MIP_BUILD *build = (MIP_BUILD *)data;
+	build->built = build_mip_chain(build->chain, build->pixels, build->width, build->height, build->channels);
+}
+
+
+void upload_mip_chain(const MIP_CHAIN *chain, bool srgb_texture) {
+	GLint internal_format = srgb_texture ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+	for (int level = 0; level < chain->levels; level++) {
+		glTexImage2D(GL_TEXTURE_2D, level, internal_format, chain->width[level], chain->height[level], 0,
+				GL_RGBA, GL_UNSIGNED_BYTE, get_mip_level(chain, level));
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, chain->levels - 1);
+}
@@ -0,0 +1,53 @@
+#ifndef MIPMAP_H
+#define MIPMAP_H
+
+#include <stddef.h>
+#include <vector>
+
+enum MIP_FILTER {
+	MIP_BOX,		// 2x2 average, what glGenerateMipmap does
+	MIP_KAISER		// 8x8 Kaiser-windowed sinc, sharper and less aliased
+};
+
+// default mipmap values
+const int MAX_MIP_LEVELS	= 16;
+const int MIP_ROW_BATCH		= 16;	// output rows per job
+
+// an RGBA8 image and its full mip chain, levels packed back to back
+typedef struct {
+	int levels;
+	int width[MAX_MIP_LEVELS];
+	int height[MAX_MIP_LEVELS];
+	size_t offset[MAX_MIP_LEVELS];
+	std::vector<unsigned char> pixels;
+} MIP_CHAIN;
+
+
+// build_mip_chain's arguments and result, to run it as a job
+typedef struct {
+	MIP_CHAIN *chain;
+	const unsigned char *pixels;
+	int width;
+	int height;
+	int channels;
+	bool built;
+} MIP_BUILD;
+
+
+// any thread, no GL: expands to RGBA8 and filters every level from the one
+// above it. With srgb set, colour is averaged in linear space and re-encoded;
+// alpha is always linear. Each level's rows are split over the job system;
+// a caller that is not a worker sits idle while they run
+bool build_mip_chain(MIP_CHAIN *chain, const unsigned char *pixels, int width, int height, int channels,
+		MIP_FILTER filter = MIP_BOX, bool srgb = true);
+// a JOB_FUNC taking a MIP_BUILD: box filtered, srgb
+void build_mip_chain_job(void *data);
+
+// GL thread: specifies every level of the bound GL_TEXTURE_2D
+void upload_mip_chain(const MIP_CHAIN *chain, bool srgb_texture = false);
+
+inline const unsigned char *get_mip_level(const MIP_CHAIN *chain, int level) {
+	return chain->pixels.data() + chain->offset[level];
+}
+
+#endif
@@ -0,0 +1,66 @@
+#include "pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+
+void init_pool(POOL *pool, size_t block_size, size_t alignment, int page_blocks) {
+	if (alignment < sizeof(void *)) alignment = sizeof(void *);
+	pool->block_size = (block_size + alignment - 1) & ~(alignment - 1);
+	pool->alignment = alignment;
+	pool->page_blocks = page_blocks > 0 ? page_blocks : 1;
+	pool->pages.clear();
+	pool->free_list = NULL;
+	pool->stats = {};
+}
+
+
+void destroy_pool(POOL *pool) {
+	for (void *page : pool->pages) {
+		free(page);
+	}
+	pool->pages.clear();
+	pool->free_list = NULL;
+	pool->stats = {};
+}
+
+
+// threads the new page's blocks onto the free list, first block first
+static bool grow_pool(POOL *pool) {
+	unsigned char *page = (unsigned char *)aligned_alloc(pool->alignment, pool->block_size * pool->page_blocks);
+	if (!page) {
+		fprintf(stderr, "ERROR:POOL:ALLOCATION:FAILED\n");
+		return false;
+	}
+	pool->pages.push_back(page);
+	pool->stats.pages++;
+	for (int i = pool->page_blocks - 1; i >= 0; i--) {
+		void *block = page + i * pool->block_size;
+		*(void **)block = pool->free_list;
+		pool->free_list = block;
+	}
+	return true;
+}
+
+
+void *pool_alloc(POOL *pool) {
+	if (!pool->free_list && !grow_pool(pool)) {
+		return NULL;
+	}
+	void *block = pool->free_list;
+	pool->free_list = *(void **)block;
+	pool->stats.allocations++;
+	if (++pool->stats.live > pool->stats.high_water) {
+		pool->stats.high_water = pool->stats.live;
+	}
+	return block;
+}
+
+
+void pool_free(POOL *pool, void *block) {
+	if (!block) {
+		return;
+	}
+	*(void **)block = pool->free_list;
+	pool->free_list = block;
+	pool->stats.live--;
+}
@@ -0,0 +1,37 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+#include <vector>
+
+// default pool values
+const int POOL_PAGE_BLOCKS = 64;	// blocks per page the pool grows by
+
+typedef struct {
+	int live;			// blocks handed out and not yet freed
+	int high_water;		// most blocks live at once
+	int allocations;
+	int pages;			// heap allocations the pool has made
+} POOL_STATS;
+
+// Fixed-size blocks carved from pages that are never given back until the
+// pool is destroyed; freed blocks go on a list and are handed out again first,
+// so a steady churn of objects costs no heap calls. One thread at a time
+typedef struct {
+	size_t block_size;
+	size_t alignment;
+	int page_blocks;
+	std::vector<void *> pages;
+	void *free_list;		// each free block holds the next one
+	POOL_STATS stats;
+} POOL;
+
+
+// block_size is rounded up to a multiple of alignment, a power of two
+void init_pool(POOL *pool, size_t block_size, size_t alignment = sizeof(void *), int page_blocks = POOL_PAGE_BLOCKS);
+void destroy_pool(POOL *pool);
+// NULL only when the heap is out of memory
+void *pool_alloc(POOL *pool);
+void pool_free(POOL *pool, void *block);
+
+#endif
@@ -0,0 +1,310 @@
+#include "range_allocator.h"
+
+
+static inline int highest_bit(unsigned int value) {
+	return 31 - __builtin_clz(value);
+}
+
+
+static inline int lowest_bit(unsigned int value) {
+	return __builtin_ctz(value);
+}
+
+
+// the bin a free run of size units is filed under
+static void size_class(int size, int *fl, int *sl) {
+	if (size < RANGE_SL_COUNT) {
+		*fl = 0;
+		*sl = size;
+		return;
+	}
+	int top = highest_bit(size);
+	*fl = top - RANGE_SL_LOG2 + 1;
+	*sl = (size >> (top - RANGE_SL_LOG2)) - RANGE_SL_COUNT;
+}
+
+
+static int new_block(RANGE_ALLOCATOR *allocator) {
+	if (!allocator->unused_blocks.empty()) {
+		int block = allocator->unused_blocks.back();
+		allocator->unused_blocks.pop_back();
+		return block;
+	}
+	allocator->blocks.push_back({});
+	return (int)allocator->blocks.size() - 1;
+}
+
+
+static void insert_free(RANGE_ALLOCATOR *allocator, int block) {
+	int fl, sl;
+	size_class(allocator->blocks[block].size, &fl, &sl);
+	RANGE_BLOCK *b = &allocator->blocks[block];
+	b->free = true;
+	b->prev_free = -1;
+	b->next_free = allocator->free_heads[fl][sl];
+	if (b->next_free >= 0) {
+		allocator->blocks[b->next_free].prev_free = block;
+	}
+	allocator->free_heads[fl][sl] = block;
+	allocator->fl_bitmap |= 1u << fl;
+	allocator->sl_bitmaps[fl] |= 1u << sl;
+	allocator->free_ranges++;
+}
+
+
+static void remove_free(RANGE_ALLOCATOR *allocator, int block) {
+	int fl, sl;
+	RANGE_BLOCK *b = &allocator->blocks[block];
+	size_class(b->size, &fl, &sl);
+	if (b->prev_free >= 0) {
+		allocator->blocks[b->prev_free].next_free = b->next_free;
+	} else {
+		allocator->free_heads[fl][sl] = b->next_free;
+	}
+	if (b->next_free >= 0) {
+		allocator->blocks[b->next_free].prev_free = b->prev_free;
+	}
+	if (allocator->free_heads[fl][sl] < 0) {
+		allocator->sl_bitmaps[fl] &= ~(1u << sl);
+		if (!allocator->sl_bitmaps[fl]) {
+			allocator->fl_bitmap &= ~(1u << fl);
+		}
+	}
+	b->free = false;
+	allocator->free_ranges--;
+}
+
+
+// a free run of at least size: the first non-empty bin whose smallest run is
+// still big enough, so the bin's head always fits
+static int find_free(const RANGE_ALLOCATOR *allocator, int size) {
+	if (size >= RANGE_SL_COUNT) {
+		long long rounded = size + (1ll << (highest_bit(size) - RANGE_SL_LOG2)) - 1;
+		if (rounded > 0x7fffffff) {
+			return -1;
+		}
+		size = (int)rounded;
+	}
+	int fl, sl;
+	size_class(size, &fl, &sl);
+	if (fl >= RANGE_FL_COUNT) {
+		return -1;
+	}
+
+	unsigned int sl_map = allocator->sl_bitmaps[fl] & (~0u << sl);
+	if (!sl_map) {
+		unsigned int fl_map = fl + 1 < 32 ? allocator->fl_bitmap & (~0u << (fl + 1)) : 0;
+		if (!fl_map) {
+			return -1;
+		}
+		fl = lowest_bit(fl_map);
+		sl_map = allocator->sl_bitmaps[fl];
+	}
+	return allocator->free_heads[fl][lowest_bit(sl_map)];
+}
+
+
+// takes next's units into block and gives next's record back
+static void absorb_next(RANGE_ALLOCATOR *allocator, int block, int next) {
+	RANGE_BLOCK *b = &allocator->blocks[block];
+	RANGE_BLOCK *n = &allocator->blocks[next];
+	b->size += n->size;
+	b->next_range = n->next_range;
+	if (b->next_range >= 0) {
+		allocator->blocks[b->next_range].prev_range = block;
+	} else {
+		allocator->last_range = block;
+	}
+	allocator->unused_blocks.push_back(next);
+}
+
+
+void init_range_allocator(RANGE_ALLOCATOR *allocator, int capacity) {
+	allocator->capacity = 0;
+	allocator->blocks.clear();
+	allocator->unused_blocks.clear();
+	allocator->first_range = -1;
+	allocator->last_range = -1;
+	allocator->fl_bitmap = 0;
+	for (int fl = 0; fl < RANGE_FL_COUNT; fl++) {
+		allocator->sl_bitmaps[fl] = 0;
+		for (int sl = 0; sl < RANGE_SL_COUNT; sl++) {
+			allocator->free_heads[fl][sl] = -1;
+		}
+	}
+	allocator->used = 0;
+	allocator->live = 0;
+	allocator->free_ranges = 0;
+	grow_range_allocator(allocator, capacity);
+}
+
+
+void grow_range_allocator(RANGE_ALLOCATOR *allocator, int capacity) {
+	int extra = capacity - allocator->capacity;
+	if (extra <= 0) {
+		return;
+	}
+	int last = allocator->last_range;
+	if (last >= 0 && allocator->blocks[last].free) {
+		remove_free(allocator, last);
+		allocator->blocks[last].size += extra;
+		insert_free(allocator, last);
+	} else {
+		int block = new_block(allocator);
+		RANGE_BLOCK *b = &allocator->blocks[block];
+		b->offset = allocator->capacity;
+		b->size = extra;
+		b->owner = -1;
+		b->prev_range = last;
+		b->next_range = -1;
+		if (last >= 0) {
+			allocator->blocks[last].next_range = block;
+		} else {
+			allocator->first_range = block;
+		}
+		allocator->last_range = block;
+		insert_free(allocator, block);
+	}
+	allocator->capacity = capacity;
+}
+
+
+int range_alloc(RANGE_ALLOCATOR *allocator, int size, int owner) {
+	if (size <= 0) {
+		return -1;
+	}
+	int block = find_free(allocator, size);
+	if (block < 0) {
+		return -1;
+	}
+	remove_free(allocator, block);
+
+	// the tail goes back as a free run of its own
+	if (allocator->blocks[block].size > size) {
+		int rest = new_block(allocator);
+		RANGE_BLOCK *b = &allocator->blocks[block];
+		RANGE_BLOCK *r = &allocator->blocks[rest];
+		r->offset = b->offset + size;
+		r->size = b->size - size;
+		r->owner = -1;
+		r->prev_range = block;
+		r->next_range = b->next_range;
+		if (r->next_range >= 0) {
+			allocator->blocks[r->next_range].prev_range = rest;
+		} else {
+			allocator->last_range = rest;
+		}
+		b->next_range = rest;
+		b->size = size;
+		insert_free(allocator, rest);
+	}
+
+	allocator->blocks[block].owner = owner;
+	allocator->used += size;
+	allocator->live++;
+	return block;
+}
+
+
+void range_free(RANGE_ALLOCATOR *allocator, int block) {
+	if (block < 0 || allocator->blocks[block].free) {
+		return;
+	}
+	allocator->used -= allocator->blocks[block].size;
+	allocator->live--;
+
+	int prev = allocator->blocks[block].prev_range;
+	if (prev >= 0 && allocator->blocks[prev].free) {
+		remove_free(allocator, prev);
+		absorb_next(allocator, prev, block);
+		block = prev;
+	}
+	int next = allocator->blocks[block].next_range;
+	if (next >= 0 && allocator->blocks[next].free) {
+		remove_free(allocator, next);
+		absorb_next(allocator, block, next);
+	}
+	allocator->blocks[block].owner = -1;
+	insert_free(allocator, block);
+}
+
+
+// the lowest free run, or -1 when there is none
+static int first_free(const RANGE_ALLOCATOR *allocator) {
+	for (int block = allocator->first_range; block >= 0; block = allocator->blocks[block].next_range) {
+		if (allocator->blocks[block].free) {
+			return block;
+		}
+	}
+	return -1;
+}
+
+
+int compact_ranges(RANGE_ALLOCATOR *allocator, int max_units, RANGE_MOVE_FUNC move, void *data) {
+	int moved = 0;
+	int hole = first_free(allocator);
+	while (hole >= 0 && moved < max_units) {
+		int live = allocator->blocks[hole].next_range;
+		if (live < 0) {
+			break;
+		}
+		RANGE_BLOCK *h = &allocator->blocks[hole];
+		RANGE_BLOCK *b = &allocator->blocks[live];
+		move(data, b->owner, b->offset, h->offset, b->size);
+		moved += b->size;
+
+		// swap the two in offset order: prev, hole, live, next -> prev, live, hole, next
+		int prev = h->prev_range;
+		int next = b->next_range;
+		b->offset = h->offset;
+		h->offset = b->offset + b->size;
+		b->prev_range = prev;
+		b->next_range = hole;
+		h->prev_range = live;
+		h->next_range = next;
+		if (prev >= 0) {
+			allocator->blocks[prev].next_range = live;
+		} else {
+			allocator->first_range = live;
+		}
+		if (next >= 0) {
+			allocator->blocks[next].prev_range = hole;
+		} else {
+			allocator->last_range = hole;
+		}
+
+		// the hole now touches the next free run, if any
+		if (next >= 0 && allocator->blocks[next].free) {
+			remove_free(allocator, hole);
+			remove_free(allocator, next);
+			absorb_next(allocator, hole, next);
+			insert_free(allocator, hole);
+		}
+	}
+	return moved;
+}
+
+
+RANGE_STATS get_range_stats(const RANGE_ALLOCATOR *allocator) {
+	RANGE_STATS stats = {};
+	stats.capacity = allocator->capacity;
+	stats.used = allocator->used;
+	stats.live = allocator->live;
+	stats.free_ranges = allocator->free_ranges;
+	for (int block = allocator->last_range; block >= 0; block = allocator->blocks[block].prev_range) {
+		const RANGE_BLOCK *b = &allocator->blocks[block];
+		if (b->free && b->size > stats.largest_free) {
+			stats.largest_free = b->size;
+		}
+	}
+	return stats;
+}
+
+
+float get_range_fragmentation(const RANGE_STATS *stats) {
+	int free_units = stats->capacity - stats->used;
+	if (free_units <= 0) {
+		return 0.0f;
+	}
+	return 1.0f - (float)stats->largest_free / free_units;
+}
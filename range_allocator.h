@@ -0,0 +1,74 @@
+#ifndef RANGE_ALLOCATOR_H
+#define RANGE_ALLOCATOR_H
+
+#include <vector>
+
+// default range allocator values
+const int RANGE_SL_LOG2		= 4;	// each power of two split into 16 size classes
+const int RANGE_SL_COUNT	= 1 << RANGE_SL_LOG2;
+const int RANGE_FL_COUNT	= 32 - RANGE_SL_LOG2;
+
+// a run of units, live or free; free runs never sit next to each other
+typedef struct {
+	int offset;
+	int size;
+	int owner;				// the caller's, passed to RANGE_MOVE_FUNC
+	int prev_range;			// neighbours by offset, -1 at either end
+	int next_range;
+	int prev_free;			// the free list of its size class, free runs only
+	int next_free;
+	bool free;
+} RANGE_BLOCK;
+
+typedef struct {
+	int capacity;
+	int used;
+	int live;				// allocations
+	int free_ranges;
+	int largest_free;
+} RANGE_STATS;
+
+// Two-level segregated fit (TLSF) over a range of abstract units, vertices or
+// indices of a GPU buffer the allocator never touches. Free runs are binned by
+// size, a power of two then one of RANGE_SL_COUNT steps within it, and two
+// bitmaps find the first non-empty bin that is sure to fit, so allocating and
+// freeing are constant time. Freed runs merge with free neighbours at once.
+// Allocations are known by block ids, which stay valid until freed
+typedef struct {
+	int capacity;
+	std::vector<RANGE_BLOCK> blocks;
+	std::vector<int> unused_blocks;				// ids of block records free for reuse
+	int first_range;							// lowest offset, where compaction starts
+	int last_range;								// highest offset, where growth goes
+	unsigned int fl_bitmap;						// bit per first level with a free run
+	unsigned int sl_bitmaps[RANGE_FL_COUNT];	// bit per second level bin with a free run
+	int free_heads[RANGE_FL_COUNT][RANGE_SL_COUNT];
+	int used;
+	int live;
+	int free_ranges;
+} RANGE_ALLOCATOR;
+
+// called by compact_ranges for each allocation it slides down; the two ranges
+// may overlap, so copy as memmove would. The block id stays the same
+typedef void (*RANGE_MOVE_FUNC)(void *data, int owner, int from_offset, int to_offset, int size);
+
+
+void init_range_allocator(RANGE_ALLOCATOR *allocator, int capacity);
+// adds units at the end, merged with a free run already there
+void grow_range_allocator(RANGE_ALLOCATOR *allocator, int capacity);
+// block id, or -1 when no free run fits size units
+int range_alloc(RANGE_ALLOCATOR *allocator, int size, int owner = -1);
+void range_free(RANGE_ALLOCATOR *allocator, int block);
+inline int get_range_offset(const RANGE_ALLOCATOR *allocator, int block) {
+	return allocator->blocks[block].offset;
+}
+
+// slides allocations down over the lowest free run, which moves up and takes
+// in every free run it meets, until max_units have moved or all free units
+// are one run at the top; returns the units moved. Call again to continue
+int compact_ranges(RANGE_ALLOCATOR *allocator, int max_units, RANGE_MOVE_FUNC move, void *data);
+RANGE_STATS get_range_stats(const RANGE_ALLOCATOR *allocator);
+// share of the free units outside the largest free run, 0..1
+float get_range_fragmentation(const RANGE_STATS *stats);
+
+#endif
@@ -0,0 +1,471 @@
+#include "render_thread.h"
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/gtc/type_ptr.hpp>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "gl_ext.h"
+
+
+void init_snapshot_mailbox(SNAPSHOT_MAILBOX *mailbox) {
+	mailbox->pending.store(SNAPSHOT_EMPTY);
+	mailbox->write_slot = 0;
+}
+
+
+// producer: blocks until the consumer has taken the previous snapshot, which
+// also means it is done drawing the slot we are about to overwrite.
+// returns NULL once the mailbox is closed
+FRAME_SNAPSHOT *begin_snapshot(SNAPSHOT_MAILBOX *mailbox) {
+	int pending = mailbox->pending.load(std::memory_order_acquire);
+	while (pending >= 0) {
+		mailbox->pending.wait(pending, std::memory_order_acquire);
+		pending = mailbox->pending.load(std::memory_order_acquire);
+	}
+
+	if (pending == SNAPSHOT_QUIT) {
+		return NULL;
+	}
+	return &mailbox->slots[mailbox->write_slot];
+}
+
+
+void publish_snapshot(SNAPSHOT_MAILBOX *mailbox) {
+	int expected = SNAPSHOT_EMPTY;
+	if (mailbox->pending.compare_exchange_strong(expected, mailbox->write_slot,
+				std::memory_order_release, std::memory_order_relaxed)) {
+		mailbox->pending.notify_one();
+		mailbox->write_slot ^= 1;
+	}
+}
+
+
+// consumer: blocks until a snapshot is published, NULL once the mailbox is closed
+const FRAME_SNAPSHOT *acquire_snapshot(SNAPSHOT_MAILBOX *mailbox) {
+	int pending = mailbox->pending.load(std::memory_order_acquire);
+	while (true) {
+		while (pending == SNAPSHOT_EMPTY) {
+			mailbox->pending.wait(SNAPSHOT_EMPTY, std::memory_order_acquire);
+			pending = mailbox->pending.load(std::memory_order_acquire);
+		}
+
+		if (pending == SNAPSHOT_QUIT) {
+			return NULL;
+		}
+
+		// fails only if the producer closed the mailbox in between
+		if (mailbox->pending.compare_exchange_weak(pending, SNAPSHOT_EMPTY,
+					std::memory_order_acquire, std::memory_order_acquire)) {
+			mailbox->pending.notify_one();
+			return &mailbox->slots[pending];
+		}
+	}
+}
+
+
+void close_snapshot_mailbox(SNAPSHOT_MAILBOX *mailbox) {
+	mailbox->pending.store(SNAPSHOT_QUIT, std::memory_order_release);
+	mailbox->pending.notify_all();
+}
+
+
+static void setup_program(RENDERER *renderer) {
+	unsigned int program = renderer->shader_program;
+	glUseProgram(program);
+	glUniform1f(glGetUniformLocation(program, "mixAmount"), renderer->mix_amount);
+
+	renderer->textures_uniform_location = glGetUniformLocation(program, "textures");
+	renderer->layer_scale_uniform_location = glGetUniformLocation(program, "layerScale");
+	renderer->view_uniform_location = glGetUniformLocation(program, "view");
+	renderer->projection_uniform_location = glGetUniformLocation(program, "projection");
+	renderer->eye_view_projections_uniform_location = glGetUniformLocation(program, "eyeViewProjections");
+	renderer->textures_generation = renderer->textures->generation - 1;	// force a refresh
+	renderer->program_ready = true;
+}
+
+
+// the array is recreated when it grows, and every upload changes the layer scales
+static void refresh_textures(RENDERER *renderer) {
+	TEXTURE_ARRAY *textures = renderer->textures;
+	if (renderer->textures_generation == textures->generation) {
+		return;
+	}
+	renderer->textures_generation = textures->generation;
+
+	if (textures->handle) {
+		gl_ext.UniformHandleui64ARB(renderer->textures_uniform_location, textures->handle);
+	} else {
+		bind_texture_array(textures, 0);
+		glUniform1i(renderer->textures_uniform_location, 0);
+	}
+
+	glm::vec2 scales[TEXTURE_ARRAY_MAX_LAYERS];
+	for (int i = 0; i < TEXTURE_ARRAY_MAX_LAYERS; i++) {
+		scales[i] = get_layer_uv_scale(textures, i);
+	}
+	glUniform2fv(renderer->layer_scale_uniform_location, TEXTURE_ARRAY_MAX_LAYERS, &scales[0].x);
+}
+
+
+void init_instance_buffer(RENDERER *renderer) {
+	init_stream_buffer(&renderer->instance_stream);
+	renderer->instance_offset = 0;
+	renderer->indirect_draws = gl_ext.multi_draw_indirect;
+	renderer->draw_calls = 0;
+	for (int format = 0; format < VERTEX_FORMAT_COUNT; format++) {
+		glBindVertexArray(renderer->meshes->stores[format].VAO);
+		for (int location = 2; location <= 6; location++) {
+			glEnableVertexAttribArray(location);
+			glVertexAttribDivisor(location, 1);
+		}
+	}
+	glBindVertexArray(0);
+}
+
+
+void destroy_instance_buffer(RENDERER *renderer) {
+	STREAM_STATS stats = renderer->instance_stream.stats;
+	printf("instance stream (%s): peak %.1f KB per frame, %ld stalls (%.1f ms), %ld failed allocations, %ld grows\n",
+			get_stream_mode_name(renderer->instance_stream.mode), stats.peak_frame_bytes / 1024.0, stats.stalls,
+			stats.stall_ms, stats.failures, stats.grows);
+	destroy_stream_buffer(&renderer->instance_stream);
+}
+
+
+// GL 3.3 has no base instance, so each run of draws re-points the instance
+// attributes at its first instance instead
+static void bind_instance_attributes(GLintptr instance_offset, int first_instance) {
+	const GLsizei stride = sizeof(INSTANCE_DATA);
+	size_t base = instance_offset + (size_t)first_instance * stride;
+	for (int column = 0; column < 4; column++) {
+		glVertexAttribPointer(2 + column, 4, GL_FLOAT, GL_FALSE, stride,
+				(void *)(base + column * sizeof(glm::vec4)));
+	}
+	glVertexAttribIPointer(6, 2, GL_INT, stride, (void *)(base + offsetof(INSTANCE_DATA, texture_layers)));
+}
+
+
+STEREO_MODE choose_stereo_mode() {
+	if (gl_ext.multiview) {
+		return STEREO_MULTIVIEW;
+	}
+	return gl_ext.shader_layer ? STEREO_LAYERED : STEREO_PASSES;
+}
+
+
+const char *get_stereo_shader_define(STEREO_MODE mode) {
+	switch (mode) {
+		case STEREO_MULTIVIEW: return "#define MULTIVIEW\n";
+		case STEREO_LAYERED: return "#define LAYERED\n";
+		default: return "";
+	}
+}
+
+
+// shared by every view: the whole draw list goes up once per frame, written
+// straight into the stream. false when it did not fit; the stream grows for
+// the next frame
+static bool upload_instances(RENDERER *renderer, const FRAME_SNAPSHOT *snapshot) {
+	int count = snapshot->draw_count;
+	begin_stream_frame(&renderer->instance_stream);
+	STREAM_ALLOCATION allocation = stream_alloc(&renderer->instance_stream, count * sizeof(INSTANCE_DATA));
+	if (!allocation.data) {
+		return false;
+	}
+	INSTANCE_DATA *instances = (INSTANCE_DATA *)allocation.data;
+	for (int i = 0; i < count; i++) {
+		instances[i].model = snapshot->draws[i].model;
+		instances[i].texture_layers[0] = snapshot->draws[i].texture_layers[0];
+		instances[i].texture_layers[1] = snapshot->draws[i].texture_layers[1];
+	}
+	stream_commit(&renderer->instance_stream);
+
+	renderer->instance_offset = allocation.offset;
+	glBindBuffer(GL_ARRAY_BUFFER, renderer->instance_stream.buffer);
+	return true;
+}
+
+
+// one instanced draw per command; repeat draws each instance that many times
+// (divisor set to match). The VAO only changes with the vertex format
+static void draw_commands_directly(RENDERER *renderer, const DRAW_COMMAND_LIST *pass, int repeat) {
+	unsigned int bound_vao = 0;
+	for (int i = 0; i < pass->count; i++) {
+		const DRAW_COMMAND *command = &pass->commands[i];
+		unsigned int vao = get_mesh_vao(renderer->meshes, command->mesh);
+		if (vao != bound_vao) {
+			glBindVertexArray(vao);
+			bound_vao = vao;
+		}
+		bind_instance_attributes(renderer->instance_offset, command->first_draw);
+		draw_mesh_instanced(renderer->meshes, command->mesh, command->draw_count * repeat);
+		renderer->draw_calls++;
+	}
+}
+
+
+// the commands resolved against the mesh pool into the stream, grouped by
+// vertex format, then one call per format. base_instance starts each
+// command's instances, so the attributes are pointed once per format and
+// the shader needs no gl_DrawID. false when the stream is full
+static bool draw_commands_indirect(RENDERER *renderer, const DRAW_COMMAND_LIST *pass, int repeat) {
+	const MESH_POOL *meshes = renderer->meshes;
+	int format_counts[VERTEX_FORMAT_COUNT] = {};
+	for (int i = 0; i < pass->count; i++) {
+		format_counts[get_mesh(meshes, pass->commands[i].mesh)->format]++;
+	}
+	STREAM_ALLOCATION allocation = stream_alloc(&renderer->instance_stream,
+			pass->count * sizeof(DRAW_ELEMENTS_INDIRECT_COMMAND), sizeof(GLuint));
+	if (!allocation.data) {
+		return false;
+	}
+
+	int format_starts[VERTEX_FORMAT_COUNT];
+	int next[VERTEX_FORMAT_COUNT];
+	int start = 0;
+	for (int format = 0; format < VERTEX_FORMAT_COUNT; format++) {
+		format_starts[format] = next[format] = start;
+		start += format_counts[format];
+	}
+	DRAW_ELEMENTS_INDIRECT_COMMAND *out = (DRAW_ELEMENTS_INDIRECT_COMMAND *)allocation.data;
+	for (int i = 0; i < pass->count; i++) {
+		const DRAW_COMMAND *command = &pass->commands[i];
+		const MESH_RECORD *mesh = get_mesh(meshes, command->mesh);
+		DRAW_ELEMENTS_INDIRECT_COMMAND *indirect = &out[next[mesh->format]++];
+		indirect->count = mesh->index_count;
+		indirect->instance_count = command->draw_count * repeat;
+		indirect->first_index = mesh->first_index;
+		indirect->base_vertex = mesh->base_vertex;
+		indirect->base_instance = command->first_draw;
+	}
+	stream_commit(&renderer->instance_stream);
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, renderer->instance_stream.buffer);
+	for (int format = 0; format < VERTEX_FORMAT_COUNT; format++) {
+		if (!format_counts[format]) {
+			continue;
+		}
+		glBindVertexArray(meshes->stores[format].VAO);
+		bind_instance_attributes(renderer->instance_offset, 0);
+		gl_ext.MultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+				(void *)(allocation.offset + format_starts[format] * sizeof(DRAW_ELEMENTS_INDIRECT_COMMAND)),
+				format_counts[format], 0);
+		renderer->draw_calls++;
+	}
+	return true;
+}
+
+
+static void draw_pass(RENDERER *renderer, const DRAW_COMMAND_LIST *pass, int repeat) {
+	if (!pass->count) {
+		return;
+	}
+	if (renderer->indirect_draws && draw_commands_indirect(renderer, pass, repeat)) {
+		return;
+	}
+	draw_commands_directly(renderer, pass, repeat);
+}
+
+
+// the divisor is VAO state, so it is set in every format's VAO
+static void set_instance_divisor(const RENDERER *renderer, int divisor) {
+	for (int format = 0; format < VERTEX_FORMAT_COUNT; format++) {
+		glBindVertexArray(renderer->meshes->stores[format].VAO);
+		for (int location = 2; location <= 6; location++) {
+			glVertexAttribDivisor(location, divisor);
+		}
+	}
+}
+
+
+static void get_view_pixels(glm::vec4 rect, int width, int height, int *pixels) {
+	pixels[0] = (int)(rect.x * width);
+	pixels[1] = (int)(rect.y * height);
+	pixels[2] = (int)(rect.z * width);
+	pixels[3] = (int)(rect.w * height);
+}
+
+
+static bool overlaps_earlier_view(const FRAME_SNAPSHOT *snapshot, int view) {
+	glm::vec4 a = snapshot->views[view].rect;
+	for (int v = 0; v < view; v++) {
+		glm::vec4 b = snapshot->views[v].rect;
+		if (a.x < b.x + b.z && b.x < a.x + a.z && a.y < b.y + b.w && b.y < a.y + a.w) {
+			return true;
+		}
+	}
+	return false;
+}
+
+
+static bool ensure_stereo_target(RENDERER *renderer, int width, int height) {
+	if (renderer->stereo_framebuffer && renderer->stereo_width == width && renderer->stereo_height == height) {
+		return true;
+	}
+	destroy_stereo_target(renderer);
+	renderer->stereo_width = width;
+	renderer->stereo_height = height;
+
+	glGenTextures(1, &renderer->stereo_color);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, renderer->stereo_color);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, width, height, 2, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glGenTextures(1, &renderer->stereo_depth);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, renderer->stereo_depth);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, width, height, 2, 0, GL_DEPTH_COMPONENT,
+			GL_UNSIGNED_INT, NULL);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	glGenFramebuffers(1, &renderer->stereo_framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, renderer->stereo_framebuffer);
+	if (renderer->stereo_mode == STEREO_MULTIVIEW) {
+		gl_ext.FramebufferTextureMultiviewOVR(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, renderer->stereo_color, 0, 0, 2);
+		gl_ext.FramebufferTextureMultiviewOVR(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, renderer->stereo_depth, 0, 0, 2);
+	} else {
+		glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, renderer->stereo_color, 0);
+		glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, renderer->stereo_depth, 0);
+	}
+	bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glGenFramebuffers(1, &renderer->stereo_blit_framebuffer);
+
+	if (!complete) {
+		fprintf(stderr, "ERROR:RENDER:STEREO_FRAMEBUFFER_INCOMPLETE\n");
+		destroy_stereo_target(renderer);
+	}
+	return complete;
+}
+
+
+void destroy_stereo_target(RENDERER *renderer) {
+	if (renderer->stereo_framebuffer) {
+		glDeleteFramebuffers(1, &renderer->stereo_framebuffer);
+		glDeleteFramebuffers(1, &renderer->stereo_blit_framebuffer);
+		glDeleteTextures(1, &renderer->stereo_color);
+		glDeleteTextures(1, &renderer->stereo_depth);
+	}
+	renderer->stereo_framebuffer = 0;
+	renderer->stereo_blit_framebuffer = 0;
+	renderer->stereo_color = 0;
+	renderer->stereo_depth = 0;
+}
+
+
+// both eyes in one draw per run, then each layer blitted to its half
+static void draw_stereo(RENDERER *renderer, const FRAME_SNAPSHOT *snapshot) {
+	int eyes[2][4];
+	get_view_pixels(snapshot->views[0].rect, snapshot->viewport_width, snapshot->viewport_height, eyes[0]);
+	get_view_pixels(snapshot->views[1].rect, snapshot->viewport_width, snapshot->viewport_height, eyes[1]);
+	int width = eyes[0][2];
+	int height = eyes[0][3];
+	if (!ensure_stereo_target(renderer, width, height)) {
+		return;
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, renderer->stereo_framebuffer);
+	glViewport(0, 0, width, height);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	glm::mat4 eye_view_projections[2] = { snapshot->views[0].view_projection, snapshot->views[1].view_projection };
+	glUniformMatrix4fv(renderer->eye_view_projections_uniform_location, 2, GL_FALSE,
+			glm::value_ptr(eye_view_projections[0]));
+	bool layered = renderer->stereo_mode == STEREO_LAYERED;
+	if (layered) {
+		set_instance_divisor(renderer, 2);
+	}
+	draw_pass(renderer, &snapshot->passes[STEREO_PASS], layered ? 2 : 1);
+	if (layered) {
+		set_instance_divisor(renderer, 1);
+	}
+
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, renderer->stereo_blit_framebuffer);
+	for (int eye = 0; eye < 2; eye++) {
+		glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, renderer->stereo_color, 0, eye);
+		glBlitFramebuffer(0, 0, width, height, eyes[eye][0], eyes[eye][1], eyes[eye][0] + width,
+				eyes[eye][1] + height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+
+void render_snapshot(RENDERER *renderer, const FRAME_SNAPSHOT *snapshot) {
+	if (!renderer->program_ready && renderer->shader_program) {
+		setup_program(renderer);
+	}
+
+	glViewport(0, 0, snapshot->viewport_width, snapshot->viewport_height);
+	glClearColor(0.1f, 0.7f, 0.9f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	renderer->draw_calls = 0;
+
+	// until the program links there is nothing to draw but the clear
+	if (!renderer->program_ready) {
+		return;
+	}
+	refresh_textures(renderer);
+	if (!upload_instances(renderer, snapshot)) {
+		return;
+	}
+
+	if (snapshot->stereo && renderer->stereo_mode != STEREO_PASSES) {
+		draw_stereo(renderer, snapshot);
+		return;
+	}
+
+	// a view drawn over an earlier one (picture in picture) clears its own
+	// rectangle first
+	glEnable(GL_SCISSOR_TEST);
+	for (int v = 0; v < snapshot->view_count; v++) {
+		const RENDER_VIEW *view = &snapshot->views[v];
+		int pixels[4];
+		get_view_pixels(view->rect, snapshot->viewport_width, snapshot->viewport_height, pixels);
+		glViewport(pixels[0], pixels[1], pixels[2], pixels[3]);
+		glScissor(pixels[0], pixels[1], pixels[2], pixels[3]);
+		if (overlaps_earlier_view(snapshot, v)) {
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		}
+
+		glUniformMatrix4fv(renderer->projection_uniform_location, 1, GL_FALSE, glm::value_ptr(view->projection));
+		glUniformMatrix4fv(renderer->view_uniform_location, 1, GL_FALSE, glm::value_ptr(view->view));
+		draw_pass(renderer, &snapshot->passes[v], 1);
+	}
+	glDisable(GL_SCISSOR_TEST);
+}
+
+
+// owns the GL context for its whole lifetime; the main thread must have
+// released it with glfwMakeContextCurrent(NULL) before starting us
+void render_thread_main(RENDERER *renderer, SNAPSHOT_MAILBOX *mailbox) {
+	glfwMakeContextCurrent(renderer->window);
+	apply_present_mode(&renderer->present_stats);
+
+	init_instance_buffer(renderer);
+
+	bool first_frame = true;
+	bool all_resident = false;
+
+	const FRAME_SNAPSHOT *snapshot;
+	while ((snapshot = acquire_snapshot(mailbox)) != NULL) {
+		pump_gl_queue(renderer->loader);
+		defragment_mesh_pool(renderer->meshes);
+		render_snapshot(renderer, snapshot);
+
+		glfwSwapBuffers(renderer->window);
+		pacer_record_present(&renderer->present_stats, snapshot->frame_time, snapshot->input_sampled);
+		report_frame_stats(&renderer->present_stats);
+
+		if (first_frame && renderer->program_ready) {
+			first_frame = false;
+			printf("time to first frame: %.1f ms\n", (pacer_now() - renderer->startup_time) * 1000.0);
+		}
+		if (!all_resident && assets_resident(renderer->loader)) {
+			all_resident = true;
+			printf("time to all assets resident: %.1f ms\n", renderer->loader->all_resident_time * 1000.0);
+		}
+	}
+
+	destroy_instance_buffer(renderer);
+	destroy_stereo_target(renderer);
+	glfwMakeContextCurrent(NULL);
+}
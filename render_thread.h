@@ -0,0 +1,153 @@
+#ifndef RENDER_THREAD_H
+#define RENDER_THREAD_H
+
+#include <glm/glm.hpp>
+#include <atomic>
+
+#include "frame_pacer.h"
+#include "asset_loader.h"
+#include "mesh_pool.h"
+#include "render_view.h"
+#include "stream_buffer.h"
+#include "texture_array.h"
+
+struct GLFWwindow;
+
+const int SNAPSHOT_SLOTS	= 2;	// frames in flight between the threads
+const int SNAPSHOT_EMPTY	= -1;
+const int SNAPSHOT_QUIT		= -2;
+const int STEREO_PASS		= MAX_VIEWS;	// both eyes of a stereo snapshot in one pass
+const int MAX_PASSES		= MAX_VIEWS + 1;
+
+// how a stereo snapshot's two eyes are drawn
+enum STEREO_MODE {
+	STEREO_PASSES,		// one pass per eye, like any other pair of views
+	STEREO_MULTIVIEW,	// one pass, GL_OVR_multiview into a two-layer target
+	STEREO_LAYERED		// one pass, instances doubled and routed by gl_Layer
+};
+
+typedef struct {
+	glm::mat4 model;
+	int texture_layers[2];
+	int mesh;			// in the renderer's mesh pool
+} DRAW_ITEM;
+
+// one instanced draw: a run of consecutive draws sharing a mesh, their
+// instances starting at first_draw. The render thread looks the mesh up
+typedef struct {
+	int mesh;
+	int first_draw;
+	int draw_count;
+} DRAW_COMMAND;
+
+typedef struct {
+	DRAW_COMMAND *commands;
+	int count;
+} DRAW_COMMAND_LIST;
+
+// per-instance vertex data, attribute locations 2-6 in shader.vert
+typedef struct {
+	glm::mat4 model;
+	int texture_layers[2];
+} INSTANCE_DATA;
+
+// everything the render thread needs for one frame, immutable once published.
+// The draws and their instance data are shared by every view; each view only
+// adds its own camera and which draws survived its culling. The draw list is
+// sized to the frame and lives in the producer's frame arena, one slot per
+// mailbox slot
+typedef struct {
+	int view_count;
+	RENDER_VIEW views[MAX_VIEWS];
+	bool stereo;		// views 0 and 1 are the eyes of one camera
+	int viewport_width;
+	int viewport_height;
+
+	int draw_count;
+	DRAW_ITEM *draws;
+	unsigned char *view_masks;	// per draw, bit v set when the draw is visible in view v
+	// what each pass draws, built on the workers from the masks: pass v is
+	// view v, STEREO_PASS both eyes of a stereo snapshot
+	DRAW_COMMAND_LIST passes[MAX_PASSES];
+
+	// carried along so the render thread can time input->present
+	float frame_time;
+	double input_sampled;
+} FRAME_SNAPSHOT;
+
+// two snapshot slots handed between one producer and one consumer through a
+// single atomic; the producer fills one slot while the other is being drawn
+typedef struct {
+	FRAME_SNAPSHOT slots[SNAPSHOT_SLOTS];
+	std::atomic<int> pending;	// published slot, SNAPSHOT_EMPTY or SNAPSHOT_QUIT
+	int write_slot;
+} SNAPSHOT_MAILBOX;
+
+// GL objects the render thread draws with; the meshes and textures are created on
+// the main thread before it starts, the program arrives later through the loader
+typedef struct {
+	GLFWwindow *window;
+	unsigned int shader_program;
+	float mix_amount;
+
+	// every draw's mesh, one VAO per vertex format; the render thread owns it
+	// once started and defragments it a little each frame
+	MESH_POOL *meshes;
+
+	// all draws sample this array; the loader grows it on the render thread
+	TEXTURE_ARRAY *textures;
+	unsigned int textures_generation;
+
+	// instances are written straight into the stream, one allocation per frame;
+	// with indirect_draws each pass's commands follow them
+	STREAM_BUFFER instance_stream;
+	GLintptr instance_offset;
+	bool indirect_draws;		// a glMultiDrawElementsIndirect per vertex format per pass
+	int draw_calls;				// made by the last render_snapshot
+
+	bool program_ready;
+	unsigned int textures_uniform_location;
+	unsigned int layer_scale_uniform_location;
+	unsigned int view_uniform_location;
+	unsigned int projection_uniform_location;
+	unsigned int eye_view_projections_uniform_location;
+
+	// stereo renders both eyes into a two-layer target, then blits each
+	// layer to its half of the window; the program must be built for the mode
+	STEREO_MODE stereo_mode;
+	unsigned int stereo_framebuffer;
+	unsigned int stereo_blit_framebuffer;
+	unsigned int stereo_color;
+	unsigned int stereo_depth;
+	int stereo_width;
+	int stereo_height;
+
+	ASSET_LOADER *loader;
+	double startup_time;
+	FRAME_PACER present_stats;
+} RENDERER;
+
+
+void init_snapshot_mailbox(SNAPSHOT_MAILBOX *mailbox);
+FRAME_SNAPSHOT *begin_snapshot(SNAPSHOT_MAILBOX *mailbox);
+void publish_snapshot(SNAPSHOT_MAILBOX *mailbox);
+const FRAME_SNAPSHOT *acquire_snapshot(SNAPSHOT_MAILBOX *mailbox);
+void close_snapshot_mailbox(SNAPSHOT_MAILBOX *mailbox);
+
+// the best single-pass stereo the driver has; needs load_gl_extensions
+STEREO_MODE choose_stereo_mode();
+// the #define the shaders need for mode, "" for STEREO_PASSES
+const char *get_stereo_shader_define(STEREO_MODE mode);
+
+// GL thread, after the mesh pool exists: the buffer render_snapshot streams
+// instances into, enabled in every vertex format's VAO. Turns indirect_draws
+// on when the driver has it
+void init_instance_buffer(RENDERER *renderer);
+void destroy_instance_buffer(RENDERER *renderer);
+// GL thread: every view of snapshot into the window's framebuffer, no swap
+void render_snapshot(RENDERER *renderer, const FRAME_SNAPSHOT *snapshot);
+void destroy_stereo_target(RENDERER *renderer);
+
+void render_thread_main(RENDERER *renderer, SNAPSHOT_MAILBOX *mailbox);
+
+#endif
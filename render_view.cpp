@@ -0,0 +1,108 @@
+#include "render_view.h"
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "job_system.h"
+
+
+int get_view_layout_rects(VIEW_LAYOUT layout, glm::vec4 *rects) {
+	switch (layout) {
+		case VIEW_SPLIT:
+		case VIEW_STEREO:
+			rects[0] = glm::vec4(0.0f, 0.0f, 0.5f, 1.0f);
+			rects[1] = glm::vec4(0.5f, 0.0f, 0.5f, 1.0f);
+			return 2;
+		case VIEW_PICTURE_IN_PICTURE:
+			rects[0] = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+			rects[1] = glm::vec4(0.68f, 0.68f, 0.3f, 0.3f);
+			return 2;
+		default:
+			rects[0] = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+			return 1;
+	}
+}
+
+
+float get_view_aspect(glm::vec4 rect, int framebuffer_width, int framebuffer_height) {
+	return (rect.z * framebuffer_width) / (rect.w * framebuffer_height);
+}
+
+
+RENDER_VIEW make_render_view(const glm::mat4 &view, const glm::mat4 &projection, glm::vec4 rect) {
+	RENDER_VIEW render_view;
+	render_view.view			= view;
+	render_view.projection		= projection;
+	render_view.view_projection	= projection * view;
+	render_view.frustum			= make_frustum(render_view.view_projection);
+	render_view.rect			= rect;
+	return render_view;
+}
+
+
+void make_stereo_views(const glm::mat4 &view, const glm::mat4 &projection, float separation,
+		glm::vec4 left_rect, glm::vec4 right_rect, RENDER_VIEW *left, RENDER_VIEW *right) {
+	// moving the eye left moves the world right in view space
+	glm::vec3 half(separation * 0.5f, 0.0f, 0.0f);
+	*left	= make_render_view(glm::translate(glm::mat4(1.0f), half) * view, projection, left_rect);
+	*right	= make_render_view(glm::translate(glm::mat4(1.0f), -half) * view, projection, right_rect);
+}
+
+
+// Gribb-Hartmann: each plane is the last row of the matrix plus or minus
+// one of the others
+FRUSTUM make_frustum(const glm::mat4 &m) {
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; i++) {
+		rows[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+	}
+
+	FRUSTUM frustum;
+	for (int i = 0; i < 3; i++) {
+		frustum.planes[i * 2]		= rows[3] + rows[i];
+		frustum.planes[i * 2 + 1]	= rows[3] - rows[i];
+	}
+	for (int i = 0; i < 6; i++) {
+		glm::vec4 &plane = frustum.planes[i];
+		plane = plane * (1.0f / glm::length(glm::vec3(plane.x, plane.y, plane.z)));
+	}
+	return frustum;
+}
+
+
+bool sphere_in_frustum(const FRUSTUM *frustum, glm::vec4 sphere) {
+	for (int i = 0; i < 6; i++) {
+		const glm::vec4 &plane = frustum->planes[i];
+		if (plane.x * sphere.x + plane.y * sphere.y + plane.z * sphere.z + plane.w < -sphere.w) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+typedef struct {
+	const RENDER_VIEW *views;
+	int view_count;
+	const glm::vec4 *spheres;
+	unsigned char *masks;
+} CULL_DATA;
+
+
+static void cull_batch(void *data, int begin, int end) {
+	CULL_DATA *cull = (CULL_DATA *)data;
+	for (int i = begin; i < end; i++) {
+		unsigned char mask = 0;
+		for (int v = 0; v < cull->view_count; v++) {
+			if (sphere_in_frustum(&cull->views[v].frustum, cull->spheres[i])) {
+				mask |= (unsigned char)(1 << v);
+			}
+		}
+		cull->masks[i] = mask;
+	}
+}
+
+
+void cull_views(const RENDER_VIEW *views, int view_count, const glm::vec4 *spheres, int count,
+		unsigned char *masks) {
+	CULL_DATA cull = { views, view_count, spheres, masks };
+	parallel_for(count, CULL_BATCH_SIZE, cull_batch, &cull);
+}
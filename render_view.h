@@ -0,0 +1,52 @@
+#ifndef RENDER_VIEW_H
+#define RENDER_VIEW_H
+
+#include <glm/glm.hpp>
+
+// default view values
+const int MAX_VIEWS					= 4;		// at most 8, visibility is a byte per draw
+const int CULL_BATCH_SIZE			= 128;
+const float STEREO_EYE_SEPARATION	= 0.064f;	// world units between the eyes
+
+enum VIEW_LAYOUT {
+	VIEW_SINGLE,
+	VIEW_SPLIT,					// two cameras side by side
+	VIEW_PICTURE_IN_PICTURE,	// a second camera inset top right
+	VIEW_STEREO					// one camera, an eye per half of the window
+};
+
+// planes point inwards: xyz normal, w distance
+typedef struct {
+	glm::vec4 planes[6];
+} FRUSTUM;
+
+// one camera's worth of a frame: where it looks from and where it lands
+typedef struct {
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::mat4 view_projection;
+	FRUSTUM frustum;
+	glm::vec4 rect;		// x, y, width, height as fractions of the framebuffer
+} RENDER_VIEW;
+
+
+// fills rects (MAX_VIEWS of them) and returns how many the layout has
+int get_view_layout_rects(VIEW_LAYOUT layout, glm::vec4 *rects);
+float get_view_aspect(glm::vec4 rect, int framebuffer_width, int framebuffer_height);
+
+RENDER_VIEW make_render_view(const glm::mat4 &view, const glm::mat4 &projection, glm::vec4 rect);
+// both eyes of a camera, each shifted half the separation along its right
+void make_stereo_views(const glm::mat4 &view, const glm::mat4 &projection, float separation,
+		glm::vec4 left_rect, glm::vec4 right_rect, RENDER_VIEW *left, RENDER_VIEW *right);
+
+FRUSTUM make_frustum(const glm::mat4 &view_projection);
+// sphere is xyz centre, w radius, in world space
+bool sphere_in_frustum(const FRUSTUM *frustum, glm::vec4 sphere);
+
+// Every view against every sphere in one parallel_for over the spheres, so
+// each bound is read once however many views there are. Bit v of masks[i] is
+// set when sphere i is visible in view v. Call from a worker thread
+void cull_views(const RENDER_VIEW *views, int view_count, const glm::vec4 *spheres, int count,
+		unsigned char *masks);
+
+#endif
@@ -0,0 +1,84 @@
+#include "sampler.h"
+#include <string.h>
+
+#include "gl_ext.h"
+
+
+SAMPLER_DESC get_sampler_preset(SAMPLER_PRESET preset, GLint wrap) {
+	SAMPLER_DESC desc = { GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, wrap, wrap, 1.0f };
+	switch (preset) {
+		case SAMPLER_ANISOTROPIC:
+			desc.max_anisotropy = gl_ext.max_anisotropy < SAMPLER_MAX_ANISOTROPY ? gl_ext.max_anisotropy
+					: SAMPLER_MAX_ANISOTROPY;
+			break;
+		case SAMPLER_NEAREST:
+			desc.min_filter = GL_NEAREST_MIPMAP_NEAREST;
+			desc.mag_filter = GL_NEAREST;
+			break;
+		default:
+			break;
+	}
+	return desc;
+}
+
+
+const char *get_sampler_preset_name(SAMPLER_PRESET preset) {
+	switch (preset) {
+		case SAMPLER_TRILINEAR: return "trilinear";
+		case SAMPLER_ANISOTROPIC: return "anisotropic";
+		case SAMPLER_NEAREST: return "nearest";
+		default: return "unknown";
+	}
+}
+
+
+void init_sampler_cache(SAMPLER_CACHE *cache) {
+	cache->samplers.clear();
+}
+
+
+void destroy_sampler_cache(SAMPLER_CACHE *cache) {
+	for (CACHED_SAMPLER &entry : cache->samplers) {
+		glDeleteSamplers(1, &entry.sampler);
+	}
+	cache->samplers.clear();
+}
+
+
+unsigned int acquire_sampler(SAMPLER_CACHE *cache, const SAMPLER_DESC *desc) {
+	for (CACHED_SAMPLER &entry : cache->samplers) {
+		if (memcmp(&entry.desc, desc, sizeof(SAMPLER_DESC)) == 0) {
+			entry.refs++;
+			return entry.sampler;
+		}
+	}
+
+	CACHED_SAMPLER entry;
+	entry.desc = *desc;
+	entry.refs = 1;
+	glGenSamplers(1, &entry.sampler);
+	glSamplerParameteri(entry.sampler, GL_TEXTURE_MIN_FILTER, desc->min_filter);
+	glSamplerParameteri(entry.sampler, GL_TEXTURE_MAG_FILTER, desc->mag_filter);
+	glSamplerParameteri(entry.sampler, GL_TEXTURE_WRAP_S, desc->wrap_s);
+	glSamplerParameteri(entry.sampler, GL_TEXTURE_WRAP_T, desc->wrap_t);
+	if (desc->max_anisotropy > 1.0f) {
+		glSamplerParameterf(entry.sampler, GL_TEXTURE_MAX_ANISOTROPY, desc->max_anisotropy);
+	}
+	cache->samplers.push_back(entry);
+	return entry.sampler;
+}
+
+
+void release_sampler(SAMPLER_CACHE *cache, unsigned int sampler) {
+	for (size_t i = 0; i < cache->samplers.size(); i++) {
+		CACHED_SAMPLER *entry = &cache->samplers[i];
+		if (entry->sampler != sampler) {
+			continue;
+		}
+		if (--entry->refs == 0) {
+			glDeleteSamplers(1, &entry->sampler);
+			cache->samplers.erase(cache->samplers.begin() + i);
+		}
+		return;
+	}
+}
@@ -0,0 +1,52 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <glad/glad.h>
+#include <vector>
+
+// default sampler values
+const float SAMPLER_MAX_ANISOTROPY = 16.0f;	// the anisotropic preset's cap, below the driver's own
+
+enum SAMPLER_PRESET {
+	SAMPLER_TRILINEAR,		// linear within and between mip levels
+	SAMPLER_ANISOTROPIC,	// trilinear plus anisotropy up to the driver's limit
+	SAMPLER_NEAREST,		// crisp texels for pixel art, still mipmapped when minified
+	SAMPLER_PRESET_COUNT
+};
+
+// how a texture is filtered and wrapped, kept apart from its pixels
+typedef struct {
+	GLint min_filter;
+	GLint mag_filter;
+	GLint wrap_s;
+	GLint wrap_t;
+	float max_anisotropy;	// 1 for none
+} SAMPLER_DESC;
+
+typedef struct {
+	SAMPLER_DESC desc;
+	unsigned int sampler;
+	int refs;
+} CACHED_SAMPLER;
+
+// One sampler object per distinct SAMPLER_DESC, however many textures use it.
+// A sampler bound to a unit overrides the bound texture's own parameters, so
+// textures carry no filter state and switching state is a single glBindSampler
+typedef struct {
+	std::vector<CACHED_SAMPLER> samplers;
+} SAMPLER_CACHE;
+
+
+// needs load_gl_extensions for the anisotropy limit; minification is mipmapped
+// in every preset, so textures need their mip chain
+SAMPLER_DESC get_sampler_preset(SAMPLER_PRESET preset, GLint wrap = GL_REPEAT);
+const char *get_sampler_preset_name(SAMPLER_PRESET preset);
+
+void init_sampler_cache(SAMPLER_CACHE *cache);
+void destroy_sampler_cache(SAMPLER_CACHE *cache);
+
+// GL thread: the shared sampler object for desc, created on first use
+unsigned int acquire_sampler(SAMPLER_CACHE *cache, const SAMPLER_DESC *desc);
+void release_sampler(SAMPLER_CACHE *cache, unsigned int sampler);
+
+#endif
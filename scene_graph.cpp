@@ -0,0 +1,196 @@
+#include "scene_graph.h"
+
+#include "job_system.h"
+
+
+NODE_TRANSFORM make_node_transform(glm::vec3 position, glm::quat rotation, glm::vec3 scale) {
+	NODE_TRANSFORM transform;
+	transform.position	= position;
+	transform.rotation	= rotation;
+	transform.scale		= scale;
+	return transform;
+}
+
+
+void init_scene_graph(SCENE_GRAPH *graph) {
+	graph->parents.clear();
+	graph->locals.clear();
+	graph->worlds.clear();
+	graph->flags.clear();
+	graph->handles.clear();
+	graph->depths.clear();
+	graph->level_starts.clear();
+	graph->slots.clear();
+	graph->sorted = true;
+	graph->levels_valid = true;
+	graph->dirty_count = 0;
+}
+
+
+// appended at the end; still in order unless it is shallower than the last node
+int add_scene_node(SCENE_GRAPH *graph, int parent, const NODE_TRANSFORM *local) {
+	int parent_slot = parent == SCENE_NO_PARENT ? SCENE_NO_PARENT : graph->slots[parent];
+	int depth = parent_slot == SCENE_NO_PARENT ? 0 : graph->depths[parent_slot] + 1;
+	if (!graph->depths.empty() && depth < graph->depths.back()) {
+		graph->sorted = false;
+	}
+
+	int handle = (int)graph->slots.size();
+	graph->slots.push_back((int)graph->parents.size());
+	graph->parents.push_back(parent_slot);
+	graph->locals.push_back(*local);
+	graph->worlds.push_back(glm::mat4(1.0f));
+	graph->flags.push_back(SCENE_LOCAL_DIRTY);
+	graph->handles.push_back(handle);
+	graph->depths.push_back(depth);
+	graph->levels_valid = false;
+	graph->dirty_count++;
+	return handle;
+}
+
+
+void set_node_transform(SCENE_GRAPH *graph, int node, const NODE_TRANSFORM *local) {
+	int slot = graph->slots[node];
+	graph->locals[slot] = *local;
+	graph->flags[slot] |= SCENE_LOCAL_DIRTY;
+	graph->dirty_count++;
+}
+
+
+const NODE_TRANSFORM *get_node_transform(const SCENE_GRAPH *graph, int node) {
+	return &graph->locals[graph->slots[node]];
+}
+
+
+const glm::mat4 &get_world_matrix(const SCENE_GRAPH *graph, int node) {
+	return graph->worlds[graph->slots[node]];
+}
+
+
+// stable counting sort by depth; parents keep pointing at the moved slots
+static void sort_by_depth(SCENE_GRAPH *graph) {
+	int count = (int)graph->parents.size();
+	int max_depth = 0;
+	for (int i = 0; i < count; i++) {
+		max_depth = graph->depths[i] > max_depth ? graph->depths[i] : max_depth;
+	}
+	std::vector<int> next(max_depth + 2, 0);
+	for (int i = 0; i < count; i++) {
+		next[graph->depths[i] + 1]++;
+	}
+	for (int d = 1; d <= max_depth + 1; d++) {
+		next[d] += next[d - 1];
+	}
+	std::vector<int> moved_to(count);
+	for (int i = 0; i < count; i++) {
+		moved_to[i] = next[graph->depths[i]]++;
+	}
+
+	std::vector<int> parents(count), handles(count), depths(count);
+	std::vector<NODE_TRANSFORM> locals(count);
+	std::vector<glm::mat4> worlds(count);
+	std::vector<unsigned char> flags(count);
+	for (int i = 0; i < count; i++) {
+		int to = moved_to[i];
+		parents[to]	= graph->parents[i] == SCENE_NO_PARENT ? SCENE_NO_PARENT : moved_to[graph->parents[i]];
+		locals[to]	= graph->locals[i];
+		worlds[to]	= graph->worlds[i];
+		flags[to]	= graph->flags[i];
+		handles[to]	= graph->handles[i];
+		depths[to]	= graph->depths[i];
+		graph->slots[graph->handles[i]] = to;
+	}
+	graph->parents.swap(parents);
+	graph->locals.swap(locals);
+	graph->worlds.swap(worlds);
+	graph->flags.swap(flags);
+	graph->handles.swap(handles);
+	graph->depths.swap(depths);
+	graph->sorted = true;
+}
+
+
+static void find_levels(SCENE_GRAPH *graph) {
+	int count = (int)graph->depths.size();
+	graph->level_starts.clear();
+	for (int i = 0; i < count; i++) {
+		if (i == 0 || graph->depths[i] != graph->depths[i - 1]) {
+			graph->level_starts.push_back(i);
+		}
+	}
+	graph->level_starts.push_back(count);
+	graph->levels_valid = true;
+}
+
+
+// translate * rotate * scale, written out rather than three matrix products
+static glm::mat4 compose_local(const NODE_TRANSFORM *local) {
+	const glm::quat &q = local->rotation;
+	float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+	float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+	float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+	glm::mat4 m(1.0f);
+	m[0][0] = (1.0f - 2.0f * (yy + zz)) * local->scale.x;
+	m[0][1] = (2.0f * (xy + wz)) * local->scale.x;
+	m[0][2] = (2.0f * (xz - wy)) * local->scale.x;
+	m[1][0] = (2.0f * (xy - wz)) * local->scale.y;
+	m[1][1] = (1.0f - 2.0f * (xx + zz)) * local->scale.y;
+	m[1][2] = (2.0f * (yz + wx)) * local->scale.y;
+	m[2][0] = (2.0f * (xz + wy)) * local->scale.z;
+	m[2][1] = (2.0f * (yz - wx)) * local->scale.z;
+	m[2][2] = (1.0f - 2.0f * (xx + yy)) * local->scale.z;
+	m[3][0] = local->position.x;
+	m[3][1] = local->position.y;
+	m[3][2] = local->position.z;
+	return m;
+}
+
+
+typedef struct {
+	SCENE_GRAPH *graph;
+	int first;		// slot the level starts at
+} SCENE_LEVEL;
+
+
+// the level above is finished, so its flags say whether a parent moved
+static void update_level(void *data, int begin, int end) {
+	SCENE_LEVEL *level = (SCENE_LEVEL *)data;
+	SCENE_GRAPH *graph = level->graph;
+	const int *parents = graph->parents.data();
+	unsigned char *flags = graph->flags.data();
+	glm::mat4 *worlds = graph->worlds.data();
+
+	for (int i = level->first + begin; i < level->first + end; i++) {
+		int parent = parents[i];
+		bool parent_moved = parent != SCENE_NO_PARENT && (flags[parent] & SCENE_WORLD_UPDATED);
+		if (!(flags[i] & SCENE_LOCAL_DIRTY) && !parent_moved) {
+			flags[i] = 0;
+			continue;
+		}
+		glm::mat4 local = compose_local(&graph->locals[i]);
+		worlds[i] = parent == SCENE_NO_PARENT ? local : worlds[parent] * local;
+		flags[i] = SCENE_WORLD_UPDATED;
+	}
+}
+
+
+// levels run in order, the nodes within one in parallel
+void update_scene_graph(SCENE_GRAPH *graph) {
+	if (graph->dirty_count == 0) {
+		return;
+	}
+	if (!graph->sorted) {
+		sort_by_depth(graph);
+	}
+	if (!graph->levels_valid) {
+		find_levels(graph);
+	}
+
+	int levels = (int)graph->level_starts.size() - 1;
+	for (int level = 0; level < levels; level++) {
+		SCENE_LEVEL range = { graph, graph->level_starts[level] };
+		parallel_for(graph->level_starts[level + 1] - range.first, SCENE_BATCH_SIZE, update_level, &range);
+	}
+	graph->dirty_count = 0;
+}
@@ -0,0 +1,63 @@
+#ifndef SCENE_GRAPH_H
+#define SCENE_GRAPH_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <vector>
+
+// default scene graph values
+const int SCENE_NO_PARENT		= -1;
+const int SCENE_BATCH_SIZE		= 2048;	// nodes per job within a level
+
+enum SCENE_NODE_FLAGS {
+	SCENE_LOCAL_DIRTY	= 1 << 0,	// local transform set since the last update
+	SCENE_WORLD_UPDATED	= 1 << 1	// world matrix rebuilt by the last update that had work
+};
+
+typedef struct {
+	glm::vec3 position;
+	glm::quat rotation;
+	glm::vec3 scale;
+} NODE_TRANSFORM;
+
+// Parent/child transforms in flat arrays sorted by depth: every parent comes
+// before its children and each depth is one contiguous range. An update walks
+// the arrays once front to back, rebuilding a world matrix only where the
+// node or an ancestor changed; a level's nodes only read the level above, so
+// each level is split across the job system.
+// Nodes are addressed by the handle add_scene_node returns, which survives
+// the re-sort that adding nodes out of depth order causes
+typedef struct {
+	// by slot, in depth order
+	std::vector<int> parents;			// slot, SCENE_NO_PARENT for roots
+	std::vector<NODE_TRANSFORM> locals;
+	std::vector<glm::mat4> worlds;
+	std::vector<unsigned char> flags;	// SCENE_NODE_FLAGS
+	std::vector<int> handles;
+	std::vector<int> depths;
+	std::vector<int> level_starts;		// first slot of each depth, then the node count
+
+	// by handle
+	std::vector<int> slots;
+
+	bool sorted;			// slots are in depth order
+	bool levels_valid;
+	int dirty_count;		// set_node_transform calls since the last update
+} SCENE_GRAPH;
+
+
+NODE_TRANSFORM make_node_transform(glm::vec3 position = glm::vec3(0.0f),
+		glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3 scale = glm::vec3(1.0f));
+
+void init_scene_graph(SCENE_GRAPH *graph);
+// parent is a handle or SCENE_NO_PARENT; returns the new node's handle
+int add_scene_node(SCENE_GRAPH *graph, int parent, const NODE_TRANSFORM *local);
+void set_node_transform(SCENE_GRAPH *graph, int node, const NODE_TRANSFORM *local);
+const NODE_TRANSFORM *get_node_transform(const SCENE_GRAPH *graph, int node);
+
+// rebuilds the world matrices of changed subtrees; call from a worker thread
+void update_scene_graph(SCENE_GRAPH *graph);
+// as of the last update
+const glm::mat4 &get_world_matrix(const SCENE_GRAPH *graph, int node);
+
+#endif
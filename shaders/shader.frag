@@ -1,14 +1,26 @@
 #version 330 core
+#ifdef BINDLESS
+#extension GL_ARB_bindless_texture : require
+#endif
 
 out vec4 FragColor;
 
-in vec3 ourColor;
 in vec2 TexCoord;
+flat in ivec2 Layers;
 
-uniform sampler2D texture1;
-uniform sampler2D texture2;
+// one array holds every material texture; each instance picks two layers
+#ifdef BINDLESS
+layout(bindless_sampler) uniform sampler2DArray textures;
+#else
+uniform sampler2DArray textures;
+#endif
+uniform vec2 layerScale[64];
 uniform float mixAmount;
 
+vec4 sample_layer(int layer) {
+    return texture(textures, vec3(TexCoord * layerScale[layer], layer));
+}
+
 void main() {
-    FragColor = mix(texture(texture1, TexCoord), texture(texture2, TexCoord), mixAmount);
+    FragColor = mix(sample_layer(Layers.x), sample_layer(Layers.y), mixAmount);
 }
\ No newline at end of file
@@ -1,15 +1,40 @@
 #version 330 core
+// stereo draws both eyes at once: MULTIVIEW runs the shader once per view,
+// LAYERED draws every instance twice and sends odd ones to the second layer
+#ifdef MULTIVIEW
+#extension GL_OVR_multiview2 : require
+layout (num_views = 2) in;
+#define EYE int(gl_ViewID_OVR)
+#elif defined(LAYERED)
+#extension GL_ARB_shader_viewport_layer_array : require
+#define EYE (gl_InstanceID & 1)
+#endif
 
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aTexCoord;
 
+// per instance
+layout (location = 2) in mat4 aModel;
+layout (location = 6) in ivec2 aLayers;
+
 out vec2 TexCoord;
+flat out ivec2 Layers;
 
-uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
+#ifdef EYE
+uniform mat4 eyeViewProjections[2];
+#endif
 
 void main() {
-    gl_Position = projection * view * model * vec4(aPos, 1.0f);
+#ifdef EYE
+    gl_Position = eyeViewProjections[EYE] * aModel * vec4(aPos, 1.0f);
+#else
+    gl_Position = projection * view * aModel * vec4(aPos, 1.0f);
+#endif
+#ifdef LAYERED
+    gl_Layer = EYE;
+#endif
     TexCoord = aTexCoord;
+    Layers = aLayers;
 }
@@ -0,0 +1,39 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoord;
+
+// set by bind_virtual_texture
+uniform sampler2D vtCache;
+uniform usampler2D vtIndirection;
+uniform vec2 vtUvScale;
+uniform float vtVirtualSize;
+uniform int vtLevels;
+uniform float vtTileSize;
+uniform float vtBorder;
+uniform float vtCacheSize;
+
+float vt_level(vec2 uv) {
+    vec2 dx = dFdx(uv * vtVirtualSize);
+    vec2 dy = dFdy(uv * vtVirtualSize);
+    float rho = max(dot(dx, dx), dot(dy, dy));
+    return clamp(0.5 * log2(max(rho, 1e-8)), 0.0, float(vtLevels - 1));
+}
+
+vec4 sample_virtual(vec2 uv) {
+    uv = clamp(uv * vtUvScale, 0.0, 0.999999);
+    int level = int(vt_level(uv));
+
+    // the entry points at this tile's cache slot or at a resident ancestor's
+    ivec2 tiles = textureSize(vtIndirection, level);
+    uvec4 entry = texelFetch(vtIndirection, ivec2(uv * vec2(tiles)), level);
+    vec2 resident_tiles = vec2(textureSize(vtIndirection, int(entry.z)));
+    vec2 in_tile = fract(uv * resident_tiles);
+
+    vec2 texel = vec2(entry.xy) * (vtTileSize + 2.0 * vtBorder) + vtBorder + in_tile * vtTileSize;
+    return texture(vtCache, texel / vtCacheSize);
+}
+
+void main() {
+    FragColor = sample_virtual(TexCoord);
+}
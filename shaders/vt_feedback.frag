@@ -0,0 +1,25 @@
+#version 330 core
+out uvec4 Feedback;
+
+in vec2 TexCoord;
+
+// set by bind_virtual_texture
+uniform vec2 vtUvScale;
+uniform float vtVirtualSize;
+uniform int vtLevels;
+uniform float vtTileSize;
+uniform float vtFeedbackBias;
+
+// writes the tile sample_virtual in virtual_texture.frag would want here
+void main() {
+    vec2 uv = clamp(TexCoord * vtUvScale, 0.0, 0.999999);
+
+    // this pass runs at reduced resolution, so derivatives are too large by the scale
+    vec2 dx = dFdx(uv * vtVirtualSize);
+    vec2 dy = dFdy(uv * vtVirtualSize);
+    float rho = max(dot(dx, dx), dot(dy, dy));
+    float level = clamp(0.5 * log2(max(rho, 1e-8)) - vtFeedbackBias, 0.0, float(vtLevels - 1));
+
+    int tiles = max(int(vtVirtualSize / vtTileSize) >> int(level), 1);
+    Feedback = uvec4(uvec2(uv * float(tiles)), uint(level), 1u);
+}
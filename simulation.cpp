@@ -0,0 +1,80 @@
+#include "simulation.h"
+#include <glm/glm.hpp>
+
+
+SIM_CLOCK create_sim_clock(float tick_rate, int max_ticks) {
+	SIM_CLOCK clock;
+	clock.tick_time		= 1.0 / tick_rate;
+	clock.accumulator	= 0.0;
+	clock.max_ticks		= max_ticks;
+	return clock;
+}
+
+
+// returns how many fixed ticks to run for this frame
+int advance_sim_clock(SIM_CLOCK *clock, double frame_time) {
+	clock->accumulator += frame_time;
+
+	int ticks = static_cast<int>(clock->accumulator / clock->tick_time);
+	if (ticks > clock->max_ticks) {
+		// hitch: drop the backlog rather than trying to catch up
+		ticks = clock->max_ticks;
+		clock->accumulator = 0.0;
+	} else {
+		clock->accumulator -= ticks * clock->tick_time;
+	}
+
+	return ticks;
+}
+
+
+// how far between the last two ticks the rendered frame lies
+float get_sim_alpha(const SIM_CLOCK *clock) {
+	return static_cast<float>(clock->accumulator / clock->tick_time);
+}
+
+
+SIM_STATE create_sim_state(const CAMERA *cam, int cube_count) {
+	SIM_STATE state;
+	state.cam			= *cam;
+	state.cube_count	= cube_count < MAX_CUBES ? cube_count : MAX_CUBES;
+	state.tick			= 0;
+	for (int i = 0; i < state.cube_count; i++) {
+		state.cube_angles[i] = 20.0f * i;
+	}
+	return state;
+}
+
+
+void simulate_tick(SIM_STATE *state, SIM_INPUT *input, float dt) {
+	if (input->mouse_dx != 0.0f || input->mouse_dy != 0.0f) {
+		get_cam_mouse_input(&state->cam, input->mouse_dx, input->mouse_dy);
+		input->mouse_dx = 0.0f;
+		input->mouse_dy = 0.0f;
+	}
+
+	if (input->scroll != 0.0f) {
+		get_cam_mouse_scroll(&state->cam, input->scroll);
+		input->scroll = 0.0f;
+	}
+
+	float forward	= (input->keys & INPUT_FORWARD ? 1.0f : 0.0f) - (input->keys & INPUT_BACKWARD ? 1.0f : 0.0f);
+	float strafe	= (input->keys & INPUT_RIGHT ? 1.0f : 0.0f) - (input->keys & INPUT_LEFT ? 1.0f : 0.0f);
+	get_cam_movement_input(&state->cam, forward, strafe, dt);
+
+	for (int i = 0; i < state->cube_count; i++) {
+		state->cube_angles[i] += CUBE_SPIN_SPEED * dt;
+	}
+
+	state->tick++;
+}
+
+
+void interpolate_sim_state(SIM_STATE *state, const SIM_STATE *prev, const SIM_STATE *curr, float alpha) {
+	interpolate_camera(&state->cam, &prev->cam, &curr->cam, alpha);
+	state->cube_count	= curr->cube_count;
+	state->tick			= curr->tick;
+	for (int i = 0; i < state->cube_count; i++) {
+		state->cube_angles[i] = glm::mix(prev->cube_angles[i], curr->cube_angles[i], alpha);
+	}
+}
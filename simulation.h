@@ -0,0 +1,46 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include "camera.h"
+#include "input.h"
+
+// default simulation values
+const float TICK_RATE			= 120.0f;	// ticks per second
+const int MAX_TICKS_PER_FRAME	= 8;		// beyond this the sim slows down instead of spiralling
+const int MAX_CUBES				= 64;
+const float CUBE_SPIN_SPEED		= 10.0f;	// degrees per second
+
+// everything the sim reads from the outside world for one tick
+typedef struct {
+	unsigned int keys;	// INPUT_KEY_BITS, held for every tick this frame runs
+
+	// consumed by the first tick that sees them
+	float mouse_dx;
+	float mouse_dy;
+	float scroll;
+} SIM_INPUT;
+
+typedef struct {
+	CAMERA cam;
+	int cube_count;
+	float cube_angles[MAX_CUBES];	// degrees
+	unsigned long long tick;
+} SIM_STATE;
+
+typedef struct {
+	double tick_time;
+	double accumulator;
+	int max_ticks;
+} SIM_CLOCK;
+
+
+SIM_CLOCK create_sim_clock(float tick_rate = TICK_RATE, int max_ticks = MAX_TICKS_PER_FRAME);
+int advance_sim_clock(SIM_CLOCK *clock, double frame_time);
+float get_sim_alpha(const SIM_CLOCK *clock);
+
+SIM_STATE create_sim_state(const CAMERA *cam, int cube_count);
+void simulate_tick(SIM_STATE *state, SIM_INPUT *input, float dt);
+// blends into state, whose camera keeps last frame's matrices if it did not move
+void interpolate_sim_state(SIM_STATE *state, const SIM_STATE *prev, const SIM_STATE *curr, float alpha);
+
+#endif
@@ -0,0 +1,216 @@
+#include "stream_buffer.h"
+#include <stdio.h>
+#include <chrono>
+
+#include "gl_ext.h"
+
+
+static double now_ms() {
+	using namespace std::chrono;
+	return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+
+// regions start on 256 bytes, enough for any offset alignment drivers ask for
+static bool create_storage(STREAM_BUFFER *stream, GLsizeiptr size) {
+	stream->size = size;
+	stream->region_size = (size / STREAM_FRAMES) & ~(GLsizeiptr)255;
+	stream->mapping = NULL;
+	glGenBuffers(1, &stream->buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, stream->buffer);
+	if (stream->mode == STREAM_MAP_RANGE) {
+		glBufferData(GL_COPY_WRITE_BUFFER, size, NULL, GL_STREAM_DRAW);
+		return true;
+	}
+
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	gl_ext.BufferStorage(GL_COPY_WRITE_BUFFER, size, NULL, flags);
+	stream->mapping = (unsigned char *)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags);
+	if (!stream->mapping) {
+		fprintf(stderr, "ERROR:STREAM_BUFFER:PERSISTENT_MAP:FAILED\n");
+		glDeleteBuffers(1, &stream->buffer);
+		stream->buffer = 0;
+		return false;
+	}
+	return true;
+}
+
+
+static void release_storage(STREAM_BUFFER *stream) {
+	if (stream->mapping || stream->mapped) {
+		glBindBuffer(GL_COPY_WRITE_BUFFER, stream->buffer);
+		glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+	}
+	glDeleteBuffers(1, &stream->buffer);
+	stream->buffer = 0;
+	stream->mapping = NULL;
+	stream->mapped = false;
+}
+
+
+// free once its fence has passed; counted as a stall if it had not yet
+static void wait_for_region(STREAM_BUFFER *stream, int region) {
+	GLsync fence = stream->fences[region];
+	if (!fence) {
+		return;
+	}
+	GLenum result = glClientWaitSync(fence, 0, 0);
+	if (result == GL_TIMEOUT_EXPIRED) {
+		double start = now_ms();
+		stream->stats.stalls++;
+		do {
+			result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, STREAM_WAIT_NS);
+		} while (result == GL_TIMEOUT_EXPIRED);
+		stream->stats.stall_ms += now_ms() - start;
+	}
+	if (result == GL_WAIT_FAILED) {
+		fprintf(stderr, "ERROR:STREAM_BUFFER:FENCE:WAIT_FAILED\n");
+	}
+	glDeleteSync(fence);
+	stream->fences[region] = NULL;
+}
+
+
+// doubles until the largest frame seen fits a region; waits for every region
+static void grow_stream(STREAM_BUFFER *stream) {
+	for (int region = 0; region < STREAM_FRAMES; region++) {
+		wait_for_region(stream, region);
+	}
+	GLsizeiptr size = stream->size;
+	while ((size / STREAM_FRAMES & ~(GLsizeiptr)255) < stream->wanted) {
+		size *= 2;
+	}
+	release_storage(stream);
+	if (!create_storage(stream, size)) {
+		stream->mode = STREAM_MAP_RANGE;
+		create_storage(stream, size);
+	}
+	stream->region = 0;
+	stream->wanted = 0;
+	stream->stats.grows++;
+}
+
+
+bool init_stream_buffer(STREAM_BUFFER *stream, GLsizeiptr size, bool allow_persistent) {
+	stream->mode = allow_persistent && gl_ext.buffer_storage ? STREAM_PERSISTENT : STREAM_MAP_RANGE;
+	stream->region = 0;
+	stream->head = 0;
+	stream->wanted = 0;
+	stream->mapped = false;
+	stream->frame_open = false;
+	for (int region = 0; region < STREAM_FRAMES; region++) {
+		stream->fences[region] = NULL;
+	}
+	stream->stats = {};
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &stream->uniform_alignment);
+	stream->storage_alignment = gl_ext.storage_buffer_alignment;
+
+	if (create_storage(stream, size)) {
+		return true;
+	}
+	stream->mode = STREAM_MAP_RANGE;
+	return create_storage(stream, size);
+}
+
+
+void destroy_stream_buffer(STREAM_BUFFER *stream) {
+	for (int region = 0; region < STREAM_FRAMES; region++) {
+		if (stream->fences[region]) {
+			glDeleteSync(stream->fences[region]);
+			stream->fences[region] = NULL;
+		}
+	}
+	if (stream->buffer) {
+		release_storage(stream);
+	}
+}
+
+
+void begin_stream_frame(STREAM_BUFFER *stream) {
+	stream_commit(stream);
+	if (stream->frame_open) {
+		stream->fences[stream->region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		stream->stats.frames++;
+		stream->stats.frame_bytes = stream->head;
+		if (stream->head > stream->stats.peak_frame_bytes) {
+			stream->stats.peak_frame_bytes = stream->head;
+		}
+		stream->region = (stream->region + 1) % STREAM_FRAMES;
+	}
+
+	if (stream->wanted > stream->region_size) {
+		grow_stream(stream);
+	}
+	wait_for_region(stream, stream->region);
+	stream->head = 0;
+	stream->frame_open = true;
+}
+
+
+STREAM_ALLOCATION stream_alloc(STREAM_BUFFER *stream, GLsizeiptr size, GLsizeiptr align) {
+	STREAM_ALLOCATION allocation = { 0, NULL, size };
+	stream_commit(stream);
+
+	GLintptr region_start = stream->region * stream->region_size;
+	GLintptr start = (region_start + stream->head + align - 1) & ~(GLintptr)(align - 1);
+	GLsizeiptr needed = start + size - region_start;
+	if (needed > stream->region_size) {
+		stream->stats.failures++;
+		stream->wanted = needed > stream->wanted ? needed : stream->wanted;
+		return allocation;
+	}
+	stream->head = needed;
+	allocation.offset = start;
+
+	if (stream->mode == STREAM_PERSISTENT) {
+		allocation.data = stream->mapping + start;
+		return allocation;
+	}
+	if (size == 0) {
+		// a frame with nothing to draw; glMapBufferRange rejects an empty
+		// range, and data only has to tell the caller this did not fail
+		static unsigned char empty;
+		allocation.data = &empty;
+		return allocation;
+	}
+	// the fences already keep the GPU off this range, so no implicit sync
+	glBindBuffer(GL_COPY_WRITE_BUFFER, stream->buffer);
+	allocation.data = glMapBufferRange(GL_COPY_WRITE_BUFFER, start, size,
+			GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+	if (!allocation.data) {
+		fprintf(stderr, "ERROR:STREAM_BUFFER:MAP_RANGE:FAILED\n");
+		stream->stats.failures++;
+		return allocation;
+	}
+	stream->mapped = true;
+	return allocation;
+}
+
+
+void stream_commit(STREAM_BUFFER *stream) {
+	if (!stream->mapped) {
+		return;
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, stream->buffer);
+	glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+	stream->mapped = false;
+}
+
+
+GLsizeiptr get_stream_uniform_alignment(const STREAM_BUFFER *stream) {
+	return stream->uniform_alignment > 0 ? stream->uniform_alignment : STREAM_ALIGN;
+}
+
+
+GLsizeiptr get_stream_storage_alignment(const STREAM_BUFFER *stream) {
+	return stream->storage_alignment > 0 ? stream->storage_alignment : STREAM_ALIGN;
+}
+
+
+const char *get_stream_mode_name(STREAM_MODE mode) {
+	switch (mode) {
+		case STREAM_PERSISTENT: return "persistent";
+		case STREAM_MAP_RANGE: return "map range";
+		default: return "unknown";
+	}
+}
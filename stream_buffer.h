@@ -0,0 +1,76 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <glad/glad.h>
+
+// default stream buffer values
+const int STREAM_FRAMES				= 3;			// regions in the ring, each fenced on its own
+const GLsizeiptr STREAM_BUFFER_SIZE	= 3 << 20;		// all regions together
+const GLsizeiptr STREAM_ALIGN		= 16;			// default sub-allocation alignment
+const GLuint64 STREAM_WAIT_NS		= 1000000;		// per glClientWaitSync while stalled
+
+enum STREAM_MODE {
+	STREAM_PERSISTENT,		// GL_ARB_buffer_storage: mapped once, written in place
+	STREAM_MAP_RANGE		// GL 3.3: each allocation mapped unsynchronized, fences keep it safe
+};
+
+// where the caller writes and what to point GL at
+typedef struct {
+	GLintptr offset;	// from the start of the buffer, for attribute pointers and glBindBufferRange
+	void *data;			// NULL when the allocation failed
+	GLsizeiptr size;
+} STREAM_ALLOCATION;
+
+typedef struct {
+	long frames;
+	GLsizeiptr frame_bytes;			// used by the last finished frame, padding included
+	GLsizeiptr peak_frame_bytes;
+	long stalls;					// frames that had to wait for the GPU to release their region
+	double stall_ms;
+	long failures;					// allocations that did not fit in their frame's region
+	long grows;
+} STREAM_STATS;
+
+// One buffer split into STREAM_FRAMES regions used round robin, a frame at a
+// time. Starting a frame fences the region the last frame wrote and waits for
+// the fence on the region it is about to reuse, so nothing the GPU may still be
+// reading is overwritten; that wait is the only synchronization, and with
+// enough regions it never blocks. A frame that outgrows its region gets failed
+// allocations, and the buffer doubles at the start of the next frame
+typedef struct {
+	unsigned int buffer;
+	STREAM_MODE mode;
+	GLsizeiptr size;
+	GLsizeiptr region_size;
+	int region;
+	GLsizeiptr head;				// bytes used in the current region
+	GLsizeiptr wanted;				// largest frame asked for, when more than a region
+	unsigned char *mapping;			// the whole buffer, STREAM_PERSISTENT only
+	bool mapped;					// a STREAM_MAP_RANGE allocation awaits stream_commit
+	bool frame_open;				// begin_stream_frame has run, so the region has a frame to fence
+	GLsync fences[STREAM_FRAMES];
+	int uniform_alignment;
+	int storage_alignment;			// 0 without shader storage buffers
+	STREAM_STATS stats;
+} STREAM_BUFFER;
+
+
+// GL thread, after load_gl_extensions; persistent mapping unless the driver
+// lacks it or allow_persistent is false. Leaves GL_COPY_WRITE_BUFFER bound
+bool init_stream_buffer(STREAM_BUFFER *stream, GLsizeiptr size = STREAM_BUFFER_SIZE, bool allow_persistent = true);
+void destroy_stream_buffer(STREAM_BUFFER *stream);
+
+// GL thread, once per frame before its first allocation; fences the last
+// frame's region, so call it after that frame's draws were submitted
+void begin_stream_frame(STREAM_BUFFER *stream);
+// align is a power of two; get_stream_uniform_alignment for glBindBufferRange.
+// Write the data, then call stream_commit before the next allocation or draw.
+// A size of 0 succeeds with data that must not be written
+STREAM_ALLOCATION stream_alloc(STREAM_BUFFER *stream, GLsizeiptr size, GLsizeiptr align = STREAM_ALIGN);
+void stream_commit(STREAM_BUFFER *stream);
+
+GLsizeiptr get_stream_uniform_alignment(const STREAM_BUFFER *stream);
+GLsizeiptr get_stream_storage_alignment(const STREAM_BUFFER *stream);
+const char *get_stream_mode_name(STREAM_MODE mode);
+
+#endif
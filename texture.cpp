@@ -0,0 +1,99 @@
+#include "texture.h"
+#include <stdlib.h>
+#include <vector>
+
+#include "image_decoder.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+bool make_texture(const char *texture_path, bool srgb) {
+    std::vector<unsigned char> data;
+    FILE *file = fopen(texture_path, "rb");
+    if (file) {
+        fseek(file, 0, SEEK_END);
+        long size = ftell(file);
+        fseek(file, 0, SEEK_SET);
+        data.resize(size > 0 ? size : 0);
+        if (fread(data.data(), 1, data.size(), file) != data.size()) {
+            data.clear();
+        }
+        fclose(file);
+    }
+
+    int width, height, channels;
+    unsigned char *pixels = data.empty() ? NULL : decode_texture(data.data(), (int)data.size(), &width, &height, &channels);
+    if (!pixels) {
+        fprintf(stderr, "Failed to load texture %s\n", texture_path);
+        return false;
+    }
+
+    bool uploaded = upload_texture(pixels, width, height, channels, srgb);
+    free_texture_pixels(pixels);
+    return uploaded;
+}
+
+
+unsigned char *decode_texture(const unsigned char *data, int size, int *width, int *height, int *channels) {
+    // RGB has no fast GL upload path, so have the decoder's colour conversion write RGBA
+    int stored = 0;
+    int w, h;
+    if (get_image_info(data, (size_t)size, &w, &h, &stored) && stored == 3) {
+        stored = 4;
+    }
+
+    DECODED_IMAGE image;
+    if (!decode_image(data, (size_t)size, &image, stored)) {
+        return NULL;
+    }
+    *width = image.width;
+    *height = image.height;
+    *channels = image.channels;
+    return image.pixels;
+}
+
+
+TEXTURE_FORMAT get_texture_format(int channels, bool srgb) {
+    switch (channels) {
+        case 1: return { GL_R8, GL_RED, true };
+        case 2: return { GL_RG8, GL_RG, true };
+        case 3: return { srgb ? GL_SRGB8 : GL_RGB8, GL_RGB, false };
+        default: return { srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8, GL_RGBA, false };
+    }
+}
+
+
+int get_unpack_alignment(int row_bytes) {
+    if (row_bytes % 8 == 0) return 8;
+    if (row_bytes % 4 == 0) return 4;
+    if (row_bytes % 2 == 0) return 2;
+    return 1;
+}
+
+
+bool upload_texture(const unsigned char *pixels, int width, int height, int channels, bool srgb) {
+    if (channels < 1 || channels > 4) {
+        fprintf(stderr, "Failed to create texture: %d channels\n", channels);
+        return false;
+    }
+
+    // matching the real row alignment lets the driver copy rows without repacking
+    TEXTURE_FORMAT format = get_texture_format(channels, srgb);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, get_unpack_alignment(width * channels));
+    glTexImage2D(GL_TEXTURE_2D, 0, format.internal_format, width, height, 0, format.format, GL_UNSIGNED_BYTE, pixels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    if (format.luminance) {
+        GLint swizzle[4] = { GL_RED, GL_RED, GL_RED, channels == 2 ? GL_GREEN : GL_ONE };
+        glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+    }
+
+    glGenerateMipmap(GL_TEXTURE_2D);
+    return true;
+}
+
+
+// every decoder backend allocates with malloc or aligned_alloc
+void free_texture_pixels(unsigned char *pixels) {
+    free(pixels);
+}
@@ -2,34 +2,27 @@
 #define TEXTURE_H
 
 #include <glad/glad.h>
+#include <stdio.h>
 
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
+// the GL format for pixels as they sit in memory, picked from their channel count
+typedef struct {
+	GLint internal_format;
+	GLenum format;
+	bool luminance;		// one or two channels, sampled as grey (and alpha) through a swizzle
+} TEXTURE_FORMAT;
 
-const int PNG_TEX = 1;
-const int JPG_TEX = 2;
 
-void make_texture(const char *texture_path, const int image_type) {
-    int texWidth, texHeight, texChannels;
-    stbi_set_flip_vertically_on_load(GL_TRUE);
-    unsigned char *pixels = stbi_load(texture_path, &texWidth, &texHeight, &texChannels, 0);
+TEXTURE_FORMAT get_texture_format(int channels, bool srgb = false);
+// the largest GL_UNPACK_ALIGNMENT tightly packed rows of this size satisfy
+int get_unpack_alignment(int row_bytes);
 
-    if (pixels) {
-        if (image_type == PNG_TEX)
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, texWidth, texHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
-        else if (image_type == JPG_TEX)
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, texWidth, texHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels);
-        else {
-            fprintf(stderr, "Failed to create texture: Wrong texture type\n");
-            stbi_image_free(pixels);
-            return;
-        }
-        glGenerateMipmap(GL_TEXTURE_2D);
-    } else {
-        fprintf(stderr, "Failed to load texture %s\n", texture_path);
-    }
+bool make_texture(const char *texture_path, bool srgb = false);
 
-    stbi_image_free(pixels);
-}
+// split form of make_texture: decode can run on any thread, upload needs the GL thread.
+// decode_texture writes the layout upload_texture sends as is: colour images
+// come out RGBA straight from the decoder, grey ones keep one or two channels
+unsigned char *decode_texture(const unsigned char *data, int size, int *width, int *height, int *channels);
+bool upload_texture(const unsigned char *pixels, int width, int height, int channels, bool srgb = false);
+void free_texture_pixels(unsigned char *pixels);
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,243 @@
+#include "texture_array.h"
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "gl_ext.h"
+
+
+static int count_levels(int width, int height) {
+	int levels = 1;
+	while ((width >> levels) || (height >> levels)) {
+		levels++;
+	}
+	return levels;
+}
+
+
+static int level_size(int size, int level) {
+	return size >> level ? size >> level : 1;
+}
+
+
+static unsigned int create_array_texture(int width, int height, int capacity) {
+	unsigned int texture;
+	glGenTextures(1, &texture);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+
+	// allocate the whole mip chain now: once a bindless handle exists the
+	// storage is frozen and levels may only be filled in
+	int levels = count_levels(width, height);
+	for (int level = 0; level < levels; level++) {
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, level_size(width, level), level_size(height, level),
+				capacity, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	}
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levels - 1);
+	return texture;
+}
+
+
+static void acquire_handle(TEXTURE_ARRAY *array) {
+	array->handle = 0;
+	if (gl_ext.bindless_texture) {
+		array->handle = array->sampler ? gl_ext.GetTextureSamplerHandleARB(array->texture, array->sampler)
+				: gl_ext.GetTextureHandleARB(array->texture);
+		gl_ext.MakeTextureHandleResidentARB(array->handle);
+	}
+}
+
+
+static void release_handle(TEXTURE_ARRAY *array) {
+	if (array->handle) {
+		gl_ext.MakeTextureHandleNonResidentARB(array->handle);
+		array->handle = 0;
+	}
+}
+
+
+// Filtering past a layer's uv-scaled edge, wider still with anisotropy,
+// reads texels outside its image, so every level of every layer is filled
+// out to the full level with the image's edge texels
+
+// copies a layer's image at one level into another texture and stretches its
+// last column and row over the rest of the level with nearest-filtered blits
+static void copy_layer_level(unsigned int source, int source_level, unsigned int texture, int level, int layer,
+		int width, int height, int level_width, int level_height, const unsigned int fbos[2]) {
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, fbos[0]);
+	glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, source, source_level, layer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbos[1]);
+	glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, texture, level, layer);
+
+	glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	if (level_width > width) {
+		glBlitFramebuffer(width - 1, 0, width, height, width, 0, level_width, height,
+				GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	}
+	if (level_height > height) {
+		glBlitFramebuffer(0, height - 1, width, height, 0, height, width, level_height,
+				GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	}
+	if (level_width > width && level_height > height) {
+		glBlitFramebuffer(width - 1, height - 1, width, height, width, height, level_width, level_height,
+				GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	}
+}
+
+
+// the same on the CPU, for an upload: one level of the chain written out to
+// level_width x level_height
+static void pad_level(const unsigned char *pixels, int width, int height, int level_width, int level_height,
+		std::vector<unsigned char> *padded) {
+	padded->resize((size_t)level_width * level_height * 4);
+	for (int y = 0; y < level_height; y++) {
+		const unsigned char *src = pixels + (size_t)(y < height ? y : height - 1) * width * 4;
+		unsigned char *dst = padded->data() + (size_t)y * level_width * 4;
+		memcpy(dst, src, (size_t)width * 4);
+		for (int x = width; x < level_width; x++) {
+			memcpy(dst + (size_t)x * 4, src + (size_t)(width - 1) * 4, 4);
+		}
+	}
+}
+
+
+// copies every uploaded layer into a new, larger array on the GPU, each level
+// refilled out to its new size. Levels the old array lacked come from its last
+// level, where every image had already run down to one texel
+static void reallocate_texture_array(TEXTURE_ARRAY *array, int width, int height, int capacity) {
+	unsigned int old_texture = array->texture;
+	unsigned int texture = create_array_texture(width, height, capacity);
+	int levels = count_levels(width, height);
+
+	unsigned int fbos[2];
+	glGenFramebuffers(2, fbos);
+	for (int layer = 0; layer < array->capacity; layer++) {
+		if (!array->layer_width[layer]) {
+			continue;
+		}
+		for (int level = 0; level < levels; level++) {
+			int source_level = level < array->levels ? level : array->levels - 1;
+			copy_layer_level(old_texture, source_level, texture, level, layer,
+					level_size(array->layer_width[layer], level), level_size(array->layer_height[layer], level),
+					level_size(width, level), level_size(height, level), fbos);
+		}
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteFramebuffers(2, fbos);
+
+	release_handle(array);
+	glDeleteTextures(1, &old_texture);
+
+	array->texture = texture;
+	array->width = width;
+	array->height = height;
+	array->levels = levels;
+	array->capacity = capacity;
+	array->generation++;
+	acquire_handle(array);
+}
+
+
+void init_texture_array(TEXTURE_ARRAY *array, int width, int height, int capacity) {
+	if (capacity > TEXTURE_ARRAY_MAX_LAYERS) capacity = TEXTURE_ARRAY_MAX_LAYERS;
+
+	array->texture = create_array_texture(width, height, capacity);
+	array->generation = 0;
+	array->sampler = 0;
+	acquire_handle(array);
+	array->width = width;
+	array->height = height;
+	array->levels = count_levels(width, height);
+	array->capacity = capacity;
+	array->reserved.store(0);
+	for (int i = 0; i < TEXTURE_ARRAY_MAX_LAYERS; i++) {
+		array->layer_width[i] = 0;
+		array->layer_height[i] = 0;
+	}
+}
+
+
+void destroy_texture_array(TEXTURE_ARRAY *array) {
+	release_handle(array);
+	glDeleteTextures(1, &array->texture);
+	array->texture = 0;
+}
+
+
+int reserve_texture_layer(TEXTURE_ARRAY *array) {
+	int layer = array->reserved.fetch_add(1, std::memory_order_relaxed);
+	if (layer >= TEXTURE_ARRAY_MAX_LAYERS) {
+		fprintf(stderr, "ERROR:TEXTURE_ARRAY:FULL\n");
+		return -1;
+	}
+	return layer;
+}
+
+
+bool upload_texture_layer(TEXTURE_ARRAY *array, int layer, const MIP_CHAIN *chain) {
+	if (layer < 0 || layer >= TEXTURE_ARRAY_MAX_LAYERS) {
+		return false;
+	}
+	int width = chain->width[0];
+	int height = chain->height[0];
+
+	// grow to fit: layer size to the largest image, layer count by doubling
+	int new_width = width > array->width ? width : array->width;
+	int new_height = height > array->height ? height : array->height;
+	int new_capacity = array->capacity;
+	while (layer >= new_capacity) {
+		new_capacity *= 2;
+	}
+	if (new_capacity > TEXTURE_ARRAY_MAX_LAYERS) new_capacity = TEXTURE_ARRAY_MAX_LAYERS;
+
+	if (new_width != array->width || new_height != array->height || new_capacity != array->capacity) {
+		reallocate_texture_array(array, new_width, new_height, new_capacity);
+	}
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, array->texture);
+
+	// a smaller image runs out of levels first; its last 1x1 level fills the rest
+	std::vector<unsigned char> padded;
+	for (int level = 0; level < array->levels; level++) {
+		int source = level < chain->levels ? level : chain->levels - 1;
+		int level_width = level_size(array->width, level);
+		int level_height = level_size(array->height, level);
+		const unsigned char *pixels = get_mip_level(chain, source);
+		if (chain->width[source] != level_width || chain->height[source] != level_height) {
+			pad_level(pixels, chain->width[source], chain->height[source], level_width, level_height, &padded);
+			pixels = padded.data();
+		}
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, level_width, level_height, 1,
+				GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+	}
+
+	array->layer_width[layer] = width;
+	array->layer_height[layer] = height;
+	array->generation++;
+	return true;
+}
+
+
+void set_texture_array_sampler(TEXTURE_ARRAY *array, unsigned int sampler) {
+	release_handle(array);
+	array->sampler = sampler;
+	acquire_handle(array);
+	array->generation++;
+}
+
+
+glm::vec2 get_layer_uv_scale(const TEXTURE_ARRAY *array, int layer) {
+	if (layer < 0 || layer >= TEXTURE_ARRAY_MAX_LAYERS || !array->layer_width[layer]) {
+		return glm::vec2(1.0f, 1.0f);
+	}
+	return glm::vec2((float)array->layer_width[layer] / array->width,
+			(float)array->layer_height[layer] / array->height);
+}
+
+
+void bind_texture_array(const TEXTURE_ARRAY *array, int unit) {
+	glActiveTexture(GL_TEXTURE0 + unit);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, array->texture);
+	glBindSampler(unit, array->sampler);
+}
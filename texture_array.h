@@ -0,0 +1,55 @@
+#ifndef TEXTURE_ARRAY_H
+#define TEXTURE_ARRAY_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <atomic>
+
+#include "mipmap.h"
+
+// default texture array values
+const int TEXTURE_ARRAY_MAX_LAYERS		= 64;	// matches layerScale[] in shader.frag
+const int TEXTURE_ARRAY_INITIAL_LAYERS	= 4;
+
+// Every material texture lives in one GL_TEXTURE_2D_ARRAY, so draws pick their
+// texture with a per-instance layer index instead of a bind. Layers share one
+// size; smaller images sit in the corner of their layer and are sampled through
+// a per-layer uv scale, with the rest of every level filled with their edge
+// texels so filtering past the edge stays defined. Adding an image larger than
+// the current layer size, or more layers than allocated, rebuilds the array and
+// copies the old layers over.
+typedef struct {
+	unsigned int texture;
+	unsigned int generation;	// bumped whenever texture is recreated or a layer uploaded
+	GLuint64 handle;			// bindless handle, 0 when bindless is unavailable
+	unsigned int sampler;		// shared sampler state, 0 for GL's defaults
+
+	int width;
+	int height;
+	int levels;
+	int capacity;
+	std::atomic<int> reserved;	// layers handed out by reserve_texture_layer
+
+	int layer_width[TEXTURE_ARRAY_MAX_LAYERS];	// 0 until the layer is uploaded
+	int layer_height[TEXTURE_ARRAY_MAX_LAYERS];
+} TEXTURE_ARRAY;
+
+
+void init_texture_array(TEXTURE_ARRAY *array, int width, int height, int capacity = TEXTURE_ARRAY_INITIAL_LAYERS);
+void destroy_texture_array(TEXTURE_ARRAY *array);
+
+// any thread; -1 once the array is full
+int reserve_texture_layer(TEXTURE_ARRAY *array);
+// GL thread; may reallocate the array, so callers must watch generation.
+// the chain's levels are copied in as they are and padded out to the layer
+// size on the GPU; no other layer is touched
+bool upload_texture_layer(TEXTURE_ARRAY *array, int layer, const MIP_CHAIN *chain);
+
+// GL thread: the array holds pixels only, filtering comes from this sampler.
+// A bindless handle bakes the sampler in, so it is reacquired and generation bumped
+void set_texture_array_sampler(TEXTURE_ARRAY *array, unsigned int sampler);
+
+glm::vec2 get_layer_uv_scale(const TEXTURE_ARRAY *array, int layer);
+void bind_texture_array(const TEXTURE_ARRAY *array, int unit);
+
+#endif
@@ -0,0 +1,168 @@
+#include "texture_atlas.h"
+#include <glad/glad.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+static unsigned int create_atlas_page(int size, int max_level) {
+	unsigned int texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	// deeper mips would average texels across gutters
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, max_level);
+
+	for (int level = 0; level <= max_level; level++) {
+		glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, size >> level, size >> level, 0,
+				GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	}
+	return texture;
+}
+
+
+void init_texture_atlas(TEXTURE_ATLAS *atlas, int page_size, int padding) {
+	atlas->page_size = page_size;
+	atlas->padding = padding > 0 ? padding : 1;
+	atlas->max_level = 0;
+	while ((2 << atlas->max_level) <= atlas->padding) {
+		atlas->max_level++;
+	}
+	atlas->pages.clear();
+	atlas->packers.clear();
+	atlas->dirty.clear();
+	atlas->image_count = 0;
+}
+
+
+void destroy_texture_atlas(TEXTURE_ATLAS *atlas) {
+	if (!atlas->pages.empty()) {
+		glDeleteTextures((int)atlas->pages.size(), atlas->pages.data());
+	}
+	atlas->pages.clear();
+	atlas->packers.clear();
+	atlas->dirty.clear();
+	atlas->image_count = 0;
+}
+
+
+unsigned char *expand_atlas_image(const unsigned char *pixels, int width, int height, int channels, int padding) {
+	if (channels < 1 || channels > 4) {
+		fprintf(stderr, "ERROR:ATLAS:UNSUPPORTED_CHANNELS\n");
+		return NULL;
+	}
+
+	int padded_width = width + 2 * padding;
+	int padded_height = height + 2 * padding;
+	unsigned char *image = (unsigned char *)malloc((size_t)padded_width * padded_height * 4);
+	if (!image) {
+		return NULL;
+	}
+
+	// every gutter texel repeats the nearest edge texel of the image
+	for (int y = 0; y < padded_height; y++) {
+		int src_y = y - padding;
+		if (src_y < 0) src_y = 0;
+		if (src_y >= height) src_y = height - 1;
+		const unsigned char *src_row = pixels + (size_t)src_y * width * channels;
+		unsigned char *dst = image + (size_t)y * padded_width * 4;
+
+		for (int x = 0; x < padded_width; x++, dst += 4) {
+			int src_x = x - padding;
+			if (src_x < 0) src_x = 0;
+			if (src_x >= width) src_x = width - 1;
+			const unsigned char *src = src_row + (size_t)src_x * channels;
+
+			switch (channels) {
+				case 1: dst[0] = dst[1] = dst[2] = src[0]; dst[3] = 255; break;
+				case 2: dst[0] = dst[1] = dst[2] = src[0]; dst[3] = src[1]; break;
+				case 3: dst[0] = src[0]; dst[1] = src[1]; dst[2] = src[2]; dst[3] = 255; break;
+				case 4: dst[0] = src[0]; dst[1] = src[1]; dst[2] = src[2]; dst[3] = src[3]; break;
+			}
+		}
+	}
+	return image;
+}
+
+
+void free_atlas_image(unsigned char *image) {
+	free(image);
+}
+
+
+bool add_atlas_image(TEXTURE_ATLAS *atlas, const unsigned char *image, int width, int height, ATLAS_REGION *region) {
+	int padding = atlas->padding;
+	// round the slot up to the padding grid so mip texels line up with it
+	int slot_width = (width + 2 * padding + padding - 1) / padding * padding;
+	int slot_height = (height + 2 * padding + padding - 1) / padding * padding;
+	if (slot_width > atlas->page_size || slot_height > atlas->page_size) {
+		fprintf(stderr, "ERROR:ATLAS:IMAGE_TOO_LARGE %dx%d\n", width, height);
+		return false;
+	}
+
+	int page = -1;
+	int slot_x = 0, slot_y = 0;
+	for (size_t i = 0; i < atlas->packers.size(); i++) {
+		if (skyline_pack(&atlas->packers[i], slot_width, slot_height, &slot_x, &slot_y)) {
+			page = (int)i;
+			break;
+		}
+	}
+	if (page < 0) {
+		SKYLINE_PACKER packer;
+		init_skyline_packer(&packer, atlas->page_size, atlas->page_size);
+		skyline_pack(&packer, slot_width, slot_height, &slot_x, &slot_y);
+		atlas->packers.push_back(packer);
+		atlas->pages.push_back(create_atlas_page(atlas->page_size, atlas->max_level));
+		atlas->dirty.push_back(0);
+		page = (int)atlas->pages.size() - 1;
+	}
+
+	glBindTexture(GL_TEXTURE_2D, atlas->pages[page]);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, slot_x, slot_y, width + 2 * padding, height + 2 * padding,
+			GL_RGBA, GL_UNSIGNED_BYTE, image);
+	atlas->dirty[page] = 1;
+	atlas->image_count++;
+
+	float size = (float)atlas->page_size;
+	region->page = page;
+	region->x = slot_x + padding;
+	region->y = slot_y + padding;
+	region->width = width;
+	region->height = height;
+	region->uv_offset = glm::vec2(region->x / size, region->y / size);
+	region->uv_scale = glm::vec2(width / size, height / size);
+	return true;
+}
+
+
+void flush_texture_atlas(TEXTURE_ATLAS *atlas) {
+	for (size_t i = 0; i < atlas->pages.size(); i++) {
+		if (!atlas->dirty[i]) {
+			continue;
+		}
+		glBindTexture(GL_TEXTURE_2D, atlas->pages[i]);
+		glGenerateMipmap(GL_TEXTURE_2D);
+		atlas->dirty[i] = 0;
+	}
+}
+
+
+glm::vec2 atlas_uv(const ATLAS_REGION *region, glm::vec2 uv) {
+	return region->uv_offset + uv * region->uv_scale;
+}
+
+
+float get_atlas_occupancy(const TEXTURE_ATLAS *atlas) {
+	if (atlas->packers.empty()) {
+		return 0.0f;
+	}
+	double used = 0.0;
+	for (const SKYLINE_PACKER &packer : atlas->packers) {
+		used += (double)packer.used_area;
+	}
+	return (float)(used / ((double)atlas->page_size * atlas->page_size * atlas->packers.size()));
+}
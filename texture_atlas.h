@@ -0,0 +1,55 @@
+#ifndef TEXTURE_ATLAS_H
+#define TEXTURE_ATLAS_H
+
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "atlas_packer.h"
+
+// default atlas values
+const int ATLAS_PAGE_SIZE	= 2048;
+const int ATLAS_PADDING		= 4;	// gutter texels around each image, also the placement alignment
+
+// Small images are packed into shared RGBA8 pages instead of getting a texture
+// object each. Every image is surrounded by a gutter of its own edge texels and
+// placed on a padding-aligned grid, so mips up to log2(padding) never blend in
+// a neighbour. New images go into the first page with room, opening a new page
+// when none has any; pages only regenerate their mips in flush_texture_atlas.
+typedef struct {
+	int page;
+	int x;			// texel rect of the image itself, gutter excluded
+	int y;
+	int width;
+	int height;
+	glm::vec2 uv_offset;
+	glm::vec2 uv_scale;
+} ATLAS_REGION;
+
+typedef struct {
+	int page_size;
+	int padding;
+	int max_level;
+
+	std::vector<unsigned int> pages;
+	std::vector<SKYLINE_PACKER> packers;
+	std::vector<char> dirty;
+	int image_count;
+} TEXTURE_ATLAS;
+
+
+void init_texture_atlas(TEXTURE_ATLAS *atlas, int page_size = ATLAS_PAGE_SIZE, int padding = ATLAS_PADDING);
+void destroy_texture_atlas(TEXTURE_ATLAS *atlas);
+
+// any thread: converts to RGBA and adds the gutter, free with free_atlas_image
+unsigned char *expand_atlas_image(const unsigned char *pixels, int width, int height, int channels, int padding);
+void free_atlas_image(unsigned char *image);
+
+// GL thread: image comes from expand_atlas_image, width and height are the unpadded size
+bool add_atlas_image(TEXTURE_ATLAS *atlas, const unsigned char *image, int width, int height, ATLAS_REGION *region);
+// GL thread: rebuild the mips of every page touched since the last flush
+void flush_texture_atlas(TEXTURE_ATLAS *atlas);
+
+glm::vec2 atlas_uv(const ATLAS_REGION *region, glm::vec2 uv);
+float get_atlas_occupancy(const TEXTURE_ATLAS *atlas);
+
+#endif
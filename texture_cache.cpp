@@ -0,0 +1,196 @@
+#include "texture_cache.h"
+#include <glad/glad.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "mipmap.h"
+#include "texture.h"
+
+
+// "./textures/a.jpg" and "textures/../textures/a.jpg" are one file; a path
+// that does not resolve is kept as given and fails in the load
+static std::string canonical_path(const char *path) {
+	char *resolved = realpath(path, NULL);
+	if (!resolved) {
+		return path;
+	}
+	std::string canonical = resolved;
+	free(resolved);
+	return canonical;
+}
+
+
+static ASSET_TASK load_cached_texture_async(TEXTURE_CACHE *cache, int id, unsigned int serial, std::string path) {
+	ASSET_LOADER *loader = cache->loader;
+	loader->pending.fetch_add(1, std::memory_order_relaxed);
+
+	FILE_READ file = co_await read_file_async(loader, path.c_str());
+	MIP_CHAIN chain;
+	MIP_BUILD build = { &chain, NULL, 0, 0, 0, false };
+	OWNED_PIXELS pixels(NULL, free_texture_pixels);
+	if (file.error) {
+		fprintf(stderr, "Failed to load texture %s\n", path.c_str());
+	} else {
+		pixels.reset(decode_texture(file.data, (int)file.size, &build.width, &build.height, &build.channels));
+		if (!pixels) {
+			fprintf(stderr, "Failed to decode texture %s\n", path.c_str());
+		}
+	}
+	release_file_read(&loader->reader, &file);
+
+	if (pixels) {
+		build.pixels = pixels.get();
+		co_await run_on_workers(loader, build_mip_chain_job, &build);
+		pixels.reset();
+	}
+	bool decoded = build.built;
+
+	co_await resume_on_gl_thread(loader);
+	// a load whose references all went while it was in flight is dropped
+	CACHED_TEXTURE *texture = &cache->textures[id];
+	if (texture->serial == serial && decoded) {
+		glBindTexture(GL_TEXTURE_2D, texture->texture);
+		upload_mip_chain(&chain);
+		texture->width = chain.width[0];
+		texture->height = chain.height[0];
+	}
+	finish_asset(loader);
+}
+
+
+void init_texture_cache(TEXTURE_CACHE *cache, ASSET_LOADER *loader, SAMPLER_CACHE *samplers) {
+	cache->loader = loader;
+	cache->samplers = samplers;
+	cache->textures.clear();
+	cache->by_path.clear();
+	cache->array = NULL;
+	cache->layers_by_path.clear();
+	cache->next_serial = 0;
+	cache->stats = {};
+}
+
+
+void destroy_texture_cache(TEXTURE_CACHE *cache) {
+	for (CACHED_TEXTURE &texture : cache->textures) {
+		if (texture.texture) {
+			glDeleteTextures(1, &texture.texture);
+		}
+	}
+	cache->textures.clear();
+	cache->by_path.clear();
+	cache->array = NULL;
+	cache->layers_by_path.clear();
+	cache->stats.textures = 0;
+	cache->stats.layers = 0;
+}
+
+
+TEXTURE_REF acquire_texture(TEXTURE_CACHE *cache, const char *path, const SAMPLER_DESC *sampler) {
+	TEXTURE_REF ref;
+	ref.sampler = acquire_sampler(cache->samplers, sampler);
+
+	std::string canonical = canonical_path(path);
+	auto found = cache->by_path.find(canonical);
+	if (found != cache->by_path.end()) {
+		ref.id = found->second;
+		cache->textures[ref.id].refs++;
+		cache->stats.hits++;
+		return ref;
+	}
+
+	ref.id = -1;
+	for (size_t i = 0; i < cache->textures.size(); i++) {
+		if (!cache->textures[i].texture) {
+			ref.id = (int)i;
+			break;
+		}
+	}
+	if (ref.id < 0) {
+		ref.id = (int)cache->textures.size();
+		cache->textures.emplace_back();
+	}
+
+	CACHED_TEXTURE *texture = &cache->textures[ref.id];
+	glGenTextures(1, &texture->texture);
+	texture->serial = ++cache->next_serial;
+	texture->path = canonical;
+	texture->refs = 1;
+	texture->width = 0;
+	texture->height = 0;
+	cache->by_path[canonical] = ref.id;
+	cache->stats.textures++;
+	cache->stats.misses++;
+
+	load_cached_texture_async(cache, ref.id, texture->serial, canonical);
+	return ref;
+}
+
+
+void release_texture(TEXTURE_CACHE *cache, TEXTURE_REF ref) {
+	if (ref.id < 0) {
+		return;
+	}
+	release_sampler(cache->samplers, ref.sampler);
+
+	CACHED_TEXTURE *texture = &cache->textures[ref.id];
+	if (--texture->refs > 0) {
+		return;
+	}
+	cache->by_path.erase(texture->path);
+	glDeleteTextures(1, &texture->texture);
+	texture->texture = 0;
+	texture->serial = 0;
+	texture->path.clear();
+	cache->stats.textures--;
+}
+
+
+int acquire_texture_layer(TEXTURE_CACHE *cache, TEXTURE_ARRAY *array, const char *path) {
+	if (cache->array && cache->array != array) {
+		fprintf(stderr, "ERROR:TEXTURE_CACHE:LAYER:OTHER_ARRAY %s\n", path);
+		return -1;
+	}
+	cache->array = array;
+
+	std::string canonical = canonical_path(path);
+	auto found = cache->layers_by_path.find(canonical);
+	if (found != cache->layers_by_path.end()) {
+		cache->stats.hits++;
+		return found->second;
+	}
+
+	// a full array is not remembered, so every material asking reports it
+	int layer = reserve_texture_layer(array);
+	if (layer < 0) {
+		return -1;
+	}
+	cache->layers_by_path[canonical] = layer;
+	cache->stats.layers++;
+	cache->stats.misses++;
+	load_texture_layer_async(cache->loader, array, layer, canonical);
+	return layer;
+}
+
+
+bool texture_ready(const TEXTURE_CACHE *cache, TEXTURE_REF ref) {
+	return ref.id >= 0 && cache->textures[ref.id].width > 0;
+}
+
+
+unsigned int get_cached_texture(const TEXTURE_CACHE *cache, TEXTURE_REF ref) {
+	return ref.id >= 0 ? cache->textures[ref.id].texture : 0;
+}
+
+
+void bind_cached_texture(const TEXTURE_CACHE *cache, TEXTURE_REF ref, int unit) {
+	glActiveTexture(GL_TEXTURE0 + unit);
+	glBindTexture(GL_TEXTURE_2D, get_cached_texture(cache, ref));
+	glBindSampler(unit, ref.id >= 0 ? ref.sampler : 0);
+}
+
+
+TEXTURE_CACHE_STATS get_texture_cache_stats(const TEXTURE_CACHE *cache) {
+	TEXTURE_CACHE_STATS stats = cache->stats;
+	stats.samplers = (int)cache->samplers->samplers.size();
+	return stats;
+}
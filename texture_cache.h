@@ -0,0 +1,71 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "asset_loader.h"
+#include "sampler.h"
+
+typedef struct {
+	unsigned int texture;	// 0 for a free entry
+	unsigned int serial;	// tells a reused entry from the one a load was started for
+	std::string path;		// canonical
+	int refs;
+	int width;				// 0 until the pixels land
+	int height;
+} CACHED_TEXTURE;
+
+// what a material holds: the shared pixels and the shared sampler state
+typedef struct {
+	int id;					// -1 for none
+	unsigned int sampler;
+} TEXTURE_REF;
+
+typedef struct {
+	int textures;
+	int layers;		// texture array layers loaded by path
+	int samplers;
+	int hits;		// acquires that found the file loaded or already loading
+	int misses;		// acquires that started a load
+} TEXTURE_CACHE_STATS;
+
+// Textures loaded from files, shared by canonical path: a file is read,
+// decoded and uploaded once however many materials reference it, including
+// while that first load is still in flight. Filtering lives in sampler objects
+// from the sampler cache, so the same pixels can be sampled several ways.
+// Every acquire takes one reference on the texture and one on the sampler;
+// the GL objects go when the last reference is released. Material textures
+// that live in a texture array are shared the same way, one layer per file,
+// and keep their layer for as long as the array lives.
+typedef struct {
+	ASSET_LOADER *loader;
+	SAMPLER_CACHE *samplers;
+	std::vector<CACHED_TEXTURE> textures;
+	std::unordered_map<std::string, int> by_path;
+	TEXTURE_ARRAY *array;	// the one array layers are loaded into, NULL until the first
+	std::unordered_map<std::string, int> layers_by_path;
+	unsigned int next_serial;
+	TEXTURE_CACHE_STATS stats;
+} TEXTURE_CACHE;
+
+
+void init_texture_cache(TEXTURE_CACHE *cache, ASSET_LOADER *loader, SAMPLER_CACHE *samplers);
+// GL thread; call after shutdown_asset_loader
+void destroy_texture_cache(TEXTURE_CACHE *cache);
+
+// GL thread: the texture exists at once and is incomplete (samples black)
+// until its pixels land
+TEXTURE_REF acquire_texture(TEXTURE_CACHE *cache, const char *path, const SAMPLER_DESC *sampler);
+void release_texture(TEXTURE_CACHE *cache, TEXTURE_REF ref);
+// the file's layer in array, reserved and loaded on first use; -1 once the
+// array is full. Every call must pass the same array
+int acquire_texture_layer(TEXTURE_CACHE *cache, TEXTURE_ARRAY *array, const char *path);
+
+bool texture_ready(const TEXTURE_CACHE *cache, TEXTURE_REF ref);
+unsigned int get_cached_texture(const TEXTURE_CACHE *cache, TEXTURE_REF ref);
+void bind_cached_texture(const TEXTURE_CACHE *cache, TEXTURE_REF ref, int unit);
+TEXTURE_CACHE_STATS get_texture_cache_stats(const TEXTURE_CACHE *cache);
+
+#endif
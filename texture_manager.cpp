@@ -0,0 +1,280 @@
+#include "texture_manager.h"
+#include <glad/glad.h>
+#include <stdio.h>
+
+#include "texture.h"
+
+
+static size_t resident_bytes(const MANAGED_TEXTURE *texture) {
+	size_t bytes = 0;
+	for (int level = texture->base_level; level < texture->levels; level++) {
+		bytes += texture->level_bytes[level];
+	}
+	return bytes;
+}
+
+
+static void set_texture_size(MANAGED_TEXTURE *texture, const MIP_CHAIN *chain) {
+	texture->width = chain->width[0];
+	texture->height = chain->height[0];
+	texture->levels = chain->levels;
+	texture->min_base_level = 0;
+	for (int level = 0; level < chain->levels; level++) {
+		texture->level_bytes[level] = (size_t)chain->width[level] * chain->height[level] * 4;
+		int size = chain->width[level] > chain->height[level] ? chain->width[level] : chain->height[level];
+		if (size >= TEXTURE_MIN_RESIDENT_SIZE) {
+			texture->min_base_level = level;
+		}
+	}
+}
+
+
+// reserved is what the caller counted this load as against the budget
+static ASSET_TASK stream_texture_async(TEXTURE_MANAGER *manager, int id, unsigned int serial, std::string path,
+		size_t reserved) {
+	manager->textures[id].streaming = true;
+	ASSET_LOADER *loader = manager->loader;
+	// the first load counts towards assets_resident, restores later on do not
+	bool first_load = manager->textures[id].levels == 0;
+	if (first_load) {
+		loader->pending.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	FILE_READ file = co_await read_file_async(loader, path.c_str());
+	MIP_CHAIN chain;
+	MIP_BUILD build = { &chain, NULL, 0, 0, 0, false };
+	OWNED_PIXELS pixels(NULL, free_texture_pixels);
+	if (file.error) {
+		fprintf(stderr, "Failed to load texture %s\n", path.c_str());
+	} else {
+		pixels.reset(decode_texture(file.data, (int)file.size, &build.width, &build.height, &build.channels));
+		if (!pixels) {
+			fprintf(stderr, "Failed to decode texture %s\n", path.c_str());
+		}
+	}
+	release_file_read(&loader->reader, &file);
+
+	if (pixels) {
+		build.pixels = pixels.get();
+		co_await run_on_workers(loader, build_mip_chain_job, &build);
+		pixels.reset();
+	}
+	bool decoded = build.built;
+
+	co_await resume_on_gl_thread(loader);
+	manager->reserved_bytes -= reserved;
+	MANAGED_TEXTURE *texture = &manager->textures[id];
+	// a load released while in flight is dropped
+	if (texture->serial == serial) {
+		texture->streaming = false;
+		if (decoded) {
+			size_t before = resident_bytes(texture);
+			glBindTexture(GL_TEXTURE_2D, texture->texture);
+			if (texture->levels == 0) {
+				set_texture_size(texture, &chain);
+				upload_mip_chain(&chain);
+			} else {
+				// the levels below base_level never left
+				for (int level = 0; level < texture->base_level; level++) {
+					glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, chain.width[level], chain.height[level], 0,
+							GL_RGBA, GL_UNSIGNED_BYTE, get_mip_level(&chain, level));
+				}
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+			}
+
+			texture->base_level = 0;
+			size_t after = resident_bytes(texture);
+			manager->stats.resident_bytes += after - before;
+			manager->stats.streamed_bytes += after - before;
+		}
+	}
+	if (first_load) {
+		finish_asset(loader);
+	}
+}
+
+
+void init_texture_manager(TEXTURE_MANAGER *manager, ASSET_LOADER *loader, size_t budget) {
+	manager->loader = loader;
+	manager->textures.clear();
+	manager->frame = 0;
+	manager->next_serial = 0;
+	manager->reserved_bytes = 0;
+	manager->stats = {};
+	manager->stats.budget = budget;
+	manager->last_frame = manager->stats;
+}
+
+
+void destroy_texture_manager(TEXTURE_MANAGER *manager) {
+	for (MANAGED_TEXTURE &texture : manager->textures) {
+		if (texture.texture) {
+			glDeleteTextures(1, &texture.texture);
+		}
+	}
+	manager->textures.clear();
+	manager->stats.resident_bytes = 0;
+	manager->stats.textures = 0;
+}
+
+
+int load_managed_texture(TEXTURE_MANAGER *manager, const char *path) {
+	int id = -1;
+	for (size_t i = 0; i < manager->textures.size(); i++) {
+		if (!manager->textures[i].texture) {
+			id = (int)i;
+			break;
+		}
+	}
+	if (id < 0) {
+		id = (int)manager->textures.size();
+		manager->textures.emplace_back();
+	}
+
+	MANAGED_TEXTURE *texture = &manager->textures[id];
+	glGenTextures(1, &texture->texture);
+	glBindTexture(GL_TEXTURE_2D, texture->texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	texture->path = path;
+	texture->width = 0;
+	texture->height = 0;
+	texture->levels = 0;
+	texture->base_level = 0;
+	texture->min_base_level = 0;
+	texture->last_used = manager->frame;
+	texture->streaming = false;
+	texture->serial = ++manager->next_serial;
+	manager->stats.textures++;
+
+	stream_texture_async(manager, id, texture->serial, texture->path, 0);
+	return id;
+}
+
+
+void release_managed_texture(TEXTURE_MANAGER *manager, int id) {
+	MANAGED_TEXTURE *texture = &manager->textures[id];
+	if (!texture->texture) {
+		return;
+	}
+	manager->stats.resident_bytes -= resident_bytes(texture);
+	manager->stats.textures--;
+	glDeleteTextures(1, &texture->texture);
+	texture->texture = 0;
+	texture->serial = 0;
+	texture->levels = 0;
+	texture->path.clear();
+}
+
+
+unsigned int get_managed_texture(const TEXTURE_MANAGER *manager, int id) {
+	return manager->textures[id].texture;
+}
+
+
+unsigned int use_managed_texture(TEXTURE_MANAGER *manager, int id) {
+	MANAGED_TEXTURE *texture = &manager->textures[id];
+	texture->last_used = manager->frame;
+	return texture->texture;
+}
+
+
+// releases the largest resident level; the chain below it stays complete
+static void drop_top_level(TEXTURE_MANAGER *manager, MANAGED_TEXTURE *texture) {
+	int level = texture->base_level;
+	glBindTexture(GL_TEXTURE_2D, texture->texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level + 1);
+	glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+	texture->base_level++;
+	manager->stats.resident_bytes -= texture->level_bytes[level];
+	manager->stats.evicted_bytes += texture->level_bytes[level];
+	manager->stats.evictions++;
+}
+
+
+// least recently used texture that can still lose a level and was not used
+// since the given frame, or NULL
+static MANAGED_TEXTURE *find_eviction_candidate(TEXTURE_MANAGER *manager, int used_before) {
+	MANAGED_TEXTURE *best = NULL;
+	for (MANAGED_TEXTURE &texture : manager->textures) {
+		if (!texture.texture || texture.streaming || !texture.levels
+				|| texture.base_level >= texture.min_base_level || texture.last_used >= used_before) {
+			continue;
+		}
+		if (!best || texture.last_used < best->last_used
+				|| (texture.last_used == best->last_used && texture.level_bytes[texture.base_level]
+					> best->level_bytes[best->base_level])) {
+			best = &texture;
+		}
+	}
+	return best;
+}
+
+
+void update_texture_residency(TEXTURE_MANAGER *manager) {
+	TEXTURE_RESIDENCY_STATS *stats = &manager->stats;
+
+	// over budget: textures the last frame did not use give up their top level
+	while (stats->resident_bytes > stats->budget) {
+		MANAGED_TEXTURE *victim = find_eviction_candidate(manager, manager->frame);
+		if (!victim) {
+			break;
+		}
+		drop_top_level(manager, victim);
+	}
+
+	// used textures missing levels come back while there is room, making room
+	// from cold textures if needed
+	int restores = 0;
+	for (size_t i = 0; i < manager->textures.size() && restores < TEXTURE_RESTORES_PER_FRAME; i++) {
+		MANAGED_TEXTURE *texture = &manager->textures[i];
+		if (!texture->texture || texture->streaming || !texture->levels || !texture->base_level
+				|| texture->last_used != manager->frame) {
+			continue;
+		}
+
+		size_t missing = 0;
+		for (int level = 0; level < texture->base_level; level++) {
+			missing += texture->level_bytes[level];
+		}
+		// loads already in flight count as resident
+		while (stats->resident_bytes + manager->reserved_bytes + missing > stats->budget) {
+			MANAGED_TEXTURE *victim = find_eviction_candidate(manager, manager->frame);
+			if (!victim) {
+				break;
+			}
+			drop_top_level(manager, victim);
+		}
+		if (stats->resident_bytes + manager->reserved_bytes + missing > stats->budget) {
+			continue;
+		}
+
+		manager->reserved_bytes += missing;
+		stream_texture_async(manager, (int)i, texture->serial, texture->path, missing);
+		restores++;
+	}
+
+	manager->last_frame = *stats;
+	stats->evictions = 0;
+	stats->evicted_bytes = 0;
+	stats->streamed_bytes = 0;
+	manager->frame++;
+}
+
+
+// the per-frame counters cover the span up to the last update_texture_residency
+TEXTURE_RESIDENCY_STATS get_texture_residency_stats(const TEXTURE_MANAGER *manager) {
+	TEXTURE_RESIDENCY_STATS stats = manager->last_frame;
+	stats.resident_bytes = manager->stats.resident_bytes;
+	stats.textures = manager->stats.textures;
+	return stats;
+}
+
+
+void set_texture_budget(TEXTURE_MANAGER *manager, size_t budget) {
+	manager->stats.budget = budget;
+}
@@ -0,0 +1,75 @@
+#ifndef TEXTURE_MANAGER_H
+#define TEXTURE_MANAGER_H
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include "asset_loader.h"
+#include "mipmap.h"
+
+// default texture manager values
+const size_t TEXTURE_BUDGET				= 256 << 20;	// bytes of texture memory
+const int TEXTURE_MIN_RESIDENT_SIZE		= 64;	// eviction never drops below a level this large
+const int TEXTURE_RESTORES_PER_FRAME	= 2;	// textures re-streamed at once
+const int MAX_TEXTURE_LEVELS			= 16;
+
+typedef struct {
+	unsigned int texture;	// 0 for a free entry
+	unsigned int serial;	// tells a reused entry from the one a load was started for
+	std::string path;
+	int width;
+	int height;
+	int levels;
+	int base_level;		// levels above this are released
+	int min_base_level;	// the deepest eviction allowed
+	int last_used;
+	bool streaming;
+	size_t level_bytes[MAX_TEXTURE_LEVELS];
+} MANAGED_TEXTURE;
+
+typedef struct {
+	size_t budget;
+	size_t resident_bytes;
+	int textures;
+	int evictions;			// levels dropped this frame
+	size_t evicted_bytes;	// this frame
+	size_t streamed_bytes;	// re-uploaded this frame
+} TEXTURE_RESIDENCY_STATS;
+
+// Owns GL_TEXTURE_2D objects loaded from files and keeps their combined size,
+// mips included, under a budget. When over budget, the least recently used
+// textures lose their largest mip level: GL_TEXTURE_BASE_LEVEL moves down and
+// the released levels are respecified as empty so the driver can free them.
+// Once such a texture is used again and the budget allows, it is decoded from
+// its file again through the asset loader and the released levels put back.
+typedef struct {
+	ASSET_LOADER *loader;
+	std::vector<MANAGED_TEXTURE> textures;
+	int frame;
+	unsigned int next_serial;
+	size_t reserved_bytes;	// restores in flight
+	TEXTURE_RESIDENCY_STATS stats;		// counters of the frame in progress
+	TEXTURE_RESIDENCY_STATS last_frame;
+} TEXTURE_MANAGER;
+
+
+void init_texture_manager(TEXTURE_MANAGER *manager, ASSET_LOADER *loader, size_t budget = TEXTURE_BUDGET);
+// GL thread; call after shutdown_asset_loader
+void destroy_texture_manager(TEXTURE_MANAGER *manager);
+
+// GL thread: creates the texture now and streams its pixels in; returns its id
+int load_managed_texture(TEXTURE_MANAGER *manager, const char *path);
+void release_managed_texture(TEXTURE_MANAGER *manager, int id);
+unsigned int get_managed_texture(const TEXTURE_MANAGER *manager, int id);
+
+// marks the texture as used this frame; returns its GL name
+unsigned int use_managed_texture(TEXTURE_MANAGER *manager, int id);
+// GL thread, once per frame after drawing: evicts down to the budget and
+// re-streams recently used textures that lost levels
+void update_texture_residency(TEXTURE_MANAGER *manager);
+TEXTURE_RESIDENCY_STATS get_texture_residency_stats(const TEXTURE_MANAGER *manager);
+// GL thread; applied by the next update_texture_residency
+void set_texture_budget(TEXTURE_MANAGER *manager, size_t budget);
+
+#endif
@@ -0,0 +1,24 @@
+// imports an OBJ or glTF model and cooks it into the mapped file load_mesh_file reads
+// usage: tools/mesh_cook <model.obj|.gltf|.glb> <output.mesh>
+#include <stdio.h>
+
+#include "../job_system.h"
+#include "../mesh_import.h"
+
+
+int main(int argc, char **argv) {
+	if (argc < 3) {
+		fprintf(stderr, "usage: %s <model.obj|.gltf|.glb> <output.mesh>\n", argv[0]);
+		return 1;
+	}
+
+	// parsing, welding and tangents spread over the job system
+	init_job_system();
+	IMPORTED_MESH mesh;
+	bool cooked = import_mesh(argv[1], &mesh) && cook_mesh(&mesh, argv[2]);
+	shutdown_job_system();
+	if (cooked) {
+		printf("%s: %zu vertices, %zu triangles\n", argv[2], mesh.vertices.size(), mesh.indices.size() / 3);
+	}
+	return cooked ? 0 : 1;
+}
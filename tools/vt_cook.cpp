@@ -0,0 +1,26 @@
+// cooks an image into the tiled mip file init_virtual_texture streams from
+// usage: tools/vt_cook <image> <output.vtex> [tile_size]
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../job_system.h"
+#include "../virtual_texture.h"
+
+
+int main(int argc, char **argv) {
+	if (argc < 3) {
+		fprintf(stderr, "usage: %s <image> <output.vtex> [tile_size]\n", argv[0]);
+		return 1;
+	}
+
+	int tile_size = argc > 3 ? atoi(argv[3]) : VT_TILE_SIZE;
+	if (tile_size <= 0) {
+		fprintf(stderr, "ERROR:VT_COOK:BAD_TILE_SIZE\n");
+		return 1;
+	}
+	// mip filtering spreads its rows over the job system
+	init_job_system();
+	bool cooked = cook_virtual_texture(argv[1], argv[2], tile_size);
+	shutdown_job_system();
+	return cooked ? 0 : 1;
+}
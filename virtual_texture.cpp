@@ -0,0 +1,437 @@
+#include "virtual_texture.h"
+#include <glad/glad.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+
+
+static int level_tiles(const VIRTUAL_TEXTURE *vt, int level) {
+	int tiles = vt->header.tiles >> level;
+	return tiles > 0 ? tiles : 1;
+}
+
+
+static int tile_key(const VIRTUAL_TEXTURE *vt, int level, int x, int y) {
+	return vt->level_first_tile[level] + y * level_tiles(vt, level) + x;
+}
+
+
+static int key_level(const VIRTUAL_TEXTURE *vt, int key) {
+	int level = 0;
+	while (level + 1 < vt->header.levels && key >= vt->level_first_tile[level + 1]) {
+		level++;
+	}
+	return level;
+}
+
+
+static int slot_size(const VIRTUAL_TEXTURE *vt) {
+	return vt->header.tile_size + 2 * vt->header.border;
+}
+
+
+static bool read_tile(const VIRTUAL_TEXTURE *vt, int key, unsigned char *data) {
+	off_t offset = (off_t)sizeof(VT_FILE_HEADER) + (off_t)key * (off_t)vt->tile_bytes;
+	size_t done = 0;
+	while (done < vt->tile_bytes) {
+		ssize_t got = pread(vt->fd, data + done, vt->tile_bytes - done, offset + (off_t)done);
+		if (got <= 0) {
+			return false;
+		}
+		done += (size_t)got;
+	}
+	return true;
+}
+
+
+static void upload_tile(VIRTUAL_TEXTURE *vt, int slot, int key, const unsigned char *data) {
+	int size = slot_size(vt);
+	glBindTexture(GL_TEXTURE_2D, vt->cache_texture);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, (slot % vt->cache_slots_x) * size, (slot / vt->cache_slots_x) * size,
+			size, size, GL_RGBA, GL_UNSIGNED_BYTE, data);
+
+	vt->slots[slot].key = key;
+	vt->slots[slot].last_used = vt->frame;
+	vt->tile_slot[key] = slot;
+	vt->indirection_dirty = true;
+	vt->stats.resident_tiles++;
+	vt->stats.uploaded_tiles++;
+	vt->stats.streamed_bytes += (long long)vt->tile_bytes;
+}
+
+
+// a free slot, else the least recently used one the current feedback did not ask for
+static int acquire_slot(VIRTUAL_TEXTURE *vt) {
+	int best = -1;
+	int oldest = INT_MAX;
+	for (size_t i = 0; i < vt->slots.size(); i++) {
+		const VT_SLOT &slot = vt->slots[i];
+		if (slot.key < 0) {
+			return (int)i;
+		}
+		if (slot.last_used < vt->frame && slot.last_used < oldest) {
+			best = (int)i;
+			oldest = slot.last_used;
+		}
+	}
+	if (best >= 0) {
+		vt->tile_slot[vt->slots[best].key] = -1;
+		vt->slots[best].key = -1;
+		vt->indirection_dirty = true;
+		vt->stats.resident_tiles--;
+		vt->stats.evicted_tiles++;
+	}
+	return best;
+}
+
+
+// every entry names the slot of its own tile, or inherits its parent's entry
+static void rebuild_indirection(VIRTUAL_TEXTURE *vt) {
+	std::vector<int> level_offset(vt->header.levels);
+	int offset = 0;
+	for (int level = 0; level < vt->header.levels; level++) {
+		level_offset[level] = offset;
+		offset += level_tiles(vt, level) * level_tiles(vt, level) * 4;
+	}
+
+	for (int level = vt->header.levels - 1; level >= 0; level--) {
+		int tiles = level_tiles(vt, level);
+		uint16_t *entries = vt->indirection.data() + level_offset[level];
+		for (int y = 0; y < tiles; y++) {
+			for (int x = 0; x < tiles; x++) {
+				uint16_t *entry = entries + (y * tiles + x) * 4;
+				int slot = vt->tile_slot[tile_key(vt, level, x, y)];
+				if (slot >= 0) {
+					entry[0] = (uint16_t)(slot % vt->cache_slots_x);
+					entry[1] = (uint16_t)(slot / vt->cache_slots_x);
+					entry[2] = (uint16_t)level;
+					entry[3] = 1;
+				} else {
+					// the top level is pinned, so a parent always exists here
+					int parent_tiles = level_tiles(vt, level + 1);
+					const uint16_t *parent = vt->indirection.data() + level_offset[level + 1]
+						+ ((y >> 1) * parent_tiles + (x >> 1)) * 4;
+					memcpy(entry, parent, 4 * sizeof(uint16_t));
+				}
+			}
+		}
+	}
+
+	glBindTexture(GL_TEXTURE_2D, vt->indirection_texture);
+	for (int level = 0; level < vt->header.levels; level++) {
+		int tiles = level_tiles(vt, level);
+		glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, tiles, tiles, GL_RGBA_INTEGER, GL_UNSIGNED_SHORT,
+				vt->indirection.data() + level_offset[level]);
+	}
+	vt->indirection_dirty = false;
+}
+
+
+static ASSET_TASK load_tile_async(VIRTUAL_TEXTURE *vt, int key) {
+	vt->tile_loading[key] = 1;
+	vt->in_flight++;
+
+	std::vector<unsigned char> data(vt->tile_bytes);
+	co_await resume_on_io_thread(vt->loader);
+	bool loaded = read_tile(vt, key, data.data());
+
+	co_await resume_on_gl_thread(vt->loader);
+	vt->tile_loading[key] = 0;
+	vt->in_flight--;
+	if (!loaded) {
+		fprintf(stderr, "ERROR:VIRTUAL_TEXTURE:TILE_READ_FAILED %d\n", key);
+		co_return;
+	}
+
+	int slot = acquire_slot(vt);
+	if (slot >= 0) {
+		upload_tile(vt, slot, key, data.data());
+	}
+}
+
+
+bool init_virtual_texture(VIRTUAL_TEXTURE *vt, ASSET_LOADER *loader, const char *path, size_t cache_budget) {
+	vt->fd = open(path, O_RDONLY);
+	if (vt->fd < 0) {
+		fprintf(stderr, "ERROR:VIRTUAL_TEXTURE:OPEN_FAILED %s\n", path);
+		return false;
+	}
+	if (pread(vt->fd, &vt->header, sizeof(vt->header), 0) != (ssize_t)sizeof(vt->header)
+			|| memcmp(vt->header.magic, VT_MAGIC, sizeof(VT_MAGIC)) != 0
+			|| vt->header.tiles <= 0 || vt->header.levels <= 0 || vt->header.tile_size <= 0) {
+		fprintf(stderr, "ERROR:VIRTUAL_TEXTURE:BAD_HEADER %s\n", path);
+		close(vt->fd);
+		return false;
+	}
+
+	vt->loader = loader;
+	vt->tile_bytes = (size_t)slot_size(vt) * slot_size(vt) * 4;
+	vt->level_first_tile.resize(vt->header.levels);
+	int tile_count = 0;
+	for (int level = 0; level < vt->header.levels; level++) {
+		vt->level_first_tile[level] = tile_count;
+		tile_count += level_tiles(vt, level) * level_tiles(vt, level);
+	}
+	// the indirection has exactly one texel per tile
+	vt->tile_slot.assign(tile_count, -1);
+	vt->tile_loading.assign(tile_count, 0);
+	vt->indirection.assign((size_t)tile_count * 4, 0);
+
+	// the cache is the largest square grid of slots that fits the budget
+	int max_size;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+	int side = (int)sqrt((double)cache_budget / (double)vt->tile_bytes);
+	if (side < 2) side = 2;
+	if (side * slot_size(vt) > max_size) side = max_size / slot_size(vt);
+	vt->cache_slots_x = side;
+	vt->cache_slots_y = side;
+	vt->slots.assign(side * side, { -1, 0 });
+
+	glGenTextures(1, &vt->cache_texture);
+	glBindTexture(GL_TEXTURE_2D, vt->cache_texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, side * slot_size(vt), side * slot_size(vt), 0,
+			GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+	// integer texture, so nearest only; one mip per tile level
+	glGenTextures(1, &vt->indirection_texture);
+	glBindTexture(GL_TEXTURE_2D, vt->indirection_texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, vt->header.levels - 1);
+	for (int level = 0; level < vt->header.levels; level++) {
+		glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA16UI, level_tiles(vt, level), level_tiles(vt, level), 0,
+				GL_RGBA_INTEGER, GL_UNSIGNED_SHORT, NULL);
+	}
+
+	vt->feedback_fbo = 0;
+	vt->feedback_color = 0;
+	vt->feedback_depth = 0;
+	vt->feedback_width = 0;
+	vt->feedback_height = 0;
+	vt->feedback_pbo[0] = vt->feedback_pbo[1] = 0;
+	vt->feedback_pixels[0] = vt->feedback_pixels[1] = 0;
+	vt->feedback_write = 0;
+	vt->in_flight = 0;
+	vt->frame = 1;
+	vt->stats = {};
+
+	// pin the single top tile so every lookup has somewhere to land
+	int top = tile_key(vt, vt->header.levels - 1, 0, 0);
+	std::vector<unsigned char> data(vt->tile_bytes);
+	if (!read_tile(vt, top, data.data())) {
+		fprintf(stderr, "ERROR:VIRTUAL_TEXTURE:TILE_READ_FAILED %d\n", top);
+		destroy_virtual_texture(vt);
+		return false;
+	}
+	upload_tile(vt, 0, top, data.data());
+	vt->slots[0].last_used = INT_MAX;
+	rebuild_indirection(vt);
+	return true;
+}
+
+
+void destroy_virtual_texture(VIRTUAL_TEXTURE *vt) {
+	glDeleteTextures(1, &vt->cache_texture);
+	glDeleteTextures(1, &vt->indirection_texture);
+	if (vt->feedback_fbo) {
+		glDeleteFramebuffers(1, &vt->feedback_fbo);
+		glDeleteRenderbuffers(1, &vt->feedback_color);
+		glDeleteRenderbuffers(1, &vt->feedback_depth);
+		glDeleteBuffers(2, vt->feedback_pbo);
+	}
+	vt->feedback_fbo = 0;
+	vt->cache_texture = 0;
+	vt->indirection_texture = 0;
+	if (vt->fd >= 0) {
+		close(vt->fd);
+		vt->fd = -1;
+	}
+}
+
+
+static void resize_feedback(VIRTUAL_TEXTURE *vt, int width, int height) {
+	if (!vt->feedback_fbo) {
+		glGenFramebuffers(1, &vt->feedback_fbo);
+		glGenRenderbuffers(1, &vt->feedback_color);
+		glGenRenderbuffers(1, &vt->feedback_depth);
+		glGenBuffers(2, vt->feedback_pbo);
+	}
+
+	glBindRenderbuffer(GL_RENDERBUFFER, vt->feedback_color);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA16UI, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, vt->feedback_depth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, vt->feedback_fbo);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, vt->feedback_color);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, vt->feedback_depth);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		fprintf(stderr, "ERROR:VIRTUAL_TEXTURE:FEEDBACK_INCOMPLETE\n");
+	}
+
+	for (int i = 0; i < 2; i++) {
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, vt->feedback_pbo[i]);
+		glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)width * height * 4 * sizeof(uint16_t), NULL, GL_STREAM_READ);
+		vt->feedback_pixels[i] = 0;
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	vt->feedback_width = width;
+	vt->feedback_height = height;
+}
+
+
+void begin_vt_feedback(VIRTUAL_TEXTURE *vt, int viewport_width, int viewport_height) {
+	int width = viewport_width / VT_FEEDBACK_SCALE > 0 ? viewport_width / VT_FEEDBACK_SCALE : 1;
+	int height = viewport_height / VT_FEEDBACK_SCALE > 0 ? viewport_height / VT_FEEDBACK_SCALE : 1;
+	if (width != vt->feedback_width || height != vt->feedback_height) {
+		resize_feedback(vt, width, height);
+	}
+
+	glGetIntegerv(GL_VIEWPORT, vt->saved_viewport);
+	glBindFramebuffer(GL_FRAMEBUFFER, vt->feedback_fbo);
+	glViewport(0, 0, width, height);
+
+	// a zero w component marks pixels that sampled nothing
+	const GLuint no_request[4] = { 0, 0, 0, 0 };
+	glClearBufferuiv(GL_COLOR, 0, no_request);
+	glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+
+// the read lands in a PBO and is only mapped next frame, so this does not stall
+void end_vt_feedback(VIRTUAL_TEXTURE *vt) {
+	int index = vt->feedback_write;
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, vt->feedback_pbo[index]);
+	glReadPixels(0, 0, vt->feedback_width, vt->feedback_height, GL_RGBA_INTEGER, GL_UNSIGNED_SHORT, NULL);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	vt->feedback_pixels[index] = vt->feedback_width * vt->feedback_height;
+	vt->feedback_write ^= 1;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(vt->saved_viewport[0], vt->saved_viewport[1], vt->saved_viewport[2], vt->saved_viewport[3]);
+}
+
+
+// distinct tiles named by the feedback written a frame ago
+static std::vector<int> read_feedback(VIRTUAL_TEXTURE *vt) {
+	std::vector<int> requests;
+	int index = vt->feedback_write;
+	int pixels = vt->feedback_pixels[index];
+	if (!pixels) {
+		return requests;
+	}
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, vt->feedback_pbo[index]);
+	const uint16_t *texels = (const uint16_t *)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+			(GLsizeiptr)pixels * 4 * sizeof(uint16_t), GL_MAP_READ_BIT);
+	if (texels) {
+		int last = -1;
+		for (int i = 0; i < pixels; i++) {
+			const uint16_t *texel = texels + i * 4;
+			int level = texel[2];
+			if (!texel[3] || level >= vt->header.levels) {
+				continue;
+			}
+			int tiles = level_tiles(vt, level);
+			if (texel[0] >= tiles || texel[1] >= tiles) {
+				continue;
+			}
+			// neighbouring pixels mostly want the same tile
+			int key = tile_key(vt, level, texel[0], texel[1]);
+			if (key != last) {
+				requests.push_back(key);
+				last = key;
+			}
+		}
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	vt->feedback_pixels[index] = 0;
+
+	std::sort(requests.begin(), requests.end());
+	requests.erase(std::unique(requests.begin(), requests.end()), requests.end());
+	return requests;
+}
+
+
+void update_virtual_texture(VIRTUAL_TEXTURE *vt) {
+	vt->frame++;
+	vt->stats.uploaded_tiles = 0;
+	vt->stats.evicted_tiles = 0;
+
+	std::vector<int> requests = read_feedback(vt);
+	if (!requests.empty()) {
+		vt->stats.requested_tiles = (int)requests.size();
+	}
+
+	// keep every requested tile and its ancestors warm, collect the missing ones
+	std::vector<int> missing;
+	for (int key : requests) {
+		int level = key_level(vt, key);
+		int index = key - vt->level_first_tile[level];
+		int x = index % level_tiles(vt, level);
+		int y = index / level_tiles(vt, level);
+		for (; level < vt->header.levels; level++, x >>= 1, y >>= 1) {
+			int ancestor = tile_key(vt, level, x, y);
+			int slot = vt->tile_slot[ancestor];
+			if (slot >= 0) {
+				if (vt->slots[slot].last_used != INT_MAX) vt->slots[slot].last_used = vt->frame;
+			} else if (!vt->tile_loading[ancestor]) {
+				missing.push_back(ancestor);
+			}
+		}
+	}
+
+	// coarse tiles first: they cover more pixels and unblock their children's fallback
+	std::sort(missing.begin(), missing.end(), [vt](int a, int b) {
+		return key_level(vt, a) != key_level(vt, b) ? key_level(vt, a) > key_level(vt, b) : a < b;
+	});
+	missing.erase(std::unique(missing.begin(), missing.end()), missing.end());
+	for (int key : missing) {
+		if (vt->in_flight >= VT_MAX_IN_FLIGHT) {
+			break;
+		}
+		load_tile_async(vt, key);
+	}
+
+	if (vt->indirection_dirty) {
+		rebuild_indirection(vt);
+	}
+}
+
+
+void bind_virtual_texture(const VIRTUAL_TEXTURE *vt, unsigned int program, int cache_unit, int indirection_unit) {
+	glActiveTexture(GL_TEXTURE0 + cache_unit);
+	glBindTexture(GL_TEXTURE_2D, vt->cache_texture);
+	glActiveTexture(GL_TEXTURE0 + indirection_unit);
+	glBindTexture(GL_TEXTURE_2D, vt->indirection_texture);
+
+	float virtual_size = (float)vt->header.tiles * vt->header.tile_size;
+	glUseProgram(program);
+	glUniform1i(glGetUniformLocation(program, "vtCache"), cache_unit);
+	glUniform1i(glGetUniformLocation(program, "vtIndirection"), indirection_unit);
+	glUniform2f(glGetUniformLocation(program, "vtUvScale"),
+			vt->header.image_width / virtual_size, vt->header.image_height / virtual_size);
+	glUniform1f(glGetUniformLocation(program, "vtVirtualSize"), virtual_size);
+	glUniform1i(glGetUniformLocation(program, "vtLevels"), vt->header.levels);
+	glUniform1f(glGetUniformLocation(program, "vtTileSize"), (float)vt->header.tile_size);
+	glUniform1f(glGetUniformLocation(program, "vtBorder"), (float)vt->header.border);
+	glUniform1f(glGetUniformLocation(program, "vtCacheSize"), (float)vt->cache_slots_x * slot_size(vt));
+	glUniform1f(glGetUniformLocation(program, "vtFeedbackBias"), log2f((float)VT_FEEDBACK_SCALE));
+}
+
+
+VT_STATS get_vt_stats(const VIRTUAL_TEXTURE *vt) {
+	return vt->stats;
+}
@@ -0,0 +1,110 @@
+#ifndef VIRTUAL_TEXTURE_H
+#define VIRTUAL_TEXTURE_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "asset_loader.h"
+
+// default virtual texture values
+const int VT_TILE_SIZE			= 128;	// texels of image data per tile side
+const int VT_TILE_BORDER		= 4;	// texels borrowed from each neighbour, for bilinear and aniso taps
+const size_t VT_CACHE_BUDGET	= 32 << 20;	// bytes of physical tile cache
+const int VT_FEEDBACK_SCALE		= 8;	// feedback buffer is the viewport divided by this
+const int VT_MAX_IN_FLIGHT		= 32;	// tile reads outstanding at once
+const char VT_MAGIC[4]			= { 'V', 'T', 'E', 'X' };
+
+// Cooked tile file: this header, then every tile of every mip level, level 0
+// first and row-major within a level. Each tile is a fixed-size RGBA8 block of
+// (tile + 2 * border)^2 texels, so a tile is found by index alone. The image is
+// padded by edge clamping to a square power-of-two number of tiles, which keeps
+// every level's tile grid equal to the indirection texture's mip sizes.
+typedef struct {
+	char magic[4];
+	int32_t image_width;
+	int32_t image_height;
+	int32_t tile_size;
+	int32_t border;
+	int32_t tiles;		// per side at level 0, a power of two
+	int32_t levels;		// down to a single tile
+} VT_FILE_HEADER;
+
+typedef struct {
+	int resident_tiles;
+	int requested_tiles;	// distinct tiles seen in the last feedback
+	int uploaded_tiles;		// this frame
+	int evicted_tiles;		// this frame
+	long long streamed_bytes;	// total
+} VT_STATS;
+
+typedef struct {
+	int32_t key;		// tile currently held, -1 when free
+	int last_used;		// frame the feedback last asked for it
+} VT_SLOT;
+
+// Image data lives on disk as tiles; only the tiles the last frames actually
+// sampled are kept in a fixed-size physical cache texture. An indirection
+// texture, one texel per tile with a mip per level, maps every virtual tile to
+// the cache slot of itself or of its nearest resident ancestor, so missing
+// tiles fall back to a blurrier level instead of stalling. A low resolution
+// feedback pass writes the tile each pixel wants; it is read back a frame late
+// through a PBO and drives the streaming, which runs on the loader's I/O threads.
+typedef struct {
+	int fd;
+	VT_FILE_HEADER header;
+	size_t tile_bytes;
+	std::vector<int> level_first_tile;	// index of each level's first tile in the file
+
+	// physical cache
+	unsigned int cache_texture;
+	int cache_slots_x;
+	int cache_slots_y;
+	std::vector<VT_SLOT> slots;
+
+	// page table: cache slot per tile or -1, plus the flattened indirection it produces
+	std::vector<int> tile_slot;
+	std::vector<char> tile_loading;
+	unsigned int indirection_texture;
+	std::vector<uint16_t> indirection;	// RGBA16UI texels, all levels back to back
+	bool indirection_dirty;
+
+	// feedback
+	unsigned int feedback_fbo;
+	unsigned int feedback_color;
+	unsigned int feedback_depth;
+	int feedback_width;
+	int feedback_height;
+	unsigned int feedback_pbo[2];
+	int feedback_pixels[2];	// texels waiting in each pbo, 0 once consumed
+	int feedback_write;		// pbo the next feedback pass reads back into
+	int saved_viewport[4];
+
+	ASSET_LOADER *loader;
+	int in_flight;
+	int frame;
+	VT_STATS stats;
+} VIRTUAL_TEXTURE;
+
+
+// offline: decode an image, build its mip chain and write it out as tiles
+bool cook_virtual_texture(const char *image_path, const char *out_path,
+		int tile_size = VT_TILE_SIZE, int border = VT_TILE_BORDER);
+
+// GL thread; the coarsest level is read immediately and pinned, so sampling is
+// always valid. Call destroy_virtual_texture after shutdown_asset_loader
+bool init_virtual_texture(VIRTUAL_TEXTURE *vt, ASSET_LOADER *loader, const char *path,
+		size_t cache_budget = VT_CACHE_BUDGET);
+void destroy_virtual_texture(VIRTUAL_TEXTURE *vt);
+
+// GL thread: draw the virtual textured geometry with shaders/vt_feedback.frag in between
+void begin_vt_feedback(VIRTUAL_TEXTURE *vt, int viewport_width, int viewport_height);
+void end_vt_feedback(VIRTUAL_TEXTURE *vt);
+// GL thread, once per frame: reads last frame's feedback, queues missing tiles
+// and uploads the indirection if tiles arrived or left
+void update_virtual_texture(VIRTUAL_TEXTURE *vt);
+
+// sets the vt* uniforms of a program using shaders/virtual_texture.frag or vt_feedback.frag
+void bind_virtual_texture(const VIRTUAL_TEXTURE *vt, unsigned int program, int cache_unit, int indirection_unit);
+VT_STATS get_vt_stats(const VIRTUAL_TEXTURE *vt);
+
+#endif
@@ -0,0 +1,120 @@
+#include "virtual_texture.h"
+#include <stdio.h>
+#include <string.h>
+
+#include "image_decoder.h"
+#include "mipmap.h"
+
+// kept apart from virtual_texture.cpp so offline tools can cook without a GL context
+
+
+static bool write_level(FILE *file, const unsigned char *level, int size, int tile_size, int border) {
+	int tiles = size / tile_size;
+	int slot = tile_size + 2 * border;
+	std::vector<unsigned char> tile((size_t)slot * slot * 4);
+
+	for (int ty = 0; ty < tiles; ty++) {
+		for (int tx = 0; tx < tiles; tx++) {
+			// the border repeats neighbouring tiles' texels, clamped at the level's edge
+			for (int y = 0; y < slot; y++) {
+				int src_y = ty * tile_size + y - border;
+				if (src_y < 0) src_y = 0;
+				if (src_y >= size) src_y = size - 1;
+				for (int x = 0; x < slot; x++) {
+					int src_x = tx * tile_size + x - border;
+					if (src_x < 0) src_x = 0;
+					if (src_x >= size) src_x = size - 1;
+					memcpy(&tile[((size_t)y * slot + x) * 4], &level[((size_t)src_y * size + src_x) * 4], 4);
+				}
+			}
+			if (fwrite(tile.data(), 1, tile.size(), file) != tile.size()) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+
+static bool read_image_file(const char *path, std::vector<unsigned char> *data) {
+	FILE *file = fopen(path, "rb");
+	if (!file) {
+		return false;
+	}
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	data->resize(size > 0 ? size : 0);
+	bool read = size > 0 && fread(data->data(), 1, data->size(), file) == data->size();
+	fclose(file);
+	return read;
+}
+
+
+bool cook_virtual_texture(const char *image_path, const char *out_path, int tile_size, int border) {
+	// cooked images are the large ones the restart-parallel decode is for; the
+	// decoders hand back the bottom row first like the textures make_texture uploads
+	std::vector<unsigned char> encoded;
+	DECODED_IMAGE image;
+	if (!read_image_file(image_path, &encoded) || !decode_image(encoded.data(), encoded.size(), &image)) {
+		fprintf(stderr, "ERROR:VIRTUAL_TEXTURE:DECODE_FAILED %s\n", image_path);
+		return false;
+	}
+	encoded.clear();
+	encoded.shrink_to_fit();
+	int width = image.width, height = image.height, channels = image.channels;
+
+	int longest = width > height ? width : height;
+	int needed = (longest + tile_size - 1) / tile_size;
+	int tiles = 1;
+	int levels = 1;
+	while (tiles < needed) {
+		tiles *= 2;
+		levels++;
+	}
+
+	// pad to the square virtual size by clamping to the image edge
+	int size = tiles * tile_size;
+	std::vector<unsigned char> padded((size_t)size * size * channels);
+	for (int y = 0; y < size; y++) {
+		int src_y = y < height ? y : height - 1;
+		for (int x = 0; x < size; x++) {
+			int src_x = x < width ? x : width - 1;
+			memcpy(&padded[((size_t)y * size + x) * channels], &image.pixels[((size_t)src_y * width + src_x) * channels],
+					channels);
+		}
+	}
+	free_decoded_image(&image);
+
+	// offline, so spend the time on the sharper filter; the chain expands to RGBA
+	MIP_CHAIN chain;
+	build_mip_chain(&chain, padded.data(), size, size, channels, MIP_KAISER);
+	padded.clear();
+	padded.shrink_to_fit();
+
+	FILE *file = fopen(out_path, "wb");
+	if (!file) {
+		fprintf(stderr, "ERROR:VIRTUAL_TEXTURE:OPEN_FAILED %s\n", out_path);
+		return false;
+	}
+
+	VT_FILE_HEADER header;
+	memcpy(header.magic, VT_MAGIC, sizeof(VT_MAGIC));
+	header.image_width = width;
+	header.image_height = height;
+	header.tile_size = tile_size;
+	header.border = border;
+	header.tiles = tiles;
+	header.levels = levels;
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+
+	for (int level = 0; level < levels && written; level++) {
+		written = write_level(file, get_mip_level(&chain, level), chain.width[level], tile_size, border);
+	}
+
+	if (fclose(file) != 0 || !written) {
+		fprintf(stderr, "ERROR:VIRTUAL_TEXTURE:WRITE_FAILED %s\n", out_path);
+		return false;
+	}
+	return true;
+}